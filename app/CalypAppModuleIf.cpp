@@ -25,6 +25,9 @@
 #include "CalypAppModuleIf.h"
 
 #include "VideoSubWindow.h"
+#include "lib/CalypMemory.h"
+#include "lib/CalypStats.h"
+#include "lib/CalypTrace.h"
 
 #include <QAction>
 #include <QApplication>
@@ -115,6 +118,7 @@ bool CalypAppModuleIf::apply( bool isPlaying, bool disableThreads )
 
 void CalypAppModuleIf::run()
 {
+  CalypTraceScope cTrace( "CalypAppModuleIf::run" );
   m_bIsRunning = true;
   m_bSuccess = false;
   std::vector<CalypFrame*> apcFrameList;
@@ -123,6 +127,8 @@ void CalypAppModuleIf::run()
     apcFrameList.push_back( m_pcSubWindow[i]->getCurrFrame() );
   }
 
+  CalypStatsTimer cStatsTimer( CLP_STATS_MODULE );
+  CalypMemoryScope cMemoryScope( CLP_MEMORY_MODULE );
   if( m_pcModule->m_iModuleType == CLP_FRAME_PROCESSING_MODULE )
   {
     if( m_pcModule->m_iModuleAPI >= CLP_MODULE_API_2 )
@@ -34,6 +34,7 @@
 #include "VideoHandle.h"
 #include "VideoSubWindow.h"
 #include "lib/CalypOptions.h"
+#include "lib/CalypTrace.h"
 
 #include <QAction>
 #include <QActionGroup>
@@ -136,6 +137,26 @@ void MainWindow::about()
   m_pcAboutDialog->exec();
 }
 
+void MainWindow::toggleTrace( bool checked )
+{
+  if( checked )
+  {
+    QString fileName = QFileDialog::getSaveFileName( this, tr( "Save Trace" ), m_cLastOpenPath + "/calyp_trace.json",
+                                                     tr( "Chrome trace (*.json)" ) );
+    if( fileName.isEmpty() )
+    {
+      m_arrayActions[TRACE_ACT]->setChecked( false );
+      return;
+    }
+    CalypTrace::start( fileName.toStdString() );
+    printMessage( "Recording trace into " + fileName, CLP_LOG_INFO );
+  }
+  else if( !CalypTrace::stop() )
+  {
+    QMessageBox::warning( this, QApplication::applicationName(), tr( "Cannot write the trace file" ) );
+  }
+}
+
 void MainWindow::closeEvent( QCloseEvent* event )
 {
   int mayCloseAll = true;
@@ -747,6 +768,12 @@ void MainWindow::createActions()
            SLOT( CheckForUpdatesNotSilent() ) );
 #endif
 
+  m_arrayActions[TRACE_ACT] = new QAction( tr( "Record &Trace" ), this );
+  m_arrayActions[TRACE_ACT]->setCheckable( true );
+  m_arrayActions[TRACE_ACT]->setChecked( CalypTrace::isEnabled() );
+  m_arrayActions[TRACE_ACT]->setStatusTip( tr( "Record the timing of reading, processing and painting frames (Chrome trace)" ) );
+  connect( m_arrayActions[TRACE_ACT], SIGNAL( triggered( bool ) ), this, SLOT( toggleTrace( bool ) ) );
+
   m_arrayActions[ABOUT_ACT] = new QAction( tr( "&About" ), this );
   m_arrayActions[ABOUT_ACT]->setIcon( QIcon( ":logos/calyp-icon.png" ) );
   m_arrayActions[ABOUT_ACT]->setStatusTip( tr( "Show the application's About box" ) );
@@ -815,6 +842,7 @@ void MainWindow::createMenus()
 #ifdef USE_FERVOR
   m_arrayMenu[ABOUT_MENU]->addAction( m_arrayActions[UPDATE_ACT] );
 #endif
+  m_arrayMenu[ABOUT_MENU]->addAction( m_arrayActions[TRACE_ACT] );
   m_arrayMenu[ABOUT_MENU]->addSeparator();
   m_arrayMenu[ABOUT_MENU]->addAction( m_arrayActions[ABOUT_ACT] );
   m_arrayMenu[ABOUT_MENU]->addAction( m_arrayActions[ABOUTQT_ACT] );
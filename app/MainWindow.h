@@ -85,6 +85,7 @@ protected:
 private Q_SLOTS:
 
   void about();
+  void toggleTrace( bool checked );
 
   /**
    *  File functions slots
@@ -227,6 +228,7 @@ private:
     ZOOM_FIT_ACT,
     ZOOM_FIT_ALL_ACT,
     UPDATE_ACT,
+    TRACE_ACT,
     ABOUT_ACT,
     ABOUTQT_ACT,
     TOTAL_ACT,
@@ -32,6 +32,7 @@
 #include "SubWindowSelectorDialog.h"
 #include "VideoHandle.h"
 #include "VideoSubWindow.h"
+#include "lib/CalypMemory.h"
 #include "modules/CalypModulesFactory.h"
 
 ModulesHandle::ModulesHandle( QWidget* parent, SubWindowHandle* windowManager, VideoHandle* moduleVideo )
@@ -112,7 +113,7 @@ void ModulesHandle::buildMenu()
     ModuleIfinternalName = QString::fromLocal8Bit( it->first );
 
     currSubMenu = NULL;
-    if( pcCurrModuleIf->m_iModuleAPI <= CLP_MODULE_API_2 )
+    if( pcCurrModuleIf->m_iModuleAPI != CLP_MODULE_API_3 )
     {
       if( pcCurrModuleIf->m_pchModuleCategory )
       {
@@ -425,19 +426,22 @@ void ModulesHandle::activateModule()
 
   // Create Module
   bool moduleCreated = false;
-  if( pcCurrAppModuleIf->m_pcModule->m_iModuleAPI >= CLP_MODULE_API_2 )
   {
-    std::vector<CalypFrame*> apcFrameList;
-    for( int i = 0; i < videoSubWindowList.size(); i++ )
+    CalypMemoryScope cMemoryScope( CLP_MEMORY_MODULE );
+    if( pcCurrAppModuleIf->m_pcModule->m_iModuleAPI >= CLP_MODULE_API_2 )
     {
-      apcFrameList.push_back( pcCurrAppModuleIf->m_pcSubWindow[i]->getCurrFrame() );
+      std::vector<CalypFrame*> apcFrameList;
+      for( int i = 0; i < videoSubWindowList.size(); i++ )
+      {
+        apcFrameList.push_back( pcCurrAppModuleIf->m_pcSubWindow[i]->getCurrFrame() );
+      }
+      moduleCreated = pcCurrAppModuleIf->m_pcModule->create( apcFrameList );
+    }
+    else if( pcCurrAppModuleIf->m_pcModule->m_iModuleAPI == CLP_MODULE_API_1 )
+    {
+      pcCurrAppModuleIf->m_pcModule->create( pcCurrAppModuleIf->m_pcSubWindow[0]->getCurrFrame() );
+      moduleCreated = true;
     }
-    moduleCreated = pcCurrAppModuleIf->m_pcModule->create( apcFrameList );
-  }
-  else if( pcCurrAppModuleIf->m_pcModule->m_iModuleAPI == CLP_MODULE_API_1 )
-  {
-    pcCurrAppModuleIf->m_pcModule->create( pcCurrAppModuleIf->m_pcSubWindow[0]->getCurrFrame() );
-    moduleCreated = true;
   }
 
   if( !moduleCreated )
@@ -31,6 +31,8 @@
 #include "SubWindowHandle.h"
 #include "SubWindowSelectorDialog.h"
 #include "VideoSubWindow.h"
+#include "lib/CalypMemory.h"
+#include "lib/CalypTrace.h"
 
 #include <QDockWidget>
 #include <QElapsedTimer>
@@ -52,6 +54,17 @@ VideoHandle::VideoHandle( QWidget* parent, SubWindowHandle* windowManager )
   m_pcPlayingTimer->setTimerType( Qt::PreciseTimer );
   connect( m_pcPlayingTimer, SIGNAL( timeout() ), this, SLOT( playEvent() ) );
   m_acPlayingSubWindows.clear();
+
+  m_pcStatsLabel = NULL;
+  CalypStats::setEnabled( true );
+  for( int i = 0; i < CLP_STATS_NUMBER_STAGES; i++ )
+  {
+    m_acLastStats[i] = CalypStats::get( i );
+  }
+  m_pcStatsTimer = new QTimer( this );
+  m_pcStatsTimer->setInterval( 1000 );
+  connect( m_pcStatsTimer, SIGNAL( timeout() ), this, SLOT( updateStats() ) );
+  m_pcStatsTimer->start();
 }
 
 VideoHandle::~VideoHandle() {}
@@ -252,6 +265,13 @@ QWidget* VideoHandle::createStatusBarMessage()
   m_pcResolutionLabel->setMinimumWidth( 90 );
   m_pcResolutionLabel->setAlignment( Qt::AlignCenter );
 
+  m_pcStatsLabel = new QLabel;
+  m_pcStatsLabel->setText( " " );
+  m_pcStatsLabel->setSizePolicy( QSizePolicy( QSizePolicy::Fixed, QSizePolicy::Fixed ) );
+  m_pcStatsLabel->setMinimumWidth( 260 );
+  m_pcStatsLabel->setAlignment( Qt::AlignCenter );
+
+  mainlayout->addWidget( m_pcStatsLabel );
   mainlayout->addWidget( m_pcVideoFormatLabel );
   mainlayout->addWidget( m_pcResolutionLabel );
   pcStatusBarWidget->setLayout( mainlayout );
@@ -658,6 +678,7 @@ void VideoHandle::stop()
 
 void VideoHandle::playEvent()
 {
+  CalypTraceScope cTrace( "VideoHandle::playEvent" );
   bool bEndOfSequence = false;
 #if( _CONTROL_PLAYING_TIME_ == 1 )
   m_dAverageFps = double( m_dAverageFps * m_uiNumberPlayedFrames + m_pcPlayControlTimer->elapsed() ) /
@@ -854,3 +875,32 @@ void VideoHandle::setGridSize( int size )
     qobject_cast<VideoSubWindow*>( subWindowList.at( i ) )->getViewArea()->setGridSize( size );
   }
 }
+
+void VideoHandle::updateStats()
+{
+  if( !m_pcStatsLabel )
+    return;
+
+  // Average time per call over the last interval of the stages that limit playback
+  const int aiStages[] = { CLP_STATS_READ, CLP_STATS_RGB, CLP_STATS_MODULE };
+  QStringList astrStages;
+  for( int iStage : aiStages )
+  {
+    CalypStats::Counter cCurr = CalypStats::get( iStage );
+    ClpULong uiCalls = cCurr.uiCalls - m_acLastStats[iStage].uiCalls;
+    ClpULong uiNanoseconds = cCurr.uiNanoseconds - m_acLastStats[iStage].uiNanoseconds;
+    if( uiCalls > 0 )
+    {
+      astrStages.append( QString( "%1 %2 ms" )
+                             .arg( QString( CalypStats::getStageName( iStage ) ) )
+                             .arg( double( uiNanoseconds ) / uiCalls / 1e6, 0, 'f', 1 ) );
+    }
+  }
+  for( int i = 0; i < CLP_STATS_NUMBER_STAGES; i++ )
+  {
+    m_acLastStats[i] = CalypStats::get( i );
+  }
+  astrStages.append( QString( "Mem %1 MB" ).arg( CalypMemory::getTotal().uiCurrent / ( 1024 * 1024 ) ) );
+  m_pcStatsLabel->setText( astrStages.join( " | " ) );
+  m_pcStatsLabel->setToolTip( QString::fromStdString( CalypStats::report() + "\n" + CalypMemory::report() ) );
+}
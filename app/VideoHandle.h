@@ -27,6 +27,7 @@
 
 #include "CommonDefs.h"
 #include "config.h"
+#include "lib/CalypStats.h"
 
 #include <QMenu>
 #include <QPoint>
@@ -115,6 +116,11 @@ private:
 
   QLabel* m_pcVideoFormatLabel;
   QLabel* m_pcResolutionLabel;
+  QLabel* m_pcStatsLabel;
+
+  // Per-stage counters at the last refresh of the statistics label
+  QTimer* m_pcStatsTimer;
+  CalypStats::Counter m_acLastStats[CLP_STATS_NUMBER_STAGES];
 
   VideoSubWindow* m_pcCurrentVideoSubWindow;
   QVector<VideoSubWindow*> m_acPlayingSubWindows;
@@ -150,6 +156,7 @@ private Q_SLOTS:
   void setTool( int tool );
   void toggleGrid( bool checked );
   void setGridSize( int size );
+  void updateStats();
 };
 
 #endif  // __VIDEOHANDLE_H__
@@ -23,17 +23,24 @@
  */
 
 #include "VideoSubWindow.h"
+#include <QProgressDialog>
 #include <QScrollArea>
 #include <QStaticText>
 #include "ConfigureFormatDialog.h"
 #include "ModulesHandle.h"
 #include "QtConcurrent/qtconcurrentrun.h"
 #include "SubWindowAbstract.h"
+#include "lib/CalypTrace.h"
 
 #include <cassert>
 
 #define QT_NO_CONCURRENT
 
+//! Memory used to keep recently displayed frames (MB)
+#define VIDEO_FRAME_CACHE_SIZE 256
+//! Memory available to load a whole stream (MB)
+#define VIDEO_LOAD_ALL_MAX_MEMORY 4096
+
 /**
  * \brief Functions to control data stream from stream information
  */
@@ -286,10 +293,15 @@ void VideoSubWindow::updateWindowOnTimeout()
 
 void VideoSubWindow::loadAll()
 {
-  QApplication::setOverrideCursor( Qt::WaitCursor );
-  m_pCurrStream->loadAll();
+  QProgressDialog cProgressDialog( tr( "Loading frames into memory..." ), tr( "Cancel" ), 0, 100, this );
+  cProgressDialog.setWindowModality( Qt::WindowModal );
+  cProgressDialog.setMinimumDuration( 500 );
+  m_pCurrStream->loadAll( VIDEO_LOAD_ALL_MAX_MEMORY, [&cProgressDialog]( ClpULong uiLoaded, ClpULong uiTotal ) {
+    cProgressDialog.setValue( uiLoaded * 100 / uiTotal );
+    QApplication::processEvents();
+    return !cProgressDialog.wasCanceled();
+  } );
   refreshFrame();
-  QApplication::restoreOverrideCursor();
 }
 
 void VideoSubWindow::refreshSubWindow()
@@ -320,6 +332,7 @@ bool VideoSubWindow::loadFile( QString cFilename, bool bForceDialog )
   if( !m_pCurrStream )
   {
     m_pCurrStream = new CalypStream;
+    m_pCurrStream->setCacheSize( VIDEO_FRAME_CACHE_SIZE );
   }
   bool bConfig = true;
   if( !bForceDialog )
@@ -371,6 +384,7 @@ bool VideoSubWindow::loadFile( CalypFileInfo* streamInfo )
   if( !m_pCurrStream )
   {
     m_pCurrStream = new CalypStream;
+    m_pCurrStream->setCacheSize( VIDEO_FRAME_CACHE_SIZE );
   }
 
   if( !m_pCurrStream->open( streamInfo->m_cFilename.toStdString(), streamInfo->m_uiWidth, streamInfo->m_uiHeight,
@@ -693,6 +707,7 @@ void VideoSubWindow::setCurrFrame( CalypFrame* pcCurrFrame )
 
 void VideoSubWindow::refreshFrameOperation()
 {
+  CalypTraceScope cTrace( "VideoSubWindow::refreshFrameOperation" );
   bool bSetFrame = false;
   if( m_pCurrStream )
   {
@@ -26,6 +26,7 @@
 #include "ViewArea.h"
 
 #include "GridManager.h"
+#include "lib/CalypTrace.h"
 
 #include <QColor>
 #include <QCoreApplication>
@@ -425,6 +426,7 @@ void ViewArea::resizeEvent( QResizeEvent* event )
 
 void ViewArea::paintEvent( QPaintEvent* event )
 {
+  CalypTraceScope cTrace( "ViewArea::paintEvent" );
   QRect winRect = event->rect();
 
   if( visibleRegion().isEmpty() )
@@ -0,0 +1,20 @@
+# - Try to find liburing (Linux io_uring interface)
+#
+# Once done this will define
+#  LIBURING_FOUND         - System has liburing
+#  LIBURING_INCLUDE_DIRS  - The liburing include directory
+#  LIBURING_LIBRARIES     - Link these to use liburing
+
+include(FindPackageHandleStandardArgs)
+
+find_path( LIBURING_INCLUDE_DIR NAMES liburing.h )
+find_library( LIBURING_LIBRARY NAMES uring )
+
+find_package_handle_standard_args( Liburing DEFAULT_MSG LIBURING_LIBRARY LIBURING_INCLUDE_DIR )
+
+if( LIBURING_FOUND )
+  set( LIBURING_INCLUDE_DIRS ${LIBURING_INCLUDE_DIR} )
+  set( LIBURING_LIBRARIES ${LIBURING_LIBRARY} )
+endif()
+
+mark_as_advanced( LIBURING_INCLUDE_DIR LIBURING_LIBRARY )
@@ -0,0 +1,20 @@
+# - Try to find the zstd compression library
+#
+# Once done this will define
+#  ZSTD_FOUND         - System has zstd
+#  ZSTD_INCLUDE_DIRS  - The zstd include directory
+#  ZSTD_LIBRARIES     - Link these to use zstd
+
+include(FindPackageHandleStandardArgs)
+
+find_path( ZSTD_INCLUDE_DIR NAMES zstd.h )
+find_library( ZSTD_LIBRARY NAMES zstd )
+
+find_package_handle_standard_args( Zstd DEFAULT_MSG ZSTD_LIBRARY ZSTD_INCLUDE_DIR )
+
+if( ZSTD_FOUND )
+  set( ZSTD_INCLUDE_DIRS ${ZSTD_INCLUDE_DIR} )
+  set( ZSTD_LIBRARIES ${ZSTD_LIBRARY} )
+endif()
+
+mark_as_advanced( ZSTD_INCLUDE_DIR ZSTD_LIBRARY )
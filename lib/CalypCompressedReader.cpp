@@ -0,0 +1,640 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * \file     CalypCompressedReader.cpp
+ * \brief    Frame based reader of zstd/lz4 compressed raw files
+ */
+
+#include "CalypCompressedReader.h"
+
+#include "CalypMemory.h"
+#include "LibMemory.h"
+#include "config.h"
+
+#include <cstring>
+
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+
+//! Number of decompressed frames kept ahead of the reader
+#define COMPRESSED_READ_AHEAD_FRAMES 4
+//! Size of the chunks read from the compressed file
+#define COMPRESSED_INPUT_CHUNK ( 128 * 1024 )
+
+#define ZSTD_FRAME_MAGIC 0xFD2FB528
+#define LZ4_FRAME_MAGIC 0x184D2204
+#define SKIPPABLE_FRAME_MAGIC 0x184D2A50
+#define SKIPPABLE_FRAME_MASK 0xFFFFFFF0
+#define ZSTD_SEEKABLE_MAGIC 0x8F92EAB1
+#define ZSTD_SEEK_TABLE_MAGIC 0x184D2A5E
+
+static inline unsigned int readLE32( const ClpByte* p )
+{
+  return p[0] | ( p[1] << 8 ) | ( p[2] << 16 ) | ( (unsigned int)p[3] << 24 );
+}
+
+static inline ClpULong readLE( const ClpByte* p, unsigned int uiBytes )
+{
+  ClpULong uiValue = 0;
+  for( unsigned int i = 0; i < uiBytes; i++ )
+    uiValue |= ClpULong( p[i] ) << ( 8 * i );
+  return uiValue;
+}
+
+CalypCompressedReader::CalypCompressedReader()
+    : m_iCodec( CODEC_NONE )
+    , m_pFile( NULL )
+    , m_uiFileSize( 0 )
+    , m_uiDecompressedSize( 0 )
+    , m_pDecoder( NULL )
+    , m_uiFrameSize( 0 )
+    , m_uiHead( 0 )
+    , m_uiCount( 0 )
+    , m_uiNextFrame( 0 )
+    , m_bEOF( false )
+    , m_bError( false )
+    , m_bStop( false )
+{
+}
+
+CalypCompressedReader::~CalypCompressedReader()
+{
+  close();
+}
+
+int CalypCompressedReader::findCodec( const ClpString& strFilename )
+{
+  ClpString strExt = clpLowercase( strFilename.substr( strFilename.find_last_of( "." ) + 1 ) );
+#ifdef USE_ZSTD
+  if( strExt == "zst" )
+    return CODEC_ZSTD;
+#endif
+#ifdef USE_LZ4
+  if( strExt == "lz4" )
+    return CODEC_LZ4;
+#endif
+  return CODEC_NONE;
+}
+
+bool CalypCompressedReader::open( const ClpString& strFilename )
+{
+  close();
+  m_iCodec = findCodec( strFilename );
+  if( m_iCodec == CODEC_NONE )
+    return false;
+
+  m_pFile = fopen( strFilename.c_str(), "rb" );
+  if( !m_pFile )
+    return false;
+  fseek( m_pFile, 0, SEEK_END );
+  m_uiFileSize = ftell( m_pFile );
+  fseek( m_pFile, 0, SEEK_SET );
+
+  if( !createDecoder() )
+  {
+    close();
+    return false;
+  }
+
+  bool bIndexed = false;
+  if( m_iCodec == CODEC_ZSTD )
+    bIndexed = readSeekTable() || indexZstd();
+  else
+    bIndexed = indexLz4();
+
+  if( !bIndexed || m_acSeekPoints.empty() )
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void CalypCompressedReader::close()
+{
+  stopThread();
+  while( m_apFrames.size() > 0 )
+  {
+    CalypMemory::release( CLP_MEMORY_HANDLER, m_uiFrameSize );
+    freeMem1D( m_apFrames.back() );
+    m_apFrames.pop_back();
+  }
+  destroyDecoder();
+  if( m_pFile )
+    fclose( m_pFile );
+  m_pFile = NULL;
+  m_acSeekPoints.clear();
+  m_uiDecompressedSize = 0;
+  m_uiFrameSize = 0;
+}
+
+bool CalypCompressedReader::setFrameSize( unsigned long long int uiFrameSize )
+{
+  stopThread();
+  while( m_apFrames.size() > 0 )
+  {
+    CalypMemory::release( CLP_MEMORY_HANDLER, m_uiFrameSize );
+    freeMem1D( m_apFrames.back() );
+    m_apFrames.pop_back();
+  }
+  m_uiFrameSize = uiFrameSize;
+  for( unsigned int i = 0; i < COMPRESSED_READ_AHEAD_FRAMES; i++ )
+  {
+    ClpByte* pFrame = NULL;
+    if( !getMem1D<ClpByte>( &pFrame, m_uiFrameSize ) )
+      return false;
+    CalypMemory::allocate( CLP_MEMORY_HANDLER, m_uiFrameSize );
+    m_apFrames.push_back( pFrame );
+  }
+  startThread( 0 );
+  return true;
+}
+
+bool CalypCompressedReader::readBytes( ClpULong uiOffset, ClpByte* pBuffer, unsigned int uiSize )
+{
+  if( uiOffset + uiSize > m_uiFileSize )
+    return false;
+  fseek( m_pFile, uiOffset, SEEK_SET );
+  return fread( pBuffer, 1, uiSize, m_pFile ) == uiSize;
+}
+
+/**
+ * Seek table of the zstd seekable format: a skippable frame at the
+ * end of the file with the sizes of each compressed frame
+ */
+bool CalypCompressedReader::readSeekTable()
+{
+  ClpByte auiFooter[9];
+  if( m_uiFileSize < 17 || !readBytes( m_uiFileSize - 9, auiFooter, 9 ) )
+    return false;
+  if( readLE32( auiFooter + 5 ) != ZSTD_SEEKABLE_MAGIC )
+    return false;
+
+  unsigned int uiNumFrames = readLE32( auiFooter );
+  unsigned int uiEntrySize = ( auiFooter[4] & 0x80 ) ? 12 : 8;
+  ClpULong uiTableSize = ClpULong( uiNumFrames ) * uiEntrySize + 9;
+  if( uiTableSize + 8 > m_uiFileSize )
+    return false;
+
+  std::vector<ClpByte> auiTable( uiTableSize + 8 );
+  if( !readBytes( m_uiFileSize - uiTableSize - 8, auiTable.data(), auiTable.size() ) ||
+      readLE32( auiTable.data() ) != ZSTD_SEEK_TABLE_MAGIC )
+    return false;
+
+  SeekPoint cPoint = {0, 0};
+  const ClpByte* pEntry = auiTable.data() + 8;
+  for( unsigned int i = 0; i < uiNumFrames; i++, pEntry += uiEntrySize )
+  {
+    m_acSeekPoints.push_back( cPoint );
+    cPoint.uiCompressedOffset += readLE32( pEntry );
+    cPoint.uiDecompressedOffset += readLE32( pEntry + 4 );
+  }
+  m_uiDecompressedSize = cPoint.uiDecompressedOffset;
+  return true;
+}
+
+/**
+ * Walk the zstd frame and block headers to find
+ * the boundaries of each compressed frame
+ */
+bool CalypCompressedReader::indexZstd()
+{
+  static const unsigned int auiDictIdSize[4] = {0, 1, 2, 4};
+  static const unsigned int auiContentSize[4] = {0, 2, 4, 8};
+
+  ClpByte auiHeader[18];
+  ClpULong uiOffset = 0;
+  ClpULong uiDecompressedOffset = 0;
+  while( uiOffset < m_uiFileSize )
+  {
+    if( !readBytes( uiOffset, auiHeader, 8 ) )
+      return false;
+    unsigned int uiMagic = readLE32( auiHeader );
+    if( ( uiMagic & SKIPPABLE_FRAME_MASK ) == SKIPPABLE_FRAME_MAGIC )
+    {
+      uiOffset += 8 + readLE32( auiHeader + 4 );
+      continue;
+    }
+    if( uiMagic != ZSTD_FRAME_MAGIC )
+      return false;
+
+    ClpByte uiDescriptor = auiHeader[4];
+    bool bSingleSegment = ( uiDescriptor >> 5 ) & 1;
+    bool bChecksum = ( uiDescriptor >> 2 ) & 1;
+    unsigned int uiContentSizeFlag = uiDescriptor >> 6;
+    unsigned int uiDictIdBytes = auiDictIdSize[uiDescriptor & 3];
+    unsigned int uiContentBytes = ( uiContentSizeFlag == 0 && bSingleSegment ) ? 1 : auiContentSize[uiContentSizeFlag];
+    unsigned int uiHeaderSize = 5 + ( bSingleSegment ? 0 : 1 ) + uiDictIdBytes + uiContentBytes;
+    if( !readBytes( uiOffset, auiHeader, uiHeaderSize ) )
+      return false;
+
+    ClpULong uiContentSize = 0;
+    bool bKnownSize = uiContentBytes > 0;
+    if( bKnownSize )
+    {
+      uiContentSize = readLE( auiHeader + uiHeaderSize - uiContentBytes, uiContentBytes );
+      if( uiContentBytes == 2 )
+        uiContentSize += 256;
+    }
+
+    ClpULong uiPos = uiOffset + uiHeaderSize;
+    bool bLastBlock = false;
+    while( !bLastBlock )
+    {
+      ClpByte auiBlock[3];
+      if( !readBytes( uiPos, auiBlock, 3 ) )
+        return false;
+      unsigned int uiBlockHeader = auiBlock[0] | ( auiBlock[1] << 8 ) | ( auiBlock[2] << 16 );
+      bLastBlock = uiBlockHeader & 1;
+      unsigned int uiBlockType = ( uiBlockHeader >> 1 ) & 3;
+      uiPos += 3 + ( uiBlockType == 1 ? 1 : ( uiBlockHeader >> 3 ) );
+    }
+    if( bChecksum )
+      uiPos += 4;
+
+    if( !bKnownSize )
+      uiContentSize = measureFrame( uiOffset, uiPos - uiOffset );
+
+    SeekPoint cPoint = {uiOffset, uiDecompressedOffset};
+    m_acSeekPoints.push_back( cPoint );
+    uiDecompressedOffset += uiContentSize;
+    uiOffset = uiPos;
+  }
+  m_uiDecompressedSize = uiDecompressedOffset;
+  return true;
+}
+
+/**
+ * Walk the lz4 frame and block headers to find
+ * the boundaries of each compressed frame
+ */
+bool CalypCompressedReader::indexLz4()
+{
+  ClpByte auiHeader[19];
+  ClpULong uiOffset = 0;
+  ClpULong uiDecompressedOffset = 0;
+  while( uiOffset < m_uiFileSize )
+  {
+    if( !readBytes( uiOffset, auiHeader, 8 ) )
+      return false;
+    unsigned int uiMagic = readLE32( auiHeader );
+    if( ( uiMagic & SKIPPABLE_FRAME_MASK ) == SKIPPABLE_FRAME_MAGIC )
+    {
+      uiOffset += 8 + readLE32( auiHeader + 4 );
+      continue;
+    }
+    if( uiMagic != LZ4_FRAME_MAGIC )
+      return false;
+
+    ClpByte uiFlags = auiHeader[4];
+    bool bBlockChecksum = ( uiFlags >> 4 ) & 1;
+    bool bKnownSize = ( uiFlags >> 3 ) & 1;
+    bool bContentChecksum = ( uiFlags >> 2 ) & 1;
+    unsigned int uiHeaderSize = 7 + ( bKnownSize ? 8 : 0 ) + ( ( uiFlags & 1 ) ? 4 : 0 );
+    if( !readBytes( uiOffset, auiHeader, uiHeaderSize ) )
+      return false;
+
+    ClpULong uiContentSize = bKnownSize ? readLE( auiHeader + 6, 8 ) : 0;
+
+    ClpULong uiPos = uiOffset + uiHeaderSize;
+    while( true )
+    {
+      ClpByte auiBlock[4];
+      if( !readBytes( uiPos, auiBlock, 4 ) )
+        return false;
+      uiPos += 4;
+      unsigned int uiBlockSize = readLE32( auiBlock ) & 0x7FFFFFFF;
+      if( uiBlockSize == 0 )
+        break;
+      uiPos += uiBlockSize + ( bBlockChecksum ? 4 : 0 );
+    }
+    if( bContentChecksum )
+      uiPos += 4;
+
+    if( !bKnownSize )
+      uiContentSize = measureFrame( uiOffset, uiPos - uiOffset );
+
+    SeekPoint cPoint = {uiOffset, uiDecompressedOffset};
+    m_acSeekPoints.push_back( cPoint );
+    uiDecompressedOffset += uiContentSize;
+    uiOffset = uiPos;
+  }
+  m_uiDecompressedSize = uiDecompressedOffset;
+  return true;
+}
+
+/**
+ * Decompress one frame without a content size field to measure it
+ */
+ClpULong CalypCompressedReader::measureFrame( ClpULong uiOffset, ClpULong uiSize )
+{
+  std::vector<ClpByte> auiIn( COMPRESSED_INPUT_CHUNK );
+  std::vector<ClpByte> auiOut( COMPRESSED_INPUT_CHUNK );
+  ClpULong uiDecompressed = 0;
+  bool bEndOfFrame = false;
+
+  resetDecoder();
+  while( uiSize > 0 && !bEndOfFrame )
+  {
+    size_t uiChunk = std::min<ClpULong>( uiSize, auiIn.size() );
+    if( !readBytes( uiOffset, auiIn.data(), uiChunk ) )
+      break;
+    size_t uiInPos = 0;
+    while( uiInPos < uiChunk && !bEndOfFrame )
+    {
+      size_t uiInSize = uiChunk - uiInPos;
+      size_t uiOutSize = auiOut.size();
+      if( !decompress( auiIn.data() + uiInPos, uiInSize, auiOut.data(), uiOutSize, bEndOfFrame ) )
+        return uiDecompressed;
+      uiInPos += uiInSize;
+      uiDecompressed += uiOutSize;
+    }
+    uiOffset += uiChunk;
+    uiSize -= uiChunk;
+  }
+  // Flush what is left inside the decoder
+  while( !bEndOfFrame )
+  {
+    size_t uiInSize = 0;
+    size_t uiOutSize = auiOut.size();
+    if( !decompress( auiIn.data(), uiInSize, auiOut.data(), uiOutSize, bEndOfFrame ) || uiOutSize == 0 )
+      break;
+    uiDecompressed += uiOutSize;
+  }
+  resetDecoder();
+  return uiDecompressed;
+}
+
+bool CalypCompressedReader::createDecoder()
+{
+#ifdef USE_ZSTD
+  if( m_iCodec == CODEC_ZSTD )
+  {
+    m_pDecoder = ZSTD_createDStream();
+    return m_pDecoder != NULL;
+  }
+#endif
+#ifdef USE_LZ4
+  if( m_iCodec == CODEC_LZ4 )
+  {
+    LZ4F_dctx* pDecoder = NULL;
+    if( LZ4F_isError( LZ4F_createDecompressionContext( &pDecoder, LZ4F_VERSION ) ) )
+      return false;
+    m_pDecoder = pDecoder;
+    return true;
+  }
+#endif
+  return false;
+}
+
+void CalypCompressedReader::destroyDecoder()
+{
+  if( !m_pDecoder )
+    return;
+#ifdef USE_ZSTD
+  if( m_iCodec == CODEC_ZSTD )
+    ZSTD_freeDStream( (ZSTD_DStream*)m_pDecoder );
+#endif
+#ifdef USE_LZ4
+  if( m_iCodec == CODEC_LZ4 )
+    LZ4F_freeDecompressionContext( (LZ4F_dctx*)m_pDecoder );
+#endif
+  m_pDecoder = NULL;
+}
+
+void CalypCompressedReader::resetDecoder()
+{
+#ifdef USE_ZSTD
+  if( m_iCodec == CODEC_ZSTD )
+    ZSTD_initDStream( (ZSTD_DStream*)m_pDecoder );
+#endif
+#ifdef USE_LZ4
+  if( m_iCodec == CODEC_LZ4 )
+    LZ4F_resetDecompressionContext( (LZ4F_dctx*)m_pDecoder );
+#endif
+}
+
+/**
+ * Decompress as much as possible, updating the sizes
+ * with the number of consumed and produced bytes
+ */
+bool CalypCompressedReader::decompress( const ClpByte* pIn, size_t& ruiInSize, ClpByte* pOut, size_t& ruiOutSize,
+                                        bool& rbEndOfFrame )
+{
+#ifdef USE_ZSTD
+  if( m_iCodec == CODEC_ZSTD )
+  {
+    ZSTD_inBuffer cIn = {pIn, ruiInSize, 0};
+    ZSTD_outBuffer cOut = {pOut, ruiOutSize, 0};
+    size_t uiRet = ZSTD_decompressStream( (ZSTD_DStream*)m_pDecoder, &cOut, &cIn );
+    if( ZSTD_isError( uiRet ) )
+      return false;
+    ruiInSize = cIn.pos;
+    ruiOutSize = cOut.pos;
+    rbEndOfFrame = uiRet == 0;
+    return true;
+  }
+#endif
+#ifdef USE_LZ4
+  if( m_iCodec == CODEC_LZ4 )
+  {
+    size_t uiRet = LZ4F_decompress( (LZ4F_dctx*)m_pDecoder, pOut, &ruiOutSize, pIn, &ruiInSize, NULL );
+    if( LZ4F_isError( uiRet ) )
+      return false;
+    rbEndOfFrame = uiRet == 0;
+    return true;
+  }
+#endif
+  return false;
+}
+
+bool CalypCompressedReader::seek( ClpULong uiFrameNum )
+{
+  if( m_apFrames.empty() )
+    return false;
+  if( uiFrameNum * m_uiFrameSize >= m_uiDecompressedSize )
+    return false;
+
+  {
+    std::unique_lock<std::mutex> lock( m_cMutex );
+    if( uiFrameNum >= m_uiNextFrame )
+    {
+      // Closest seek point to the requested frame
+      unsigned int uiPoint = m_acSeekPoints.size() - 1;
+      while( uiPoint > 0 && m_acSeekPoints[uiPoint].uiDecompressedOffset > uiFrameNum * m_uiFrameSize )
+        uiPoint--;
+
+      // Keep decompressing forward unless a seek point gets us there faster
+      if( m_acSeekPoints[uiPoint].uiDecompressedOffset <= ( m_uiNextFrame + m_uiCount ) * m_uiFrameSize )
+      {
+        while( m_uiNextFrame < uiFrameNum && m_uiCount > 0 )
+        {
+          m_uiHead = ( m_uiHead + 1 ) % m_apFrames.size();
+          m_uiCount--;
+          m_uiNextFrame++;
+        }
+        if( m_uiNextFrame < uiFrameNum )
+        {
+          // The remaining frames are dropped as they are decompressed
+          m_uiNextFrame = uiFrameNum;
+        }
+        m_cCond.notify_all();
+        return true;
+      }
+    }
+  }
+  stopThread();
+  startThread( uiFrameNum );
+  return true;
+}
+
+bool CalypCompressedReader::read( ClpByte* pBuffer )
+{
+  std::unique_lock<std::mutex> lock( m_cMutex );
+  m_cCond.wait( lock, [this] { return m_uiCount > 0 || m_bEOF || m_bError; } );
+  if( m_uiCount == 0 )
+    return false;
+  memcpy( pBuffer, m_apFrames[m_uiHead], m_uiFrameSize );
+  m_uiHead = ( m_uiHead + 1 ) % m_apFrames.size();
+  m_uiCount--;
+  m_uiNextFrame++;
+  m_cCond.notify_all();
+  return true;
+}
+
+void CalypCompressedReader::startThread( ClpULong uiFrameNum )
+{
+  m_uiHead = 0;
+  m_uiCount = 0;
+  m_uiNextFrame = uiFrameNum;
+  m_bEOF = false;
+  m_bError = false;
+  m_bStop = false;
+  m_cThread = std::thread( &CalypCompressedReader::decompressLoop, this, uiFrameNum );
+}
+
+void CalypCompressedReader::stopThread()
+{
+  if( !m_cThread.joinable() )
+    return;
+  {
+    std::unique_lock<std::mutex> lock( m_cMutex );
+    m_bStop = true;
+  }
+  m_cCond.notify_all();
+  m_cThread.join();
+}
+
+void CalypCompressedReader::decompressLoop( ClpULong uiFrameNum )
+{
+  ClpULong uiTarget = uiFrameNum * m_uiFrameSize;
+  unsigned int uiPoint = m_acSeekPoints.size() - 1;
+  while( uiPoint > 0 && m_acSeekPoints[uiPoint].uiDecompressedOffset > uiTarget )
+    uiPoint--;
+
+  ClpULong uiFilePos = m_acSeekPoints[uiPoint].uiCompressedOffset;
+  ClpULong uiSkip = uiTarget - m_acSeekPoints[uiPoint].uiDecompressedOffset;
+  ClpULong uiDecodedFrame = uiFrameNum;  // Index of the frame being filled
+
+  std::vector<ClpByte> auiIn( COMPRESSED_INPUT_CHUNK );
+  std::vector<ClpByte> auiScratch( COMPRESSED_INPUT_CHUNK );
+  size_t uiInPos = 0;
+  size_t uiInSize = 0;
+  ClpByte* pFrame = NULL;
+  unsigned long long int uiFill = 0;
+  bool bInputEOF = false;
+  bool bError = false;
+
+  resetDecoder();
+  fseek( m_pFile, uiFilePos, SEEK_SET );
+  while( true )
+  {
+    if( uiInPos == uiInSize && !bInputEOF )
+    {
+      uiInSize = fread( auiIn.data(), 1, auiIn.size(), m_pFile );
+      uiInPos = 0;
+      bInputEOF = uiInSize == 0;
+    }
+
+    ClpByte* pOut;
+    size_t uiOutSize;
+    if( uiSkip > 0 )
+    {
+      pOut = auiScratch.data();
+      uiOutSize = std::min<ClpULong>( uiSkip, auiScratch.size() );
+    }
+    else
+    {
+      if( !pFrame )
+      {
+        std::unique_lock<std::mutex> lock( m_cMutex );
+        m_cCond.wait( lock, [this] { return m_bStop || m_uiCount < m_apFrames.size(); } );
+        if( m_bStop )
+          return;
+        pFrame = m_apFrames[( m_uiHead + m_uiCount ) % m_apFrames.size()];
+        uiFill = 0;
+      }
+      pOut = pFrame + uiFill;
+      uiOutSize = m_uiFrameSize - uiFill;
+    }
+
+    size_t uiConsumed = uiInSize - uiInPos;
+    bool bEndOfFrame = false;
+    if( !decompress( auiIn.data() + uiInPos, uiConsumed, pOut, uiOutSize, bEndOfFrame ) )
+    {
+      bError = true;
+      break;
+    }
+    uiInPos += uiConsumed;
+    // The decoder may still hold output after the whole input is consumed
+    if( bInputEOF && uiOutSize == 0 )
+      break;
+
+    if( uiSkip > 0 )
+    {
+      uiSkip -= uiOutSize;
+      continue;
+    }
+    uiFill += uiOutSize;
+    if( uiFill == m_uiFrameSize )
+    {
+      std::unique_lock<std::mutex> lock( m_cMutex );
+      if( m_bStop )
+        return;
+      // Frames skipped by a forward seek are dropped here
+      if( uiDecodedFrame >= m_uiNextFrame + m_uiCount )
+      {
+        m_uiCount++;
+        m_cCond.notify_all();
+      }
+      uiDecodedFrame++;
+      pFrame = NULL;
+    }
+  }
+
+  std::unique_lock<std::mutex> lock( m_cMutex );
+  m_bEOF = true;
+  m_bError = bError;
+  m_cCond.notify_all();
+}
@@ -0,0 +1,134 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * \file     CalypCompressedReader.h
+ * \brief    Frame based reader of zstd/lz4 compressed raw files
+ */
+
+#ifndef __CALYPCOMPRESSEDREADER_H__
+#define __CALYPCOMPRESSEDREADER_H__
+
+#include "CalypDefs.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \class CalypCompressedReader
+ * \brief Reads fixed size frames out of a zstd or lz4 compressed file
+ *
+ * When opening, the compressed file is indexed using the boundaries of
+ * its compressed frames (or the seek table of the zstd seekable format
+ * when available). Each compressed frame is a seek point: seeking
+ * decompresses from the closest seek point before the requested frame.
+ * Files with a single compressed frame can only be read sequentially
+ * without penalty.
+ *
+ * Decompression runs on a background thread which keeps a bounded
+ * number of decompressed frames ahead of the reader.
+ */
+class CalypCompressedReader
+{
+public:
+  enum CompressedCodec
+  {
+    CODEC_NONE = -1,
+    CODEC_ZSTD,
+    CODEC_LZ4,
+  };
+
+  CalypCompressedReader();
+  ~CalypCompressedReader();
+
+  /**
+   * Check if a file name has the extension of a compressed
+   * format supported by this build
+   */
+  static int findCodec( const ClpString& strFilename );
+
+  bool open( const ClpString& strFilename );
+  void close();
+
+  /**
+   * Total size of the decompressed data
+   */
+  ClpULong getDecompressedSize() const { return m_uiDecompressedSize; }
+
+  /**
+   * Number of seek points found in the file
+   */
+  unsigned int getNumberOfSeekPoints() const { return m_acSeekPoints.size(); }
+
+  /**
+   * Set the size of the frames returned by read
+   * and start decompressing from the beginning
+   */
+  bool setFrameSize( unsigned long long int uiFrameSize );
+
+  bool seek( ClpULong uiFrameNum );
+  bool read( ClpByte* pBuffer );
+
+private:
+  struct SeekPoint
+  {
+    ClpULong uiCompressedOffset;
+    ClpULong uiDecompressedOffset;
+  };
+
+  int m_iCodec;
+  FILE* m_pFile;
+  ClpULong m_uiFileSize;
+  ClpULong m_uiDecompressedSize;
+  std::vector<SeekPoint> m_acSeekPoints;
+  void* m_pDecoder;
+  unsigned long long int m_uiFrameSize;
+
+  /** Background decompression */
+  std::thread m_cThread;
+  std::mutex m_cMutex;
+  std::condition_variable m_cCond;
+  std::vector<ClpByte*> m_apFrames;
+  unsigned int m_uiHead;
+  unsigned int m_uiCount;
+  ClpULong m_uiNextFrame;  //!< Index of the frame at the head of the ring
+  bool m_bEOF;
+  bool m_bError;
+  bool m_bStop;
+
+  bool readBytes( ClpULong uiOffset, ClpByte* pBuffer, unsigned int uiSize );
+  bool readSeekTable();
+  bool indexZstd();
+  bool indexLz4();
+  ClpULong measureFrame( ClpULong uiOffset, ClpULong uiSize );
+
+  bool createDecoder();
+  void destroyDecoder();
+  void resetDecoder();
+  bool decompress( const ClpByte* pIn, size_t& ruiInSize, ClpByte* pOut, size_t& ruiOutSize, bool& rbEndOfFrame );
+
+  void startThread( ClpULong uiFrameNum );
+  void stopThread();
+  void decompressLoop( ClpULong uiFrameNum );
+};
+
+#endif  // __CALYPCOMPRESSEDREADER_H__
@@ -24,6 +24,8 @@
 
 #include "CalypFrame.h"
 
+#include "CalypMemory.h"
+#include "CalypStats.h"
 #include "LibMemory.h"
 #include "PixelFormats.h"
 #include "config.h"
@@ -119,6 +121,11 @@ public:
   /** Numbers of histogram segments depending of image bytes depth*/
   unsigned int m_uiHistoSegments;
 
+  int m_iMemoryCategory;     //!< Category of the allocating thread (see CalypMemory)
+  ClpULong m_uiMemoryBytes;  //!< Memory accounted for this frame
+
+  CalypFramePrivate() : m_iMemoryCategory( CLP_MEMORY_FRAME ), m_uiMemoryBytes( 0 ) {}
+
   void init( unsigned int width, unsigned int height, int pel_format, unsigned bitsPixel )
   {
     init( width, height, pel_format, bitsPixel, false );
@@ -128,6 +135,8 @@ public:
   {
     m_bInit = false;
     m_bHasRGBPel = false;
+    CalypMemory::release( m_iMemoryCategory, m_uiMemoryBytes );
+    m_uiMemoryBytes = 0;
     m_pppcInputPel = NULL;
     m_pcARGB32 = NULL;
     m_uiWidth = width;
@@ -192,6 +201,11 @@ public:
 
     getMem1D<unsigned int>( &( m_puiHistogram ), m_uiHistoSegments * m_uiHistoChannels );
 
+    m_iMemoryCategory = CalypMemory::getThreadCategory();
+    m_uiMemoryBytes = mem_size + ClpULong( m_uiHeight ) * m_uiWidth * 4 +
+                      ClpULong( m_uiHistoSegments ) * m_uiHistoChannels * sizeof( unsigned int );
+    CalypMemory::allocate( m_iMemoryCategory, m_uiMemoryBytes );
+
     m_cPelFmtName = CalypFrame::supportedPixelFormatListNames()[m_iPixelFormat].c_str();
 
     m_bInit = true;
@@ -251,6 +265,8 @@ public:
 
     if( m_pcARGB32 )
       freeMem1D( m_pcARGB32 );
+
+    CalypMemory::release( m_iMemoryCategory, m_uiMemoryBytes );
   }
 };
 
@@ -479,6 +495,24 @@ void CalypFrame::reset()
   }
 }
 
+void CalypFrame::fillSynthetic( unsigned int uiSeed )
+{
+  ClpPel*** pppPel = getPelBufferYUV();
+  unsigned int uiMask = ( 1 << d->m_uiBitsPel ) - 1;
+  unsigned int uiState = 0x9E3779B9u * ( uiSeed + 1 );
+  for( unsigned int ch = 0; ch < d->m_pcPelFormat->numberChannels; ch++ )
+  {
+    for( unsigned int y = 0; y < getHeight( ch ); y++ )
+    {
+      for( unsigned int x = 0; x < getWidth( ch ); x++ )
+      {
+        uiState = uiState * 1664525u + 1013904223u;
+        pppPel[ch][y][x] = ( ( x + y + ch * 32 + uiSeed ) ^ ( uiState >> 16 ) ) & uiMask;
+      }
+    }
+  }
+}
+
 ClpPel*** CalypFrame::getPelBufferYUV() const
 {
   return d->m_pppcInputPel;
@@ -522,8 +556,8 @@ CalypPixel CalypFrame::getPixel( unsigned int xPos, unsigned int yPos ) const
   CalypPixel PixelValue( d->m_pcPelFormat->colorSpace );
   for( unsigned int ch = 0; ch < d->m_pcPelFormat->numberChannels; ch++ )
   {
-    int ratioH = ch > 0 ? d->m_pcPelFormat->log2ChromaWidth : 0;
-    int ratioW = ch > 0 ? d->m_pcPelFormat->log2ChromaHeight : 0;
+    int ratioH = ch > 0 ? d->m_pcPelFormat->log2ChromaHeight : 0;
+    int ratioW = ch > 0 ? d->m_pcPelFormat->log2ChromaWidth : 0;
     PixelValue[ch] = d->m_pppcInputPel[ch][( yPos >> ratioH )][( xPos >> ratioW )];
   }
   return PixelValue;
@@ -538,8 +572,8 @@ void CalypFrame::setPixel( unsigned int xPos, unsigned int yPos, CalypPixel pixe
 {
   for( unsigned int ch = 0; ch < d->m_pcPelFormat->numberChannels; ch++ )
   {
-    int ratioH = ch > 0 ? d->m_pcPelFormat->log2ChromaWidth : 0;
-    int ratioW = ch > 0 ? d->m_pcPelFormat->log2ChromaHeight : 0;
+    int ratioH = ch > 0 ? d->m_pcPelFormat->log2ChromaHeight : 0;
+    int ratioW = ch > 0 ? d->m_pcPelFormat->log2ChromaWidth : 0;
     d->m_pppcInputPel[ch][( yPos >> ratioH )][( xPos >> ratioW )] = pixel[ch];
   }
   d->m_bHasHistogram = false;
@@ -569,8 +603,8 @@ void CalypFrame::copyFrom( const CalypFrame& other, unsigned x, unsigned y )
   ClpPel*** pInput = other.getPelBufferYUV();
   for( unsigned int ch = 0; ch < d->m_pcPelFormat->numberChannels; ch++ )
   {
-    int ratioH = ch > 0 ? d->m_pcPelFormat->log2ChromaWidth : 0;
-    int ratioW = ch > 0 ? d->m_pcPelFormat->log2ChromaHeight : 0;
+    int ratioH = ch > 0 ? d->m_pcPelFormat->log2ChromaHeight : 0;
+    int ratioW = ch > 0 ? d->m_pcPelFormat->log2ChromaWidth : 0;
     for( unsigned int i = 0; i < CHROMASHIFT( d->m_uiHeight, ratioH ); i++ )
     {
       memcpy( &( d->m_pppcInputPel[ch][i][0] ), &( pInput[ch][( y >> ratioH ) + i][( x >> ratioW )] ),
@@ -596,8 +630,8 @@ void CalypFrame::copyTo( const CalypFrame& other, unsigned x, unsigned y )
   // TODO: Protect width and height
   for( unsigned int ch = 0; ch < d->m_pcPelFormat->numberChannels; ch++ )
   {
-    int ratioH = ch > 0 ? d->m_pcPelFormat->log2ChromaWidth : 0;
-    int ratioW = ch > 0 ? d->m_pcPelFormat->log2ChromaHeight : 0;
+    int ratioH = ch > 0 ? d->m_pcPelFormat->log2ChromaHeight : 0;
+    int ratioW = ch > 0 ? d->m_pcPelFormat->log2ChromaWidth : 0;
     for( unsigned int i = 0; i < other.getHeight( ch ); i++ )
     {
       memcpy( &( d->m_pppcInputPel[ch][( y >> ratioH ) + i][( x >> ratioW )] ), &( pInput[ch][i][0] ),
@@ -624,6 +658,13 @@ void CalypFrame::frameFromBuffer( ClpByte* Buff, int iEndianness, unsigned long
 
 void CalypFrame::frameFromBuffer( ClpByte* Buff, int iEndianness )
 {
+  frameFromBuffer( Buff, iEndianness, -1, 0, 0 );
+}
+
+void CalypFrame::frameFromBuffer( ClpByte* Buff, int iEndianness, unsigned int uiChannelMask, unsigned int uiFirstRow,
+                                  unsigned int uiNumRows )
+{
+  CalypStatsTimer cTimer( CLP_STATS_UNPACK, getBytesPerFrame() );
   ClpByte* ppBuff[MAX_NUMBER_PLANES];
   ClpByte* pTmpBuff;
   ClpPel* pPel;
@@ -651,16 +692,29 @@ void CalypFrame::frameFromBuffer( ClpByte* Buff, int iEndianness )
     ppBuff[i] = ppBuff[i - 1] + CHROMASHIFT( d->m_uiHeight, ratioH ) * CHROMASHIFT( d->m_uiWidth, ratioW ) * bytesPixel;
   }
 
+  if( uiFirstRow >= d->m_uiHeight )
+    return;
+  if( uiNumRows == 0 || uiFirstRow + uiNumRows > d->m_uiHeight )
+    uiNumRows = d->m_uiHeight - uiFirstRow;
+
   for( ch = 0; ch < d->m_pcPelFormat->numberChannels; ch++ )
   {
+    if( !( uiChannelMask & ( 1 << ch ) ) )
+      continue;
+
     ratioW = ch > 0 ? d->m_pcPelFormat->log2ChromaWidth : 0;
     ratioH = ch > 0 ? d->m_pcPelFormat->log2ChromaHeight : 0;
     step = ( d->m_pcPelFormat->comp[ch].step_minus1 ) * bytesPixel;
 
-    pPel = d->m_pppcInputPel[ch][0];
+    unsigned int uiWidth = CHROMASHIFT( d->m_uiWidth, ratioW );
+    unsigned int uiStartRow = uiFirstRow >> ratioH;
+    unsigned int uiEndRow = CHROMASHIFT( uiFirstRow + uiNumRows, ratioH );
+
+    pPel = d->m_pppcInputPel[ch][uiStartRow];
     pTmpBuff = ppBuff[d->m_pcPelFormat->comp[ch].plane] + ( d->m_pcPelFormat->comp[ch].offset_plus1 - 1 ) * bytesPixel;
+    pTmpBuff += ClpULong( uiStartRow ) * uiWidth * ( bytesPixel + step );
 
-    for( i = 0; i < CHROMASHIFT( d->m_uiHeight, ratioH ) * CHROMASHIFT( d->m_uiWidth, ratioW ); i++ )
+    for( i = 0; i < ( uiEndRow - uiStartRow ) * uiWidth; i++ )
     {
       *pPel = 0;
       for( b = startByte; b != endByte; b += incByte )
@@ -683,6 +737,7 @@ void CalypFrame::frameFromBuffer( ClpByte* Buff, int iEndianness )
 
 void CalypFrame::frameToBuffer( ClpByte* output_buffer, int iEndianness )
 {
+  CalypStatsTimer cTimer( CLP_STATS_PACK, getBytesPerFrame() );
   unsigned int bytesPixel = ( d->m_uiBitsPel - 1 ) / 8 + 1;
   ClpByte* ppBuff[MAX_NUMBER_PLANES];
   ClpByte* pTmpBuff;
@@ -746,6 +801,7 @@ void CalypFrame::fillRGBBuffer()
 
   if( d->m_bHasRGBPel )
     return;
+  CalypStatsTimer cTimer( CLP_STATS_RGB, getBytesPerFrame() );
   int shiftBits = d->m_uiBitsPel - 8;
 
   // 4 bytes for A, R, G and B
@@ -833,6 +889,8 @@ void CalypFrame::calcHistogram()
   if( d->m_bHasHistogram || !d->m_puiHistogram )
     return;
 
+  CalypStatsTimer cTimer( CLP_STATS_HISTOGRAM, getBytesPerFrame() );
+
   d->m_bHistogramRunning = true;
 
   xMemSet( unsigned int, d->m_uiHistoSegments * d->m_uiHistoChannels, d->m_puiHistogram );
@@ -1332,6 +1390,8 @@ double CalypFrame::getQuality( int Metric, CalypFrame* Org, unsigned int compone
   {
     return 0;
   }
+  CalypStatsTimer cTimer( CLP_STATS_QUALITY,
+                          ClpULong( getWidth( component ) ) * getHeight( component ) * ( ( getBitsPel() - 1 ) / 8 + 1 ) );
   switch( Metric )
   {
   case PSNR_METRIC:
@@ -1360,7 +1420,7 @@ double CalypFrame::getMSE( CalypFrame* Org, unsigned int component )
   ClpULong ssd = 0;
   for( unsigned int i = 0; i < numberOfPixels; i++ )
   {
-    int diff = int( *pPelYUV++ ) - int( *pOrgPelYUV++ );
+    long long diff = int( *pPelYUV++ ) - int( *pOrgPelYUV++ );
     ssd += diff * diff;
   }
   if( ssd == 0.0 )
@@ -268,6 +268,14 @@ public:
 	 */
   void reset();
 
+  /**
+	 * Fill the frame with reproducible synthetic content: a gradient
+	 * mixed with noise so that every bit of the samples changes
+	 * (used by the tests and benchmarks)
+	 * @param uiSeed seed of the noise
+	 */
+  void fillSynthetic( unsigned int uiSeed );
+
   ClpPel*** getPelBufferYUV() const;
   ClpPel*** getPelBufferYUV();
 
@@ -346,6 +354,13 @@ public:
 
   void frameFromBuffer( ClpByte*, int, unsigned long );
   void frameFromBuffer( ClpByte*, int );
+  /**
+   * Convert only some channels/rows of a frame buffer
+   * @param uiChannelMask bit mask of the channels to convert (1 << CLP_LUMA, ...)
+   * @param uiFirstRow first luma row to convert (chroma rows are scaled)
+   * @param uiNumRows number of luma rows (0 until the last row)
+   */
+  void frameFromBuffer( ClpByte*, int, unsigned int uiChannelMask, unsigned int uiFirstRow, unsigned int uiNumRows );
   void frameToBuffer( ClpByte*, int );
 
   void fillRGBBuffer();
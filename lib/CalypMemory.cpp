@@ -0,0 +1,200 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * \file     CalypMemory.cpp
+ * \ingroup  CalypLibGrp
+ * \brief    Accounting and budget of the memory used by frames and streams
+ */
+
+#include "CalypMemory.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+
+static std::atomic<ClpULong> s_auiCurrent[CLP_MEMORY_NUMBER_CATEGORIES];
+static std::atomic<ClpULong> s_auiPeak[CLP_MEMORY_NUMBER_CATEGORIES];
+static std::atomic<ClpULong> s_uiTotalCurrent( 0 );
+static std::atomic<ClpULong> s_uiTotalPeak( 0 );
+static std::atomic<ClpULong> s_uiBudget( 0 );
+
+static std::mutex s_cReclaimMutex;
+static std::map<int, CalypMemory::ReclaimFn> s_apfReclaimers;
+static int s_iNextReclaimerId = 0;
+
+thread_local int s_iThreadCategory = CLP_MEMORY_FRAME;
+thread_local bool s_bReclaiming = false;
+
+static void updatePeak( std::atomic<ClpULong>& ruiPeak, ClpULong uiValue )
+{
+  ClpULong uiPeak = ruiPeak.load( std::memory_order_relaxed );
+  while( uiValue > uiPeak && !ruiPeak.compare_exchange_weak( uiPeak, uiValue, std::memory_order_relaxed ) )
+  {
+  }
+}
+
+//! Ask the reclaimers to free uiBytes (skipped if another thread is doing it)
+static void reclaim( ClpULong uiBytes )
+{
+  if( s_bReclaiming )
+    return;
+  std::unique_lock<std::mutex> lock( s_cReclaimMutex, std::try_to_lock );
+  if( !lock.owns_lock() )
+    return;
+  s_bReclaiming = true;
+  ClpULong uiFreed = 0;
+  for( auto it = s_apfReclaimers.begin(); it != s_apfReclaimers.end() && uiFreed < uiBytes; ++it )
+  {
+    uiFreed += it->second( uiBytes - uiFreed );
+  }
+  s_bReclaiming = false;
+}
+
+void CalypMemory::allocate( int iCategory, ClpULong uiBytes )
+{
+  if( iCategory < 0 || iCategory >= CLP_MEMORY_NUMBER_CATEGORIES || uiBytes == 0 )
+    return;
+  ClpULong uiBudget = s_uiBudget.load( std::memory_order_relaxed );
+  if( uiBudget > 0 )
+  {
+    ClpULong uiTotal = s_uiTotalCurrent.load( std::memory_order_relaxed ) + uiBytes;
+    if( uiTotal > uiBudget )
+      reclaim( uiTotal - uiBudget );
+  }
+  updatePeak( s_auiPeak[iCategory], s_auiCurrent[iCategory].fetch_add( uiBytes, std::memory_order_relaxed ) + uiBytes );
+  updatePeak( s_uiTotalPeak, s_uiTotalCurrent.fetch_add( uiBytes, std::memory_order_relaxed ) + uiBytes );
+}
+
+void CalypMemory::release( int iCategory, ClpULong uiBytes )
+{
+  if( iCategory < 0 || iCategory >= CLP_MEMORY_NUMBER_CATEGORIES )
+    return;
+  s_auiCurrent[iCategory].fetch_sub( uiBytes, std::memory_order_relaxed );
+  s_uiTotalCurrent.fetch_sub( uiBytes, std::memory_order_relaxed );
+}
+
+CalypMemory::Usage CalypMemory::get( int iCategory )
+{
+  Usage cUsage = { 0, 0 };
+  if( iCategory >= 0 && iCategory < CLP_MEMORY_NUMBER_CATEGORIES )
+  {
+    cUsage.uiCurrent = s_auiCurrent[iCategory].load( std::memory_order_relaxed );
+    cUsage.uiPeak = s_auiPeak[iCategory].load( std::memory_order_relaxed );
+  }
+  return cUsage;
+}
+
+CalypMemory::Usage CalypMemory::getTotal()
+{
+  Usage cUsage = { s_uiTotalCurrent.load( std::memory_order_relaxed ), s_uiTotalPeak.load( std::memory_order_relaxed ) };
+  return cUsage;
+}
+
+const char* CalypMemory::getCategoryName( int iCategory )
+{
+  static const char* s_apchNames[CLP_MEMORY_NUMBER_CATEGORIES] = {
+      "Frames", "Stream buffers", "Stream caches", "Handler buffers", "Modules",
+  };
+  return iCategory >= 0 && iCategory < CLP_MEMORY_NUMBER_CATEGORIES ? s_apchNames[iCategory] : "";
+}
+
+ClpString CalypMemory::report()
+{
+  ClpString strReport;
+  char acLine[128];
+  snprintf( acLine, sizeof( acLine ), "%-16s %12s %12s\n", "Memory", "Current (MB)", "Peak (MB)" );
+  strReport += acLine;
+  for( int i = 0; i <= CLP_MEMORY_NUMBER_CATEGORIES; i++ )
+  {
+    Usage cUsage = i < CLP_MEMORY_NUMBER_CATEGORIES ? get( i ) : getTotal();
+    if( cUsage.uiPeak == 0 )
+      continue;
+    snprintf( acLine, sizeof( acLine ), "%-16s %12.1f %12.1f\n", i < CLP_MEMORY_NUMBER_CATEGORIES ? getCategoryName( i ) : "Total",
+              cUsage.uiCurrent / ( 1024.0 * 1024.0 ), cUsage.uiPeak / ( 1024.0 * 1024.0 ) );
+    strReport += acLine;
+  }
+  ClpULong uiBudget = getBudget();
+  if( uiBudget > 0 )
+  {
+    snprintf( acLine, sizeof( acLine ), "%-16s %12.1f\n", "Budget", uiBudget / ( 1024.0 * 1024.0 ) );
+    strReport += acLine;
+  }
+  return strReport;
+}
+
+void CalypMemory::setBudget( ClpULong uiBytes )
+{
+  s_uiBudget.store( uiBytes );
+  ClpULong uiTotal = s_uiTotalCurrent.load( std::memory_order_relaxed );
+  if( uiBytes > 0 && uiTotal > uiBytes )
+    reclaim( uiTotal - uiBytes );
+}
+
+ClpULong CalypMemory::getBudget()
+{
+  return s_uiBudget.load( std::memory_order_relaxed );
+}
+
+ClpULong CalypMemory::getAvailable()
+{
+  ClpULong uiBudget = getBudget();
+  if( uiBudget == 0 )
+    return CLP_MEMORY_UNLIMITED;
+  ClpULong uiTotal = s_uiTotalCurrent.load( std::memory_order_relaxed );
+  return uiTotal < uiBudget ? uiBudget - uiTotal : 0;
+}
+
+int CalypMemory::addReclaimer( ReclaimFn pfReclaim )
+{
+  std::lock_guard<std::mutex> lock( s_cReclaimMutex );
+  int iId = s_iNextReclaimerId++;
+  s_apfReclaimers[iId] = pfReclaim;
+  return iId;
+}
+
+void CalypMemory::removeReclaimer( int iId )
+{
+  std::lock_guard<std::mutex> lock( s_cReclaimMutex );
+  s_apfReclaimers.erase( iId );
+}
+
+int CalypMemory::getThreadCategory()
+{
+  return s_iThreadCategory;
+}
+
+void CalypMemory::setThreadCategory( int iCategory )
+{
+  s_iThreadCategory = iCategory;
+}
+
+//! Budget requested with CALYP_MEMORY_BUDGET=<MB>
+static struct CalypMemoryEnvironment
+{
+  CalypMemoryEnvironment()
+  {
+    const char* pchBudget = getenv( "CALYP_MEMORY_BUDGET" );
+    if( pchBudget && atoi( pchBudget ) > 0 )
+      CalypMemory::setBudget( ClpULong( atoi( pchBudget ) ) * 1024 * 1024 );
+  }
+} s_cMemoryEnvironment;
@@ -0,0 +1,120 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * \file     CalypMemory.h
+ * \ingroup  CalypLibGrp
+ * \brief    Accounting and budget of the memory used by frames and streams
+ */
+
+#ifndef __CALYPMEMORY_H__
+#define __CALYPMEMORY_H__
+
+#include "CalypDefs.h"
+
+#include <functional>
+
+#define CLP_MEMORY_UNLIMITED ClpULong( -1 )
+
+/**
+ * Users of the memory accounted by the library
+ */
+enum CalypMemoryCategory
+{
+  CLP_MEMORY_FRAME = 0,  //!< Frames not covered by the other categories
+  CLP_MEMORY_STREAM,     //!< Frame buffers of the streams (including loadAll)
+  CLP_MEMORY_CACHE,      //!< Frame caches of the streams (evicted on demand)
+  CLP_MEMORY_HANDLER,    //!< I/O and read-ahead buffers of the stream handlers
+  CLP_MEMORY_MODULE,     //!< Frames allocated by the modules
+  CLP_MEMORY_NUMBER_CATEGORIES,
+};
+
+/**
+ * \class    CalypMemory
+ * \ingroup  CalypLibGrp
+ * \brief    Process wide registry of the allocated memory
+ *
+ * Frames are accounted in the category of the allocating thread (see
+ * CalypMemoryScope). When a budget is set, allocations that exceed it
+ * first ask the reclaimers (the stream caches) to free memory; they
+ * never fail because of the budget. The CALYP_MEMORY_BUDGET environment
+ * variable sets the budget in MB
+ */
+class CalypMemory
+{
+public:
+  struct Usage
+  {
+    ClpULong uiCurrent;
+    ClpULong uiPeak;
+  };
+
+  static void allocate( int iCategory, ClpULong uiBytes );
+  static void release( int iCategory, ClpULong uiBytes );
+
+  static Usage get( int iCategory );
+  static Usage getTotal();
+  static const char* getCategoryName( int iCategory );
+
+  //! Table with the current and peak usage of each category
+  static ClpString report();
+
+  /**
+   * Limit the accounted memory
+   * @param uiBytes budget (0 no limit)
+   */
+  static void setBudget( ClpULong uiBytes );
+  static ClpULong getBudget();
+  //! Memory left in the budget (CLP_MEMORY_UNLIMITED without budget)
+  static ClpULong getAvailable();
+
+  /**
+   * Called with the number of bytes to free; returns the bytes freed.
+   * Reclaimers must not block (e.g., try_lock their mutex)
+   */
+  typedef std::function<ClpULong( ClpULong )> ReclaimFn;
+  static int addReclaimer( ReclaimFn pfReclaim );
+  static void removeReclaimer( int iId );
+
+  //! Category of the frames allocated by the calling thread
+  static int getThreadCategory();
+  static void setThreadCategory( int iCategory );
+};
+
+/**
+ * \class    CalypMemoryScope
+ * \ingroup  CalypLibGrp
+ * \brief    Accounts the frames allocated by the thread during the
+ *           lifetime of the object in one category
+ */
+class CalypMemoryScope
+{
+public:
+  CalypMemoryScope( int iCategory ) : m_iPrevCategory( CalypMemory::getThreadCategory() )
+  {
+    CalypMemory::setThreadCategory( iCategory );
+  }
+  ~CalypMemoryScope() { CalypMemory::setThreadCategory( m_iPrevCategory ); }
+
+private:
+  int m_iPrevCategory;
+};
+
+#endif  // __CALYPMEMORY_H__
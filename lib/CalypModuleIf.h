@@ -65,6 +65,7 @@ enum Module_API_Version
   CLP_MODULE_API_1,
   CLP_MODULE_API_2,
   CLP_MODULE_API_3,
+  CLP_MODULE_API_4,
 };
 
 /** Module_Type Enum
@@ -93,6 +94,9 @@ enum Module_Features
   CLP_MODULE_USES_KEYS = 8,
   CLP_MODULES_VARIABLE_NUM_FRAMES = 16,
   CLP_MODULES_HAS_INFO = 32,
+  CLP_MODULE_FRAME_INDEPENDENT = 64,  //!< No state between frames (frames can be processed in parallel)
+  CLP_MODULE_REENTRANT = 128,         //!< API 4 process() can run concurrently on the same instance
+  CLP_MODULE_IN_PLACE = 256,          //!< API 4 output can be the first input (when the formats match)
   CLP_MODULE_REQURES_MAX = 1024,
 };
 
@@ -127,6 +131,12 @@ public:
   unsigned int m_iFrameBufferCount;
   CalypFrame* m_pcOutputFrame;
 
+  //! Format of the output frames (API 4, see setOutputFormat)
+  unsigned int m_uiOutputWidth;
+  unsigned int m_uiOutputHeight;
+  int m_iOutputPelFormat;
+  unsigned int m_uiOutputBitsPel;
+
   CalypOptions m_cModuleOptions;
 
   CalypModuleIf()
@@ -136,6 +146,10 @@ public:
     m_pchModuleLongName = NULL;
     m_pcOutputFrame = NULL;
     m_iFrameBufferCount = 0;
+    m_uiOutputWidth = 0;
+    m_uiOutputHeight = 0;
+    m_iOutputPelFormat = CLP_INVALID_FMT;
+    m_uiOutputBitsPel = 0;
   }
   virtual ~CalypModuleIf() {}
   virtual void Delete() = 0;
@@ -156,7 +170,25 @@ public:
    * Module API version 2
    */
   virtual bool create( std::vector<CalypFrame*> apcFrameList ) { return false; }
-  virtual CalypFrame* process( std::vector<CalypFrame*> ) { return NULL; }
+  /**
+   * API 4 modules also run on hosts of the previous versions: the output
+   * is written to a frame owned by the module (m_pcOutputFrame)
+   */
+  virtual CalypFrame* process( std::vector<CalypFrame*> apcFrameList )
+  {
+    if( m_iModuleAPI != CLP_MODULE_API_4 || apcFrameList.size() != m_uiNumberOfFrames )
+      return NULL;
+    if( m_pcOutputFrame && !isOutputFormat( m_pcOutputFrame ) )
+    {
+      delete m_pcOutputFrame;
+      m_pcOutputFrame = NULL;
+    }
+    if( !m_pcOutputFrame )
+      m_pcOutputFrame = newOutputFrame();
+    if( !m_pcOutputFrame || !process( apcFrameList, m_pcOutputFrame ) )
+      return NULL;
+    return m_pcOutputFrame;
+  }
   virtual double measure( std::vector<CalypFrame*> ) { return 0; }
   virtual bool keyPressed( enum Module_Key_Supported ) { return false; }
   virtual ClpString moduleInfo() { return ClpString(); }
@@ -170,6 +202,54 @@ public:
     m_iFrameBufferCount = 0;
     return true;
   };
+  /**
+   * Module API version 4
+   * The host owns the output frames. create() (API 2) checks the inputs
+   * and sets the output format (setOutputFormat); the host allocates the
+   * outputs with newOutputFrame() and may reuse or pool them. Modules
+   * declare CLP_MODULE_REENTRANT if process() can be called from several
+   * threads at once (with different outputs) and CLP_MODULE_IN_PLACE if
+   * the output can be the first input
+   */
+  virtual bool process( std::vector<CalypFrame*> apcFrameList, CalypFrame* pcOutput ) { return false; }
+  /**
+   * Process several sets of input frames (one output for each set) in one
+   * call. Modules can override it to amortize their per-call overhead
+   */
+  virtual bool processBatch( const std::vector<std::vector<CalypFrame*>>& aapcFrameSets,
+                             const std::vector<CalypFrame*>& apcOutputList )
+  {
+    if( aapcFrameSets.size() != apcOutputList.size() )
+      return false;
+    for( unsigned int i = 0; i < aapcFrameSets.size(); i++ )
+      if( !process( aapcFrameSets[i], apcOutputList[i] ) )
+        return false;
+    return true;
+  }
+  void setOutputFormat( unsigned int uiWidth, unsigned int uiHeight, int iPelFormat, unsigned int uiBitsPel )
+  {
+    m_uiOutputWidth = uiWidth;
+    m_uiOutputHeight = uiHeight;
+    m_iOutputPelFormat = iPelFormat;
+    m_uiOutputBitsPel = uiBitsPel;
+  }
+  CalypFrame* newOutputFrame() const
+  {
+    if( m_iOutputPelFormat == CLP_INVALID_FMT )
+      return NULL;
+    return new CalypFrame( m_uiOutputWidth, m_uiOutputHeight, m_iOutputPelFormat, m_uiOutputBitsPel );
+  }
+  bool isOutputFormat( const CalypFrame* pcFrame ) const
+  {
+    return pcFrame->getWidth() == m_uiOutputWidth && pcFrame->getHeight() == m_uiOutputHeight &&
+           pcFrame->getPelFormat() == m_iOutputPelFormat && pcFrame->getBitsPel() == m_uiOutputBitsPel;
+  }
+  //! The first input can be used as output (API 4)
+  bool canProcessInPlace( const std::vector<CalypFrame*>& apcFrameList ) const
+  {
+    return ( m_uiModuleRequirements & CLP_MODULE_IN_PLACE ) && apcFrameList.size() > 0 &&
+           isOutputFormat( apcFrameList[0] );
+  }
 };
 
 #endif  // __CALYPMODULESIF_H__
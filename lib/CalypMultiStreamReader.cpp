@@ -0,0 +1,227 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * \file     CalypMultiStreamReader.cpp
+ * \brief    Synchronized reading of several input streams
+ */
+
+#include "CalypMultiStreamReader.h"
+
+#include "CalypFrame.h"
+#include "CalypStats.h"
+#include "CalypStream.h"
+#include "CalypStreamHandlerIf.h"
+#include "CalypThreadPool.h"
+#include "config.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#ifdef USE_LIBURING
+#include <liburing.h>
+#endif
+
+/**
+ * Read the remaining bytes of a request (synchronous fallback)
+ */
+static bool readRequest( const CalypAsyncReadRequest& rcRequest, ClpULong uiDone )
+{
+#ifndef _WIN32
+  while( uiDone < rcRequest.uiSize )
+  {
+    ssize_t iRead = pread( rcRequest.iFileDescriptor, rcRequest.pBuffer + uiDone, rcRequest.uiSize - uiDone,
+                           rcRequest.uiOffset + uiDone );
+    if( iRead <= 0 )
+      return false;
+    uiDone += iRead;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+struct CalypMultiStreamReaderPrivate
+{
+  std::vector<CalypStream*> apcStreams;
+  CalypThreadPool* pcThreadPool;
+#ifdef USE_LIBURING
+  struct io_uring cRing;
+#endif
+  bool bRing;
+
+  /**
+   * Issue all requests at once; abSuccess reports each one
+   */
+  void submitReads( const std::vector<CalypAsyncReadRequest>& acRequests, const std::vector<unsigned int>& auiStreams,
+                    std::vector<char>& abSuccess )
+  {
+    abSuccess.assign( apcStreams.size(), false );
+#ifdef USE_LIBURING
+    if( bRing )
+    {
+      unsigned int uiPending = 0;
+      for( unsigned int i = 0; i < auiStreams.size(); i++ )
+      {
+        unsigned int s = auiStreams[i];
+        struct io_uring_sqe* pcSqe = io_uring_get_sqe( &cRing );
+        if( !pcSqe )
+        {
+          io_uring_submit( &cRing );
+          pcSqe = io_uring_get_sqe( &cRing );
+        }
+        io_uring_prep_read( pcSqe, acRequests[s].iFileDescriptor, acRequests[s].pBuffer, acRequests[s].uiSize,
+                            acRequests[s].uiOffset );
+        io_uring_sqe_set_data( pcSqe, (void*)uintptr_t( s ) );
+        uiPending++;
+      }
+      io_uring_submit( &cRing );
+      while( uiPending > 0 )
+      {
+        struct io_uring_cqe* pcCqe;
+        if( io_uring_wait_cqe( &cRing, &pcCqe ) < 0 )
+          break;
+        unsigned int s = (unsigned int)uintptr_t( io_uring_cqe_get_data( pcCqe ) );
+        int iRes = pcCqe->res;
+        io_uring_cqe_seen( &cRing, pcCqe );
+        uiPending--;
+        // Short reads and unsupported operations (old kernels) are completed with pread
+        abSuccess[s] = readRequest( acRequests[s], iRes > 0 ? ClpULong( iRes ) : 0 );
+      }
+      if( uiPending == 0 )
+        return;
+      // The ring failed: it cannot be reused safely
+      io_uring_queue_exit( &cRing );
+      bRing = false;
+    }
+#endif
+    std::vector<std::future<void>> acTasks;
+    for( unsigned int i = 0; i < auiStreams.size(); i++ )
+    {
+      unsigned int s = auiStreams[i];
+      if( abSuccess[s] )
+        continue;
+      const CalypAsyncReadRequest* pcRequest = &acRequests[s];
+      acTasks.push_back( pcThreadPool->addTask( [pcRequest, s, &abSuccess]() { abSuccess[s] = readRequest( *pcRequest, 0 ); } ) );
+    }
+    for( unsigned int i = 0; i < acTasks.size(); i++ )
+      acTasks[i].get();
+  }
+};
+
+CalypMultiStreamReader::CalypMultiStreamReader( const std::vector<CalypStream*>& apcStreams )
+    : d( new CalypMultiStreamReaderPrivate )
+{
+  d->apcStreams = apcStreams;
+  d->pcThreadPool = new CalypThreadPool( std::max<unsigned int>( 1, apcStreams.size() ) );
+  d->bRing = false;
+#ifdef USE_LIBURING
+  d->bRing = io_uring_queue_init( std::max<unsigned int>( 1, apcStreams.size() ), &d->cRing, 0 ) == 0;
+#endif
+}
+
+CalypMultiStreamReader::~CalypMultiStreamReader()
+{
+#ifdef USE_LIBURING
+  if( d->bRing )
+    io_uring_queue_exit( &d->cRing );
+#endif
+  delete d->pcThreadPool;
+  delete d;
+}
+
+bool CalypMultiStreamReader::isAsyncIO() const
+{
+  return d->bRing;
+}
+
+bool CalypMultiStreamReader::readNextFrames()
+{
+  // The streams are only advanced together, so none moves when one of them ended
+  for( unsigned int s = 0; s < d->apcStreams.size(); s++ )
+  {
+    if( !d->apcStreams[s]->hasNextFrame() )
+      return false;
+  }
+  for( unsigned int s = 0; s < d->apcStreams.size(); s++ )
+  {
+    d->apcStreams[s]->setNextFrame();
+  }
+
+  std::vector<CalypAsyncReadRequest> acRequests( d->apcStreams.size() );
+  std::vector<unsigned int> auiAsyncStreams;
+  std::vector<std::future<void>> acTasks;
+  for( unsigned int s = 0; s < d->apcStreams.size(); s++ )
+  {
+    CalypStream* pcStream = d->apcStreams[s];
+    if( pcStream->prepareNextFrameRead( acRequests[s] ) )
+      auiAsyncStreams.push_back( s );
+    else
+      acTasks.push_back( d->pcThreadPool->addTask( [pcStream]() { pcStream->readNextFrame(); } ) );
+  }
+
+  std::vector<char> abSuccess;  // not vector<bool>: written by several threads
+  {
+    // The batched reads are accounted as a single read
+    CalypStatsTimer cTimer( CLP_STATS_READ );
+    ClpULong uiBytes = 0;
+    for( unsigned int i = 0; i < auiAsyncStreams.size(); i++ )
+      uiBytes += acRequests[auiAsyncStreams[i]].uiSize;
+    cTimer.setBytes( uiBytes );
+    d->submitReads( acRequests, auiAsyncStreams, abSuccess );
+  }
+
+  // Conversion of the read bytes into frames
+  for( unsigned int i = 0; i < auiAsyncStreams.size(); i++ )
+  {
+    CalypStream* pcStream = d->apcStreams[auiAsyncStreams[i]];
+    bool bSuccess = abSuccess[auiAsyncStreams[i]];
+    acTasks.push_back( d->pcThreadPool->addTask( [pcStream, bSuccess]() { pcStream->finishNextFrameRead( bSuccess ); } ) );
+  }
+  // Wait for every task before reporting a failure
+  std::exception_ptr pcError;
+  for( unsigned int i = 0; i < acTasks.size(); i++ )
+  {
+    try
+    {
+      acTasks[i].get();
+    }
+    catch( ... )
+    {
+      pcError = std::current_exception();
+    }
+  }
+  if( pcError )
+    std::rethrow_exception( pcError );
+  return true;
+}
+
+std::vector<CalypFrame*> CalypMultiStreamReader::getCurrFrames() const
+{
+  std::vector<CalypFrame*> apcFrames;
+  for( unsigned int s = 0; s < d->apcStreams.size(); s++ )
+    apcFrames.push_back( d->apcStreams[s]->getCurrFrame() );
+  return apcFrames;
+}
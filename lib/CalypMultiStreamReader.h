@@ -0,0 +1,68 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * \file     CalypMultiStreamReader.h
+ * \ingroup  CalypStreamGrp
+ * \brief    Synchronized reading of several input streams
+ */
+
+#ifndef __CALYPMULTISTREAMREADER_H__
+#define __CALYPMULTISTREAMREADER_H__
+
+#include "CalypDefs.h"
+
+class CalypFrame;
+class CalypStream;
+
+/**
+ * \class CalypMultiStreamReader
+ * \ingroup CalypLibGrp CalypStreamGrp
+ * \brief  Advance several input streams together
+ *
+ * The reads of the next frame of every stream are issued as one batch
+ * of asynchronous I/O (io_uring when available, a thread per stream
+ * otherwise). Streams that cannot be read this way (e.g., compressed
+ * files) are decoded in parallel on the same threads
+ */
+class CalypMultiStreamReader
+{
+public:
+  /**
+   * @param apcStreams opened input streams (not owned)
+   */
+  CalypMultiStreamReader( const std::vector<CalypStream*>& apcStreams );
+  ~CalypMultiStreamReader();
+
+  //! True if the reads are issued through io_uring
+  bool isAsyncIO() const;
+
+  /**
+   * Move every stream to its next frame
+   * @return false if any of the streams reached its end
+   */
+  bool readNextFrames();
+
+  std::vector<CalypFrame*> getCurrFrames() const;
+
+private:
+  struct CalypMultiStreamReaderPrivate* d;
+};
+
+#endif  // __CALYPMULTISTREAMREADER_H__
@@ -0,0 +1,466 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * \file     CalypPlaneKernels.cpp
+ * \ingroup  CalypLibGrp
+ * \brief    Pixel-wise kernels over planes of samples
+ */
+
+#include "CalypPlaneKernels.h"
+
+#include "CalypFrame.h"
+#include "config.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+//! Side of the square tiles of the transposition: 64 x 64 samples of
+//! source and destination (16 KB) stay in L1
+#define CLP_TRANSPOSE_BLOCK 64
+
+#if defined( USE_SSE ) && defined( __SSE2__ )
+#define CLP_PLANE_KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+/**
+ * Division by a constant lower than 256: powers of two are shifts, the
+ * others a multiplication by ( 2^32 / d + 1 ) followed by a 32 bits
+ * shift, exact for dividends below 2^24
+ */
+struct DivisionByConstant
+{
+  DivisionByConstant( unsigned int uiDivisor )
+  {
+    uiShift = 0;
+    while( ( 1u << uiShift ) < uiDivisor )
+      uiShift++;
+    bIsShift = ( 1u << uiShift ) == uiDivisor;
+    uiMagic = bIsShift ? 0 : std::uint32_t( ( std::uint64_t( 1 ) << 32 ) / uiDivisor + 1 );
+  }
+  inline std::uint32_t divide( std::uint32_t uiValue ) const
+  {
+    return bIsShift ? uiValue >> uiShift : std::uint32_t( ( std::uint64_t( uiValue ) * uiMagic ) >> 32 );
+  }
+  bool bIsShift;
+  unsigned int uiShift;
+  std::uint32_t uiMagic;
+};
+
+#ifdef CLP_PLANE_KERNELS_SSE2
+
+static inline __m128i sseDivide( __m128i v, const DivisionByConstant& cDiv )
+{
+  if( cDiv.bIsShift )
+    return _mm_srl_epi32( v, _mm_cvtsi32_si128( cDiv.uiShift ) );
+  const __m128i vMagic = _mm_set1_epi32( int( cDiv.uiMagic ) );
+  const __m128i vHighMask = _mm_set_epi32( -1, 0, -1, 0 );
+  __m128i vEven = _mm_srli_epi64( _mm_mul_epu32( v, vMagic ), 32 );
+  __m128i vOdd = _mm_mul_epu32( _mm_srli_epi64( v, 32 ), vMagic );
+  return _mm_or_si128( vEven, _mm_and_si128( vOdd, vHighMask ) );
+}
+
+//! Unsigned saturated pack of two vectors of 32 bits to 16 bits
+static inline __m128i ssePackUnsigned( __m128i v0, __m128i v1 )
+{
+  const __m128i vBias32 = _mm_set1_epi32( 0x8000 );
+  const __m128i vBias16 = _mm_set1_epi16( short( 0x8000 ) );
+  return _mm_xor_si128( _mm_packs_epi32( _mm_sub_epi32( v0, vBias32 ), _mm_sub_epi32( v1, vBias32 ) ), vBias16 );
+}
+
+static inline __m128i sseReverse( __m128i v )
+{
+  v = _mm_shuffle_epi32( v, _MM_SHUFFLE( 0, 1, 2, 3 ) );
+  v = _mm_shufflelo_epi16( v, _MM_SHUFFLE( 2, 3, 0, 1 ) );
+  return _mm_shufflehi_epi16( v, _MM_SHUFFLE( 2, 3, 0, 1 ) );
+}
+
+static inline void sseTranspose8x8( ClpPel* pDst, std::ptrdiff_t iDstStride, const ClpPel* pSrc, std::ptrdiff_t iSrcStride )
+{
+  __m128i aRow[8];
+  for( int i = 0; i < 8; i++ )
+    aRow[i] = _mm_loadu_si128( (const __m128i*)( pSrc + i * iSrcStride ) );
+
+  __m128i a0 = _mm_unpacklo_epi16( aRow[0], aRow[1] );
+  __m128i a1 = _mm_unpackhi_epi16( aRow[0], aRow[1] );
+  __m128i a2 = _mm_unpacklo_epi16( aRow[2], aRow[3] );
+  __m128i a3 = _mm_unpackhi_epi16( aRow[2], aRow[3] );
+  __m128i a4 = _mm_unpacklo_epi16( aRow[4], aRow[5] );
+  __m128i a5 = _mm_unpackhi_epi16( aRow[4], aRow[5] );
+  __m128i a6 = _mm_unpacklo_epi16( aRow[6], aRow[7] );
+  __m128i a7 = _mm_unpackhi_epi16( aRow[6], aRow[7] );
+
+  __m128i b0 = _mm_unpacklo_epi32( a0, a2 );
+  __m128i b1 = _mm_unpackhi_epi32( a0, a2 );
+  __m128i b2 = _mm_unpacklo_epi32( a1, a3 );
+  __m128i b3 = _mm_unpackhi_epi32( a1, a3 );
+  __m128i b4 = _mm_unpacklo_epi32( a4, a6 );
+  __m128i b5 = _mm_unpackhi_epi32( a4, a6 );
+  __m128i b6 = _mm_unpacklo_epi32( a5, a7 );
+  __m128i b7 = _mm_unpackhi_epi32( a5, a7 );
+
+  _mm_storeu_si128( (__m128i*)( pDst + 0 * iDstStride ), _mm_unpacklo_epi64( b0, b4 ) );
+  _mm_storeu_si128( (__m128i*)( pDst + 1 * iDstStride ), _mm_unpackhi_epi64( b0, b4 ) );
+  _mm_storeu_si128( (__m128i*)( pDst + 2 * iDstStride ), _mm_unpacklo_epi64( b1, b5 ) );
+  _mm_storeu_si128( (__m128i*)( pDst + 3 * iDstStride ), _mm_unpackhi_epi64( b1, b5 ) );
+  _mm_storeu_si128( (__m128i*)( pDst + 4 * iDstStride ), _mm_unpacklo_epi64( b2, b6 ) );
+  _mm_storeu_si128( (__m128i*)( pDst + 5 * iDstStride ), _mm_unpackhi_epi64( b2, b6 ) );
+  _mm_storeu_si128( (__m128i*)( pDst + 6 * iDstStride ), _mm_unpacklo_epi64( b3, b7 ) );
+  _mm_storeu_si128( (__m128i*)( pDst + 7 * iDstStride ), _mm_unpackhi_epi64( b3, b7 ) );
+}
+
+#endif
+
+static inline void transposeScalar( ClpPel* pDst, std::ptrdiff_t iDstStride, const ClpPel* pSrc, std::ptrdiff_t iSrcStride,
+                                    unsigned int uiWidth, unsigned int uiHeight )
+{
+  for( unsigned int y = 0; y < uiHeight; y++ )
+    for( unsigned int x = 0; x < uiWidth; x++ )
+      pDst[x * iDstStride + y] = pSrc[y * iSrcStride + x];
+}
+
+/**
+ * Power of two rescaling of a plane: averages groups of samples where
+ * the destination is smaller and repeats samples where it is larger
+ */
+static void rescalePlane( ClpPel* pDst, unsigned int uiDstWidth, unsigned int uiDstHeight, const ClpPel* pSrc,
+                          unsigned int uiSrcWidth, unsigned int uiSrcHeight )
+{
+  unsigned int uiCols = uiSrcWidth > uiDstWidth ? uiSrcWidth / uiDstWidth : 1;
+  unsigned int uiRows = uiSrcHeight > uiDstHeight ? uiSrcHeight / uiDstHeight : 1;
+  unsigned int uiCount = uiCols * uiRows;
+  for( unsigned int y = 0; y < uiDstHeight; y++ )
+  {
+    unsigned int uiFirstRow = uiRows > 1 ? y * uiRows : ClpULong( y ) * uiSrcHeight / uiDstHeight;
+    for( unsigned int x = 0; x < uiDstWidth; x++ )
+    {
+      unsigned int uiFirstCol = uiCols > 1 ? x * uiCols : ClpULong( x ) * uiSrcWidth / uiDstWidth;
+      unsigned int uiSum = 0;
+      for( unsigned int j = 0; j < uiRows; j++ )
+        for( unsigned int i = 0; i < uiCols; i++ )
+          uiSum += pSrc[ClpULong( uiFirstRow + j ) * uiSrcWidth + uiFirstCol + i];
+      pDst[ClpULong( y ) * uiDstWidth + x] = ClpPel( ( uiSum + uiCount / 2 ) / uiCount );
+    }
+  }
+}
+
+const char* CalypPlaneKernels::getInstructionSet()
+{
+#ifdef CLP_PLANE_KERNELS_SSE2
+  return "SSE2";
+#else
+  return "C++";
+#endif
+}
+
+void CalypPlaneKernels::blend( ClpPel* pDst, const ClpPel* pA, const ClpPel* pB, ClpULong uiSize, unsigned int uiWeightA,
+                               unsigned int uiWeightB, unsigned int uiDivisor )
+{
+  DivisionByConstant cDiv( uiDivisor );
+  ClpULong i = 0;
+#ifdef CLP_PLANE_KERNELS_SSE2
+  const __m128i vWeightA = _mm_set1_epi16( short( uiWeightA ) );
+  const __m128i vWeightB = _mm_set1_epi16( short( uiWeightB ) );
+  for( ; i + 8 <= uiSize; i += 8 )
+  {
+    __m128i vA = _mm_loadu_si128( (const __m128i*)( pA + i ) );
+    __m128i vB = _mm_loadu_si128( (const __m128i*)( pB + i ) );
+    __m128i vLowA = _mm_mullo_epi16( vA, vWeightA );
+    __m128i vHighA = _mm_mulhi_epu16( vA, vWeightA );
+    __m128i vLowB = _mm_mullo_epi16( vB, vWeightB );
+    __m128i vHighB = _mm_mulhi_epu16( vB, vWeightB );
+    __m128i vSum0 = _mm_add_epi32( _mm_unpacklo_epi16( vLowA, vHighA ), _mm_unpacklo_epi16( vLowB, vHighB ) );
+    __m128i vSum1 = _mm_add_epi32( _mm_unpackhi_epi16( vLowA, vHighA ), _mm_unpackhi_epi16( vLowB, vHighB ) );
+    _mm_storeu_si128( (__m128i*)( pDst + i ), ssePackUnsigned( sseDivide( vSum0, cDiv ), sseDivide( vSum1, cDiv ) ) );
+  }
+#endif
+  for( ; i < uiSize; i++ )
+    pDst[i] = ClpPel( cDiv.divide( std::uint32_t( pA[i] ) * uiWeightA + std::uint32_t( pB[i] ) * uiWeightB ) );
+}
+
+void CalypPlaneKernels::absDiff( ClpPel* pDst, const ClpPel* pA, const ClpPel* pB, ClpULong uiSize )
+{
+  ClpULong i = 0;
+#ifdef CLP_PLANE_KERNELS_SSE2
+  for( ; i + 8 <= uiSize; i += 8 )
+  {
+    __m128i vA = _mm_loadu_si128( (const __m128i*)( pA + i ) );
+    __m128i vB = _mm_loadu_si128( (const __m128i*)( pB + i ) );
+    _mm_storeu_si128( (__m128i*)( pDst + i ), _mm_or_si128( _mm_subs_epu16( vA, vB ), _mm_subs_epu16( vB, vA ) ) );
+  }
+#endif
+  for( ; i < uiSize; i++ )
+    pDst[i] = pA[i] > pB[i] ? pA[i] - pB[i] : pB[i] - pA[i];
+}
+
+void CalypPlaneKernels::threshold( ClpPel* pDst, const ClpPel* pSrc, ClpULong uiSize, ClpPel uiThreshold, ClpPel uiLow,
+                                   ClpPel uiHigh )
+{
+  ClpULong i = 0;
+#ifdef CLP_PLANE_KERNELS_SSE2
+  const __m128i vThreshold = _mm_set1_epi16( short( uiThreshold ) );
+  const __m128i vLow = _mm_set1_epi16( short( uiLow ) );
+  const __m128i vHigh = _mm_set1_epi16( short( uiHigh ) );
+  const __m128i vZero = _mm_setzero_si128();
+  for( ; i + 8 <= uiSize; i += 8 )
+  {
+    __m128i vSrc = _mm_loadu_si128( (const __m128i*)( pSrc + i ) );
+    // pSrc >= threshold when the saturated ( threshold - pSrc ) is zero
+    __m128i vMask = _mm_cmpeq_epi16( _mm_subs_epu16( vThreshold, vSrc ), vZero );
+    _mm_storeu_si128( (__m128i*)( pDst + i ), _mm_or_si128( _mm_and_si128( vMask, vHigh ), _mm_andnot_si128( vMask, vLow ) ) );
+  }
+#endif
+  for( ; i < uiSize; i++ )
+    pDst[i] = pSrc[i] >= uiThreshold ? uiHigh : uiLow;
+}
+
+void CalypPlaneKernels::shift( ClpPel* pDst, const ClpPel* pSrc, ClpULong uiSize, int iShift )
+{
+  ClpULong i = 0;
+  if( iShift >= 0 )
+  {
+#ifdef CLP_PLANE_KERNELS_SSE2
+    const __m128i vCount = _mm_cvtsi32_si128( iShift );
+    for( ; i + 8 <= uiSize; i += 8 )
+      _mm_storeu_si128( (__m128i*)( pDst + i ), _mm_srl_epi16( _mm_loadu_si128( (const __m128i*)( pSrc + i ) ), vCount ) );
+#endif
+    for( ; i < uiSize; i++ )
+      pDst[i] = pSrc[i] >> iShift;
+  }
+  else
+  {
+    iShift = -iShift;
+#ifdef CLP_PLANE_KERNELS_SSE2
+    const __m128i vCount = _mm_cvtsi32_si128( iShift );
+    for( ; i + 8 <= uiSize; i += 8 )
+      _mm_storeu_si128( (__m128i*)( pDst + i ), _mm_sll_epi16( _mm_loadu_si128( (const __m128i*)( pSrc + i ) ), vCount ) );
+#endif
+    for( ; i < uiSize; i++ )
+      pDst[i] = ClpPel( pSrc[i] << iShift );
+  }
+}
+
+void CalypPlaneKernels::applyLut( ClpPel* pDst, const ClpPel* pSrc, ClpULong uiSize, const ClpPel* pLut )
+{
+  // There is no gather before AVX2: unroll to overlap the table loads
+  ClpULong i = 0;
+  for( ; i + 4 <= uiSize; i += 4 )
+  {
+    ClpPel uiValue0 = pLut[pSrc[i]];
+    ClpPel uiValue1 = pLut[pSrc[i + 1]];
+    ClpPel uiValue2 = pLut[pSrc[i + 2]];
+    ClpPel uiValue3 = pLut[pSrc[i + 3]];
+    pDst[i] = uiValue0;
+    pDst[i + 1] = uiValue1;
+    pDst[i + 2] = uiValue2;
+    pDst[i + 3] = uiValue3;
+  }
+  for( ; i < uiSize; i++ )
+    pDst[i] = pLut[pSrc[i]];
+}
+
+void CalypPlaneKernels::upsample( ClpPel* pDst, const ClpPel* pSrc, ClpULong uiDstSize, unsigned int uiLog2Factor )
+{
+  ClpULong i = 0;
+#ifdef CLP_PLANE_KERNELS_SSE2
+  if( uiLog2Factor == 1 )
+  {
+    for( ; i + 16 <= uiDstSize; i += 16 )
+    {
+      __m128i vSrc = _mm_loadu_si128( (const __m128i*)( pSrc + ( i >> 1 ) ) );
+      _mm_storeu_si128( (__m128i*)( pDst + i ), _mm_unpacklo_epi16( vSrc, vSrc ) );
+      _mm_storeu_si128( (__m128i*)( pDst + i + 8 ), _mm_unpackhi_epi16( vSrc, vSrc ) );
+    }
+  }
+#endif
+  for( ; i < uiDstSize; i++ )
+    pDst[i] = pSrc[i >> uiLog2Factor];
+}
+
+void CalypPlaneKernels::reverse( ClpPel* pDst, const ClpPel* pSrc, ClpULong uiSize )
+{
+  ClpULong i = 0;
+#ifdef CLP_PLANE_KERNELS_SSE2
+  for( ; i + 8 <= uiSize; i += 8 )
+    _mm_storeu_si128( (__m128i*)( pDst + i ), sseReverse( _mm_loadu_si128( (const __m128i*)( pSrc + uiSize - i - 8 ) ) ) );
+#endif
+  for( ; i < uiSize; i++ )
+    pDst[i] = pSrc[uiSize - 1 - i];
+}
+
+void CalypPlaneKernels::transpose( ClpPel* pDst, std::ptrdiff_t iDstStride, const ClpPel* pSrc, std::ptrdiff_t iSrcStride,
+                                   unsigned int uiWidth, unsigned int uiHeight )
+{
+  for( unsigned int uiBlockY = 0; uiBlockY < uiHeight; uiBlockY += CLP_TRANSPOSE_BLOCK )
+  {
+    unsigned int uiBlockHeight = std::min<unsigned int>( CLP_TRANSPOSE_BLOCK, uiHeight - uiBlockY );
+    unsigned int uiTilesHeight = uiBlockHeight & ~7u;
+    for( unsigned int uiBlockX = 0; uiBlockX < uiWidth; uiBlockX += CLP_TRANSPOSE_BLOCK )
+    {
+      unsigned int uiBlockWidth = std::min<unsigned int>( CLP_TRANSPOSE_BLOCK, uiWidth - uiBlockX );
+      unsigned int uiTilesWidth = uiBlockWidth & ~7u;
+      const ClpPel* pSrcBlock = pSrc + std::ptrdiff_t( uiBlockY ) * iSrcStride + uiBlockX;
+      ClpPel* pDstBlock = pDst + std::ptrdiff_t( uiBlockX ) * iDstStride + uiBlockY;
+
+      // 8 x 8 tiles
+      for( unsigned int y = 0; y < uiTilesHeight; y += 8 )
+        for( unsigned int x = 0; x < uiTilesWidth; x += 8 )
+        {
+#ifdef CLP_PLANE_KERNELS_SSE2
+          sseTranspose8x8( pDstBlock + std::ptrdiff_t( x ) * iDstStride + y, iDstStride,
+                           pSrcBlock + std::ptrdiff_t( y ) * iSrcStride + x, iSrcStride );
+#else
+          transposeScalar( pDstBlock + std::ptrdiff_t( x ) * iDstStride + y, iDstStride,
+                           pSrcBlock + std::ptrdiff_t( y ) * iSrcStride + x, iSrcStride, 8, 8 );
+#endif
+        }
+      // Right and bottom borders
+      transposeScalar( pDstBlock + std::ptrdiff_t( uiTilesWidth ) * iDstStride, iDstStride, pSrcBlock + uiTilesWidth,
+                       iSrcStride, uiBlockWidth - uiTilesWidth, uiTilesHeight );
+      transposeScalar( pDstBlock + uiTilesHeight, iDstStride, pSrcBlock + std::ptrdiff_t( uiTilesHeight ) * iSrcStride,
+                       iSrcStride, uiBlockWidth, uiBlockHeight - uiTilesHeight );
+    }
+  }
+}
+
+void CalypPlaneKernels::blend( CalypFrame* pcDst, const CalypFrame* pcA, const CalypFrame* pcB, unsigned int uiWeightA,
+                               unsigned int uiWeightB, unsigned int uiDivisor )
+{
+  const CalypFrame* apcSrc[2] = { pcA, pcB };
+  std::vector<ClpPel> aauiRow[2];
+
+  for( unsigned int ch = 0; ch < pcDst->getNumberChannels(); ch++ )
+  {
+    unsigned int uiWidth = pcDst->getWidth( ch );
+    unsigned int uiHeight = pcDst->getHeight( ch );
+    ClpPel** ppDst = pcDst->getPelBufferYUV()[ch];
+
+    int aiLog2Width[2];
+    int aiLog2Height[2];
+    bool abIsZero[2];
+    bool bSameSampling = true;
+    for( unsigned int s = 0; s < 2; s++ )
+    {
+      abIsZero[s] = ch >= apcSrc[s]->getNumberChannels();
+      aiLog2Width[s] = 0;
+      aiLog2Height[s] = 0;
+      if( ch > 0 && !abIsZero[s] )
+      {
+        aiLog2Width[s] = int( apcSrc[s]->getChromaWidthRatio() ) - int( pcDst->getChromaWidthRatio() );
+        aiLog2Height[s] = int( apcSrc[s]->getChromaHeightRatio() ) - int( pcDst->getChromaHeightRatio() );
+        if( aiLog2Width[s] < 0 || aiLog2Height[s] < 0 )
+          throw CalypFailure( "CalypPlaneKernels", "The destination cannot have coarser chroma than the sources" );
+      }
+      if( abIsZero[s] )
+        aauiRow[s].assign( uiWidth, 0 );
+      else if( aiLog2Width[s] > 0 )
+        aauiRow[s].resize( uiWidth );
+      bSameSampling &= !abIsZero[s] && aiLog2Width[s] == 0 && aiLog2Height[s] == 0;
+    }
+
+    if( bSameSampling )
+    {
+      // Planes are contiguous
+      blend( ppDst[0], pcA->getPelBufferYUV()[ch][0], pcB->getPelBufferYUV()[ch][0], ClpULong( uiWidth ) * uiHeight,
+             uiWeightA, uiWeightB, uiDivisor );
+      continue;
+    }
+
+    for( unsigned int y = 0; y < uiHeight; y++ )
+    {
+      const ClpPel* apRow[2];
+      for( unsigned int s = 0; s < 2; s++ )
+      {
+        if( abIsZero[s] )
+        {
+          apRow[s] = aauiRow[s].data();
+          continue;
+        }
+        const ClpPel* pSrcRow = apcSrc[s]->getPelBufferYUV()[ch][y >> aiLog2Height[s]];
+        if( aiLog2Width[s] > 0 )
+        {
+          upsample( aauiRow[s].data(), pSrcRow, uiWidth, aiLog2Width[s] );
+          pSrcRow = aauiRow[s].data();
+        }
+        apRow[s] = pSrcRow;
+      }
+      blend( ppDst[y], apRow[0], apRow[1], uiWidth, uiWeightA, uiWeightB, uiDivisor );
+    }
+  }
+}
+
+bool CalypPlaneKernels::rotate( CalypFrame* pcDst, const CalypFrame* pcSrc, int iAngle )
+{
+  bool bSwap = iAngle == 90 || iAngle == 270;
+  if( !bSwap && iAngle != 0 && iAngle != 180 )
+    return false;
+  if( pcDst->getPelFormat() != pcSrc->getPelFormat() ||
+      pcDst->getWidth() != ( bSwap ? pcSrc->getHeight() : pcSrc->getWidth() ) ||
+      pcDst->getHeight() != ( bSwap ? pcSrc->getWidth() : pcSrc->getHeight() ) )
+    return false;
+
+  std::vector<ClpPel> auiRotated;
+  for( unsigned int ch = 0; ch < pcDst->getNumberChannels(); ch++ )
+  {
+    unsigned int uiWidth = pcSrc->getWidth( ch );
+    unsigned int uiHeight = pcSrc->getHeight( ch );
+    const ClpPel* pSrc = pcSrc->getPelBufferYUV()[ch][0];
+    ClpPel* pDst = pcDst->getPelBufferYUV()[ch][0];
+
+    switch( iAngle )
+    {
+    case 0:
+      if( pDst != pSrc )
+        memcpy( pDst, pSrc, ClpULong( uiWidth ) * uiHeight * sizeof( ClpPel ) );
+      break;
+    case 180:
+      for( unsigned int y = 0; y < uiHeight; y++ )
+        reverse( pDst + ClpULong( uiHeight - 1 - y ) * uiWidth, pSrc + ClpULong( y ) * uiWidth, uiWidth );
+      break;
+    case 90:
+    case 270:
+    {
+      // Chroma subsampled in one direction only does not match the
+      // rotated plane and is rotated into a temporary plane first
+      bool bRescale = pcDst->getWidth( ch ) != uiHeight || pcDst->getHeight( ch ) != uiWidth;
+      ClpPel* pRotated = pDst;
+      if( bRescale )
+      {
+        auiRotated.resize( ClpULong( uiWidth ) * uiHeight );
+        pRotated = auiRotated.data();
+      }
+      // 90: transpose from the last row up; 270: transpose into the last row up
+      if( iAngle == 90 )
+        transpose( pRotated, uiHeight, pSrc + ClpULong( uiHeight - 1 ) * uiWidth, -std::ptrdiff_t( uiWidth ), uiWidth,
+                   uiHeight );
+      else
+        transpose( pRotated + ClpULong( uiWidth - 1 ) * uiHeight, -std::ptrdiff_t( uiHeight ), pSrc, uiWidth, uiWidth,
+                   uiHeight );
+      if( bRescale )
+        rescalePlane( pDst, pcDst->getWidth( ch ), pcDst->getHeight( ch ), pRotated, uiHeight, uiWidth );
+      break;
+    }
+    }
+  }
+  return true;
+}
@@ -0,0 +1,108 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * \file     CalypPlaneKernels.h
+ * \ingroup  CalypLibGrp
+ * \brief    Pixel-wise kernels over planes of samples
+ */
+
+#ifndef __CALYPPLANEKERNELS_H__
+#define __CALYPPLANEKERNELS_H__
+
+#include "CalypDefs.h"
+
+#include <cstddef>
+
+class CalypFrame;
+
+/**
+ * \class    CalypPlaneKernels
+ * \ingroup  CalypLibGrp
+ * \brief    Vectorized operations over runs of samples
+ *
+ * The kernels work on contiguous samples (a plane, a row or the whole
+ * frame buffer). With USE_SSE they use SSE2, otherwise plain loops
+ * written to be auto-vectorized. Source and destination may be the same
+ * buffer (but must not partially overlap)
+ */
+class CalypPlaneKernels
+{
+public:
+  //! Instruction set used by the kernels
+  static const char* getInstructionSet();
+
+  /**
+   * Weighted average pDst[i] = ( pA[i] * uiWeightA + pB[i] * uiWeightB ) / uiDivisor
+   * (truncated). The weights and the divisor must be lower than 256
+   * and uiWeightA + uiWeightB must not be larger than uiDivisor
+   */
+  static void blend( ClpPel* pDst, const ClpPel* pA, const ClpPel* pB, ClpULong uiSize, unsigned int uiWeightA,
+                     unsigned int uiWeightB, unsigned int uiDivisor );
+
+  //! pDst[i] = | pA[i] - pB[i] |
+  static void absDiff( ClpPel* pDst, const ClpPel* pA, const ClpPel* pB, ClpULong uiSize );
+
+  //! pDst[i] = pSrc[i] >= uiThreshold ? uiHigh : uiLow
+  static void threshold( ClpPel* pDst, const ClpPel* pSrc, ClpULong uiSize, ClpPel uiThreshold, ClpPel uiLow,
+                         ClpPel uiHigh );
+
+  //! pDst[i] = pSrc[i] >> iShift (iShift > 0) or pSrc[i] << -iShift (iShift < 0)
+  static void shift( ClpPel* pDst, const ClpPel* pSrc, ClpULong uiSize, int iShift );
+
+  //! pDst[i] = pLut[pSrc[i]] (the table must cover every source value)
+  static void applyLut( ClpPel* pDst, const ClpPel* pSrc, ClpULong uiSize, const ClpPel* pLut );
+
+  //! Sample repetition pDst[i] = pSrc[i >> uiLog2Factor] for uiDstSize samples
+  static void upsample( ClpPel* pDst, const ClpPel* pSrc, ClpULong uiDstSize, unsigned int uiLog2Factor );
+
+  //! pDst[i] = pSrc[uiSize - 1 - i] (the buffers must not overlap)
+  static void reverse( ClpPel* pDst, const ClpPel* pSrc, ClpULong uiSize );
+
+  /**
+   * Blocked transposition of a uiWidth x uiHeight block:
+   * pDst[x * iDstStride + y] = pSrc[y * iSrcStride + x]. Negative strides
+   * (pointing to the last row) flip the block, which gives the 90 and 270
+   * degrees rotations. The buffers must not overlap
+   */
+  static void transpose( ClpPel* pDst, std::ptrdiff_t iDstStride, const ClpPel* pSrc, std::ptrdiff_t iSrcStride,
+                         unsigned int uiWidth, unsigned int uiHeight );
+
+  /**
+   * Frame level blend of each channel of pcDst. Sources with coarser
+   * chroma are upsampled by repetition (as getPixel) and missing channels
+   * (gray sources) are taken as zero. pcDst may be one of the sources
+   * when it has the same sampling
+   */
+  static void blend( CalypFrame* pcDst, const CalypFrame* pcA, const CalypFrame* pcB, unsigned int uiWeightA,
+                     unsigned int uiWeightB, unsigned int uiDivisor );
+
+  /**
+   * Clockwise rotation of each plane by iAngle (0, 90, 180 or 270) into
+   * pcDst, which must have the same format and the rotated size. At 90
+   * and 270 degrees the chroma of formats subsampled in one direction
+   * only (4:2:2) is averaged along the new subsampled direction and
+   * repeated along the other
+   * @return false if the angle or the size of pcDst are not valid
+   */
+  static bool rotate( CalypFrame* pcDst, const CalypFrame* pcSrc, int iAngle );
+};
+
+#endif  // __CALYPPLANEKERNELS_H__
@@ -0,0 +1,278 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * \file     CalypRemap.cpp
+ * \ingroup  CalypLibGrp
+ * \brief    Geometric remapping with precomputed tables
+ */
+
+#include "CalypRemap.h"
+
+#include "CalypFrame.h"
+#include "PixelFormats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#define CLP_REMAP_FRAC_BITS 8
+#define CLP_REMAP_ONE ( 1 << CLP_REMAP_FRAC_BITS )
+//! Set in usFracX when the right neighbour is the first sample of the row
+#define CLP_REMAP_WRAPPED 0x8000
+#define CLP_REMAP_FRAC_MASK ( 2 * CLP_REMAP_ONE - 1 )
+
+struct CalypRemapEntry
+{
+  unsigned int uiIndex;  //!< Top-left input sample
+  unsigned short usFracX;
+  unsigned short usFracY;
+};
+
+struct CalypRemapTable
+{
+  unsigned int uiWidth;
+  unsigned int uiHeight;
+  std::ptrdiff_t iStepX;         //!< Offset of the right neighbour (0 in planes one sample wide)
+  std::ptrdiff_t iStepY;         //!< Offset of the lower neighbour (0 in planes one sample high)
+  std::ptrdiff_t iWrappedStepX;  //!< Offset from the last sample of a row to the first one
+  std::vector<CalypRemapEntry> acEntries;
+};
+
+struct CalypRemapPrivate
+{
+  unsigned int uiDstWidth;
+  unsigned int uiDstHeight;
+  unsigned int uiSrcWidth;
+  unsigned int uiSrcHeight;
+  int iPelFormat;
+  bool bBilinear;
+  unsigned int uiRegionWidth;
+  unsigned int uiRegionHeight;
+  bool bWrapX;
+  std::vector<CalypRemapTable> acTables;
+};
+
+/**
+ * Position of an input sample along one direction: index of the first
+ * sample and weight of the second one. Samples are read from
+ * [ uiBegin, uiEnd ) or, wrapping around, from the whole [ 0, uiEnd )
+ * of a plane with uiPlaneSize samples
+ */
+static void mapPosition( double dPos, unsigned int uiBegin, unsigned int uiEnd, unsigned int uiPlaneSize, bool bWrap,
+                         bool bBilinear, unsigned int& ruiFirst, unsigned short& rusFrac )
+{
+  unsigned int uiSize = uiEnd - uiBegin;
+  rusFrac = 0;
+  if( bWrap )
+  {
+    dPos -= uiSize * std::floor( dPos / uiSize );
+    if( !bBilinear || uiSize == 1 )
+    {
+      ruiFirst = (unsigned int)( dPos + 0.5 ) % uiSize;
+      return;
+    }
+    ruiFirst = std::min( (unsigned int)dPos, uiSize - 1 );
+    unsigned int uiFrac = (unsigned int)std::floor( ( dPos - ruiFirst ) * CLP_REMAP_ONE + 0.5 );
+    if( uiFrac == CLP_REMAP_ONE )
+    {
+      ruiFirst = ( ruiFirst + 1 ) % uiSize;
+      uiFrac = 0;
+    }
+    rusFrac = (unsigned short)uiFrac;
+    if( uiFrac && ruiFirst == uiSize - 1 )
+      rusFrac |= CLP_REMAP_WRAPPED;
+    return;
+  }
+  dPos = std::min( std::max( dPos, double( uiBegin ) ), double( uiEnd - 1 ) );
+  if( !bBilinear )
+  {
+    ruiFirst = std::min( (unsigned int)( dPos + 0.5 ), uiEnd - 1 );
+    return;
+  }
+  if( uiSize == 1 )
+  {
+    // The taps must stay in the plane even with no weight: a region
+    // one sample wide at the end of the plane is read as the second tap
+    ruiFirst = uiBegin;
+    if( uiEnd == uiPlaneSize && uiBegin > 0 )
+    {
+      ruiFirst = uiBegin - 1;
+      rusFrac = CLP_REMAP_ONE;
+    }
+    return;
+  }
+  ruiFirst = std::min( (unsigned int)dPos, uiEnd - 2 );
+  rusFrac = (unsigned short)std::floor( ( dPos - ruiFirst ) * CLP_REMAP_ONE + 0.5 );
+}
+
+/**
+ * Samples of a plane covered by the region of the luma position dPos
+ */
+static void regionBounds( double dPos, unsigned int uiRegionSize, unsigned int uiSize, unsigned int uiLog2Ratio,
+                          unsigned int& ruiBegin, unsigned int& ruiEnd )
+{
+  unsigned int uiPlaneSize = CHROMASHIFT( uiSize, uiLog2Ratio );
+  if( !uiRegionSize || uiRegionSize >= uiSize )
+  {
+    ruiBegin = 0;
+    ruiEnd = uiPlaneSize;
+    return;
+  }
+  // The region is found in luma samples, where the positions given by
+  // the mapping are exact
+  unsigned int uiRegions = ( uiSize + uiRegionSize - 1 ) / uiRegionSize;
+  double dRegion = std::floor( ( dPos + 0.5 ) / uiRegionSize );
+  unsigned int uiRegion = (unsigned int)std::min( std::max( dRegion, 0.0 ), double( uiRegions - 1 ) );
+  ruiBegin = std::min( CHROMASHIFT( uiRegion * uiRegionSize, uiLog2Ratio ), uiPlaneSize - 1 );
+  ruiEnd = std::max( std::min( CHROMASHIFT( ( uiRegion + 1 ) * uiRegionSize, uiLog2Ratio ), uiPlaneSize ), ruiBegin + 1 );
+}
+
+CalypRemap::CalypRemap()
+    : d( new CalypRemapPrivate )
+{
+  d->uiDstWidth = 0;
+  d->uiDstHeight = 0;
+  d->uiSrcWidth = 0;
+  d->uiSrcHeight = 0;
+  d->iPelFormat = -1;
+  d->bBilinear = true;
+  d->uiRegionWidth = 0;
+  d->uiRegionHeight = 0;
+  d->bWrapX = false;
+}
+
+CalypRemap::~CalypRemap()
+{
+  delete d;
+}
+
+void CalypRemap::setRegionSize( unsigned int uiWidth, unsigned int uiHeight )
+{
+  d->uiRegionWidth = uiWidth;
+  d->uiRegionHeight = uiHeight;
+}
+
+void CalypRemap::setHorizontalWrap( bool bWrap )
+{
+  d->bWrapX = bWrap;
+}
+
+bool CalypRemap::create( unsigned int uiDstWidth, unsigned int uiDstHeight, unsigned int uiSrcWidth,
+                         unsigned int uiSrcHeight, int iPelFormat, const MapFunction& fnMap, int iInterpolation )
+{
+  destroy();
+  auto itFormat = g_CalypPixFmtDescriptorsMap.find( iPelFormat );
+  if( itFormat == g_CalypPixFmtDescriptorsMap.end() || !uiDstWidth || !uiDstHeight || !uiSrcWidth || !uiSrcHeight )
+    return false;
+  const CalypPixelFormatDescriptor& rcFormat = itFormat->second;
+
+  d->uiDstWidth = uiDstWidth;
+  d->uiDstHeight = uiDstHeight;
+  d->uiSrcWidth = uiSrcWidth;
+  d->uiSrcHeight = uiSrcHeight;
+  d->iPelFormat = iPelFormat;
+  d->bBilinear = iInterpolation == CLP_REMAP_BILINEAR;
+
+  // The luma table is also used by channels with the same sampling
+  unsigned int uiTables = rcFormat.numberChannels > 1 && ( rcFormat.log2ChromaWidth || rcFormat.log2ChromaHeight ) ? 2 : 1;
+  d->acTables.resize( uiTables );
+  for( unsigned int t = 0; t < uiTables; t++ )
+  {
+    unsigned int uiLog2Width = t > 0 ? rcFormat.log2ChromaWidth : 0;
+    unsigned int uiLog2Height = t > 0 ? rcFormat.log2ChromaHeight : 0;
+    double dRatioX = double( 1 << uiLog2Width );
+    double dRatioY = double( 1 << uiLog2Height );
+    unsigned int uiSrcPlaneWidth = CHROMASHIFT( uiSrcWidth, uiLog2Width );
+    unsigned int uiSrcPlaneHeight = CHROMASHIFT( uiSrcHeight, uiLog2Height );
+
+    CalypRemapTable& rcTable = d->acTables[t];
+    rcTable.uiWidth = CHROMASHIFT( uiDstWidth, uiLog2Width );
+    rcTable.uiHeight = CHROMASHIFT( uiDstHeight, uiLog2Height );
+    rcTable.iStepX = uiSrcPlaneWidth > 1 ? 1 : 0;
+    rcTable.iStepY = uiSrcPlaneHeight > 1 ? uiSrcPlaneWidth : 0;
+    rcTable.iWrappedStepX = 1 - std::ptrdiff_t( uiSrcPlaneWidth );
+    rcTable.acEntries.resize( ClpULong( rcTable.uiWidth ) * rcTable.uiHeight );
+
+    CalypRemapEntry* pcEntry = rcTable.acEntries.data();
+    for( unsigned int y = 0; y < rcTable.uiHeight; y++ )
+    {
+      for( unsigned int x = 0; x < rcTable.uiWidth; x++, pcEntry++ )
+      {
+        double dSrcX, dSrcY;
+        fnMap( ( x + 0.5 ) * dRatioX - 0.5, ( y + 0.5 ) * dRatioY - 0.5, dSrcX, dSrcY );
+        unsigned int uiBeginX, uiEndX, uiBeginY, uiEndY;
+        regionBounds( dSrcX, d->bWrapX ? 0 : d->uiRegionWidth, uiSrcWidth, uiLog2Width, uiBeginX, uiEndX );
+        regionBounds( dSrcY, d->uiRegionHeight, uiSrcHeight, uiLog2Height, uiBeginY, uiEndY );
+        unsigned int uiSrcX, uiSrcY;
+        mapPosition( ( dSrcX + 0.5 ) / dRatioX - 0.5, uiBeginX, uiEndX, uiSrcPlaneWidth, d->bWrapX, d->bBilinear, uiSrcX,
+                     pcEntry->usFracX );
+        mapPosition( ( dSrcY + 0.5 ) / dRatioY - 0.5, uiBeginY, uiEndY, uiSrcPlaneHeight, false, d->bBilinear, uiSrcY,
+                     pcEntry->usFracY );
+        pcEntry->uiIndex = uiSrcY * uiSrcPlaneWidth + uiSrcX;
+      }
+    }
+  }
+  return true;
+}
+
+void CalypRemap::destroy()
+{
+  std::vector<CalypRemapTable>().swap( d->acTables );
+  d->iPelFormat = -1;
+}
+
+bool CalypRemap::remap( CalypFrame* pcDst, const CalypFrame* pcSrc ) const
+{
+  if( d->acTables.empty() || pcDst->getPelFormat() != d->iPelFormat || pcSrc->getPelFormat() != d->iPelFormat ||
+      pcDst->getWidth() != d->uiDstWidth || pcDst->getHeight() != d->uiDstHeight ||
+      pcSrc->getWidth() != d->uiSrcWidth || pcSrc->getHeight() != d->uiSrcHeight )
+    return false;
+
+  for( unsigned int ch = 0; ch < pcDst->getNumberChannels(); ch++ )
+  {
+    const CalypRemapTable& rcTable = d->acTables[std::min<unsigned int>( ch, d->acTables.size() - 1 )];
+    const CalypRemapEntry* pcEntry = rcTable.acEntries.data();
+    const CalypRemapEntry* pcEnd = pcEntry + rcTable.acEntries.size();
+    const ClpPel* pSrc = pcSrc->getPelBufferYUV()[ch][0];
+    ClpPel* pDst = pcDst->getPelBufferYUV()[ch][0];
+    if( !d->bBilinear )
+    {
+      for( ; pcEntry != pcEnd; pcEntry++ )
+        *pDst++ = pSrc[pcEntry->uiIndex];
+      continue;
+    }
+    const std::ptrdiff_t iStepY = rcTable.iStepY;
+    for( ; pcEntry != pcEnd; pcEntry++ )
+    {
+      const ClpPel* pTaps = pSrc + pcEntry->uiIndex;
+      std::ptrdiff_t iStepX = pcEntry->usFracX & CLP_REMAP_WRAPPED ? rcTable.iWrappedStepX : rcTable.iStepX;
+      unsigned int uiFracX = pcEntry->usFracX & CLP_REMAP_FRAC_MASK;
+      unsigned int uiFracY = pcEntry->usFracY;
+      // At most 16 bits samples times 16 bits of weights
+      unsigned int uiTop = pTaps[0] * ( CLP_REMAP_ONE - uiFracX ) + pTaps[iStepX] * uiFracX;
+      unsigned int uiBottom = pTaps[iStepY] * ( CLP_REMAP_ONE - uiFracX ) + pTaps[iStepY + iStepX] * uiFracX;
+      *pDst++ = ClpPel( ( uiTop * ( CLP_REMAP_ONE - uiFracY ) + uiBottom * uiFracY + ( 1 << ( 2 * CLP_REMAP_FRAC_BITS - 1 ) ) ) >>
+                        ( 2 * CLP_REMAP_FRAC_BITS ) );
+    }
+  }
+  return true;
+}
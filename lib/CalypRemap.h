@@ -0,0 +1,99 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * \file     CalypRemap.h
+ * \ingroup  CalypLibGrp
+ * \brief    Geometric remapping with precomputed tables
+ */
+
+#ifndef __CALYPREMAP_H__
+#define __CALYPREMAP_H__
+
+#include "CalypDefs.h"
+
+#include <functional>
+
+class CalypFrame;
+
+enum CalypRemapInterpolation
+{
+  CLP_REMAP_NEAREST = 0,
+  CLP_REMAP_BILINEAR,
+};
+
+/**
+ * \class    CalypRemap
+ * \ingroup  CalypLibGrp
+ * \brief    Applies a fixed per-sample mapping to frames
+ *
+ * The mapping from each output sample to its position in the input frame
+ * is evaluated once in create() and kept, for every plane, as the index
+ * of the top-left input sample and the bilinear weights (8 bits of
+ * fraction). remap() only reads the tables, so it can run concurrently
+ * on several frames.
+ *
+ * The input can be split in regions (e.g., the faces of a cubemap) that
+ * the interpolation of a sample does not cross, and the columns can wrap
+ * around (e.g., the longitude of an equirectangular frame). Both are
+ * applied in the sampling of each plane
+ */
+class CalypRemap
+{
+public:
+  /**
+   * Map from the centre of an output luma sample ( dX, dY ) to a
+   * position in the input luma samples (chroma samples are taken as
+   * centred on the luma samples they cover)
+   */
+  typedef std::function<void( double dX, double dY, double& rdSrcX, double& rdSrcY )> MapFunction;
+
+  CalypRemap();
+  ~CalypRemap();
+
+  /**
+   * Size in luma samples of the regions of the input, starting at the
+   * top-left corner (0 for the whole frame). Used by the next create()
+   */
+  void setRegionSize( unsigned int uiWidth, unsigned int uiHeight );
+  //! Interpolate across the left and right borders (used by the next create())
+  void setHorizontalWrap( bool bWrap );
+
+  /**
+   * Build the tables
+   * @param iPelFormat pel format of both frames
+   * @param iInterpolation CalypRemapInterpolation
+   * @return false if a size is zero
+   */
+  bool create( unsigned int uiDstWidth, unsigned int uiDstHeight, unsigned int uiSrcWidth, unsigned int uiSrcHeight,
+               int iPelFormat, const MapFunction& fnMap, int iInterpolation = CLP_REMAP_BILINEAR );
+  void destroy();
+
+  /**
+   * Fill pcDst from pcSrc
+   * @return false if the frames do not have the sizes and format of the tables
+   */
+  bool remap( CalypFrame* pcDst, const CalypFrame* pcSrc ) const;
+
+private:
+  struct CalypRemapPrivate* d;
+};
+
+#endif  // __CALYPREMAP_H__
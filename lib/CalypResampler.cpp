@@ -0,0 +1,455 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * \file     CalypResampler.cpp
+ * \ingroup  CalypLibGrp
+ * \brief    Separable polyphase scaler
+ */
+
+#include "CalypResampler.h"
+
+#include "CalypFrame.h"
+#include "CalypThreadPool.h"
+#include "config.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <future>
+#include <vector>
+
+#if defined( USE_SSE ) && defined( __SSE2__ )
+#define CLP_RESAMPLER_SSE2
+#include <emmintrin.h>
+#endif
+
+//! Maximum number of filter banks kept (luma and chroma of both directions)
+#define CLP_RESAMPLER_MAX_BANKS 8
+//! Minimum number of rows of a band given to a thread
+#define CLP_RESAMPLER_MIN_BAND_ROWS 16
+
+/**
+ * Filters of one direction: output sample i is the weighted sum of
+ * uiTaps input samples starting at auiFirst[i]
+ */
+struct CalypResamplerFilterBank
+{
+  int iFilter;
+  unsigned int uiSrcSize;
+  unsigned int uiDstSize;
+  double dScale;
+  unsigned int uiLog2Ratio;
+  double dSitingOffset;
+
+  bool bIdentity;
+  unsigned int uiTaps;
+  std::vector<unsigned int> auiFirst;
+  std::vector<float> afCoeffs;
+};
+
+struct CalypResamplerPrivate
+{
+  int iFilter;
+  int iChromaSiting;
+  unsigned int uiNumThreads;
+  CalypThreadPool* pcThreadPool;
+
+  std::vector<CalypResamplerFilterBank> acBanks;
+  std::vector<float> afRows;  //!< Horizontally filtered rows
+  std::vector<float> afAccumulators;
+
+  CalypResamplerPrivate()
+      : iFilter( CLP_RESAMPLER_BICUBIC ), iChromaSiting( CLP_CHROMA_SITING_LEFT ), uiNumThreads( 1 ), pcThreadPool( NULL )
+  {
+    // References to the banks are kept while filtering a plane
+    acBanks.reserve( CLP_RESAMPLER_MAX_BANKS );
+  }
+  ~CalypResamplerPrivate() { delete pcThreadPool; }
+
+  const CalypResamplerFilterBank& getBank( unsigned int uiSrcSize, unsigned int uiDstSize, double dScale,
+                                           unsigned int uiLog2Ratio, double dSitingOffset );
+  void runBands( unsigned int uiSize, const std::function<void( unsigned int, unsigned int )>& fnBand );
+  void resamplePlane( ClpPel* pDst, unsigned int uiDstWidth, unsigned int uiDstHeight, const ClpPel* pSrc,
+                      unsigned int uiSrcWidth, unsigned int uiSrcHeight, unsigned int uiBitsPel, double dScaleX,
+                      double dScaleY, unsigned int uiLog2RatioWidth, unsigned int uiLog2RatioHeight,
+                      double dSitingOffsetX );
+};
+
+/**
+ * Filter kernels
+ */
+
+static double filterRadius( int iFilter )
+{
+  switch( iFilter )
+  {
+  case CLP_RESAMPLER_BILINEAR:
+    return 1;
+  case CLP_RESAMPLER_BICUBIC:
+    return 2;
+  case CLP_RESAMPLER_LANCZOS:
+    return 4;
+  }
+  return 0.5;
+}
+
+static double filterKernel( int iFilter, double dX )
+{
+  const double dPi = 3.14159265358979323846;
+  dX = std::fabs( dX );
+  switch( iFilter )
+  {
+  case CLP_RESAMPLER_BILINEAR:
+    return std::max( 0.0, 1 - dX );
+  case CLP_RESAMPLER_BICUBIC:
+  {
+    const double dA = -0.5;
+    if( dX < 1 )
+      return ( ( dA + 2 ) * dX - ( dA + 3 ) ) * dX * dX + 1;
+    if( dX < 2 )
+      return ( ( dA * dX - 5 * dA ) * dX + 8 * dA ) * dX - 4 * dA;
+    return 0;
+  }
+  case CLP_RESAMPLER_LANCZOS:
+  {
+    const double dLobes = 4;
+    if( dX < 1e-8 )
+      return 1;
+    if( dX >= dLobes )
+      return 0;
+    return dLobes * std::sin( dPi * dX ) * std::sin( dPi * dX / dLobes ) / ( dPi * dPi * dX * dX );
+  }
+  }
+  return dX <= 0.5 ? 1 : 0;
+}
+
+static void buildFilterBank( CalypResamplerFilterBank& rcBank )
+{
+  unsigned int uiSrcSize = rcBank.uiSrcSize;
+  unsigned int uiDstSize = rcBank.uiDstSize;
+  double dRatio = double( 1 << rcBank.uiLog2Ratio );
+  double dFilterScale = std::max( 1.0, rcBank.dScale );
+  double dSupport = filterRadius( rcBank.iFilter ) * dFilterScale;
+
+  // Centre of each output sample in input samples: the sample positions
+  // are mapped through the luma grid, where the chroma sample i sits at
+  // i * ratio + offset
+  std::vector<double> adCenter( uiDstSize );
+  rcBank.bIdentity = uiSrcSize == uiDstSize;
+  for( unsigned int i = 0; i < uiDstSize; i++ )
+  {
+    double dLuma = ( i * dRatio + rcBank.dSitingOffset + 0.5 ) * rcBank.dScale - 0.5;
+    adCenter[i] = ( dLuma - rcBank.dSitingOffset ) / dRatio;
+    rcBank.bIdentity &= std::fabs( adCenter[i] - i ) < 1e-9;
+  }
+
+  if( rcBank.bIdentity || rcBank.iFilter == CLP_RESAMPLER_NEAREST )
+  {
+    rcBank.uiTaps = 1;
+    rcBank.auiFirst.resize( uiDstSize );
+    rcBank.afCoeffs.assign( uiDstSize, 1.0f );
+    for( unsigned int i = 0; i < uiDstSize; i++ )
+    {
+      double dNearest = std::floor( adCenter[i] + 0.5 );
+      rcBank.auiFirst[i] = (unsigned int)std::min( std::max( dNearest, 0.0 ), double( uiSrcSize - 1 ) );
+    }
+    return;
+  }
+
+  unsigned int uiTaps = std::min<unsigned int>( uiSrcSize, (unsigned int)std::ceil( 2 * dSupport ) + 1 );
+  rcBank.uiTaps = uiTaps;
+  rcBank.auiFirst.resize( uiDstSize );
+  rcBank.afCoeffs.assign( ClpULong( uiDstSize ) * uiTaps, 0.0f );
+
+  std::vector<double> adWeights( uiTaps );
+  for( unsigned int i = 0; i < uiDstSize; i++ )
+  {
+    int iBegin = (int)std::ceil( adCenter[i] - dSupport );
+    int iEnd = (int)std::floor( adCenter[i] + dSupport );
+    // Samples out of the plane repeat the border one (the weights are
+    // added to the first/last taps)
+    int iFirst = std::min( std::max( iBegin, 0 ), int( uiSrcSize - uiTaps ) );
+    std::fill( adWeights.begin(), adWeights.end(), 0.0 );
+    double dSum = 0;
+    for( int j = iBegin; j <= iEnd; j++ )
+    {
+      double dWeight = filterKernel( rcBank.iFilter, ( j - adCenter[i] ) / dFilterScale );
+      int iPos = std::min( std::max( j, 0 ), int( uiSrcSize ) - 1 ) - iFirst;
+      adWeights[iPos] += dWeight;
+      dSum += dWeight;
+    }
+    rcBank.auiFirst[i] = iFirst;
+    for( unsigned int k = 0; k < uiTaps; k++ )
+      rcBank.afCoeffs[ClpULong( i ) * uiTaps + k] = float( dSum != 0 ? adWeights[k] / dSum : 0 );
+  }
+}
+
+const CalypResamplerFilterBank& CalypResamplerPrivate::getBank( unsigned int uiSrcSize, unsigned int uiDstSize,
+                                                               double dScale, unsigned int uiLog2Ratio,
+                                                               double dSitingOffset )
+{
+  for( const CalypResamplerFilterBank& rcBank : acBanks )
+  {
+    if( rcBank.iFilter == iFilter && rcBank.uiSrcSize == uiSrcSize && rcBank.uiDstSize == uiDstSize &&
+        rcBank.dScale == dScale && rcBank.uiLog2Ratio == uiLog2Ratio && rcBank.dSitingOffset == dSitingOffset )
+      return rcBank;
+  }
+  acBanks.push_back( CalypResamplerFilterBank() );
+  CalypResamplerFilterBank& rcBank = acBanks.back();
+  rcBank.iFilter = iFilter;
+  rcBank.uiSrcSize = uiSrcSize;
+  rcBank.uiDstSize = uiDstSize;
+  rcBank.dScale = dScale;
+  rcBank.uiLog2Ratio = uiLog2Ratio;
+  rcBank.dSitingOffset = dSitingOffset;
+  buildFilterBank( rcBank );
+  return rcBank;
+}
+
+void CalypResamplerPrivate::runBands( unsigned int uiSize,
+                                      const std::function<void( unsigned int, unsigned int )>& fnBand )
+{
+  unsigned int uiBands = std::min( uiNumThreads, std::max( 1u, uiSize / CLP_RESAMPLER_MIN_BAND_ROWS ) );
+  if( uiBands <= 1 )
+  {
+    fnBand( 0, uiSize );
+    return;
+  }
+  if( !pcThreadPool )
+    pcThreadPool = new CalypThreadPool( uiNumThreads - 1 );
+
+  std::vector<std::future<void>> acBands;
+  unsigned int uiBandSize = ( uiSize + uiBands - 1 ) / uiBands;
+  for( unsigned int uiBegin = uiBandSize; uiBegin < uiSize; uiBegin += uiBandSize )
+  {
+    unsigned int uiEnd = std::min( uiSize, uiBegin + uiBandSize );
+    acBands.push_back( pcThreadPool->addTask( [&fnBand, uiBegin, uiEnd]() { fnBand( uiBegin, uiEnd ); } ) );
+  }
+  fnBand( 0, std::min( uiSize, uiBandSize ) );
+  for( std::future<void>& rcBand : acBands )
+    rcBand.get();
+}
+
+static void horizontalPass( float* pRows, unsigned int uiDstWidth, const ClpPel* pSrc, unsigned int uiSrcWidth,
+                            const CalypResamplerFilterBank& rcBank, unsigned int uiBegin, unsigned int uiEnd )
+{
+  unsigned int uiTaps = rcBank.uiTaps;
+  for( unsigned int y = uiBegin; y < uiEnd; y++ )
+  {
+    const ClpPel* pSrcRow = pSrc + ClpULong( y ) * uiSrcWidth;
+    float* pRow = pRows + ClpULong( y ) * uiDstWidth;
+    if( rcBank.bIdentity )
+    {
+      for( unsigned int x = 0; x < uiDstWidth; x++ )
+        pRow[x] = pSrcRow[x];
+      continue;
+    }
+    const unsigned int* puiFirst = rcBank.auiFirst.data();
+    const float* pfCoeffs = rcBank.afCoeffs.data();
+    for( unsigned int x = 0; x < uiDstWidth; x++, pfCoeffs += uiTaps )
+    {
+      const ClpPel* pTaps = pSrcRow + puiFirst[x];
+      float fSum = 0;
+      for( unsigned int k = 0; k < uiTaps; k++ )
+        fSum += pfCoeffs[k] * pTaps[k];
+      pRow[x] = fSum;
+    }
+  }
+}
+
+/**
+ * The accumulation order is the same with and without SSE2, so both
+ * give the same samples
+ */
+static void verticalPass( ClpPel* pDst, unsigned int uiWidth, const float* pRows, const CalypResamplerFilterBank& rcBank,
+                          float fMaxValue, float* pfAccumulator, unsigned int uiBegin, unsigned int uiEnd )
+{
+  unsigned int uiTaps = rcBank.uiTaps;
+  for( unsigned int y = uiBegin; y < uiEnd; y++ )
+  {
+    const float* pfCoeffs = rcBank.afCoeffs.data() + ClpULong( y ) * uiTaps;
+    const float* pFirstRow = pRows + ClpULong( rcBank.auiFirst[y] ) * uiWidth;
+    ClpPel* pDstRow = pDst + ClpULong( y ) * uiWidth;
+    unsigned int x = 0;
+#ifdef CLP_RESAMPLER_SSE2
+    const __m128 vZero = _mm_setzero_ps();
+    const __m128 vMax = _mm_set1_ps( fMaxValue );
+    const __m128 vHalf = _mm_set1_ps( 0.5f );
+    const __m128i vBias32 = _mm_set1_epi32( 0x8000 );
+    const __m128i vBias16 = _mm_set1_epi16( short( 0x8000 ) );
+    for( ; x + 8 <= uiWidth; x += 8 )
+    {
+      __m128 vSum0 = _mm_setzero_ps();
+      __m128 vSum1 = _mm_setzero_ps();
+      const float* pRow = pFirstRow + x;
+      for( unsigned int k = 0; k < uiTaps; k++, pRow += uiWidth )
+      {
+        __m128 vCoeff = _mm_set1_ps( pfCoeffs[k] );
+        vSum0 = _mm_add_ps( vSum0, _mm_mul_ps( vCoeff, _mm_loadu_ps( pRow ) ) );
+        vSum1 = _mm_add_ps( vSum1, _mm_mul_ps( vCoeff, _mm_loadu_ps( pRow + 4 ) ) );
+      }
+      vSum0 = _mm_add_ps( _mm_min_ps( _mm_max_ps( vSum0, vZero ), vMax ), vHalf );
+      vSum1 = _mm_add_ps( _mm_min_ps( _mm_max_ps( vSum1, vZero ), vMax ), vHalf );
+      __m128i vPel0 = _mm_sub_epi32( _mm_cvttps_epi32( vSum0 ), vBias32 );
+      __m128i vPel1 = _mm_sub_epi32( _mm_cvttps_epi32( vSum1 ), vBias32 );
+      _mm_storeu_si128( (__m128i*)( pDstRow + x ), _mm_xor_si128( _mm_packs_epi32( vPel0, vPel1 ), vBias16 ) );
+    }
+#endif
+    if( x == uiWidth )
+      continue;
+    // Row by row accumulation (vectorized by the compiler)
+    unsigned int uiRemaining = uiWidth - x;
+    std::fill( pfAccumulator, pfAccumulator + uiRemaining, 0.0f );
+    const float* pRow = pFirstRow + x;
+    for( unsigned int k = 0; k < uiTaps; k++, pRow += uiWidth )
+    {
+      float fCoeff = pfCoeffs[k];
+      for( unsigned int i = 0; i < uiRemaining; i++ )
+        pfAccumulator[i] += fCoeff * pRow[i];
+    }
+    for( unsigned int i = 0; i < uiRemaining; i++ )
+      pDstRow[x + i] = ClpPel( std::min( std::max( pfAccumulator[i], 0.0f ), fMaxValue ) + 0.5f );
+  }
+}
+
+void CalypResamplerPrivate::resamplePlane( ClpPel* pDst, unsigned int uiDstWidth, unsigned int uiDstHeight,
+                                           const ClpPel* pSrc, unsigned int uiSrcWidth, unsigned int uiSrcHeight,
+                                           unsigned int uiBitsPel, double dScaleX, double dScaleY,
+                                           unsigned int uiLog2RatioWidth, unsigned int uiLog2RatioHeight,
+                                           double dSitingOffsetX )
+{
+  if( !uiDstWidth || !uiDstHeight || !uiSrcWidth || !uiSrcHeight )
+    return;
+
+  // Room for the banks of both directions
+  if( acBanks.size() + 2 > CLP_RESAMPLER_MAX_BANKS )
+    acBanks.clear();
+  const CalypResamplerFilterBank& rcBankX = getBank( uiSrcWidth, uiDstWidth, dScaleX, uiLog2RatioWidth, dSitingOffsetX );
+  const CalypResamplerFilterBank& rcBankY =
+      getBank( uiSrcHeight, uiDstHeight, dScaleY, uiLog2RatioHeight, ( ( 1 << uiLog2RatioHeight ) - 1 ) / 2.0 );
+  float fMaxValue = float( ( 1 << uiBitsPel ) - 1 );
+
+  afRows.resize( ClpULong( uiSrcHeight ) * uiDstWidth );
+  float* pRows = afRows.data();
+  runBands( uiSrcHeight, [&]( unsigned int uiBegin, unsigned int uiEnd ) {
+    horizontalPass( pRows, uiDstWidth, pSrc, uiSrcWidth, rcBankX, uiBegin, uiEnd );
+  } );
+
+  unsigned int uiBands = std::max( 1u, uiNumThreads );
+  afAccumulators.resize( ClpULong( uiBands ) * uiDstWidth );
+  float* pfAccumulators = afAccumulators.data();
+  unsigned int uiBandSize = ( uiDstHeight + uiBands - 1 ) / uiBands;
+  runBands( uiDstHeight, [&]( unsigned int uiBegin, unsigned int uiEnd ) {
+    // Each band has its own accumulator row
+    float* pfAccumulator = pfAccumulators + ClpULong( uiBegin / uiBandSize ) * uiDstWidth;
+    verticalPass( pDst, uiDstWidth, pRows, rcBankY, fMaxValue, pfAccumulator, uiBegin, uiEnd );
+  } );
+}
+
+/**
+ * CalypResampler
+ */
+
+CalypResampler::CalypResampler( int iFilter, int iChromaSiting, unsigned int uiNumThreads )
+    : d( new CalypResamplerPrivate )
+{
+  setFilter( iFilter );
+  setChromaSiting( iChromaSiting );
+  setNumberOfThreads( uiNumThreads );
+}
+
+CalypResampler::~CalypResampler()
+{
+  delete d;
+}
+
+void CalypResampler::setFilter( int iFilter )
+{
+  if( iFilter < CLP_RESAMPLER_NEAREST || iFilter > CLP_RESAMPLER_LANCZOS )
+    iFilter = CLP_RESAMPLER_BICUBIC;
+  d->iFilter = iFilter;
+}
+
+int CalypResampler::getFilter() const
+{
+  return d->iFilter;
+}
+
+void CalypResampler::setChromaSiting( int iChromaSiting )
+{
+  d->iChromaSiting = iChromaSiting == CLP_CHROMA_SITING_CENTER ? CLP_CHROMA_SITING_CENTER : CLP_CHROMA_SITING_LEFT;
+}
+
+int CalypResampler::getChromaSiting() const
+{
+  return d->iChromaSiting;
+}
+
+void CalypResampler::setNumberOfThreads( unsigned int uiNumThreads )
+{
+  if( uiNumThreads == 0 )
+    uiNumThreads = CalypThreadPool::defaultNumberOfThreads();
+  if( uiNumThreads != d->uiNumThreads )
+  {
+    delete d->pcThreadPool;
+    d->pcThreadPool = NULL;
+  }
+  d->uiNumThreads = std::max( 1u, uiNumThreads );
+}
+
+unsigned int CalypResampler::getNumberOfThreads() const
+{
+  return d->uiNumThreads;
+}
+
+bool CalypResampler::resample( CalypFrame* pcDst, const CalypFrame* pcSrc )
+{
+  if( pcDst->getPelFormat() != pcSrc->getPelFormat() || pcDst->getBitsPel() != pcSrc->getBitsPel() )
+    return false;
+
+  // Chroma uses the scale of luma so that the planes stay aligned
+  double dScaleX = double( pcSrc->getWidth() ) / double( pcDst->getWidth() );
+  double dScaleY = double( pcSrc->getHeight() ) / double( pcDst->getHeight() );
+  for( unsigned int ch = 0; ch < pcDst->getNumberChannels(); ch++ )
+  {
+    unsigned int uiLog2RatioWidth = ch > 0 ? pcSrc->getChromaWidthRatio() : 0;
+    unsigned int uiLog2RatioHeight = ch > 0 ? pcSrc->getChromaHeightRatio() : 0;
+    double dSitingOffsetX = 0;
+    if( d->iChromaSiting == CLP_CHROMA_SITING_CENTER )
+      dSitingOffsetX = ( ( 1 << uiLog2RatioWidth ) - 1 ) / 2.0;
+    d->resamplePlane( pcDst->getPelBufferYUV()[ch][0], pcDst->getWidth( ch ), pcDst->getHeight( ch ),
+                      pcSrc->getPelBufferYUV()[ch][0], pcSrc->getWidth( ch ), pcSrc->getHeight( ch ), pcDst->getBitsPel(),
+                      dScaleX, dScaleY, uiLog2RatioWidth, uiLog2RatioHeight, dSitingOffsetX );
+  }
+  return true;
+}
+
+void CalypResampler::resamplePlane( ClpPel* pDst, unsigned int uiDstWidth, unsigned int uiDstHeight, const ClpPel* pSrc,
+                                    unsigned int uiSrcWidth, unsigned int uiSrcHeight, unsigned int uiBitsPel,
+                                    unsigned int uiLog2RatioWidth, unsigned int uiLog2RatioHeight )
+{
+  double dSitingOffsetX = 0;
+  if( d->iChromaSiting == CLP_CHROMA_SITING_CENTER )
+    dSitingOffsetX = ( ( 1 << uiLog2RatioWidth ) - 1 ) / 2.0;
+  d->resamplePlane( pDst, uiDstWidth, uiDstHeight, pSrc, uiSrcWidth, uiSrcHeight, uiBitsPel,
+                    double( uiSrcWidth ) / double( uiDstWidth ), double( uiSrcHeight ) / double( uiDstHeight ),
+                    uiLog2RatioWidth, uiLog2RatioHeight, dSitingOffsetX );
+}
@@ -0,0 +1,102 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * \file     CalypResampler.h
+ * \ingroup  CalypLibGrp
+ * \brief    Separable polyphase scaler
+ */
+
+#ifndef __CALYPRESAMPLER_H__
+#define __CALYPRESAMPLER_H__
+
+#include "CalypDefs.h"
+
+class CalypFrame;
+
+enum CalypResamplerFilter
+{
+  CLP_RESAMPLER_NEAREST = 0,
+  CLP_RESAMPLER_BILINEAR,
+  CLP_RESAMPLER_BICUBIC,  //!< Catmull-Rom (a = -0.5)
+  CLP_RESAMPLER_LANCZOS,  //!< Lanczos with 4 lobes
+};
+
+/**
+ * Horizontal position of the subsampled chroma samples
+ * (vertically they are always centred between the luma rows)
+ */
+enum CalypChromaSiting
+{
+  CLP_CHROMA_SITING_LEFT = 0,  //!< Co-sited with the even luma columns (MPEG-2, H.264, HEVC)
+  CLP_CHROMA_SITING_CENTER,    //!< Centred between the luma columns (JPEG, MPEG-1)
+};
+
+/**
+ * \class    CalypResampler
+ * \ingroup  CalypLibGrp
+ * \brief    Separable polyphase scaler for any bit depth
+ *
+ * The filters of each output row and column are computed once for each
+ * pair of sizes and kept (filter banks). When downscaling the filters are
+ * stretched to avoid aliasing. Rows are filtered horizontally and then
+ * vertically in single precision floating point; the vertical pass uses
+ * SSE2 with USE_SSE. Both passes can be split in bands of rows over
+ * several threads
+ */
+class CalypResampler
+{
+public:
+  /**
+   * @param iFilter filter (CalypResamplerFilter)
+   * @param iChromaSiting horizontal position of subsampled chroma (CalypChromaSiting)
+   * @param uiNumThreads number of threads (0 uses the number of cores)
+   */
+  CalypResampler( int iFilter = CLP_RESAMPLER_BICUBIC, int iChromaSiting = CLP_CHROMA_SITING_LEFT,
+                  unsigned int uiNumThreads = 1 );
+  ~CalypResampler();
+
+  void setFilter( int iFilter );
+  int getFilter() const;
+  void setChromaSiting( int iChromaSiting );
+  int getChromaSiting() const;
+  void setNumberOfThreads( unsigned int uiNumThreads );
+  unsigned int getNumberOfThreads() const;
+
+  /**
+   * Scale every channel of pcSrc to the size of pcDst
+   * @return false if the frames have different pel formats or bit depths
+   */
+  bool resample( CalypFrame* pcDst, const CalypFrame* pcSrc );
+
+  /**
+   * Scale one plane (rows are contiguous)
+   * @param uiLog2Ratio subsampling of the plane in relation to luma
+   *        (horizontal and vertical), used to place the chroma samples
+   */
+  void resamplePlane( ClpPel* pDst, unsigned int uiDstWidth, unsigned int uiDstHeight, const ClpPel* pSrc,
+                      unsigned int uiSrcWidth, unsigned int uiSrcHeight, unsigned int uiBitsPel,
+                      unsigned int uiLog2RatioWidth = 0, unsigned int uiLog2RatioHeight = 0 );
+
+private:
+  struct CalypResamplerPrivate* d;
+};
+
+#endif  // __CALYPRESAMPLER_H__
@@ -0,0 +1,100 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * \file     CalypStats.cpp
+ * \ingroup  CalypLibGrp
+ * \brief    Timing and counters of the processing stages
+ */
+
+#include "CalypStats.h"
+
+#include <cstdio>
+
+std::atomic<bool> CalypStats::s_bEnabled( false );
+
+static std::atomic<ClpULong> s_auiCalls[CLP_STATS_NUMBER_STAGES];
+static std::atomic<ClpULong> s_auiNanoseconds[CLP_STATS_NUMBER_STAGES];
+static std::atomic<ClpULong> s_auiBytes[CLP_STATS_NUMBER_STAGES];
+
+void CalypStats::setEnabled( bool bEnabled )
+{
+  s_bEnabled.store( bEnabled );
+}
+
+void CalypStats::reset()
+{
+  for( int i = 0; i < CLP_STATS_NUMBER_STAGES; i++ )
+  {
+    s_auiCalls[i] = 0;
+    s_auiNanoseconds[i] = 0;
+    s_auiBytes[i] = 0;
+  }
+}
+
+void CalypStats::add( int iStage, ClpULong uiNanoseconds, ClpULong uiBytes )
+{
+  if( iStage < 0 || iStage >= CLP_STATS_NUMBER_STAGES )
+    return;
+  s_auiCalls[iStage].fetch_add( 1, std::memory_order_relaxed );
+  s_auiNanoseconds[iStage].fetch_add( uiNanoseconds, std::memory_order_relaxed );
+  s_auiBytes[iStage].fetch_add( uiBytes, std::memory_order_relaxed );
+}
+
+CalypStats::Counter CalypStats::get( int iStage )
+{
+  Counter cCounter = { 0, 0, 0 };
+  if( iStage >= 0 && iStage < CLP_STATS_NUMBER_STAGES )
+  {
+    cCounter.uiCalls = s_auiCalls[iStage].load( std::memory_order_relaxed );
+    cCounter.uiNanoseconds = s_auiNanoseconds[iStage].load( std::memory_order_relaxed );
+    cCounter.uiBytes = s_auiBytes[iStage].load( std::memory_order_relaxed );
+  }
+  return cCounter;
+}
+
+const char* CalypStats::getStageName( int iStage )
+{
+  static const char* s_apchNames[CLP_STATS_NUMBER_STAGES] = {
+      "Read", "Seek", "Write", "Unpack", "Pack", "RGB conversion", "Histogram", "Quality", "Module",
+  };
+  return iStage >= 0 && iStage < CLP_STATS_NUMBER_STAGES ? s_apchNames[iStage] : "";
+}
+
+ClpString CalypStats::report()
+{
+  ClpString strReport;
+  char acLine[128];
+  snprintf( acLine, sizeof( acLine ), "%-16s %10s %12s %12s %10s\n", "Stage", "Calls", "Total (ms)", "Avg (ms)",
+            "MB/s" );
+  strReport += acLine;
+  for( int i = 0; i < CLP_STATS_NUMBER_STAGES; i++ )
+  {
+    Counter cCounter = get( i );
+    if( cCounter.uiCalls == 0 )
+      continue;
+    double dTotal = cCounter.uiNanoseconds / 1e6;
+    double dThroughput = cCounter.uiNanoseconds > 0 ? cCounter.uiBytes * 1e3 / cCounter.uiNanoseconds : 0;
+    snprintf( acLine, sizeof( acLine ), "%-16s %10llu %12.2f %12.3f %10.1f\n", getStageName( i ),
+              (unsigned long long)cCounter.uiCalls, dTotal, dTotal / cCounter.uiCalls, dThroughput );
+    strReport += acLine;
+  }
+  return strReport;
+}
@@ -0,0 +1,117 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * \file     CalypStats.h
+ * \ingroup  CalypLibGrp
+ * \brief    Timing and counters of the processing stages
+ */
+
+#ifndef __CALYPSTATS_H__
+#define __CALYPSTATS_H__
+
+#include "CalypDefs.h"
+
+#include <atomic>
+#include <chrono>
+
+/**
+ * Stages measured by the library (and by the applications running modules)
+ */
+enum CalypStatsStage
+{
+  CLP_STATS_READ = 0,   //!< Handler read (I/O, decoding and unpacking)
+  CLP_STATS_SEEK,       //!< Handler seek or skip
+  CLP_STATS_WRITE,      //!< Handler write
+  CLP_STATS_UNPACK,     //!< Conversion from the file buffer (frameFromBuffer)
+  CLP_STATS_PACK,       //!< Conversion to the file buffer (frameToBuffer)
+  CLP_STATS_RGB,        //!< Conversion to RGB (fillRGBBuffer)
+  CLP_STATS_HISTOGRAM,  //!< calcHistogram
+  CLP_STATS_QUALITY,    //!< Quality metrics (one component)
+  CLP_STATS_MODULE,     //!< Module process/measure
+  CLP_STATS_NUMBER_STAGES,
+};
+
+/**
+ * \class    CalypStats
+ * \ingroup  CalypLibGrp
+ * \brief    Process wide counters of the time spent in each stage
+ *
+ * Disabled by default; when disabled the timers only check a flag
+ */
+class CalypStats
+{
+public:
+  struct Counter
+  {
+    ClpULong uiCalls;
+    ClpULong uiNanoseconds;
+    ClpULong uiBytes;
+  };
+
+  static void setEnabled( bool bEnabled );
+  static bool isEnabled() { return s_bEnabled.load( std::memory_order_relaxed ); }
+
+  static void reset();
+  static void add( int iStage, ClpULong uiNanoseconds, ClpULong uiBytes = 0 );
+  static Counter get( int iStage );
+  static const char* getStageName( int iStage );
+
+  /**
+   * Table with the calls, total and average time and throughput
+   * of the stages used so far
+   */
+  static ClpString report();
+
+private:
+  static std::atomic<bool> s_bEnabled;
+};
+
+/**
+ * \class    CalypStatsTimer
+ * \ingroup  CalypLibGrp
+ * \brief    Adds the lifetime of the object to a stage
+ */
+class CalypStatsTimer
+{
+public:
+  CalypStatsTimer( int iStage, ClpULong uiBytes = 0 )
+      : m_iStage( iStage ), m_uiBytes( uiBytes ), m_bActive( CalypStats::isEnabled() )
+  {
+    if( m_bActive )
+      m_cStart = std::chrono::steady_clock::now();
+  }
+  ~CalypStatsTimer()
+  {
+    if( m_bActive )
+      CalypStats::add( m_iStage,
+                       std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - m_cStart ).count(),
+                       m_uiBytes );
+  }
+  void setBytes( ClpULong uiBytes ) { m_uiBytes = uiBytes; }
+
+private:
+  int m_iStage;
+  ClpULong m_uiBytes;
+  bool m_bActive;
+  std::chrono::steady_clock::time_point m_cStart;
+};
+
+#endif  // __CALYPSTATS_H__
@@ -26,8 +26,14 @@
 #include "CalypStream.h"
 
 #include "CalypFrame.h"
+#include "CalypMemory.h"
+#include "CalypStats.h"
 #include "CalypStreamHandlerIf.h"
+#include "CalypThreadPool.h"
+#include "CalypTrace.h"
 #include "LibMemory.h"
+#include "StreamHandlerCalyp.h"
+#include "StreamHandlerImageSequence.h"
 #include "StreamHandlerPortableMap.h"
 #include "StreamHandlerRaw.h"
 #include "config.h"
@@ -38,13 +44,30 @@
 #include "StreamHandlerOpenCV.h"
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
+#include <cstring>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+//! Memory used by each decoded GOP during backward playback (a third
+//! of the global memory budget when it is lower)
+#define REVERSE_GOP_MAX_BYTES ( 512 * 1024 * 1024 )
 
 std::vector<CalypStreamFormat> CalypStream::supportedReadFormats()
 {
   INI_REGIST_CALYP_SUPPORTED_FMT;
   APPEND_CALYP_SUPPORTED_FMT( StreamHandlerRaw, Read );
   APPEND_CALYP_SUPPORTED_FMT( StreamHandlerPortableMap, Read );
+  APPEND_CALYP_SUPPORTED_FMT( StreamHandlerCalyp, Read );
+  APPEND_CALYP_SUPPORTED_FMT( StreamHandlerImageSequence, Read );
 //#ifdef USE_OPENCV
 //  APPEND_CALYP_SUPPORTED_FMT( StreamHandlerOpenCV, Read );
 //#endif
@@ -59,6 +82,8 @@ std::vector<CalypStreamFormat> CalypStream::supportedWriteFormats()
   INI_REGIST_CALYP_SUPPORTED_FMT;
   APPEND_CALYP_SUPPORTED_FMT( StreamHandlerRaw, Write );
   APPEND_CALYP_SUPPORTED_FMT( StreamHandlerPortableMap, Write );
+  APPEND_CALYP_SUPPORTED_FMT( StreamHandlerCalyp, Write );
+  APPEND_CALYP_SUPPORTED_FMT( StreamHandlerImageSequence, Write );
 #ifdef USE_FFMPEG
   APPEND_CALYP_SUPPORTED_FMT( StreamHandlerLibav, Write );
 #endif
@@ -105,6 +130,7 @@ private:
 public:
   CalypStreamBufferPrivate( unsigned int size, unsigned int width, unsigned int height, int pelFormat, int bitsPixel, bool hasNegative )
   {
+    CalypMemoryScope cMemoryScope( CLP_MEMORY_STREAM );
     for( unsigned int i = 0; i < size; i++ )
     {
       CalypFrame* pFrame = new CalypFrame( width, height, pelFormat, bitsPixel, hasNegative );
@@ -123,12 +149,23 @@ public:
   }
   void increase( unsigned int newSize )
   {
+    CalypMemoryScope cMemoryScope( CLP_MEMORY_STREAM );
     for( unsigned int i = m_apcFrameBuffer.size(); i < newSize; i++ )
     {
       CalypFrame* pFrame = new CalypFrame( m_apcFrameBuffer.at( 0 ) );
       m_apcFrameBuffer.push_back( pFrame );
     }
   }
+  void shrink( unsigned int newSize )
+  {
+    while( m_apcFrameBuffer.size() > newSize )
+    {
+      delete m_apcFrameBuffer.back();
+      m_apcFrameBuffer.pop_back();
+    }
+    if( m_uiIndex >= newSize )
+      m_uiIndex = 0;
+  }
   unsigned int size() { return m_apcFrameBuffer.size(); }
   void setIndex( unsigned int i ) { m_uiIndex = i; }
   CalypFrame* frame( int i ) { return m_apcFrameBuffer.at( i ); }
@@ -136,10 +173,366 @@ public:
   CalypFrame* current() { return m_apcFrameBuffer.at( m_uiIndex ); }
   CalypFrame* next() { return m_apcFrameBuffer.at( nextIndex() ); }
   void setNextFrame() { m_uiIndex = nextIndex(); }
+  void setPrevFrame() { m_uiIndex = prevIndex(); }
 
 private:
   inline int nextIndex() { return m_uiIndex + 1 >= m_apcFrameBuffer.size() ? 0 : m_uiIndex + 1; }
-  inline int prevIndex() { return m_uiIndex - 1 < 0 ? m_apcFrameBuffer.size() - 1 : m_uiIndex - 1; }
+  inline int prevIndex() { return m_uiIndex == 0 ? m_apcFrameBuffer.size() - 1 : m_uiIndex - 1; }
+};
+
+/**
+ * Least recently used cache of decoded frames keyed by frame index.
+ * Only the pel data is kept, the memory used is capped by a budget in bytes.
+ * Shared caches are used by several streams (and threads) that opened the
+ * same file with the same format. The cache also gives memory back when
+ * the global memory budget is exceeded (see CalypMemory)
+ */
+class CalypStreamCachePrivate
+{
+private:
+  typedef std::pair<ClpULong, std::vector<ClpPel>*> CacheEntry;
+  std::list<CacheEntry> m_acEntries;  //!< Most recently used first
+  std::map<ClpULong, std::list<CacheEntry>::iterator> m_acIndex;
+  std::vector<std::vector<ClpPel>*> m_apcFreeBuffers;
+  ClpULong m_uiBudget;
+  ClpULong m_uiFrameBytes;
+  int m_iReclaimerId;
+  mutable std::mutex m_cMutex;
+
+public:
+  CalypStreamCachePrivate( ClpULong uiBudget )
+      : m_uiBudget( uiBudget ), m_uiFrameBytes( 0 )
+  {
+    m_iReclaimerId = CalypMemory::addReclaimer( [this]( ClpULong uiBytes ) { return reclaim( uiBytes ); } );
+  }
+  ~CalypStreamCachePrivate()
+  {
+    CalypMemory::removeReclaimer( m_iReclaimerId );
+    clear();
+    std::lock_guard<std::mutex> lock( m_cMutex );
+    releaseFreeBuffers();
+  }
+  ClpULong budget() const { return m_uiBudget; }
+  void setBudget( ClpULong uiBudget )
+  {
+    std::lock_guard<std::mutex> lock( m_cMutex );
+    m_uiBudget = uiBudget;
+    evict( 0 );
+  }
+  void clear()
+  {
+    std::lock_guard<std::mutex> lock( m_cMutex );
+    while( m_acEntries.size() > 0 )
+    {
+      m_apcFreeBuffers.push_back( m_acEntries.back().second );
+      m_acEntries.pop_back();
+    }
+    m_acIndex.clear();
+  }
+  bool contains( ClpULong uiFrameNum ) const
+  {
+    std::lock_guard<std::mutex> lock( m_cMutex );
+    return m_acIndex.find( uiFrameNum ) != m_acIndex.end();
+  }
+  bool get( ClpULong uiFrameNum, CalypFrame* pcFrame )
+  {
+    std::lock_guard<std::mutex> lock( m_cMutex );
+    std::map<ClpULong, std::list<CacheEntry>::iterator>::iterator it = m_acIndex.find( uiFrameNum );
+    if( it == m_acIndex.end() )
+      return false;
+    m_acEntries.splice( m_acEntries.begin(), m_acEntries, it->second );
+    const std::vector<ClpPel>* pcPels = it->second->second;
+    memcpy( &( pcFrame->getPelBufferYUV()[0][0][0] ), pcPels->data(), pcPels->size() * sizeof( ClpPel ) );
+    return true;
+  }
+  void put( ClpULong uiFrameNum, const CalypFrame* pcFrame )
+  {
+    ClpULong uiAllocated = 0;
+    {
+      std::lock_guard<std::mutex> lock( m_cMutex );
+      m_uiFrameBytes = pcFrame->getTotalNumberOfPixels() * sizeof( ClpPel );
+      if( m_uiFrameBytes > m_uiBudget || m_acIndex.find( uiFrameNum ) != m_acIndex.end() )
+        return;
+      evict( m_uiFrameBytes );
+      std::vector<ClpPel>* pcPels;
+      if( m_apcFreeBuffers.size() > 0 )
+      {
+        pcPels = m_apcFreeBuffers.back();
+        m_apcFreeBuffers.pop_back();
+      }
+      else
+      {
+        pcPels = new std::vector<ClpPel>;
+      }
+      ClpULong uiPrevBytes = bufferBytes( pcPels );
+      pcPels->resize( pcFrame->getTotalNumberOfPixels() );
+      uiAllocated = bufferBytes( pcPels ) - uiPrevBytes;
+      memcpy( pcPels->data(), &( pcFrame->getPelBufferYUV()[0][0][0] ), m_uiFrameBytes );
+      m_acEntries.push_front( CacheEntry( uiFrameNum, pcPels ) );
+      m_acIndex[uiFrameNum] = m_acEntries.begin();
+    }
+    // Outside of the lock: exceeding the global budget calls reclaim()
+    CalypMemory::allocate( CLP_MEMORY_CACHE, uiAllocated );
+  }
+
+private:
+  static ClpULong bufferBytes( const std::vector<ClpPel>* pcPels ) { return pcPels->capacity() * sizeof( ClpPel ); }
+
+  ClpULong deleteBuffer( std::vector<ClpPel>* pcPels )
+  {
+    ClpULong uiBytes = bufferBytes( pcPels );
+    CalypMemory::release( CLP_MEMORY_CACHE, uiBytes );
+    delete pcPels;
+    return uiBytes;
+  }
+  ClpULong releaseFreeBuffers()
+  {
+    ClpULong uiFreed = 0;
+    while( m_apcFreeBuffers.size() > 0 )
+    {
+      uiFreed += deleteBuffer( m_apcFreeBuffers.back() );
+      m_apcFreeBuffers.pop_back();
+    }
+    return uiFreed;
+  }
+  ClpULong dropLeastRecent()
+  {
+    m_acIndex.erase( m_acEntries.back().first );
+    ClpULong uiFreed = deleteBuffer( m_acEntries.back().second );
+    m_acEntries.pop_back();
+    return uiFreed;
+  }
+  //! Drop the least recently used frames until uiBytes more fit in the budget
+  void evict( ClpULong uiBytes )
+  {
+    while( m_acEntries.size() > 0 && ( m_acEntries.size() * m_uiFrameBytes + uiBytes ) > m_uiBudget )
+    {
+      dropLeastRecent();
+    }
+  }
+  //! Give memory back to the global budget (never waits for the cache)
+  ClpULong reclaim( ClpULong uiBytes )
+  {
+    std::unique_lock<std::mutex> lock( m_cMutex, std::try_to_lock );
+    if( !lock.owns_lock() )
+      return 0;
+    ClpULong uiFreed = releaseFreeBuffers();
+    while( uiFreed < uiBytes && m_acEntries.size() > 0 )
+    {
+      uiFreed += dropLeastRecent();
+    }
+    return uiFreed;
+  }
+};
+
+/**
+ * Registry of the shared caches: streams opening the same file with the
+ * same format get the same cache while at least one of them is open
+ */
+static std::mutex s_cSharedCacheMutex;
+static std::map<ClpString, std::weak_ptr<CalypStreamCachePrivate>> s_acSharedCaches;
+
+static std::shared_ptr<CalypStreamCachePrivate> getSharedCache( const ClpString& strKey, ClpULong uiBudget )
+{
+  std::lock_guard<std::mutex> lock( s_cSharedCacheMutex );
+  std::shared_ptr<CalypStreamCachePrivate> pcCache = s_acSharedCaches[strKey].lock();
+  if( !pcCache )
+  {
+    pcCache = std::make_shared<CalypStreamCachePrivate>( uiBudget );
+    s_acSharedCaches[strKey] = pcCache;
+  }
+  else if( pcCache->budget() < uiBudget )
+  {
+    pcCache->setBudget( uiBudget );
+  }
+  // Forget the caches no longer in use
+  for( auto it = s_acSharedCaches.begin(); it != s_acSharedCaches.end(); )
+  {
+    if( it->second.expired() )
+      it = s_acSharedCaches.erase( it );
+    else
+      ++it;
+  }
+  return pcCache;
+}
+
+/**
+ * Backward playback of inter coded streams. The GOP of the requested
+ * frame is decoded once with a dedicated handler and its frames are
+ * served backwards while the previous GOP is decoded in the background
+ */
+class CalypStreamReversePrivate
+{
+private:
+  struct Gop
+  {
+    ClpULong uiFirst;  //!< First frame kept (GOPs longer than the budget are truncated)
+    std::vector<CalypFrame*> apcFrames;
+  };
+  CalypStreamHandlerIf* m_pcHandler;
+  CalypFrame m_cFormat;
+  ClpULong m_uiFrameBytes;
+  Gop* m_pcCurrGop;
+  Gop* m_pcLastGop;  //!< GOP served before the current one
+  std::future<Gop*> m_cPrefetch;
+  std::atomic<bool> m_bCancel;  //!< Stops the prefetch (the stream seeks away or closes)
+  std::vector<CalypFrame*> m_apcFreeFrames;
+  std::mutex m_cFreeFramesMutex;
+  int m_iReclaimerId;
+
+public:
+  CalypStreamReversePrivate( CalypStreamHandlerIf* pcHandler, const CalypFrame* pcFormat )
+      : m_pcHandler( pcHandler )
+      , m_cFormat( pcFormat->getWidth(), pcFormat->getHeight(), pcFormat->getPelFormat(), pcFormat->getBitsPel(),
+                   pcFormat->getHasNegativeValues() )
+      , m_pcCurrGop( NULL )
+      , m_pcLastGop( NULL )
+      , m_bCancel( false )
+  {
+    m_uiFrameBytes = pcFormat->getTotalNumberOfPixels() * sizeof( ClpPel );
+    m_iReclaimerId = CalypMemory::addReclaimer( [this]( ClpULong uiBytes ) { return reclaim( uiBytes ); } );
+  }
+  ~CalypStreamReversePrivate()
+  {
+    CalypMemory::removeReclaimer( m_iReclaimerId );
+    m_bCancel = true;
+    if( m_cPrefetch.valid() )
+      releaseGop( m_cPrefetch.get() );
+    releaseGop( m_pcCurrGop );
+    releaseGop( m_pcLastGop );
+    while( m_apcFreeFrames.size() > 0 )
+    {
+      delete m_apcFreeFrames.back();
+      m_apcFreeFrames.pop_back();
+    }
+    m_pcHandler->closeHandler();
+    m_pcHandler->Delete();
+  }
+
+  bool get( ClpULong uiFrameNum, CalypFrame* pcFrame )
+  {
+    if( !contains( m_pcCurrGop, uiFrameNum ) && !contains( m_pcLastGop, uiFrameNum ) )
+    {
+      Gop* pcGop = NULL;
+      if( m_cPrefetch.valid() )
+      {
+        pcGop = m_cPrefetch.get();
+        if( !contains( pcGop, uiFrameNum ) )
+        {
+          releaseGop( pcGop );
+          pcGop = NULL;
+        }
+      }
+      if( !pcGop )
+      {
+        pcGop = decodeGop( uiFrameNum + 1 );
+        if( !contains( pcGop, uiFrameNum ) )
+        {
+          releaseGop( pcGop );
+          return false;
+        }
+      }
+      releaseGop( m_pcLastGop );
+      m_pcLastGop = m_pcCurrGop;
+      m_pcCurrGop = pcGop;
+      if( pcGop->uiFirst > 0 )
+        m_cPrefetch = std::async( std::launch::async, &CalypStreamReversePrivate::decodeGop, this, pcGop->uiFirst );
+    }
+    const Gop* pcGop = contains( m_pcCurrGop, uiFrameNum ) ? m_pcCurrGop : m_pcLastGop;
+    pcFrame->copyFrom( pcGop->apcFrames[uiFrameNum - pcGop->uiFirst] );
+    return true;
+  }
+
+private:
+  static bool contains( const Gop* pcGop, ClpULong uiFrameNum )
+  {
+    return pcGop && uiFrameNum >= pcGop->uiFirst && uiFrameNum < pcGop->uiFirst + pcGop->apcFrames.size();
+  }
+
+  //! Frames kept for each GOP: up to three GOPs (last, current and
+  //! prefetched) are in memory at once
+  ClpULong maxFrames() const
+  {
+    ClpULong uiMaxBytes = REVERSE_GOP_MAX_BYTES;
+    ClpULong uiBudget = CalypMemory::getBudget();
+    if( uiBudget > 0 )
+      uiMaxBytes = std::min( uiMaxBytes, uiBudget / 3 );
+    return std::max<ClpULong>( 1, uiMaxBytes / m_uiFrameBytes );
+  }
+
+  //! Free the spare frames (called by CalypMemory, must not block)
+  ClpULong reclaim( ClpULong uiBytes )
+  {
+    std::unique_lock<std::mutex> cLock( m_cFreeFramesMutex, std::try_to_lock );
+    if( !cLock.owns_lock() )
+      return 0;
+    ClpULong uiFreed = 0;
+    while( m_apcFreeFrames.size() > 0 && uiFreed < uiBytes )
+    {
+      delete m_apcFreeFrames.back();
+      m_apcFreeFrames.pop_back();
+      uiFreed += m_uiFrameBytes;
+    }
+    return uiFreed;
+  }
+
+  //! Decode the frames that precede uiEnd starting at their key frame
+  Gop* decodeGop( ClpULong uiEnd )
+  {
+    ClpULong uiKeyFrame = m_pcHandler->getKeyFrame( uiEnd - 1 );
+    ClpULong uiMaxFrames = maxFrames();
+    Gop* pcGop = new Gop;
+    pcGop->uiFirst = std::max( uiKeyFrame, uiEnd > uiMaxFrames ? uiEnd - uiMaxFrames : 0 );
+    {
+      CalypStatsTimer cTimer( CLP_STATS_SEEK );
+      if( !m_pcHandler->seek( uiKeyFrame ) )
+        return pcGop;
+    }
+    CalypFrame* pcFrame = NULL;
+    for( ClpULong n = uiKeyFrame; n < uiEnd && !m_bCancel; n++ )
+    {
+      if( !pcFrame )
+        pcFrame = allocFrame();
+      CalypStatsTimer cTimer( CLP_STATS_READ, m_pcHandler->m_uiNBytesPerFrame );
+      if( !m_pcHandler->read( pcFrame ) || m_pcHandler->m_isEOF )
+        break;
+      if( n >= pcGop->uiFirst )
+      {
+        pcGop->apcFrames.push_back( pcFrame );
+        pcFrame = NULL;
+      }
+    }
+    if( pcFrame )
+    {
+      std::lock_guard<std::mutex> cLock( m_cFreeFramesMutex );
+      m_apcFreeFrames.push_back( pcFrame );
+    }
+    return pcGop;
+  }
+
+  CalypFrame* allocFrame()
+  {
+    {
+      std::lock_guard<std::mutex> cLock( m_cFreeFramesMutex );
+      if( m_apcFreeFrames.size() > 0 )
+      {
+        CalypFrame* pcFrame = m_apcFreeFrames.back();
+        m_apcFreeFrames.pop_back();
+        return pcFrame;
+      }
+    }
+    CalypMemoryScope cMemoryScope( CLP_MEMORY_STREAM );
+    return new CalypFrame( &m_cFormat );
+  }
+
+  void releaseGop( Gop* pcGop )
+  {
+    if( !pcGop )
+      return;
+    std::lock_guard<std::mutex> cLock( m_cFreeFramesMutex );
+    m_apcFreeFrames.insert( m_apcFreeFrames.end(), pcGop->apcFrames.begin(), pcGop->apcFrames.end() );
+    delete pcGop;
+  }
 };
 
 struct CalypStreamPrivate
@@ -151,26 +544,107 @@ struct CalypStreamPrivate
   CreateStreamHandlerFn pfctCreateHandler;
 
   CalypStreamBufferPrivate* frameBuffer;
+  std::shared_ptr<CalypStreamCachePrivate> frameCache;
+  ClpULong uiCacheBudget;
+  bool bSharedCache;
+  ClpULong uiHandlerMemory;  //!< Stream buffer of the handler (accounted in CalypMemory)
+  CalypStreamReversePrivate* reverse;
 
   ClpString cFilename;
   long long int iCurrFrameNum;
+  ClpULong uiHandlerFrameNum;  //!< Frame the handler reads next
   bool bLoadAll;
 
+  // Frame selection (either a range or a list)
+  ClpULong uiSelStart;
+  ClpULong uiSelEnd;
+  ClpULong uiSelStep;
+  std::vector<ClpULong> auiSelFrames;
+
   CalypStreamPrivate()
   {
     handler = NULL;
+    uiCacheBudget = 0;
+    uiHandlerMemory = 0;
+    bSharedCache = false;
+    reverse = NULL;
+    uiHandlerFrameNum = 0;
     pfctCreateHandler = NULL;
     isInput = true;
     isInit = false;
     bLoadAll = false;
     iCurrFrameNum = -1;
     cFilename = "";
+    uiSelStart = 0;
+    uiSelEnd = 0;
+    uiSelStep = 1;
+  }
+
+  //! Selected frame that follows the current one (-1 if none)
+  ClpULong nextFrameNum() const
+  {
+    ClpULong uiNext = iCurrFrameNum + 1;
+    if( !auiSelFrames.empty() )
+    {
+      std::vector<ClpULong>::const_iterator it = std::lower_bound( auiSelFrames.begin(), auiSelFrames.end(), uiNext );
+      return it == auiSelFrames.end() ? ClpULong( -1 ) : *it;
+    }
+    if( uiNext < uiSelStart )
+      uiNext = uiSelStart;
+    else
+      uiNext = uiSelStart + ( uiNext - uiSelStart + uiSelStep - 1 ) / uiSelStep * uiSelStep;
+    if( uiSelEnd > 0 && uiNext >= uiSelEnd )
+      return ClpULong( -1 );
+    return uiNext;
+  }
+
+  //! Partially read frames (read mask) are not cached
+  bool readsFullFrames() const
+  {
+    return handler->m_uiReadChannelMask == (unsigned int)-1 && handler->m_uiReadFirstRow == 0 && handler->m_uiReadNumRows == 0;
+  }
+
+  //! Open a second handler on the input stream (e.g., for background decoding)
+  CalypStreamHandlerIf* createInputHandler()
+  {
+    CalypStreamHandlerIf* pcHandler = pfctCreateHandler();
+    if( !pcHandler )
+      return NULL;
+    pcHandler->m_cFilename = cFilename;
+    pcHandler->m_uiWidth = handler->m_uiWidth;
+    pcHandler->m_uiHeight = handler->m_uiHeight;
+    pcHandler->m_iPixelFormat = handler->m_iPixelFormat;
+    pcHandler->m_uiBitsPerPixel = handler->m_uiBitsPerPixel;
+    pcHandler->m_iEndianness = handler->m_iEndianness;
+    pcHandler->m_dFrameRate = handler->m_dFrameRate;
+    if( !pcHandler->openHandler( cFilename, true ) )
+    {
+      pcHandler->Delete();
+      return NULL;
+    }
+    pcHandler->m_uiNBytesPerFrame = handler->m_uiNBytesPerFrame;
+    pcHandler->calculateFrameNumber();
+    if( !pcHandler->configureBuffer( frameBuffer->current() ) )
+    {
+      pcHandler->closeHandler();
+      pcHandler->Delete();
+      return NULL;
+    }
+    return pcHandler;
+  }
+
+  void resetReverse()
+  {
+    delete reverse;
+    reverse = NULL;
   }
 };
 
 std::vector<ClpString> CalypStreamFormat::getExts()
 {
   std::vector<ClpString> arrayExt;
+  if( formatExt.empty() )
+    return arrayExt;
   ClpString::size_type prev_pos = 0, pos = 0;
   while( ( pos = formatExt.find( ',', pos ) ) != ClpString::npos )
   {
@@ -182,6 +656,22 @@ std::vector<ClpString> CalypStreamFormat::getExts()
   return arrayExt;
 }
 
+/**
+ * Match a filename against an abstract format pattern
+ * where '*' matches any (possibly empty) sequence of characters
+ * and '#' one or more decimal digits
+ */
+static bool matchFormatPattern( const char* pattern, const char* filename )
+{
+  if( *pattern == '\0' )
+    return *filename == '\0';
+  if( *pattern == '*' )
+    return matchFormatPattern( pattern + 1, filename ) || ( *filename != '\0' && matchFormatPattern( pattern, filename + 1 ) );
+  if( *pattern == '#' )
+    return *filename >= '0' && *filename <= '9' && ( matchFormatPattern( pattern + 1, filename + 1 ) || matchFormatPattern( pattern, filename + 1 ) );
+  return *pattern == *filename && matchFormatPattern( pattern + 1, filename + 1 );
+}
+
 CreateStreamHandlerFn CalypStream::findStreamHandler( ClpString strFilename, bool bRead )
 {
   ClpString currExt = strFilename.substr( strFilename.find_last_of( "." ) + 1 );
@@ -196,6 +686,16 @@ CreateStreamHandlerFn CalypStream::findStreamHandler( ClpString strFilename, boo
   {
     supportedFmts = CalypStream::supportedWriteFormats();
   }
+  // Abstract formats (e.g., image sequences) take precedence over the extension
+  for( unsigned int i = 0; i < supportedFmts.size(); i++ )
+  {
+    if( supportedFmts[i].formatPattern != "" &&
+        matchFormatPattern( supportedFmts[i].formatPattern.c_str(), strFilename.c_str() ) )
+    {
+      return supportedFmts[i].formatFct;
+    }
+  }
+  // Exact extension match first, then any extension found in the name (e.g., .yuv.zst)
   for( unsigned int i = 0; i < supportedFmts.size(); i++ )
   {
     std::vector<ClpString> arrayExt = supportedFmts[i].getExts();
@@ -205,7 +705,14 @@ CreateStreamHandlerFn CalypStream::findStreamHandler( ClpString strFilename, boo
       {
         return supportedFmts[i].formatFct;
       }
-      else if( strFilename.find( *e ) != ClpString::npos )
+    }
+  }
+  for( unsigned int i = 0; i < supportedFmts.size(); i++ )
+  {
+    std::vector<ClpString> arrayExt = supportedFmts[i].getExts();
+    for( std::vector<ClpString>::iterator e = arrayExt.begin(); e != arrayExt.end(); ++e )
+    {
+      if( strFilename.find( *e ) != ClpString::npos )
       {
         return supportedFmts[i].formatFct;
       }
@@ -227,6 +734,7 @@ CalypStream::CalypStream()
 CalypStream::~CalypStream()
 {
   close();
+  delete d;
 }
 
 ClpString CalypStream::getFormatName() const
@@ -311,6 +819,7 @@ bool CalypStream::open( ClpString filename, unsigned int width, unsigned int hei
 
   if( d->handler->m_uiWidth <= 0 || d->handler->m_uiHeight <= 0 || d->handler->m_iPixelFormat < 0 )
   {
+    d->handler->closeHandler();
     close();
     //throw CalypFailure( "CalypStream", "Incorrect configuration: width, height or pixel format" );
     return d->isInit;
@@ -324,6 +833,7 @@ bool CalypStream::open( ClpString filename, unsigned int width, unsigned int hei
   }
   catch( CalypFailure& e )
   {
+    d->handler->closeHandler();
     close();
     throw CalypFailure( "CalypStream", "Cannot allocated frame buffer" );
     return d->isInit;
@@ -334,31 +844,48 @@ bool CalypStream::open( ClpString filename, unsigned int width, unsigned int hei
   // Some handlers need to know how long is a frame to get frame number
   d->handler->calculateFrameNumber();
 
-  if( d->isInput && d->handler->m_uiTotalNumberFrames == 0 )
+  if( !d->handler->configureBuffer( d->frameBuffer->current() ) )
   {
+    delete d->frameBuffer;
+    d->handler->closeHandler();
     close();
-    throw CalypFailure( "CalypStream", "Incorrect configuration: less than one frame" );
+    throw CalypFailure( "CalypStream", "Cannot allocated buffers" );
     return d->isInit;
   }
+  d->uiHandlerMemory = d->handler->m_uiNBytesPerFrame;
+  CalypMemory::allocate( CLP_MEMORY_HANDLER, d->uiHandlerMemory );
 
-  if( !d->handler->configureBuffer( d->frameBuffer->current() ) )
+  // Streams of the same file share the decoded frames (pipes are read once)
+  if( d->isInput && d->bSharedCache && d->handler->m_bSeekable )
   {
-    close();
-    throw CalypFailure( "CalypStream", "Cannot allocated buffers" );
-    return d->isInit;
+    char acKey[64];
+    snprintf( acKey, sizeof( acKey ), "|%ux%u|%d|%u|%d|%d", d->handler->m_uiWidth, d->handler->m_uiHeight,
+              d->handler->m_iPixelFormat, d->handler->m_uiBitsPerPixel, d->handler->m_iEndianness, int( hasNegative ) );
+    d->frameCache = getSharedCache( d->cFilename + acKey, d->uiCacheBudget );
   }
 
   d->iCurrFrameNum = -1;
+  d->uiHandlerFrameNum = 0;
   d->isInit = true;
 
   seekInput( 0 );
 
+  // Checked after the first read: non-seekable streams only know their
+  // length once they reach the end
+  if( d->isInput && d->handler->m_uiTotalNumberFrames == 0 )
+  {
+    close();
+    throw CalypFailure( "CalypStream", "Incorrect configuration: less than one frame" );
+    return false;
+  }
+
   d->isInit = true;
   return d->isInit;
 }
 
 bool CalypStream::reload()
 {
+  d->resetReverse();
   d->handler->closeHandler();
   if( !d->handler->openHandler( d->cFilename, d->isInput ) )
   {
@@ -380,6 +907,9 @@ bool CalypStream::reload()
   }
   int currFrameNum = d->iCurrFrameNum;
   d->iCurrFrameNum = -1;
+  d->uiHandlerFrameNum = 0;
+  if( d->frameCache )
+    d->frameCache->clear();
   seekInput( currFrameNum );
   return true;
 }
@@ -387,12 +917,26 @@ bool CalypStream::reload()
 void CalypStream::close()
 {
   if( !d->isInit )
+  {
+    // Handler of an open that failed
+    if( d->handler )
+      d->handler->Delete();
+    d->handler = NULL;
     return;
+  }
 
+  d->resetReverse();
   d->handler->closeHandler();
   d->handler->Delete();
+  d->handler = NULL;
+  CalypMemory::release( CLP_MEMORY_HANDLER, d->uiHandlerMemory );
+  d->uiHandlerMemory = 0;
 
   delete d->frameBuffer;
+  if( d->bSharedCache )
+    d->frameCache.reset();
+  else if( d->frameCache )
+    d->frameCache->clear();
 
   d->bLoadAll = false;
   d->isInit = false;
@@ -408,6 +952,11 @@ bool CalypStream::isNative() const
   return d->handler->m_bNative;
 }
 
+bool CalypStream::isSeekable() const
+{
+  return d->handler->m_bSeekable;
+}
+
 ClpULong CalypStream::getFrameNum() const
 {
   return d->handler->m_uiTotalNumberFrames;
@@ -463,7 +1012,7 @@ void CalypStream::getFormat( unsigned int& rWidth, unsigned int& rHeight, int& r
 
 void CalypStream::loadAll()
 {
-  if( d->bLoadAll || !d->isInput )
+  if( d->bLoadAll || !d->isInput || !d->handler->m_bSeekable )
     return;
 
   try
@@ -479,12 +1028,288 @@ void CalypStream::loadAll()
   seekInput( 0 );
   for( unsigned int i = 2; i < d->frameBuffer->size(); i++ )
   {
-    readFrame( d->frameBuffer->frame( i ) );
+    readFrame( d->frameBuffer->frame( i ), i );
   }
   d->bLoadAll = true;
   d->iCurrFrameNum = 0;
 }
 
+bool CalypStream::loadAll( unsigned int uiMaxMemoryMB, LoadProgressFn pfProgress, unsigned int uiNumThreads )
+{
+  if( !d->isInit || !d->isInput || !d->handler->m_bSeekable )
+    return false;
+  if( d->bLoadAll )
+    return true;
+
+  ClpULong uiNumFrames = d->handler->m_uiTotalNumberFrames;
+  CalypFrame* pcCurrFrame = d->frameBuffer->current();
+  ClpULong uiPelBytes = pcCurrFrame->getTotalNumberOfPixels() * sizeof( ClpPel );
+  ClpULong uiFrameBytes = uiPelBytes + ClpULong( pcCurrFrame->getWidth() ) * pcCurrFrame->getHeight() * 4;
+  ClpULong uiBudget = ClpULong( uiMaxMemoryMB ) * 1024 * 1024;
+
+  // The global memory budget also limits the frames kept in memory
+  ClpULong uiAvailable = CalypMemory::getAvailable();
+  if( uiAvailable != CLP_MEMORY_UNLIMITED && ( uiBudget == 0 || uiAvailable < uiBudget ) )
+    uiBudget = uiAvailable > 0 ? uiAvailable : 1;
+
+  bool bFits = uiBudget == 0 || uiNumFrames * uiFrameBytes <= uiBudget;
+  if( bFits )
+  {
+    try
+    {
+      d->frameBuffer->increase( uiNumFrames );
+    }
+    catch( CalypFailure& e )
+    {
+      d->frameBuffer->shrink( 3 );
+      if( uiBudget == 0 )
+        throw CalypFailure( "CalypStream", "Cannot allocated frame buffer for the whole stream" );
+      bFits = false;
+    }
+  }
+
+  if( bFits )
+  {
+    // Frames are stored by their index, so the ones already buffered are overwritten
+    ClpULong uiCurr = d->iCurrFrameNum;
+    bool bRet = false;
+    try
+    {
+      bRet = loadFrames( 0, uiNumFrames, false, pfProgress, uiNumThreads );
+    }
+    catch( CalypFailure& e )
+    {
+      d->frameBuffer->shrink( 3 );
+      d->iCurrFrameNum = -1;
+      seekInput( uiCurr );
+      throw;
+    }
+    if( !bRet )
+    {
+      d->frameBuffer->shrink( 3 );
+      d->iCurrFrameNum = -1;
+      seekInput( uiCurr );
+      return false;
+    }
+    d->bLoadAll = true;
+    d->frameBuffer->setIndex( uiCurr );
+    return true;
+  }
+
+  // Keep as many frames as the budget allows in the cache, starting at the current one
+  if( !d->frameCache )
+  {
+    d->frameCache = std::make_shared<CalypStreamCachePrivate>( uiBudget );
+    d->uiCacheBudget = uiBudget;
+    d->bSharedCache = false;
+  }
+  else if( d->frameCache->budget() < uiBudget )
+  {
+    d->frameCache->setBudget( uiBudget );
+  }
+  ClpULong uiFirst = d->iCurrFrameNum;
+  ClpULong uiCacheFrames = std::min( uiNumFrames - uiFirst, std::min( d->frameCache->budget(), uiBudget ) / uiPelBytes );
+  if( uiCacheFrames > 0 )
+    loadFrames( uiFirst, uiCacheFrames, true, pfProgress, uiNumThreads );
+  return false;
+}
+
+/**
+ * Read frames [uiFirst, uiFirst + uiNumFrames) with several handlers,
+ * each one reading a contiguous range, into the frame buffer (indexed
+ * by frame number) or into the frame cache
+ */
+bool CalypStream::loadFrames( ClpULong uiFirst, ClpULong uiNumFrames, bool bIntoCache, LoadProgressFn pfProgress,
+                              unsigned int uiNumThreads )
+{
+  if( uiNumThreads == 0 )
+    uiNumThreads = CalypThreadPool::defaultNumberOfThreads();
+  uiNumThreads = std::max<ClpULong>( 1, std::min<ClpULong>( uiNumThreads, uiNumFrames ) );
+
+  std::vector<CalypStreamHandlerIf*> apcReaders;
+  for( unsigned int i = 0; i < uiNumThreads; i++ )
+  {
+    CalypStreamHandlerIf* pcHandler = d->createInputHandler();
+    if( !pcHandler )
+      break;
+    apcReaders.push_back( pcHandler );
+  }
+  // Handlers that cannot be opened twice are read by a single decode thread
+  bool bOwnReaders = apcReaders.size() > 0;
+  if( !bOwnReaders )
+  {
+    apcReaders.push_back( d->handler );
+    d->uiHandlerFrameNum = ClpULong( -1 );
+  }
+
+  std::atomic<ClpULong> uiLoaded( 0 );
+  std::atomic<bool> bCancel( false );
+  std::atomic<bool> bFailed( false );
+  std::mutex cMutex;
+  std::condition_variable cProgressCond;
+
+  std::vector<std::thread> acThreads;
+  for( unsigned int r = 0; r < apcReaders.size(); r++ )
+  {
+    ClpULong uiStart = uiFirst + uiNumFrames * r / apcReaders.size();
+    ClpULong uiEnd = uiFirst + uiNumFrames * ( r + 1 ) / apcReaders.size();
+    CalypStreamHandlerIf* pcHandler = apcReaders[r];
+    acThreads.push_back( std::thread( [this, pcHandler, uiStart, uiEnd, bIntoCache, &uiLoaded, &bCancel, &bFailed,
+                                       &cMutex, &cProgressCond]() {
+      CalypFrame* pcTmpFrame = bIntoCache ? new CalypFrame( d->frameBuffer->current() ) : NULL;
+      if( !pcHandler->seek( uiStart ) )
+        bFailed = true;
+      for( ClpULong n = uiStart; n < uiEnd && !bCancel && !bFailed; n++ )
+      {
+        CalypFrame* pcFrame = bIntoCache ? pcTmpFrame : d->frameBuffer->frame( n );
+        CalypStatsTimer cTimer( CLP_STATS_READ, pcHandler->m_uiNBytesPerFrame );
+        if( !pcHandler->read( pcFrame ) )
+        {
+          bFailed = true;
+          break;
+        }
+        {
+          std::lock_guard<std::mutex> cLock( cMutex );
+          if( bIntoCache )
+            d->frameCache->put( n, pcFrame );
+          uiLoaded++;
+        }
+        cProgressCond.notify_one();
+      }
+      delete pcTmpFrame;
+    } ) );
+  }
+
+  // Progress is reported on the caller thread (e.g., the GUI)
+  {
+    std::unique_lock<std::mutex> cLock( cMutex );
+    ClpULong uiReported = ClpULong( -1 );
+    while( uiLoaded < uiNumFrames && !bFailed && !bCancel )
+    {
+      cProgressCond.wait_for( cLock, std::chrono::milliseconds( 100 ) );
+      if( pfProgress && uiLoaded != uiReported )
+      {
+        uiReported = uiLoaded;
+        cLock.unlock();
+        if( !pfProgress( uiReported, uiNumFrames ) )
+          bCancel = true;
+        cLock.lock();
+      }
+    }
+  }
+
+  for( unsigned int r = 0; r < acThreads.size(); r++ )
+  {
+    acThreads[r].join();
+    if( bOwnReaders )
+    {
+      apcReaders[r]->closeHandler();
+      apcReaders[r]->Delete();
+    }
+  }
+  if( bFailed )
+    throw CalypFailure( "CalypStream", "Cannot read frame from stream" );
+  if( pfProgress && !bCancel )
+    pfProgress( uiNumFrames, uiNumFrames );
+  return !bCancel;
+}
+
+void CalypStream::setCacheSize( unsigned int uiSizeMB, bool bShared )
+{
+  ClpULong uiBudget = ClpULong( uiSizeMB ) * 1024 * 1024;
+  if( uiBudget == 0 )
+  {
+    d->frameCache.reset();
+    bShared = false;
+  }
+  else if( bShared )
+  {
+    // Attached when the stream is opened
+    if( !d->bSharedCache )
+      d->frameCache.reset();
+    else if( d->frameCache && d->frameCache->budget() < uiBudget )
+      d->frameCache->setBudget( uiBudget );
+  }
+  else if( d->bSharedCache || !d->frameCache )
+  {
+    d->frameCache = std::make_shared<CalypStreamCachePrivate>( uiBudget );
+  }
+  else
+  {
+    d->frameCache->setBudget( uiBudget );
+  }
+  d->uiCacheBudget = uiBudget;
+  d->bSharedCache = bShared;
+}
+
+unsigned int CalypStream::getCacheSize() const
+{
+  return d->frameCache ? d->frameCache->budget() / ( 1024 * 1024 ) : d->uiCacheBudget / ( 1024 * 1024 );
+}
+
+void CalypStream::setFrameSelection( ClpULong uiStart, ClpULong uiEnd, ClpULong uiStep )
+{
+  d->auiSelFrames.clear();
+  d->uiSelStart = uiStart;
+  d->uiSelEnd = uiEnd;
+  d->uiSelStep = uiStep > 0 ? uiStep : 1;
+  applyFrameSelection();
+}
+
+void CalypStream::setFrameSelection( const std::vector<ClpULong>& auiFrames )
+{
+  d->auiSelFrames = auiFrames;
+  std::sort( d->auiSelFrames.begin(), d->auiSelFrames.end() );
+  d->auiSelFrames.erase( std::unique( d->auiSelFrames.begin(), d->auiSelFrames.end() ), d->auiSelFrames.end() );
+  applyFrameSelection();
+}
+
+void CalypStream::applyFrameSelection()
+{
+  long long int iPrevFrameNum = d->iCurrFrameNum;
+  d->iCurrFrameNum = -1;
+  ClpULong uiFirstFrameNum = d->nextFrameNum();
+  d->iCurrFrameNum = iPrevFrameNum;
+  if( (long long int)uiFirstFrameNum == d->iCurrFrameNum )
+  {
+    // Only the next frame changes (pipes cannot go back)
+    if( !d->bLoadAll )
+      readFrame( d->frameBuffer->next(), d->nextFrameNum() );
+    return;
+  }
+  seekInput( uiFirstFrameNum );
+}
+
+void CalypStream::resetFrameSelection()
+{
+  setFrameSelection( 0, 0, 1 );
+}
+
+ClpULong CalypStream::getNumberOfSelectedFrames() const
+{
+  ClpULong uiTotal = d->handler->m_uiTotalNumberFrames;
+  if( !d->auiSelFrames.empty() )
+    return std::lower_bound( d->auiSelFrames.begin(), d->auiSelFrames.end(), uiTotal ) - d->auiSelFrames.begin();
+  ClpULong uiEnd = d->uiSelEnd > 0 ? std::min( d->uiSelEnd, uiTotal ) : uiTotal;
+  if( d->uiSelStart >= uiEnd )
+    return 0;
+  return ( uiEnd - d->uiSelStart + d->uiSelStep - 1 ) / d->uiSelStep;
+}
+
+void CalypStream::setReadMask( unsigned int uiChannelMask, unsigned int uiFirstRow, unsigned int uiNumRows )
+{
+  if( !d->handler )
+    return;
+  d->handler->m_uiReadChannelMask = uiChannelMask;
+  d->handler->m_uiReadFirstRow = uiFirstRow;
+  d->handler->m_uiReadNumRows = uiNumRows;
+}
+
+void CalypStream::resetReadMask()
+{
+  setReadMask( -1, 0, 0 );
+}
+
 void CalypStream::getDuration( int* duration_array ) const
 {
   //   int hours, mins, secs = 0;
@@ -508,22 +1333,92 @@ void CalypStream::getDuration( int* duration_array ) const
   //   *duration_array++ = secs;
 }
 
-bool CalypStream::readFrame( CalypFrame* frame )
+bool CalypStream::readFrame( CalypFrame* frame, ClpULong uiFrameNum )
 {
-  if( !d->isInit || !d->isInput || d->handler->m_uiCurrFrameFileIdx >= d->handler->m_uiTotalNumberFrames )
+  CalypTraceScope cTrace( "CalypStream::readFrame" );
+  if( !d->isInit || !d->isInput || uiFrameNum >= d->handler->m_uiTotalNumberFrames )
     return false;
 
   if( d->bLoadAll )
     return true;
 
-  if( !d->handler->read( frame ) )
+  if( d->frameCache && d->frameCache->get( uiFrameNum, frame ) )
+    return true;
+
+  // The handler position is only moved when needed (e.g., after cache hits)
+  if( d->uiHandlerFrameNum != uiFrameNum )
+  {
+    // Frames in the same GOP (or in pipes) are skipped instead of seeking
+    bool bSkip = uiFrameNum > d->uiHandlerFrameNum &&
+                 ( !d->handler->m_bSeekable || d->handler->getKeyFrame( uiFrameNum ) <= d->uiHandlerFrameNum );
+    bool bRet;
+    {
+      CalypStatsTimer cTimer( CLP_STATS_SEEK );
+      bRet = bSkip ? d->handler->skip( uiFrameNum - d->uiHandlerFrameNum ) : d->handler->seek( uiFrameNum );
+    }
+    if( !bRet )
+    {
+      if( !d->handler->m_bSeekable && d->handler->m_isEOF )
+      {
+        d->handler->m_uiTotalNumberFrames = d->handler->m_uiCurrFrameFileIdx;
+        return false;
+      }
+      throw CalypFailure( "CalypStream", "Cannot seek file into desired position" );
+    }
+    d->uiHandlerFrameNum = uiFrameNum;
+  }
+
+  bool bRead;
   {
+    CalypStatsTimer cTimer( CLP_STATS_READ, d->handler->m_uiNBytesPerFrame );
+    bRead = d->handler->read( frame );
+  }
+  if( !bRead )
+  {
+    if( !d->handler->m_bSeekable && d->handler->m_isEOF )
+    {
+      // End of a non-seekable stream: now we know its length
+      d->handler->m_uiTotalNumberFrames = d->handler->m_uiCurrFrameFileIdx;
+      return false;
+    }
     throw CalypFailure( "CalypStream", "Cannot read frame from stream" );
     return false;
   }
+  d->uiHandlerFrameNum++;
+
+  if( d->frameCache && d->readsFullFrames() )
+  {
+    d->frameCache->put( uiFrameNum, frame );
+  }
   return true;
 }
 
+/**
+ * Returns true if the next frame can be read by the caller with the
+ * request filled by the handler; otherwise readNextFrame() has to be used
+ */
+bool CalypStream::prepareNextFrameRead( CalypAsyncReadRequest& rcRequest )
+{
+  ClpULong uiFrameNum = d->nextFrameNum();
+  if( !d->isInit || !d->isInput || d->bLoadAll || uiFrameNum >= d->handler->m_uiTotalNumberFrames )
+    return false;
+  if( d->uiHandlerFrameNum != uiFrameNum || ( d->frameCache && d->frameCache->contains( uiFrameNum ) ) )
+    return false;
+  return d->handler->prepareAsyncRead( rcRequest );
+}
+
+void CalypStream::finishNextFrameRead( bool bSuccess )
+{
+  CalypFrame* pcFrame = d->frameBuffer->next();
+  if( !bSuccess || !d->handler->finishAsyncRead( pcFrame ) )
+  {
+    throw CalypFailure( "CalypStream", "Cannot read frame from stream" );
+  }
+  d->uiHandlerFrameNum++;
+  if( d->frameCache && d->readsFullFrames() )
+    d->frameCache->put( d->nextFrameNum(), pcFrame );
+}
+
 void CalypStream::writeFrame()
 {
   writeFrame( d->frameBuffer->current() );
@@ -531,6 +1426,7 @@ void CalypStream::writeFrame()
 
 void CalypStream::writeFrame( CalypFrame* pcFrame )
 {
+  CalypStatsTimer cTimer( CLP_STATS_WRITE, d->handler->m_uiNBytesPerFrame );
   if( !d->handler->write( pcFrame ) )
   {
     throw CalypFailure( "CalypStream", "Cannot write frame into the stream" );
@@ -556,14 +1452,23 @@ bool CalypStream::saveFrame( const ClpString& filename, CalypFrame* saveFrame )
   return true;
 }
 
+bool CalypStream::hasNextFrame() const
+{
+  return d->isInit && d->nextFrameNum() < d->handler->m_uiTotalNumberFrames;
+}
+
 bool CalypStream::setNextFrame()
 {
   bool bEndOfSeq = false;
 
-  if( d->iCurrFrameNum + 1 < (long)( d->handler->m_uiTotalNumberFrames ) )
+  ClpULong uiNextFrameNum = d->nextFrameNum();
+  if( uiNextFrameNum < d->handler->m_uiTotalNumberFrames )
   {
-    d->frameBuffer->setNextFrame();
-    d->iCurrFrameNum++;
+    if( d->bLoadAll )
+      d->frameBuffer->setIndex( uiNextFrameNum );
+    else
+      d->frameBuffer->setNextFrame();
+    d->iCurrFrameNum = uiNextFrameNum;
   }
   else
   {
@@ -574,11 +1479,12 @@ bool CalypStream::setNextFrame()
 
 void CalypStream::readNextFrame()
 {
-  readFrame( d->frameBuffer->next() );
+  readFrame( d->frameBuffer->next(), d->nextFrameNum() );
 }
 
 void CalypStream::readNextFrameFillRGBBuffer()
 {
+  CalypTraceScope cTrace( "CalypStream::readNextFrameFillRGBBuffer" );
   readNextFrame();
   d->frameBuffer->next()->fillRGBBuffer();
   return;
@@ -607,13 +1513,29 @@ bool CalypStream::seekInputRelative( bool bIsFoward )
   if( bIsFoward )
   {
     bRet = !setNextFrame();
-    readFrame( d->frameBuffer->next() );
+    readFrame( d->frameBuffer->next(), d->nextFrameNum() );
   }
-  else
+  else if( d->bLoadAll || d->iCurrFrameNum <= 0 )
   {
     unsigned long long int newFrameNum = d->iCurrFrameNum - 1;
     bRet = seekInput( newFrameNum );
   }
+  else
+  {
+    // The current frame becomes the next one, only the previous is read
+    ClpULong uiFrameNum = d->iCurrFrameNum - 1;
+    d->frameBuffer->setPrevFrame();
+    d->iCurrFrameNum = uiFrameNum;
+    if( !d->reverse && d->handler->m_bSeekable && d->handler->getKeyFrame( uiFrameNum ) < uiFrameNum )
+    {
+      CalypStreamHandlerIf* pcHandler = d->createInputHandler();
+      if( pcHandler )
+        d->reverse = new CalypStreamReversePrivate( pcHandler, d->frameBuffer->current() );
+    }
+    CalypFrame* pcFrame = d->frameBuffer->current();
+    bRet = ( d->frameCache && d->frameCache->get( uiFrameNum, pcFrame ) ) ||
+           ( d->reverse && d->reverse->get( uiFrameNum, pcFrame ) ) || readFrame( pcFrame, uiFrameNum );
+  }
   return bRet;
 }
 
@@ -623,6 +1545,7 @@ bool CalypStream::seekInput( unsigned long new_frame_num )
     return false;
 
   d->iCurrFrameNum = new_frame_num;
+  d->resetReverse();
 
   if( d->bLoadAll )
   {
@@ -630,15 +1553,10 @@ bool CalypStream::seekInput( unsigned long new_frame_num )
     return true;
   }
 
-  if( !d->handler->seek( d->iCurrFrameNum ) )
-  {
-    throw CalypFailure( "CalypStream", "Cannot seek file into desired position" );
-  }
-
   d->frameBuffer->setIndex( 0 );
-  readFrame( d->frameBuffer->current() );
+  readFrame( d->frameBuffer->current(), d->iCurrFrameNum );
   if( d->handler->m_uiTotalNumberFrames > 1 )
-    readFrame( d->frameBuffer->next() );
+    readFrame( d->frameBuffer->next(), d->nextFrameNum() );
 
   return true;
 }
@@ -28,8 +28,11 @@
 
 #include "CalypDefs.h"
 
+#include <functional>
+
 class CalypFrame;
 class CalypStreamHandlerIf;
+struct CalypAsyncReadRequest;
 
 typedef CalypStreamHandlerIf* ( *CreateStreamHandlerFn )( void );
 
@@ -56,6 +59,8 @@ typedef struct
  */
 class CalypStream
 {
+  friend class CalypMultiStreamReader;
+
 public:
   static std::vector<CalypStreamFormat> supportedReadFormats();
   static std::vector<CalypStreamFormat> supportedWriteFormats();
@@ -83,6 +88,11 @@ public:
   void close();
 
   bool isNative() const;
+  /**
+   * Non-seekable streams (pipes/stdin) can only be read forward
+   * and getFrameNum() is an upper bound until the end is reached
+   */
+  bool isSeekable() const;
   ClpString getFileName() const;
   ClpULong getFrameNum() const;
   unsigned int getWidth() const;
@@ -96,6 +106,62 @@ public:
 
   void loadAll();
 
+  /**
+   * Called with the number of frames loaded so far and the number of
+   * frames to load; returning false cancels the loading
+   */
+  typedef std::function<bool( ClpULong, ClpULong )> LoadProgressFn;
+
+  /**
+   * Load the whole stream into memory using several readers (seekable
+   * streams only). The progress callback runs on the caller thread
+   * @param uiMaxMemoryMB memory budget (0 no limit). Streams that do not
+   *        fit are partially loaded into the frame cache instead
+   * @param pfProgress progress callback (optional)
+   * @param uiNumThreads number of readers (0 uses the number of cores)
+   * @return true if the whole stream is in memory
+   */
+  bool loadAll( unsigned int uiMaxMemoryMB, LoadProgressFn pfProgress = LoadProgressFn(), unsigned int uiNumThreads = 0 );
+
+  /**
+   * Keep the most recently decoded frames in memory so that seekInput
+   * and seekInputRelative do not touch the handler for frames that were
+   * read before (e.g., stepping back and forth)
+   * @param uiSizeMB memory budget of the cache (0 disables it)
+   * @param bShared share the cache with the other streams (possibly in
+   *        other threads) that open the same file with the same format.
+   *        Takes effect on the next open
+   */
+  void setCacheSize( unsigned int uiSizeMB, bool bShared = false );
+  unsigned int getCacheSize() const;
+
+  /**
+   * Restrict the following reads to some channels and/or a range of
+   * rows. Handlers that support it (raw files and the native container)
+   * only read the needed bytes; the content of the remaining channels
+   * and rows is undefined. Frames already buffered are not re-read
+   * @param uiChannelMask bit mask of the channels (e.g., 1 << CLP_LUMA)
+   * @param uiFirstRow first luma row
+   * @param uiNumRows number of luma rows (0 until the last row)
+   */
+  void setReadMask( unsigned int uiChannelMask, unsigned int uiFirstRow = 0, unsigned int uiNumRows = 0 );
+  void resetReadMask();
+
+  /**
+   * Visit only some frames: setNextFrame, readNextFrame and forward
+   * relative seeks move to the next selected frame. The frames in
+   * between are not read (the handler seeks or skips them) and the
+   * stream is moved to the first selected frame
+   * @param uiStart first frame
+   * @param uiEnd frame after the last one (0 until the end)
+   * @param uiStep distance between selected frames
+   */
+  void setFrameSelection( ClpULong uiStart, ClpULong uiEnd = 0, ClpULong uiStep = 1 );
+  void setFrameSelection( const std::vector<ClpULong>& auiFrames );
+  void resetFrameSelection();
+  //! Number of frames visited with the current selection
+  ClpULong getNumberOfSelectedFrames() const;
+
   void writeFrame();
   void writeFrame( CalypFrame* pcFrame );
 
@@ -105,6 +171,8 @@ public:
   CalypFrame* getCurrFrame( CalypFrame* ) const;
 
   // continuous read control
+  //! True if setNextFrame would move to another frame
+  bool hasNextFrame() const;
   bool setNextFrame();
   void readNextFrame();
   void readNextFrameFillRGBBuffer();
@@ -116,7 +184,14 @@ public:
   void getDuration( int* duration_array ) const;
 
 private:
-  bool readFrame( CalypFrame* frame );
+  bool readFrame( CalypFrame* frame, ClpULong uiFrameNum );
+  void applyFrameSelection();
+  bool loadFrames( ClpULong uiFirst, ClpULong uiNumFrames, bool bIntoCache, LoadProgressFn pfProgress,
+                   unsigned int uiNumThreads );
+
+  // Read of the next frame in two steps (see CalypMultiStreamReader)
+  bool prepareNextFrameRead( CalypAsyncReadRequest& rcRequest );
+  void finishNextFrameRead( bool bSuccess );
 
 private:
   struct CalypStreamPrivate* d;
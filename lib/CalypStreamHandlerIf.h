@@ -57,6 +57,18 @@ public:                                                          \
   static std::vector<CalypStreamFormat> supportedWriteFormats(); \
   // static int checkforSupportedFile( String, bool );
 
+/**
+ * Bytes of a frame that the caller reads on behalf of the handler
+ * (see CalypStreamHandlerIf::prepareAsyncRead)
+ */
+struct CalypAsyncReadRequest
+{
+  int iFileDescriptor;
+  ClpULong uiOffset;
+  ClpULong uiSize;
+  ClpByte* pBuffer;
+};
+
 /**
  * \class CalypStreamHandlerIf
  * \ingroup  CalypStreamGrp
@@ -65,11 +77,14 @@ public:                                                          \
 class CalypStreamHandlerIf
 {
   friend class CalypStream;
+  friend struct CalypStreamPrivate;
+  friend class CalypStreamReversePrivate;
 
 public:
   CalypStreamHandlerIf()
       : m_bIsInput( true )
       , m_bNative( true )
+      , m_bSeekable( true )
       , m_uiWidth( 0 )
       , m_uiHeight( 0 )
       , m_iPixelFormat( -1 )
@@ -81,6 +96,9 @@ public:
       , m_pStreamBuffer( NULL )
       , m_uiNBytesPerFrame( 0 )
       , m_isEOF( false )
+      , m_uiReadChannelMask( -1 )
+      , m_uiReadFirstRow( 0 )
+      , m_uiReadNumRows( 0 )
   {
   }
   virtual ~CalypStreamHandlerIf() {}
@@ -95,6 +113,27 @@ public:
 
   virtual void calculateFrameNumber(){};
 
+  /**
+   * First frame to decode in order to reconstruct iFrameNum, i.e.,
+   * the start of its GOP. Intra-only streams return iFrameNum
+   */
+  virtual ClpULong getKeyFrame( ClpULong iFrameNum ) { return iFrameNum; }
+
+  /**
+   * Move forward without returning the frames. Used instead of seek when
+   * the handler has to go through them anyway (same GOP, pipes)
+   */
+  virtual bool skip( ClpULong uiNumFrames ) { return seek( m_uiCurrFrameFileIdx + uiNumFrames ); }
+
+  /**
+   * Split the read of the next frame so that several handlers can be
+   * read with one batch of asynchronous I/O. The handler describes the
+   * bytes to read (false if it cannot, e.g., compressed files) and
+   * finishAsyncRead converts them once they are in the buffer
+   */
+  virtual bool prepareAsyncRead( CalypAsyncReadRequest& rcRequest ) { return false; }
+  virtual bool finishAsyncRead( CalypFrame* pcFrame ) { return false; }
+
   ClpString getFormatName() { return m_strFormatName; }
   ClpString getCodecName() { return m_strCodecName; }
 
@@ -105,6 +144,7 @@ protected:
   ClpString m_strCodecName;
   bool m_bIsInput;
   bool m_bNative;
+  bool m_bSeekable;  //!< False for pipes/stdin: the number of frames is only known at EOF
   ClpString m_cFilename;
   unsigned int m_uiWidth;
   unsigned int m_uiHeight;
@@ -117,6 +157,11 @@ protected:
   ClpByte* m_pStreamBuffer;
   ClpULong m_uiNBytesPerFrame;
   bool m_isEOF;
+
+  /** Read mask: handlers may skip channels/rows outside of it */
+  unsigned int m_uiReadChannelMask;
+  unsigned int m_uiReadFirstRow;
+  unsigned int m_uiReadNumRows;  //!< 0 means until the last row
 };
 
 #endif  // __CALYPSTREAMHANDLERIF_H__
@@ -0,0 +1,85 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * \file     CalypThreadPool.cpp
+ * \brief    Fixed size pool of worker threads
+ */
+
+#include "CalypThreadPool.h"
+
+CalypThreadPool::CalypThreadPool( unsigned int numThreads )
+    : m_bStop( false )
+{
+  if( numThreads == 0 )
+    numThreads = defaultNumberOfThreads();
+  for( unsigned int i = 0; i < numThreads; i++ )
+  {
+    m_apcWorkers.push_back( std::thread( &CalypThreadPool::workerLoop, this ) );
+  }
+}
+
+CalypThreadPool::~CalypThreadPool()
+{
+  {
+    std::unique_lock<std::mutex> lock( m_cMutex );
+    m_bStop = true;
+  }
+  m_cCondition.notify_all();
+  for( unsigned int i = 0; i < m_apcWorkers.size(); i++ )
+  {
+    m_apcWorkers[i].join();
+  }
+}
+
+unsigned int CalypThreadPool::defaultNumberOfThreads()
+{
+  unsigned int numThreads = std::thread::hardware_concurrency();
+  return numThreads == 0 ? 1 : numThreads;
+}
+
+std::future<void> CalypThreadPool::addTask( std::function<void()> task )
+{
+  std::packaged_task<void()> packagedTask( task );
+  std::future<void> result = packagedTask.get_future();
+  {
+    std::unique_lock<std::mutex> lock( m_cMutex );
+    m_apcTasks.push_back( std::move( packagedTask ) );
+  }
+  m_cCondition.notify_one();
+  return result;
+}
+
+void CalypThreadPool::workerLoop()
+{
+  while( true )
+  {
+    std::packaged_task<void()> task;
+    {
+      std::unique_lock<std::mutex> lock( m_cMutex );
+      m_cCondition.wait( lock, [this] { return m_bStop || !m_apcTasks.empty(); } );
+      // Pending tasks are still executed so that no future is left unsatisfied
+      if( m_apcTasks.empty() )
+        return;
+      task = std::move( m_apcTasks.front() );
+      m_apcTasks.pop_front();
+    }
+    task();
+  }
+}
@@ -0,0 +1,71 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * \file     CalypThreadPool.h
+ * \ingroup  CalypLibGrp
+ * \brief    Fixed size pool of worker threads
+ */
+
+#ifndef __CALYPTHREADPOOL_H__
+#define __CALYPTHREADPOOL_H__
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \class    CalypThreadPool
+ * \ingroup  CalypLibGrp
+ * \brief    Runs tasks on a fixed number of worker threads
+ *
+ * Exceptions thrown by a task are forwarded to the
+ * corresponding future
+ */
+class CalypThreadPool
+{
+public:
+  /**
+   * Create the pool
+   * @param numThreads number of workers (0 uses the number of cores)
+   */
+  CalypThreadPool( unsigned int numThreads = 0 );
+  ~CalypThreadPool();
+
+  static unsigned int defaultNumberOfThreads();
+
+  unsigned int size() const { return m_apcWorkers.size(); }
+
+  std::future<void> addTask( std::function<void()> task );
+
+private:
+  void workerLoop();
+
+  std::vector<std::thread> m_apcWorkers;
+  std::deque<std::packaged_task<void()>> m_apcTasks;
+  std::mutex m_cMutex;
+  std::condition_variable m_cCondition;
+  bool m_bStop;
+};
+
+#endif  // __CALYPTHREADPOOL_H__
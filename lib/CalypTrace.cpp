@@ -0,0 +1,129 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * \file     CalypTrace.cpp
+ * \ingroup  CalypLibGrp
+ * \brief    Event tracing in the Chrome trace format
+ */
+
+#include "CalypTrace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+//! Bound on the recorded events (about 24 MB)
+#define TRACE_MAX_EVENTS ( 1 << 20 )
+
+struct CalypTraceEvent
+{
+  const char* pchName;
+  char cPhase;
+  unsigned int uiThreadId;
+  std::chrono::steady_clock::time_point cTime;
+};
+
+std::atomic<bool> CalypTrace::s_bEnabled( false );
+
+static std::mutex s_cTraceMutex;
+static std::vector<CalypTraceEvent> s_acTraceEvents;
+static ClpString s_strTraceFilename;
+static std::chrono::steady_clock::time_point s_cTraceStart;
+static std::atomic<unsigned int> s_uiNextThreadId( 1 );
+
+static unsigned int getTraceThreadId()
+{
+  thread_local unsigned int uiThreadId = s_uiNextThreadId.fetch_add( 1 );
+  return uiThreadId;
+}
+
+static void addTraceEvent( const char* pchName, char cPhase )
+{
+  CalypTraceEvent cEvent = { pchName, cPhase, getTraceThreadId(), std::chrono::steady_clock::now() };
+  std::lock_guard<std::mutex> lock( s_cTraceMutex );
+  if( s_acTraceEvents.size() < TRACE_MAX_EVENTS )
+    s_acTraceEvents.push_back( cEvent );
+}
+
+void CalypTrace::start( const ClpString& strFilename )
+{
+  std::lock_guard<std::mutex> lock( s_cTraceMutex );
+  s_acTraceEvents.clear();
+  s_strTraceFilename = strFilename;
+  s_cTraceStart = std::chrono::steady_clock::now();
+  s_bEnabled.store( true );
+}
+
+bool CalypTrace::stop()
+{
+  if( !s_bEnabled.exchange( false ) )
+    return true;
+
+  std::vector<CalypTraceEvent> acEvents;
+  ClpString strFilename;
+  {
+    std::lock_guard<std::mutex> lock( s_cTraceMutex );
+    acEvents.swap( s_acTraceEvents );
+    strFilename = s_strTraceFilename;
+  }
+
+  FILE* pFile = fopen( strFilename.c_str(), "w" );
+  if( !pFile )
+    return false;
+  fprintf( pFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+  for( size_t i = 0; i < acEvents.size(); i++ )
+  {
+    double dTimestamp = std::chrono::duration<double, std::micro>( acEvents[i].cTime - s_cTraceStart ).count();
+    fprintf( pFile, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}", i > 0 ? ",\n" : "",
+             acEvents[i].pchName, acEvents[i].cPhase, dTimestamp, acEvents[i].uiThreadId );
+  }
+  fprintf( pFile, "\n]}\n" );
+  return fclose( pFile ) == 0;
+}
+
+void CalypTrace::begin( const char* pchName )
+{
+  if( isEnabled() )
+    addTraceEvent( pchName, 'B' );
+}
+
+void CalypTrace::end( const char* pchName )
+{
+  if( isEnabled() )
+    addTraceEvent( pchName, 'E' );
+}
+
+/**
+ * Tracing of the whole run requested with CALYP_TRACE=<file>
+ * (declared after the trace state so that it is destroyed first)
+ */
+static struct CalypTraceEnvironment
+{
+  CalypTraceEnvironment()
+  {
+    const char* pchFilename = getenv( "CALYP_TRACE" );
+    if( pchFilename && pchFilename[0] )
+      CalypTrace::start( pchFilename );
+  }
+  ~CalypTraceEnvironment() { CalypTrace::stop(); }
+} s_cTraceEnvironment;
@@ -0,0 +1,90 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * \file     CalypTrace.h
+ * \ingroup  CalypLibGrp
+ * \brief    Event tracing in the Chrome trace format
+ */
+
+#ifndef __CALYPTRACE_H__
+#define __CALYPTRACE_H__
+
+#include "CalypDefs.h"
+
+#include <atomic>
+
+/**
+ * \class    CalypTrace
+ * \ingroup  CalypLibGrp
+ * \brief    Records begin/end events of each thread and writes them as a
+ *           Chrome trace (JSON) that can be opened in chrome://tracing
+ *
+ * Disabled by default; when disabled the scopes only check a flag.
+ * Setting the CALYP_TRACE environment variable to a file name records
+ * the whole run into that file
+ */
+class CalypTrace
+{
+public:
+  /**
+   * Start recording (previous events are discarded)
+   * @param strFilename file written by stop()
+   */
+  static void start( const ClpString& strFilename );
+  /**
+   * Stop recording and write the trace file
+   * @return false if the file cannot be written
+   */
+  static bool stop();
+  static bool isEnabled() { return s_bEnabled.load( std::memory_order_relaxed ); }
+
+  //! Event names must be string literals (only the pointer is kept)
+  static void begin( const char* pchName );
+  static void end( const char* pchName );
+
+private:
+  static std::atomic<bool> s_bEnabled;
+};
+
+/**
+ * \class    CalypTraceScope
+ * \ingroup  CalypLibGrp
+ * \brief    Records the lifetime of the object as one event
+ */
+class CalypTraceScope
+{
+public:
+  CalypTraceScope( const char* pchName ) : m_pchName( CalypTrace::isEnabled() ? pchName : NULL )
+  {
+    if( m_pchName )
+      CalypTrace::begin( m_pchName );
+  }
+  ~CalypTraceScope()
+  {
+    if( m_pchName )
+      CalypTrace::end( m_pchName );
+  }
+
+private:
+  const char* m_pchName;
+};
+
+#endif  // __CALYPTRACE_H__
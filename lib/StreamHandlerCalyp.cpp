@@ -0,0 +1,640 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * \file     StreamHandlerCalyp.cpp
+ * \brief    Interface for the Calyp native container
+ */
+
+#include "StreamHandlerCalyp.h"
+
+#include "CalypFrame.h"
+#include "LibMemory.h"
+#include "PixelFormats.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define CLP_FILE_VERSION 1
+#define CLP_HEADER_SIZE 40
+#define CLP_PLANE_HEADER_SIZE 8
+#define CLP_FOOTER_SIZE 16
+
+//! Plane codecs
+enum
+{
+  CLP_PLANE_STORED = 0,
+  CLP_PLANE_RICE = 1,
+};
+
+//! Longest unary prefix before escaping to a raw value
+#define RICE_LIMIT 24
+//! Halve the adaptive statistics after this number of samples
+#define RICE_RESET 64
+
+static const char g_acHeaderMagic[] = "CLPV";
+static const char g_acIndexMagic[] = "CLPI";
+static const char g_acFooterMagic[] = "CLPE";
+
+static inline void putLE( ClpByte* p, ClpULong uiValue, unsigned int uiBytes )
+{
+  for( unsigned int i = 0; i < uiBytes; i++ )
+    p[i] = ( uiValue >> ( 8 * i ) ) & 0xFF;
+}
+
+static inline ClpULong getLE( const ClpByte* p, unsigned int uiBytes )
+{
+  ClpULong uiValue = 0;
+  for( unsigned int i = 0; i < uiBytes; i++ )
+    uiValue |= ClpULong( p[i] ) << ( 8 * i );
+  return uiValue;
+}
+
+/*
+ **************************************************************
+ * Lossless plane codec
+ * median edge detector prediction (as in LOCO-I) and
+ * adaptive Rice coding of the residuals
+ **************************************************************
+ */
+
+class RiceBitWriter
+{
+public:
+  RiceBitWriter( std::vector<ClpByte>& out )
+      : m_rOut( out ), m_uiAcc( 0 ), m_uiBits( 0 )
+  {
+  }
+  inline void put( unsigned int uiValue, unsigned int uiBits )
+  {
+    m_uiAcc |= (unsigned long long)uiValue << m_uiBits;
+    m_uiBits += uiBits;
+    while( m_uiBits >= 8 )
+    {
+      m_rOut.push_back( m_uiAcc & 0xFF );
+      m_uiAcc >>= 8;
+      m_uiBits -= 8;
+    }
+  }
+  inline void putOnes( unsigned int uiCount )
+  {
+    while( uiCount > 16 )
+    {
+      put( 0xFFFF, 16 );
+      uiCount -= 16;
+    }
+    put( ( 1 << uiCount ) - 1, uiCount );
+  }
+  void flush()
+  {
+    if( m_uiBits > 0 )
+      m_rOut.push_back( m_uiAcc & 0xFF );
+    m_uiAcc = 0;
+    m_uiBits = 0;
+  }
+
+private:
+  std::vector<ClpByte>& m_rOut;
+  unsigned long long m_uiAcc;
+  unsigned int m_uiBits;
+};
+
+class RiceBitReader
+{
+public:
+  RiceBitReader( const ClpByte* pIn, ClpULong uiSize )
+      : m_pIn( pIn ), m_pEnd( pIn + uiSize ), m_uiAcc( 0 ), m_uiBits( 0 )
+  {
+  }
+  inline void refill()
+  {
+    while( m_uiBits <= 56 )
+    {
+      ClpByte uiByte = m_pIn < m_pEnd ? *m_pIn++ : 0;
+      m_uiAcc |= (unsigned long long)uiByte << m_uiBits;
+      m_uiBits += 8;
+    }
+  }
+  inline unsigned int get( unsigned int uiBits )
+  {
+    refill();
+    unsigned int uiValue = m_uiAcc & ( ( 1ULL << uiBits ) - 1 );
+    m_uiAcc >>= uiBits;
+    m_uiBits -= uiBits;
+    return uiValue;
+  }
+  //! Count ones up to uiLimit, consuming the terminating zero if found
+  inline unsigned int getOnes( unsigned int uiLimit )
+  {
+    unsigned int uiCount = 0;
+    refill();
+    while( uiCount < uiLimit && ( m_uiAcc & 1 ) )
+    {
+      m_uiAcc >>= 1;
+      m_uiBits--;
+      uiCount++;
+    }
+    if( uiCount < uiLimit )
+    {
+      m_uiAcc >>= 1;
+      m_uiBits--;
+    }
+    return uiCount;
+  }
+
+private:
+  const ClpByte* m_pIn;
+  const ClpByte* m_pEnd;
+  unsigned long long m_uiAcc;
+  unsigned int m_uiBits;
+};
+
+static inline int medianPrediction( ClpPel** pPlane, unsigned int x, unsigned int y )
+{
+  if( y == 0 )
+    return x == 0 ? 0 : pPlane[0][x - 1];
+  if( x == 0 )
+    return pPlane[y - 1][0];
+  int a = pPlane[y][x - 1];
+  int b = pPlane[y - 1][x];
+  int c = pPlane[y - 1][x - 1];
+  if( c >= std::max( a, b ) )
+    return std::min( a, b );
+  if( c <= std::min( a, b ) )
+    return std::max( a, b );
+  return a + b - c;
+}
+
+class RiceContext
+{
+public:
+  RiceContext()
+      : m_uiSum( 4 ), m_uiCount( 1 )
+  {
+  }
+  inline unsigned int k() const
+  {
+    unsigned int k = 0;
+    while( ( m_uiCount << k ) < m_uiSum )
+      k++;
+    return k;
+  }
+  inline void update( unsigned int uiValue )
+  {
+    m_uiSum += uiValue;
+    if( ++m_uiCount == RICE_RESET )
+    {
+      m_uiSum >>= 1;
+      m_uiCount >>= 1;
+    }
+  }
+
+private:
+  unsigned int m_uiSum;
+  unsigned int m_uiCount;
+};
+
+/**
+ * Encode one plane, returns false if any sample does not fit
+ * in the declared bit depth (the plane is then stored with
+ * 2 bytes per sample)
+ */
+static bool encodePlaneRice( ClpPel** pPlane, unsigned int uiWidth, unsigned int uiHeight, unsigned int uiBits,
+                             std::vector<ClpByte>& out )
+{
+  const int iMask = ( 1 << uiBits ) - 1;
+  const int iHalf = 1 << ( uiBits - 1 );
+  RiceBitWriter cWriter( out );
+  RiceContext cContext;
+  for( unsigned int y = 0; y < uiHeight; y++ )
+  {
+    for( unsigned int x = 0; x < uiWidth; x++ )
+    {
+      int iPel = pPlane[y][x];
+      if( iPel > iMask )
+        return false;
+      int iRes = ( iPel - medianPrediction( pPlane, x, y ) ) & iMask;
+      if( iRes >= iHalf )
+        iRes -= 1 << uiBits;
+      unsigned int uiValue = iRes >= 0 ? 2 * iRes : -2 * iRes - 1;
+
+      unsigned int k = cContext.k();
+      unsigned int q = uiValue >> k;
+      if( q < RICE_LIMIT )
+      {
+        cWriter.putOnes( q );
+        cWriter.put( 0, 1 );
+        if( k > 0 )
+          cWriter.put( uiValue & ( ( 1 << k ) - 1 ), k );
+      }
+      else
+      {
+        cWriter.putOnes( RICE_LIMIT );
+        cWriter.put( uiValue, uiBits );
+      }
+      cContext.update( uiValue );
+    }
+  }
+  cWriter.flush();
+  return true;
+}
+
+/**
+ * Decode the first uiHeight rows of a plane (prediction
+ * needs all the rows before the last one requested)
+ */
+static void decodePlaneRice( const ClpByte* pIn, ClpULong uiSize, ClpPel** pPlane, unsigned int uiWidth,
+                             unsigned int uiHeight, unsigned int uiBits )
+{
+  const int iMask = ( 1 << uiBits ) - 1;
+  RiceBitReader cReader( pIn, uiSize );
+  RiceContext cContext;
+  for( unsigned int y = 0; y < uiHeight; y++ )
+  {
+    for( unsigned int x = 0; x < uiWidth; x++ )
+    {
+      unsigned int k = cContext.k();
+      unsigned int q = cReader.getOnes( RICE_LIMIT );
+      unsigned int uiValue;
+      if( q < RICE_LIMIT )
+        uiValue = ( q << k ) | ( k > 0 ? cReader.get( k ) : 0 );
+      else
+        uiValue = cReader.get( uiBits );
+      cContext.update( uiValue );
+      int iRes = ( uiValue & 1 ) ? -int( ( uiValue + 1 ) >> 1 ) : int( uiValue >> 1 );
+      pPlane[y][x] = ( medianPrediction( pPlane, x, y ) + iRes ) & iMask;
+    }
+  }
+}
+
+static void encodePlaneStored( ClpPel** pPlane, unsigned int uiWidth, unsigned int uiHeight, unsigned int uiBytes,
+                               std::vector<ClpByte>& out )
+{
+  out.resize( ClpULong( uiWidth ) * uiHeight * uiBytes );
+  ClpByte* p = out.data();
+  for( unsigned int y = 0; y < uiHeight; y++ )
+    for( unsigned int x = 0; x < uiWidth; x++, p += uiBytes )
+      putLE( p, pPlane[y][x], uiBytes );
+}
+
+static void decodePlaneStored( const ClpByte* pIn, ClpPel** pPlane, unsigned int uiWidth, unsigned int uiStartRow,
+                               unsigned int uiEndRow, unsigned int uiBytes )
+{
+  pIn += ClpULong( uiStartRow ) * uiWidth * uiBytes;
+  for( unsigned int y = uiStartRow; y < uiEndRow; y++ )
+    for( unsigned int x = 0; x < uiWidth; x++, pIn += uiBytes )
+      pPlane[y][x] = getLE( pIn, uiBytes );
+}
+
+/*
+ **************************************************************
+ * Stream handler
+ **************************************************************
+ */
+
+std::vector<CalypStreamFormat> StreamHandlerCalyp::supportedReadFormats()
+{
+  INI_REGIST_CALYP_SUPPORTED_FMT;
+  REGIST_CALYP_SUPPORTED_FMT( &StreamHandlerCalyp::Create, "Calyp Video", "clp" );
+  END_REGIST_CALYP_SUPPORTED_FMT;
+}
+
+std::vector<CalypStreamFormat> StreamHandlerCalyp::supportedWriteFormats()
+{
+  INI_REGIST_CALYP_SUPPORTED_FMT;
+  REGIST_CALYP_SUPPORTED_FMT( &StreamHandlerCalyp::Create, "Calyp Video", "clp" );
+  END_REGIST_CALYP_SUPPORTED_FMT;
+}
+
+StreamHandlerCalyp::StreamHandlerCalyp()
+    : m_pFile( NULL )
+    , m_pMappedFile( NULL )
+    , m_uiFileSize( 0 )
+{
+  m_pchHandlerName = "CalypVideo";
+}
+
+StreamHandlerCalyp::~StreamHandlerCalyp()
+{
+  closeHandler();
+}
+
+bool StreamHandlerCalyp::openHandler( ClpString strFilename, bool bInput )
+{
+  m_bIsInput = bInput;
+  m_strFormatName = "CLP";
+  m_strCodecName = "Calyp Lossless";
+  m_iEndianness = CLP_LITTLE_ENDIAN;
+  m_auiFrameOffsets.clear();
+
+  m_pFile = fopen( strFilename.c_str(), bInput ? "rb" : "wb" );
+  if( m_pFile == NULL )
+    return false;
+
+  if( m_bIsInput )
+  {
+    if( !mapFile() || !readHeader() || !readIndex() )
+    {
+      closeHandler();
+      return false;
+    }
+    m_uiTotalNumberFrames = m_auiFrameOffsets.size();
+  }
+  else
+  {
+    writeHeader();
+  }
+  return true;
+}
+
+void StreamHandlerCalyp::closeHandler()
+{
+  if( m_pFile && !m_bIsInput )
+  {
+    // Trailing index, footer and final number of frames
+    ClpULong uiIndexOffset = ftell( m_pFile );
+    std::vector<ClpByte> auiIndex( 8 + 8 * m_auiFrameOffsets.size() + CLP_FOOTER_SIZE );
+    memcpy( auiIndex.data(), g_acIndexMagic, 4 );
+    putLE( auiIndex.data() + 4, 0, 4 );
+    for( unsigned int i = 0; i < m_auiFrameOffsets.size(); i++ )
+      putLE( auiIndex.data() + 8 + 8 * i, m_auiFrameOffsets[i], 8 );
+    ClpByte* pFooter = auiIndex.data() + auiIndex.size() - CLP_FOOTER_SIZE;
+    putLE( pFooter, uiIndexOffset, 8 );
+    memcpy( pFooter + 8, g_acFooterMagic, 4 );
+    putLE( pFooter + 12, 0, 4 );
+    fwrite( auiIndex.data(), 1, auiIndex.size(), m_pFile );
+
+    m_uiTotalNumberFrames = m_auiFrameOffsets.size();
+    writeHeader();
+  }
+  unmapFile();
+  if( m_pFile )
+    fclose( m_pFile );
+  m_pFile = NULL;
+  m_auiFrameOffsets.clear();
+
+  if( m_pStreamBuffer )
+    freeMem1D( m_pStreamBuffer );
+}
+
+bool StreamHandlerCalyp::configureBuffer( CalypFrame* pcFrame )
+{
+  // Planes are decoded directly into the frame
+  return true;
+}
+
+bool StreamHandlerCalyp::mapFile()
+{
+  fseek( m_pFile, 0, SEEK_END );
+  m_uiFileSize = ftell( m_pFile );
+  fseek( m_pFile, 0, SEEK_SET );
+  if( m_uiFileSize < CLP_HEADER_SIZE )
+    return false;
+#ifndef _WIN32
+  void* pMap = mmap( NULL, m_uiFileSize, PROT_READ, MAP_SHARED, fileno( m_pFile ), 0 );
+  if( pMap == MAP_FAILED )
+    return false;
+  m_pMappedFile = (const ClpByte*)pMap;
+#else
+  ClpByte* pData = new ClpByte[m_uiFileSize];
+  if( fread( pData, 1, m_uiFileSize, m_pFile ) != m_uiFileSize )
+  {
+    delete[] pData;
+    return false;
+  }
+  m_pMappedFile = pData;
+#endif
+  return true;
+}
+
+void StreamHandlerCalyp::unmapFile()
+{
+  if( !m_pMappedFile )
+    return;
+#ifndef _WIN32
+  munmap( (void*)m_pMappedFile, m_uiFileSize );
+#else
+  delete[] m_pMappedFile;
+#endif
+  m_pMappedFile = NULL;
+}
+
+bool StreamHandlerCalyp::readHeader()
+{
+  const ClpByte* p = m_pMappedFile;
+  if( memcmp( p, g_acHeaderMagic, 4 ) || getLE( p + 4, 2 ) > CLP_FILE_VERSION )
+    return false;
+  ClpULong uiHeaderSize = getLE( p + 6, 2 );
+  m_uiWidth = getLE( p + 8, 4 );
+  m_uiHeight = getLE( p + 12, 4 );
+  m_iPixelFormat = int( getLE( p + 16, 4 ) );
+  m_uiBitsPerPixel = getLE( p + 20, 4 );
+  m_dFrameRate = getLE( p + 24, 4 ) / 1000.0;
+  m_uiTotalNumberFrames = getLE( p + 32, 8 );
+  if( uiHeaderSize < CLP_HEADER_SIZE || uiHeaderSize > m_uiFileSize )
+    return false;
+  if( g_CalypPixFmtDescriptorsMap.find( m_iPixelFormat ) == g_CalypPixFmtDescriptorsMap.end() )
+    return false;
+  // Every frame has at least one plane header
+  if( m_uiTotalNumberFrames > ( m_uiFileSize - uiHeaderSize ) / CLP_PLANE_HEADER_SIZE )
+    return false;
+  return m_uiWidth > 0 && m_uiHeight > 0 && m_uiBitsPerPixel > 0 && m_uiBitsPerPixel <= 16;
+}
+
+void StreamHandlerCalyp::writeHeader()
+{
+  ClpByte auiHeader[CLP_HEADER_SIZE];
+  memset( auiHeader, 0, CLP_HEADER_SIZE );
+  memcpy( auiHeader, g_acHeaderMagic, 4 );
+  putLE( auiHeader + 4, CLP_FILE_VERSION, 2 );
+  putLE( auiHeader + 6, CLP_HEADER_SIZE, 2 );
+  putLE( auiHeader + 8, m_uiWidth, 4 );
+  putLE( auiHeader + 12, m_uiHeight, 4 );
+  putLE( auiHeader + 16, m_iPixelFormat, 4 );
+  putLE( auiHeader + 20, m_uiBitsPerPixel, 4 );
+  putLE( auiHeader + 24, ClpULong( m_dFrameRate * 1000 + 0.5 ), 4 );
+  putLE( auiHeader + 32, m_uiTotalNumberFrames, 8 );
+  fseek( m_pFile, 0, SEEK_SET );
+  fwrite( auiHeader, 1, CLP_HEADER_SIZE, m_pFile );
+  fseek( m_pFile, 0, SEEK_END );
+}
+
+/**
+ * Read the trailing index. Files that were not properly
+ * closed have no index and their frames are walked instead
+ */
+bool StreamHandlerCalyp::readIndex()
+{
+  unsigned int uiHeaderSize = getLE( m_pMappedFile + 6, 2 );
+  if( m_uiFileSize >= uiHeaderSize + 8 + CLP_FOOTER_SIZE )
+  {
+    const ClpByte* pFooter = m_pMappedFile + m_uiFileSize - CLP_FOOTER_SIZE;
+    ClpULong uiIndexOffset = getLE( pFooter, 8 );
+    if( !memcmp( pFooter + 8, g_acFooterMagic, 4 ) && uiIndexOffset >= uiHeaderSize &&
+        uiIndexOffset + 8 + CLP_FOOTER_SIZE <= m_uiFileSize && !memcmp( m_pMappedFile + uiIndexOffset, g_acIndexMagic, 4 ) )
+    {
+      // Frames lie between the header and the index, in order, and
+      // their number matches the header of a closed file
+      ClpULong uiNumFrames = ( m_uiFileSize - CLP_FOOTER_SIZE - uiIndexOffset - 8 ) / 8;
+      bool bValid = m_uiTotalNumberFrames == 0 || uiNumFrames == m_uiTotalNumberFrames;
+      ClpULong uiLastOffset = uiHeaderSize;
+      for( ClpULong i = 0; i < uiNumFrames && bValid; i++ )
+      {
+        ClpULong uiOffset = getLE( m_pMappedFile + uiIndexOffset + 8 + 8 * i, 8 );
+        bValid = uiOffset >= uiLastOffset && uiOffset + CLP_PLANE_HEADER_SIZE <= uiIndexOffset;
+        uiLastOffset = uiOffset;
+        m_auiFrameOffsets.push_back( uiOffset );
+      }
+      if( bValid )
+        return true;
+      m_auiFrameOffsets.clear();
+    }
+  }
+
+  unsigned int uiNumChannels = g_CalypPixFmtDescriptorsMap.at( m_iPixelFormat ).numberChannels;
+  ClpULong uiOffset = uiHeaderSize;
+  while( true )
+  {
+    ClpULong uiPos = uiOffset;
+    for( unsigned int ch = 0; ch < uiNumChannels && uiPos <= m_uiFileSize; ch++ )
+    {
+      if( uiPos + CLP_PLANE_HEADER_SIZE > m_uiFileSize )
+      {
+        uiPos = m_uiFileSize + 1;
+        break;
+      }
+      uiPos += CLP_PLANE_HEADER_SIZE + getLE( m_pMappedFile + uiPos, 4 );
+    }
+    if( uiPos > m_uiFileSize )
+      break;
+    m_auiFrameOffsets.push_back( uiOffset );
+    uiOffset = uiPos;
+  }
+  return true;
+}
+
+bool StreamHandlerCalyp::seek( ClpULong iFrameNum )
+{
+  if( iFrameNum >= m_auiFrameOffsets.size() )
+    return false;
+  m_uiCurrFrameFileIdx = iFrameNum;
+  return true;
+}
+
+bool StreamHandlerCalyp::read( CalypFrame* pcFrame )
+{
+  if( m_uiCurrFrameFileIdx >= m_auiFrameOffsets.size() )
+  {
+    m_isEOF = true;
+    return false;
+  }
+
+  unsigned int uiBits = pcFrame->getBitsPel();
+  unsigned int uiBytes = uiBits > 8 ? 2 : 1;
+  ClpPel*** pppPel = pcFrame->getPelBufferYUV();
+  const ClpByte* p = m_pMappedFile + m_auiFrameOffsets[m_uiCurrFrameFileIdx];
+
+  // Read mask: planes outside of it are skipped and rows after the last one are not decoded
+  unsigned int uiFirstRow = std::min( m_uiReadFirstRow, m_uiHeight - 1 );
+  unsigned int uiNumRows = m_uiReadNumRows;
+  if( uiNumRows == 0 || uiFirstRow + uiNumRows > m_uiHeight )
+    uiNumRows = m_uiHeight - uiFirstRow;
+
+  for( unsigned int ch = 0; ch < pcFrame->getNumberChannels(); ch++ )
+  {
+    unsigned int uiWidth = pcFrame->getWidth( ch );
+    unsigned int uiHeight = pcFrame->getHeight( ch );
+    unsigned int ratioH = ch > 0 ? g_CalypPixFmtDescriptorsMap.at( m_iPixelFormat ).log2ChromaHeight : 0;
+    unsigned int uiStartRow = uiFirstRow >> ratioH;
+    unsigned int uiEndRow = std::min( CHROMASHIFT( uiFirstRow + uiNumRows, ratioH ), uiHeight );
+    if( p + CLP_PLANE_HEADER_SIZE > m_pMappedFile + m_uiFileSize )
+      return false;
+    ClpULong uiSize = getLE( p, 4 );
+    int iCodec = p[4];
+    unsigned int uiPlaneBytes = p[5] ? p[5] : uiBytes;
+    p += CLP_PLANE_HEADER_SIZE;
+    if( p + uiSize > m_pMappedFile + m_uiFileSize )
+      return false;
+    if( !( m_uiReadChannelMask & ( 1 << ch ) ) )
+    {
+      p += uiSize;
+      continue;
+    }
+    switch( iCodec )
+    {
+    case CLP_PLANE_STORED:
+      if( uiPlaneBytes > 2 || uiSize < ClpULong( uiWidth ) * uiHeight * uiPlaneBytes )
+        return false;
+      decodePlaneStored( p, pppPel[ch], uiWidth, uiStartRow, uiEndRow, uiPlaneBytes );
+      break;
+    case CLP_PLANE_RICE:
+      decodePlaneRice( p, uiSize, pppPel[ch], uiWidth, uiEndRow, uiBits );
+      break;
+    default:
+      return false;
+    }
+    p += uiSize;
+  }
+  m_uiCurrFrameFileIdx++;
+  return true;
+}
+
+bool StreamHandlerCalyp::write( CalypFrame* pcFrame )
+{
+  unsigned int uiBits = pcFrame->getBitsPel();
+  unsigned int uiBytes = uiBits > 8 ? 2 : 1;
+  ClpPel*** pppPel = static_cast<const CalypFrame*>( pcFrame )->getPelBufferYUV();
+
+  m_auiFrameOffsets.push_back( ftell( m_pFile ) );
+  for( unsigned int ch = 0; ch < pcFrame->getNumberChannels(); ch++ )
+  {
+    unsigned int uiWidth = pcFrame->getWidth( ch );
+    unsigned int uiHeight = pcFrame->getHeight( ch );
+    ClpULong uiStoredSize = ClpULong( uiWidth ) * uiHeight * uiBytes;
+
+    int iCodec = CLP_PLANE_RICE;
+    unsigned int uiPlaneBytes = uiBytes;
+    m_auiPlaneBuffer.clear();
+    m_auiPlaneBuffer.reserve( uiStoredSize );
+    bool bFits = encodePlaneRice( pppPel[ch], uiWidth, uiHeight, uiBits, m_auiPlaneBuffer );
+    if( !bFits || m_auiPlaneBuffer.size() >= uiStoredSize )
+    {
+      // Samples above the bit depth are kept with 2 bytes
+      iCodec = CLP_PLANE_STORED;
+      uiPlaneBytes = bFits ? uiBytes : 2;
+      encodePlaneStored( pppPel[ch], uiWidth, uiHeight, uiPlaneBytes, m_auiPlaneBuffer );
+    }
+
+    ClpByte auiPlaneHeader[CLP_PLANE_HEADER_SIZE];
+    memset( auiPlaneHeader, 0, CLP_PLANE_HEADER_SIZE );
+    putLE( auiPlaneHeader, m_auiPlaneBuffer.size(), 4 );
+    auiPlaneHeader[4] = iCodec;
+    auiPlaneHeader[5] = uiPlaneBytes;
+    if( fwrite( auiPlaneHeader, 1, CLP_PLANE_HEADER_SIZE, m_pFile ) != CLP_PLANE_HEADER_SIZE ||
+        fwrite( m_auiPlaneBuffer.data(), 1, m_auiPlaneBuffer.size(), m_pFile ) != m_auiPlaneBuffer.size() )
+      return false;
+  }
+  m_uiCurrFrameFileIdx++;
+  return true;
+}
@@ -0,0 +1,79 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * \file     StreamHandlerCalyp.h
+ * \ingroup  CalypStreamGrp
+ * \brief    Interface for the Calyp native container
+ */
+
+#ifndef __STREAMHANDLERCALYP_H__
+#define __STREAMHANDLERCALYP_H__
+
+#include "CalypStreamHandlerIf.h"
+
+#include <vector>
+
+/**
+ * \class StreamHandlerCalyp
+ * \brief    Class to handle the Calyp native container (.clp)
+ *
+ * Layout (all fields little endian):
+ *  - header: magic "CLPV", version, resolution, pixel format,
+ *    bits per pixel, frame rate and number of frames
+ *  - one chunk per frame: for each channel a plane header
+ *    (payload size, codec and bytes per stored sample)
+ *    followed by the payload.
+ *    Planes are compressed independently with a lossless
+ *    median prediction + adaptive Rice codec
+ *  - trailing index with the offset of every frame chunk
+ *    and a footer pointing to the index
+ *
+ * Input files are memory mapped and the index gives
+ * constant time access to any frame
+ */
+class StreamHandlerCalyp : public CalypStreamHandlerIf
+{
+  REGISTER_CALYP_STREAM_HANDLER( StreamHandlerCalyp )
+
+public:
+  StreamHandlerCalyp();
+  ~StreamHandlerCalyp();
+  bool openHandler( ClpString strFilename, bool bInput );
+  void closeHandler();
+  bool configureBuffer( CalypFrame* pcFrame );
+  bool seek( ClpULong iFrameNum );
+  bool read( CalypFrame* pcFrame );
+  bool write( CalypFrame* pcFrame );
+
+private:
+  FILE* m_pFile;
+  const ClpByte* m_pMappedFile;  //!< Whole input file (mmap or read into memory)
+  ClpULong m_uiFileSize;
+  std::vector<ClpULong> m_auiFrameOffsets;
+  std::vector<ClpByte> m_auiPlaneBuffer;
+
+  bool readHeader();
+  bool readIndex();
+  void writeHeader();
+  bool mapFile();
+  void unmapFile();
+};
+
+#endif  // __STREAMHANDLERCALYP_H__
@@ -0,0 +1,353 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * \file     StreamHandlerImageSequence.cpp
+ * \brief    Handling numbered image sequences (e.g. frame_%05d.png)
+ */
+
+#include "StreamHandlerImageSequence.h"
+
+#include "CalypFrame.h"
+#include "CalypThreadPool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#ifndef _WIN32
+#include <dirent.h>
+#endif
+
+//! Highest index probed when looking for the first image of the sequence
+//! (only without directory listing)
+#define MAX_FIRST_IMAGE_INDEX 10000
+
+std::vector<CalypStreamFormat> StreamHandlerImageSequence::supportedReadFormats()
+{
+  INI_REGIST_CALYP_SUPPORTED_FMT;
+  REGIST_CALYP_SUPPORTED_ABSTRACT_FMT( &StreamHandlerImageSequence::Create, "Image Sequence", "*%0#d*" );
+  END_REGIST_CALYP_SUPPORTED_FMT;
+}
+
+std::vector<CalypStreamFormat> StreamHandlerImageSequence::supportedWriteFormats()
+{
+  INI_REGIST_CALYP_SUPPORTED_FMT;
+  REGIST_CALYP_SUPPORTED_ABSTRACT_FMT( &StreamHandlerImageSequence::Create, "Image Sequence", "*%0#d*" );
+  END_REGIST_CALYP_SUPPORTED_FMT;
+}
+
+StreamHandlerImageSequence::StreamHandlerImageSequence()
+    : m_uiNumberWidth( 0 )
+    , m_uiFirstImageIdx( 0 )
+    , m_uiDecodeAhead( 0 )
+    , m_pcDecodePool( NULL )
+    , m_pcFrameTemplate( NULL )
+{
+  m_pchHandlerName = "ImageSequence";
+}
+
+StreamHandlerImageSequence::~StreamHandlerImageSequence()
+{
+  closeHandler();
+}
+
+/**
+ * Only zero padded conversions (%0Nd) are accepted, so that
+ * filenames with other uses of '%' are not taken as sequences
+ */
+bool StreamHandlerImageSequence::parsePattern( const ClpString& strPattern )
+{
+  ClpString::size_type pos = strPattern.find( "%0" );
+  if( pos == ClpString::npos )
+    return false;
+
+  ClpString::size_type end = pos + 2;
+  while( end < strPattern.size() && isdigit( strPattern[end] ) )
+    end++;
+  if( end == pos + 2 || end >= strPattern.size() || strPattern[end] != 'd' )
+    return false;
+
+  m_strPrefix = strPattern.substr( 0, pos );
+  m_strSuffix = strPattern.substr( end + 1 );
+  m_uiNumberWidth = std::stoi( strPattern.substr( pos + 2, end - pos - 2 ) );
+  return m_strPrefix.find( '%' ) == ClpString::npos && m_strSuffix.find( '%' ) == ClpString::npos;
+}
+
+ClpString StreamHandlerImageSequence::getImageFileName( ClpULong uiImageIdx ) const
+{
+  ClpString strNumber = std::to_string( uiImageIdx );
+  if( strNumber.size() < m_uiNumberWidth )
+    strNumber.insert( 0, m_uiNumberWidth - strNumber.size(), '0' );
+  return m_strPrefix + strNumber + m_strSuffix;
+}
+
+bool StreamHandlerImageSequence::imageExists( ClpULong uiImageIdx ) const
+{
+  FILE* pFile = fopen( getImageFileName( uiImageIdx ).c_str(), "rb" );
+  if( pFile == NULL )
+    return false;
+  fclose( pFile );
+  return true;
+}
+
+/**
+ * Lowest index of the images in the directory of the pattern
+ * (a single listing instead of probing every index)
+ */
+bool StreamHandlerImageSequence::findFirstImage()
+{
+#ifndef _WIN32
+  ClpString::size_type uiSlash = m_strPrefix.find_last_of( '/' );
+  ClpString strDirectory = uiSlash == ClpString::npos ? "." : m_strPrefix.substr( 0, uiSlash + 1 );
+  ClpString strName = uiSlash == ClpString::npos ? m_strPrefix : m_strPrefix.substr( uiSlash + 1 );
+
+  DIR* pDir = opendir( strDirectory.c_str() );
+  if( pDir == NULL )
+    return false;
+  bool bFound = false;
+  struct dirent* pEntry;
+  while( ( pEntry = readdir( pDir ) ) != NULL )
+  {
+    ClpString strEntry( pEntry->d_name );
+    if( strEntry.size() < strName.size() + m_uiNumberWidth + m_strSuffix.size() ||
+        strEntry.compare( 0, strName.size(), strName ) ||
+        strEntry.compare( strEntry.size() - m_strSuffix.size(), m_strSuffix.size(), m_strSuffix ) )
+      continue;
+    ClpString strNumber = strEntry.substr( strName.size(), strEntry.size() - strName.size() - m_strSuffix.size() );
+    if( strNumber.size() > 18 || !std::all_of( strNumber.begin(), strNumber.end(), []( char c ) { return c >= '0' && c <= '9'; } ) )
+      continue;
+    // The number is written with the padding of the pattern
+    ClpULong uiIdx = std::stoull( strNumber );
+    if( getImageFileName( uiIdx ) != m_strPrefix + strNumber + m_strSuffix )
+      continue;
+    if( !bFound || uiIdx < m_uiFirstImageIdx )
+      m_uiFirstImageIdx = uiIdx;
+    bFound = true;
+  }
+  closedir( pDir );
+  return bFound;
+#else
+  for( m_uiFirstImageIdx = 0; m_uiFirstImageIdx <= MAX_FIRST_IMAGE_INDEX; m_uiFirstImageIdx++ )
+    if( imageExists( m_uiFirstImageIdx ) )
+      return true;
+  return false;
+#endif
+}
+
+bool StreamHandlerImageSequence::openHandler( ClpString strFilename, bool bInput )
+{
+  m_bIsInput = bInput;
+  m_uiCurrFrameFileIdx = 0;
+  m_uiFirstImageIdx = 0;
+  m_strFormatName = "Image Sequence";
+
+  if( !parsePattern( strFilename ) )
+  {
+    return false;
+  }
+
+  if( !m_bIsInput )
+  {
+    m_strCodecName = "Image Sequence";
+    return true;
+  }
+
+  if( !findFirstImage() )
+  {
+    return false;
+  }
+
+  // The first image defines the format of the whole sequence
+  CalypStream cFirstImage;
+  if( !cFirstImage.open( getImageFileName( m_uiFirstImageIdx ), m_uiWidth, m_uiHeight, m_iPixelFormat, m_uiBitsPerPixel,
+                         m_iEndianness, m_dFrameRate, true ) )
+  {
+    return false;
+  }
+  m_uiWidth = cFirstImage.getWidth();
+  m_uiHeight = cFirstImage.getHeight();
+  m_iPixelFormat = cFirstImage.getCurrFrame()->getPelFormat();
+  m_uiBitsPerPixel = cFirstImage.getBitsPerPixel();
+  m_iEndianness = cFirstImage.getEndianess();
+  m_strCodecName = cFirstImage.getFormatName();
+  cFirstImage.close();
+
+  calculateFrameNumber();
+  return true;
+}
+
+void StreamHandlerImageSequence::closeHandler()
+{
+  dropPendingDecodes();
+  delete m_pcDecodePool;
+  m_pcDecodePool = NULL;
+  while( m_apcFreeFrames.size() > 0 )
+  {
+    delete m_apcFreeFrames.back();
+    m_apcFreeFrames.pop_back();
+  }
+  delete m_pcFrameTemplate;
+  m_pcFrameTemplate = NULL;
+}
+
+bool StreamHandlerImageSequence::configureBuffer( CalypFrame* pcFrame )
+{
+  if( !m_bIsInput )
+    return true;
+
+  m_pcFrameTemplate = new CalypFrame( pcFrame->getWidth(), pcFrame->getHeight(), pcFrame->getPelFormat(),
+                                      pcFrame->getBitsPel(), pcFrame->getHasNegativeValues() );
+  m_pcDecodePool = new CalypThreadPool;
+  m_uiDecodeAhead = 2 * m_pcDecodePool->size();
+  return true;
+}
+
+/**
+ * Numbering is assumed to be contiguous: an exponential probe
+ * followed by a binary search finds the last image using a
+ * logarithmic number of file system accesses
+ */
+void StreamHandlerImageSequence::calculateFrameNumber()
+{
+  if( !m_bIsInput )
+    return;
+
+  ClpULong uiLastFound = 0;
+  ClpULong uiStep = 1;
+  while( imageExists( m_uiFirstImageIdx + uiStep ) )
+  {
+    uiLastFound = uiStep;
+    uiStep *= 2;
+  }
+  ClpULong uiLow = uiLastFound;
+  ClpULong uiHigh = uiStep;
+  while( uiHigh - uiLow > 1 )
+  {
+    ClpULong uiMiddle = uiLow + ( uiHigh - uiLow ) / 2;
+    if( imageExists( m_uiFirstImageIdx + uiMiddle ) )
+      uiLow = uiMiddle;
+    else
+      uiHigh = uiMiddle;
+  }
+  m_uiTotalNumberFrames = uiLow + 1;
+}
+
+bool StreamHandlerImageSequence::seek( ClpULong iFrameNum )
+{
+  if( !m_bIsInput || iFrameNum >= m_uiTotalNumberFrames )
+    return false;
+  m_uiCurrFrameFileIdx = iFrameNum;
+  return true;
+}
+
+void StreamHandlerImageSequence::decodeImage( ClpULong uiFrameIdx, CalypFrame* pcFrame )
+{
+  ClpString strImageName = getImageFileName( m_uiFirstImageIdx + uiFrameIdx );
+  CalypStream cImage;
+  if( !cImage.open( strImageName, m_uiWidth, m_uiHeight, m_iPixelFormat, m_uiBitsPerPixel, m_iEndianness, m_dFrameRate,
+                    true ) )
+  {
+    throw CalypFailure( "StreamHandlerImageSequence", "Cannot open image " + strImageName );
+  }
+  if( !cImage.getCurrFrame()->haveSameFmt( pcFrame, CalypFrame::MATCH_RESOLUTION | CalypFrame::MATCH_PEL_FMT |
+                                                        CalypFrame::MATCH_BITS ) )
+  {
+    throw CalypFailure( "StreamHandlerImageSequence", "Image " + strImageName + " does not match the sequence format" );
+  }
+  pcFrame->copyFrom( cImage.getCurrFrame() );
+}
+
+void StreamHandlerImageSequence::scheduleDecode( ClpULong uiFrameIdx )
+{
+  DecodeSlot cSlot;
+  cSlot.uiFrameIdx = uiFrameIdx;
+  if( m_apcFreeFrames.size() > 0 )
+  {
+    cSlot.pcFrame = m_apcFreeFrames.back();
+    m_apcFreeFrames.pop_back();
+  }
+  else
+  {
+    cSlot.pcFrame = new CalypFrame( m_pcFrameTemplate );
+  }
+  CalypFrame* pcFrame = cSlot.pcFrame;
+  cSlot.cDone = m_pcDecodePool->addTask( [this, uiFrameIdx, pcFrame]() { decodeImage( uiFrameIdx, pcFrame ); } );
+  m_apcPendingDecodes.push_back( std::move( cSlot ) );
+}
+
+void StreamHandlerImageSequence::dropPendingDecodes()
+{
+  while( m_apcPendingDecodes.size() > 0 )
+  {
+    m_apcPendingDecodes.front().cDone.wait();
+    m_apcFreeFrames.push_back( m_apcPendingDecodes.front().pcFrame );
+    m_apcPendingDecodes.pop_front();
+  }
+}
+
+bool StreamHandlerImageSequence::read( CalypFrame* pcFrame )
+{
+  if( !m_pcDecodePool || m_uiCurrFrameFileIdx >= m_uiTotalNumberFrames )
+    return false;
+
+  // Decodes scheduled before a seek are no longer useful
+  if( m_apcPendingDecodes.size() > 0 && m_apcPendingDecodes.front().uiFrameIdx != m_uiCurrFrameFileIdx )
+  {
+    dropPendingDecodes();
+  }
+  if( m_apcPendingDecodes.size() == 0 )
+  {
+    scheduleDecode( m_uiCurrFrameFileIdx );
+  }
+
+  bool bRet = true;
+  DecodeSlot& cSlot = m_apcPendingDecodes.front();
+  try
+  {
+    cSlot.cDone.get();
+    pcFrame->copyFrom( cSlot.pcFrame );
+  }
+  catch( ... )
+  {
+    // Any error of the image decoders fails the read
+    bRet = false;
+  }
+  m_apcFreeFrames.push_back( cSlot.pcFrame );
+  m_apcPendingDecodes.pop_front();
+  if( !bRet )
+    return false;
+
+  m_uiCurrFrameFileIdx++;
+
+  // Keep the workers busy with the following images
+  ClpULong uiNextIdx = m_apcPendingDecodes.size() > 0 ? m_apcPendingDecodes.back().uiFrameIdx + 1 : m_uiCurrFrameFileIdx;
+  while( m_apcPendingDecodes.size() < m_uiDecodeAhead && uiNextIdx < m_uiTotalNumberFrames )
+  {
+    scheduleDecode( uiNextIdx++ );
+  }
+  return true;
+}
+
+bool StreamHandlerImageSequence::write( CalypFrame* pcFrame )
+{
+  if( !CalypStream::saveFrame( getImageFileName( m_uiFirstImageIdx + m_uiCurrFrameFileIdx ), pcFrame ) )
+    return false;
+  m_uiCurrFrameFileIdx++;
+  return true;
+}
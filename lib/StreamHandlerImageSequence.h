@@ -0,0 +1,88 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * \file     StreamHandlerImageSequence.h
+ * \ingroup  CalypStreamGrp
+ * \brief    Handling numbered image sequences (e.g. frame_%05d.png)
+ */
+
+#ifndef __STREAMHANDLERIMAGESEQUENCE_H__
+#define __STREAMHANDLERIMAGESEQUENCE_H__
+
+#include "CalypStreamHandlerIf.h"
+
+#include <deque>
+#include <future>
+
+class CalypThreadPool;
+
+/**
+ * \class StreamHandlerImageSequence
+ * \brief    Handle a set of numbered images as a single stream
+ *
+ * The filename is a printf-like pattern with one zero padded
+ * integer conversion (e.g. frame_%05d.pgm). Each image is opened with
+ * the handler that supports its extension and several images
+ * are decoded ahead of the current position by a pool of workers
+ */
+class StreamHandlerImageSequence : public CalypStreamHandlerIf
+{
+  REGISTER_CALYP_STREAM_HANDLER( StreamHandlerImageSequence )
+
+public:
+  StreamHandlerImageSequence();
+  ~StreamHandlerImageSequence();
+  bool openHandler( ClpString strFilename, bool bInput );
+  void closeHandler();
+  bool configureBuffer( CalypFrame* pcFrame );
+  void calculateFrameNumber();
+  bool seek( ClpULong iFrameNum );
+  bool read( CalypFrame* pcFrame );
+  bool write( CalypFrame* pcFrame );
+
+private:
+  struct DecodeSlot
+  {
+    ClpULong uiFrameIdx;
+    CalypFrame* pcFrame;
+    std::future<void> cDone;
+  };
+
+  bool parsePattern( const ClpString& strPattern );
+  bool findFirstImage();
+  ClpString getImageFileName( ClpULong uiImageIdx ) const;
+  bool imageExists( ClpULong uiImageIdx ) const;
+  void decodeImage( ClpULong uiFrameIdx, CalypFrame* pcFrame );
+  void scheduleDecode( ClpULong uiFrameIdx );
+  void dropPendingDecodes();
+
+  ClpString m_strPrefix;
+  ClpString m_strSuffix;
+  unsigned int m_uiNumberWidth;
+  ClpULong m_uiFirstImageIdx;
+
+  unsigned int m_uiDecodeAhead;
+  CalypThreadPool* m_pcDecodePool;
+  std::deque<DecodeSlot> m_apcPendingDecodes;
+  std::vector<CalypFrame*> m_apcFreeFrames;
+  CalypFrame* m_pcFrameTemplate;
+};
+
+#endif  // __STREAMHANDLERIMAGESEQUENCE_H__
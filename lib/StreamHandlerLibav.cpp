@@ -28,6 +28,7 @@
 #include "LibMemory.h"
 #include "PixelFormats.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <iostream>
 
@@ -36,6 +37,13 @@
 #define FF_USER_CODEC_PARAM
 #endif
 
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT( 58, 78, 100 )
+#define FF_INDEX_GET_ENTRY_API
+#endif
+
+//! Assumed distance between key frames when the container has no index
+#define LIBAV_DEFAULT_GOP_SIZE 32
+
 std::vector<CalypStreamFormat> StreamHandlerLibav::supportedReadFormats()
 {
   INI_REGIST_CALYP_SUPPORTED_FMT;
@@ -356,7 +364,11 @@ void StreamHandlerLibav::calculateFrameNumber()
   m_uiTotalNumberFrames = num_frames;
 }
 
-bool StreamHandlerLibav::read( CalypFrame* pcFrame )
+/**
+ * Decode the next frame into m_cFrame
+ * (rbGotFrame is false at the end of the stream)
+ */
+bool StreamHandlerLibav::decodeFrame( bool& rbGotFrame )
 {
   int bGotFrame = 0;
   bool bErrors = false;
@@ -404,6 +416,7 @@ bool StreamHandlerLibav::read( CalypFrame* pcFrame )
         if( iRet == AVERROR_EOF )
         {
           m_isEOF = true;
+          rbGotFrame = false;
           return true;
         }
         return false;
@@ -416,6 +429,15 @@ bool StreamHandlerLibav::read( CalypFrame* pcFrame )
 #endif
     }
   }
+  rbGotFrame = bGotFrame;
+  return bGotFrame;
+}
+
+bool StreamHandlerLibav::read( CalypFrame* pcFrame )
+{
+  bool bGotFrame = false;
+  if( !decodeFrame( bGotFrame ) )
+    return false;
 
   if( bGotFrame )
   {
@@ -432,9 +454,21 @@ bool StreamHandlerLibav::read( CalypFrame* pcFrame )
 
     pcFrame->frameFromBuffer( m_pStreamBuffer, m_iEndianness );
     m_uiCurrFrameFileIdx++;
-    return true;
   }
-  return false;
+  return true;
+}
+
+bool StreamHandlerLibav::skip( ClpULong uiNumFrames )
+{
+  // Frames are still decoded (they may be references) but not converted
+  for( ClpULong i = 0; i < uiNumFrames; i++ )
+  {
+    bool bGotFrame = false;
+    if( !decodeFrame( bGotFrame ) || !bGotFrame )
+      return false;
+    m_uiCurrFrameFileIdx++;
+  }
+  return true;
 }
 
 bool StreamHandlerLibav::write( CalypFrame* pcFrame )
@@ -464,3 +498,27 @@ bool StreamHandlerLibav::seek( ClpULong iFrameNum )
   m_uiCurrFrameFileIdx = iFrameNum;
   return true;
 }
+
+ClpULong StreamHandlerLibav::getKeyFrame( ClpULong iFrameNum )
+{
+  if( m_uiTotalNumberFrames == 1 || !m_cStream )
+    return iFrameNum;
+
+  // Frame numbers are mapped to timestamps through the frame rate
+  double dFramesPerTick = m_dFrameRate * av_q2d( m_cStream->time_base );
+  int64_t iStartTime = m_cStream->start_time != AV_NOPTS_VALUE ? m_cStream->start_time : 0;
+  int64_t iTimestamp = iStartTime + int64_t( iFrameNum / dFramesPerTick );
+
+  int iIdx = av_index_search_timestamp( m_cStream, iTimestamp, AVSEEK_FLAG_BACKWARD );
+  if( iIdx < 0 )
+  {
+    return iFrameNum - iFrameNum % LIBAV_DEFAULT_GOP_SIZE;
+  }
+#ifdef FF_INDEX_GET_ENTRY_API
+  int64_t iKeyTimestamp = avformat_index_get_entry( m_cStream, iIdx )->timestamp;
+#else
+  int64_t iKeyTimestamp = m_cStream->index_entries[iIdx].timestamp;
+#endif
+  ClpULong iKeyFrame = ClpULong( ( iKeyTimestamp - iStartTime ) * dFramesPerTick + 0.5 );
+  return std::min( iKeyFrame, iFrameNum );
+}
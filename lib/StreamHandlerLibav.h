@@ -67,6 +67,8 @@ public:
   bool configureBuffer( CalypFrame* pcFrame );
   void calculateFrameNumber();
   bool seek( ClpULong iFrameNum );
+  ClpULong getKeyFrame( ClpULong iFrameNum );
+  bool skip( ClpULong uiNumFrames );
   bool read( CalypFrame* pcFrame );
   bool write( CalypFrame* pcFrame );
 
@@ -94,6 +96,8 @@ private:
   unsigned long long int m_uiMicroSec;
 
   AVFrame* m_cConvertedFrame;
+
+  bool decodeFrame( bool& rbGotFrame );
 };
 
 #endif  // __STREAMHANDLERLIBAV_H__
@@ -25,9 +25,20 @@
 #include "StreamHandlerRaw.h"
 
 #include "CalypFrame.h"
+#include "CalypMemory.h"
 #include "LibMemory.h"
+#include "PixelFormats.h"
+#include "config.h"
 
 #include <cstdio>
+#include <limits>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+//! Number of frames buffered ahead when reading from a pipe
+#define RAW_READ_AHEAD_FRAMES 4
 
 std::vector<CalypStreamFormat> StreamHandlerRaw::supportedReadFormats()
 {
@@ -35,6 +46,13 @@ std::vector<CalypStreamFormat> StreamHandlerRaw::supportedReadFormats()
   REGIST_CALYP_SUPPORTED_FMT( &StreamHandlerRaw::Create, "Raw YUV Video", "yuv" );
   REGIST_CALYP_SUPPORTED_FMT( &StreamHandlerRaw::Create, "Raw Gray Video", "gray" );
   REGIST_CALYP_SUPPORTED_FMT( &StreamHandlerRaw::Create, "Raw RGB Video", "rgb" );
+#ifdef USE_ZSTD
+  REGIST_CALYP_SUPPORTED_FMT( &StreamHandlerRaw::Create, "Raw Video (zstd)", "zst" );
+#endif
+#ifdef USE_LZ4
+  REGIST_CALYP_SUPPORTED_FMT( &StreamHandlerRaw::Create, "Raw Video (lz4)", "lz4" );
+#endif
+  REGIST_CALYP_SUPPORTED_ABSTRACT_FMT( &StreamHandlerRaw::Create, "Raw Video (standard input)", "-" );
   END_REGIST_CALYP_SUPPORTED_FMT;
 }
 
@@ -48,12 +66,43 @@ std::vector<CalypStreamFormat> StreamHandlerRaw::supportedWriteFormats()
 bool StreamHandlerRaw::openHandler( ClpString strFilename, bool bInput )
 {
   m_bIsInput = bInput;
+  m_bSeekable = true;
   m_pFile = NULL;
-  m_pFile = fopen( strFilename.c_str(), bInput ? "rb" : "wb" );
+  if( bInput && CalypCompressedReader::findCodec( strFilename ) != CalypCompressedReader::CODEC_NONE )
+  {
+    m_pcCompressedReader = new CalypCompressedReader;
+    if( !m_pcCompressedReader->open( strFilename ) )
+    {
+      delete m_pcCompressedReader;
+      m_pcCompressedReader = NULL;
+      return false;
+    }
+    calculateFrameNumber();
+    m_strFormatName = "YUV";
+    m_strCodecName = "Raw Video";
+    m_dFrameRate = 30;
+    return true;
+  }
+  if( bInput && strFilename == "-" )
+  {
+    m_pFile = stdin;
+  }
+  else
+  {
+    m_pFile = fopen( strFilename.c_str(), bInput ? "rb" : "wb" );
+  }
   if( m_pFile == NULL )
   {
     return false;
   }
+  if( bInput )
+  {
+    struct stat fileStat;
+    if( fstat( fileno( m_pFile ), &fileStat ) == 0 && !S_ISREG( fileStat.st_mode ) )
+    {
+      m_bSeekable = false;
+    }
+  }
   calculateFrameNumber();
   m_strFormatName = "YUV";
   m_strCodecName = "Raw Video";
@@ -63,19 +112,57 @@ bool StreamHandlerRaw::openHandler( ClpString strFilename, bool bInput )
 
 void StreamHandlerRaw::closeHandler()
 {
-  if( m_pFile )
+  stopReadAhead();
+  if( m_pcCompressedReader )
+    delete m_pcCompressedReader;
+  m_pcCompressedReader = NULL;
+  if( m_pFile && m_pFile != stdin )
     fclose( m_pFile );
+  m_pFile = NULL;
   if( m_pStreamBuffer )
     freeMem1D( m_pStreamBuffer );
 }
 
 bool StreamHandlerRaw::configureBuffer( CalypFrame* pcFrame )
 {
-  return getMem1D<ClpByte>( &m_pStreamBuffer, pcFrame->getBytesPerFrame() );
+  if( !getMem1D<ClpByte>( &m_pStreamBuffer, pcFrame->getBytesPerFrame() ) )
+    return false;
+
+  if( m_pcCompressedReader )
+    return m_pcCompressedReader->setFrameSize( m_uiNBytesPerFrame );
+
+  if( m_bIsInput && !m_bSeekable && !m_cReadAheadThread.joinable() )
+  {
+    for( unsigned int i = 0; i < RAW_READ_AHEAD_FRAMES; i++ )
+    {
+      ClpByte* pBuffer = NULL;
+      if( !getMem1D<ClpByte>( &pBuffer, m_uiNBytesPerFrame ) )
+        return false;
+      CalypMemory::allocate( CLP_MEMORY_HANDLER, m_uiNBytesPerFrame );
+      m_apReadAheadBuffers.push_back( pBuffer );
+    }
+    m_uiReadAheadHead = 0;
+    m_uiReadAheadCount = 0;
+    m_bReadAheadEOF = false;
+    m_bReadAheadStop = false;
+    m_cReadAheadThread = std::thread( &StreamHandlerRaw::readAheadLoop, this );
+  }
+  return true;
 }
 
 void StreamHandlerRaw::calculateFrameNumber()
 {
+  if( !m_bSeekable )
+  {
+    // Unknown until EOF is reached (see CalypStream::readFrame)
+    m_uiTotalNumberFrames = std::numeric_limits<long>::max();
+    return;
+  }
+  if( m_pcCompressedReader && m_uiNBytesPerFrame > 0 )
+  {
+    m_uiTotalNumberFrames = m_pcCompressedReader->getDecompressedSize() / m_uiNBytesPerFrame;
+    return;
+  }
   if( m_pFile && m_uiNBytesPerFrame > 0 )
   {
     fseek( m_pFile, 0, SEEK_END );
@@ -87,6 +174,18 @@ void StreamHandlerRaw::calculateFrameNumber()
 
 bool StreamHandlerRaw::seek( ClpULong iFrameNum )
 {
+  if( !m_bSeekable )
+  {
+    // Pipes can only be read forward
+    return iFrameNum == m_uiCurrFrameFileIdx;
+  }
+  if( m_pcCompressedReader )
+  {
+    if( !m_pcCompressedReader->seek( iFrameNum ) )
+      return false;
+    m_uiCurrFrameFileIdx = iFrameNum;
+    return true;
+  }
   if( m_bIsInput && m_pFile )
   {
     fseek( m_pFile, iFrameNum >= 0 ? iFrameNum * m_uiNBytesPerFrame : 0, SEEK_SET );
@@ -96,14 +195,202 @@ bool StreamHandlerRaw::seek( ClpULong iFrameNum )
   return false;
 }
 
+bool StreamHandlerRaw::skip( ClpULong uiNumFrames )
+{
+  if( m_bSeekable )
+    return seek( m_uiCurrFrameFileIdx + uiNumFrames );
+  // Pipes: frames are consumed without being converted
+  for( ClpULong i = 0; i < uiNumFrames; i++ )
+  {
+    if( !readStreaming( NULL ) )
+      return false;
+  }
+  return true;
+}
+
+void StreamHandlerRaw::readAheadLoop()
+{
+  while( true )
+  {
+    ClpByte* pBuffer;
+    {
+      std::unique_lock<std::mutex> lock( m_cReadAheadMutex );
+      m_cReadAheadCond.wait( lock, [this] { return m_bReadAheadStop || m_uiReadAheadCount < m_apReadAheadBuffers.size(); } );
+      if( m_bReadAheadStop )
+        return;
+      pBuffer = m_apReadAheadBuffers[( m_uiReadAheadHead + m_uiReadAheadCount ) % m_apReadAheadBuffers.size()];
+    }
+    unsigned long long int processed_bytes = fread( pBuffer, sizeof( ClpByte ), m_uiNBytesPerFrame, m_pFile );
+    {
+      std::unique_lock<std::mutex> lock( m_cReadAheadMutex );
+      if( processed_bytes != m_uiNBytesPerFrame )
+        m_bReadAheadEOF = true;
+      else
+        m_uiReadAheadCount++;
+    }
+    m_cReadAheadCond.notify_all();
+    if( processed_bytes != m_uiNBytesPerFrame )
+      return;
+  }
+}
+
+void StreamHandlerRaw::stopReadAhead()
+{
+  if( m_cReadAheadThread.joinable() )
+  {
+    {
+      std::unique_lock<std::mutex> lock( m_cReadAheadMutex );
+      m_bReadAheadStop = true;
+    }
+    m_cReadAheadCond.notify_all();
+    // Waits for a frame read that might still be blocked on the pipe
+    m_cReadAheadThread.join();
+  }
+  while( m_apReadAheadBuffers.size() > 0 )
+  {
+    CalypMemory::release( CLP_MEMORY_HANDLER, m_uiNBytesPerFrame );
+    freeMem1D( m_apReadAheadBuffers.back() );
+    m_apReadAheadBuffers.pop_back();
+  }
+}
+
+bool StreamHandlerRaw::readStreaming( CalypFrame* pcFrame )
+{
+  ClpByte* pBuffer;
+  {
+    std::unique_lock<std::mutex> lock( m_cReadAheadMutex );
+    m_cReadAheadCond.wait( lock, [this] { return m_uiReadAheadCount > 0 || m_bReadAheadEOF; } );
+    if( m_uiReadAheadCount == 0 )
+    {
+      m_isEOF = true;
+      return false;
+    }
+    pBuffer = m_apReadAheadBuffers[m_uiReadAheadHead];
+  }
+  if( pcFrame )
+    pcFrame->frameFromBuffer( pBuffer, m_iEndianness, m_uiReadChannelMask, m_uiReadFirstRow, m_uiReadNumRows );
+  {
+    std::unique_lock<std::mutex> lock( m_cReadAheadMutex );
+    m_uiReadAheadHead = ( m_uiReadAheadHead + 1 ) % m_apReadAheadBuffers.size();
+    m_uiReadAheadCount--;
+  }
+  m_cReadAheadCond.notify_all();
+  m_uiCurrFrameFileIdx++;
+  return true;
+}
+
+bool StreamHandlerRaw::readAt( ClpULong uiOffset, ClpByte* pBuffer, ClpULong uiSize )
+{
+#ifndef _WIN32
+  while( uiSize > 0 )
+  {
+    ssize_t iRead = pread( fileno( m_pFile ), pBuffer, uiSize, uiOffset );
+    if( iRead <= 0 )
+      return false;
+    pBuffer += iRead;
+    uiOffset += iRead;
+    uiSize -= iRead;
+  }
+  return true;
+#else
+  fseek( m_pFile, uiOffset, SEEK_SET );
+  return fread( pBuffer, 1, uiSize, m_pFile ) == uiSize;
+#endif
+}
+
+/**
+ * Read only the bytes of the channels and rows in the read mask
+ */
+bool StreamHandlerRaw::readPartial( CalypFrame* pcFrame )
+{
+  const CalypPixelFormatDescriptor* pcFmt = &g_CalypPixFmtDescriptorsMap.at( m_iPixelFormat );
+  unsigned int bytesPixel = ( m_uiBitsPerPixel - 1 ) / 8 + 1;
+  unsigned int uiFirstRow = std::min( m_uiReadFirstRow, m_uiHeight - 1 );
+  unsigned int uiNumRows = m_uiReadNumRows;
+  if( uiNumRows == 0 || uiFirstRow + uiNumRows > m_uiHeight )
+    uiNumRows = m_uiHeight - uiFirstRow;
+
+  ClpULong uiFrameOffset = m_uiCurrFrameFileIdx * m_uiNBytesPerFrame;
+  ClpULong uiPlaneOffset = 0;
+  for( unsigned int p = 0; p < pcFmt->numberPlanes; p++ )
+  {
+    int ratioW = p > 0 ? pcFmt->log2ChromaWidth : 0;
+    int ratioH = p > 0 ? pcFmt->log2ChromaHeight : 0;
+    unsigned int uiPlaneRows = CHROMASHIFT( m_uiHeight, ratioH );
+    ClpULong uiPlaneBytes = p + 1 < pcFmt->numberPlanes
+                                ? ClpULong( uiPlaneRows ) * CHROMASHIFT( m_uiWidth, ratioW ) * bytesPixel
+                                : m_uiNBytesPerFrame - uiPlaneOffset;
+    ClpULong uiRowBytes = uiPlaneBytes / uiPlaneRows;
+
+    bool bNeeded = false;
+    for( unsigned int ch = 0; ch < pcFmt->numberChannels; ch++ )
+      bNeeded |= pcFmt->comp[ch].plane == p && ( m_uiReadChannelMask & ( 1 << ch ) );
+    if( bNeeded )
+    {
+      unsigned int uiStartRow = uiFirstRow >> ratioH;
+      unsigned int uiEndRow = CHROMASHIFT( uiFirstRow + uiNumRows, ratioH );
+      ClpULong uiOffset = uiPlaneOffset + uiStartRow * uiRowBytes;
+      if( !readAt( uiFrameOffset + uiOffset, m_pStreamBuffer + uiOffset, ( uiEndRow - uiStartRow ) * uiRowBytes ) )
+        return false;
+    }
+    uiPlaneOffset += uiPlaneBytes;
+  }
+  m_uiCurrFrameFileIdx++;
+  // Keep the sequential read position consistent
+  fseek( m_pFile, m_uiCurrFrameFileIdx * m_uiNBytesPerFrame, SEEK_SET );
+  pcFrame->frameFromBuffer( m_pStreamBuffer, m_iEndianness, m_uiReadChannelMask, uiFirstRow, uiNumRows );
+  return true;
+}
+
 bool StreamHandlerRaw::read( CalypFrame* pcFrame )
 {
+  if( m_pcCompressedReader && m_pStreamBuffer )
+  {
+    if( !m_pcCompressedReader->read( m_pStreamBuffer ) )
+      return false;
+    m_uiCurrFrameFileIdx++;
+    pcFrame->frameFromBuffer( m_pStreamBuffer, m_iEndianness, m_uiReadChannelMask, m_uiReadFirstRow, m_uiReadNumRows );
+    return true;
+  }
   if( !m_pFile || !m_pStreamBuffer || m_uiNBytesPerFrame == 0 )
     return false;
+  if( !m_bSeekable )
+    return readStreaming( pcFrame );
+  if( m_uiReadChannelMask != (unsigned int)-1 || m_uiReadFirstRow > 0 || m_uiReadNumRows > 0 )
+    return readPartial( pcFrame );
   unsigned long long int processed_bytes = fread( m_pStreamBuffer, sizeof( ClpByte ), m_uiNBytesPerFrame, m_pFile );
   if( processed_bytes != m_uiNBytesPerFrame )
+  {
+    m_isEOF = feof( m_pFile );
+    return false;
+  }
+  m_uiCurrFrameFileIdx++;
+  pcFrame->frameFromBuffer( m_pStreamBuffer, m_iEndianness );
+  return true;
+}
+
+bool StreamHandlerRaw::prepareAsyncRead( CalypAsyncReadRequest& rcRequest )
+{
+#ifndef _WIN32
+  if( m_pcCompressedReader || !m_pFile || !m_pStreamBuffer || !m_bSeekable || m_uiNBytesPerFrame == 0 )
+    return false;
+  if( m_uiReadChannelMask != (unsigned int)-1 || m_uiReadFirstRow > 0 || m_uiReadNumRows > 0 )
     return false;
+  rcRequest.iFileDescriptor = fileno( m_pFile );
+  rcRequest.uiOffset = m_uiCurrFrameFileIdx * m_uiNBytesPerFrame;
+  rcRequest.uiSize = m_uiNBytesPerFrame;
+  rcRequest.pBuffer = m_pStreamBuffer;
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool StreamHandlerRaw::finishAsyncRead( CalypFrame* pcFrame )
+{
   m_uiCurrFrameFileIdx++;
+  // Keep the sequential read position consistent
+  fseek( m_pFile, m_uiCurrFrameFileIdx * m_uiNBytesPerFrame, SEEK_SET );
   pcFrame->frameFromBuffer( m_pStreamBuffer, m_iEndianness );
   return true;
 }
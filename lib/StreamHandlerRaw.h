@@ -26,11 +26,24 @@
 #ifndef __STREAMHANDLERRAW_H__
 #define __STREAMHANDLERRAW_H__
 
+#include "CalypCompressedReader.h"
 #include "CalypStreamHandlerIf.h"
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 /**
  * \class StreamHandlerRaw
  * \brief    Class to handle raw video format
+ *
+ * Non-seekable inputs (stdin using "-" as filename or FIFOs) are
+ * handled in streaming mode: frames are read ahead by a background
+ * thread into a bounded buffer and the number of frames is only
+ * known when the end of the stream is reached
+ *
+ * Files compressed with zstd or lz4 (e.g., .yuv.zst) are decompressed
+ * on the fly by CalypCompressedReader
  */
 class StreamHandlerRaw : public CalypStreamHandlerIf
 {
@@ -38,16 +51,42 @@ class StreamHandlerRaw : public CalypStreamHandlerIf
 
 private:
   FILE* m_pFile; /**< The input file pointer >*/
+  CalypCompressedReader* m_pcCompressedReader;
+
+  /** Streaming mode read-ahead */
+  std::thread m_cReadAheadThread;
+  std::mutex m_cReadAheadMutex;
+  std::condition_variable m_cReadAheadCond;
+  std::vector<ClpByte*> m_apReadAheadBuffers;
+  unsigned int m_uiReadAheadHead;
+  unsigned int m_uiReadAheadCount;
+  bool m_bReadAheadEOF;
+  bool m_bReadAheadStop;
+
+  void readAheadLoop();
+  void stopReadAhead();
+  bool readStreaming( CalypFrame* pcFrame );
+
+  bool readAt( ClpULong uiOffset, ClpByte* pBuffer, ClpULong uiSize );
+  bool readPartial( CalypFrame* pcFrame );
 
 public:
-  StreamHandlerRaw() { m_pchHandlerName = "RawVideo"; }
+  StreamHandlerRaw()
+      : m_pFile( NULL )
+      , m_pcCompressedReader( NULL )
+  {
+    m_pchHandlerName = "RawVideo";
+  }
   ~StreamHandlerRaw() {}
   bool openHandler( ClpString strFilename, bool bInput );
   void closeHandler();
   bool configureBuffer( CalypFrame* pcFrame );
   void calculateFrameNumber();
   bool seek( ClpULong iFrameNum );
+  bool skip( ClpULong uiNumFrames );
   bool read( CalypFrame* pcFrame );
+  bool prepareAsyncRead( CalypAsyncReadRequest& rcRequest );
+  bool finishAsyncRead( CalypFrame* pcFrame );
   bool write( CalypFrame* pcFrame );
 };
 
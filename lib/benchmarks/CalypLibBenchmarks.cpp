@@ -0,0 +1,218 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * \file     CalypLibBenchmarks.cpp
+ * \brief    Calyp library micro-benchmarks
+ *
+ * Frames are synthetic so the benchmarks do not need external data.
+ * Use --benchmark_out=<file> --benchmark_out_format=json to keep the
+ * results (the benchmark_json target does it for the build directory)
+ */
+
+#include "CalypFrame.h"
+#include "CalypStream.h"
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <memory>
+
+#define BENCH_WIDTH 1920
+#define BENCH_HEIGHT 1080
+#define BENCH_STREAM_FRAMES 8
+
+static const unsigned int s_auiBitsPel[] = { 8, 10 };
+
+static std::unique_ptr<CalypFrame> createSyntheticFrame( int iPelFmt, unsigned int uiBitsPel, unsigned int uiSeed = 1 )
+{
+  std::unique_ptr<CalypFrame> pcFrame( new CalypFrame( BENCH_WIDTH, BENCH_HEIGHT, iPelFmt, uiBitsPel ) );
+  pcFrame->fillSynthetic( uiSeed );
+  return pcFrame;
+}
+
+static void BM_FrameFromBuffer( benchmark::State& state, int iPelFmt, unsigned int uiBitsPel, int iEndianness )
+{
+  std::unique_ptr<CalypFrame> pcFrame = createSyntheticFrame( iPelFmt, uiBitsPel );
+  std::vector<ClpByte> acBuffer( pcFrame->getBytesPerFrame() );
+  pcFrame->frameToBuffer( acBuffer.data(), iEndianness );
+  for( auto _ : state )
+  {
+    pcFrame->frameFromBuffer( acBuffer.data(), iEndianness );
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed( state.iterations() * acBuffer.size() );
+}
+
+static void BM_FrameToBuffer( benchmark::State& state, int iPelFmt, unsigned int uiBitsPel, int iEndianness )
+{
+  std::unique_ptr<CalypFrame> pcFrame = createSyntheticFrame( iPelFmt, uiBitsPel );
+  std::vector<ClpByte> acBuffer( pcFrame->getBytesPerFrame() );
+  for( auto _ : state )
+  {
+    pcFrame->frameToBuffer( acBuffer.data(), iEndianness );
+    benchmark::DoNotOptimize( acBuffer.data() );
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed( state.iterations() * acBuffer.size() );
+}
+
+static void BM_FillRGBBuffer( benchmark::State& state, int iPelFmt, unsigned int uiBitsPel )
+{
+  std::unique_ptr<CalypFrame> pcFrame = createSyntheticFrame( iPelFmt, uiBitsPel );
+  for( auto _ : state )
+  {
+    // Drop the cached conversion
+    pcFrame->getPelBufferYUV();
+    pcFrame->fillRGBBuffer();
+    benchmark::DoNotOptimize( pcFrame->getRGBBuffer() );
+  }
+  state.SetItemsProcessed( state.iterations() * pcFrame->getPixels() );
+}
+
+static void BM_CalcHistogram( benchmark::State& state, int iPelFmt, unsigned int uiBitsPel )
+{
+  std::unique_ptr<CalypFrame> pcFrame = createSyntheticFrame( iPelFmt, uiBitsPel );
+  for( auto _ : state )
+  {
+    // Drop the cached histogram
+    pcFrame->getPelBufferYUV();
+    pcFrame->calcHistogram();
+    benchmark::DoNotOptimize( pcFrame->getMaximum( 0 ) );
+  }
+  state.SetItemsProcessed( state.iterations() * pcFrame->getTotalNumberOfPixels() );
+}
+
+static void BM_CopyFrom( benchmark::State& state, int iPelFmt, unsigned int uiBitsPel )
+{
+  std::unique_ptr<CalypFrame> pcSrc = createSyntheticFrame( iPelFmt, uiBitsPel );
+  CalypFrame cDst( BENCH_WIDTH, BENCH_HEIGHT, iPelFmt, uiBitsPel );
+  for( auto _ : state )
+  {
+    cDst.copyFrom( pcSrc.get() );
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed( state.iterations() * pcSrc->getTotalNumberOfPixels() * sizeof( ClpPel ) );
+}
+
+static void BM_CopyTo( benchmark::State& state, int iPelFmt, unsigned int uiBitsPel )
+{
+  // Copy a quarter-size block into the middle of the frame
+  std::unique_ptr<CalypFrame> pcFrame = createSyntheticFrame( iPelFmt, uiBitsPel );
+  CalypFrame cBlock( BENCH_WIDTH / 2, BENCH_HEIGHT / 2, iPelFmt, uiBitsPel );
+  cBlock.fillSynthetic( 2 );
+  for( auto _ : state )
+  {
+    pcFrame->copyTo( cBlock, BENCH_WIDTH / 4, BENCH_HEIGHT / 4 );
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed( state.iterations() * cBlock.getTotalNumberOfPixels() * sizeof( ClpPel ) );
+}
+
+static void BM_Quality( benchmark::State& state, int iMetric, int iPelFmt, unsigned int uiBitsPel )
+{
+  std::unique_ptr<CalypFrame> pcRef = createSyntheticFrame( iPelFmt, uiBitsPel, 1 );
+  std::unique_ptr<CalypFrame> pcDec = createSyntheticFrame( iPelFmt, uiBitsPel, 2 );
+  for( auto _ : state )
+  {
+    for( unsigned int c = 0; c < pcDec->getNumberChannels(); c++ )
+    {
+      benchmark::DoNotOptimize( pcDec->getQuality( iMetric, pcRef.get(), c ) );
+    }
+  }
+  state.SetItemsProcessed( state.iterations() * pcDec->getTotalNumberOfPixels() );
+}
+
+static void BM_StreamRead( benchmark::State& state, int iPelFmt, unsigned int uiBitsPel )
+{
+  ClpString strFilename = "CalypLibBenchmarks_" + std::to_string( iPelFmt ) + "_" + std::to_string( uiBitsPel ) + ".yuv";
+  std::unique_ptr<CalypFrame> pcFrame = createSyntheticFrame( iPelFmt, uiBitsPel );
+  try
+  {
+    CalypStream cOutput;
+    cOutput.open( strFilename, BENCH_WIDTH, BENCH_HEIGHT, iPelFmt, uiBitsPel, CLP_LITTLE_ENDIAN, 1, false );
+    for( unsigned int i = 0; i < BENCH_STREAM_FRAMES; i++ )
+      cOutput.writeFrame( pcFrame.get() );
+    cOutput.close();
+
+    CalypStream cInput;
+    cInput.open( strFilename, BENCH_WIDTH, BENCH_HEIGHT, iPelFmt, uiBitsPel, CLP_LITTLE_ENDIAN, 1, true );
+    for( auto _ : state )
+    {
+      if( cInput.setNextFrame() )
+        cInput.seekInput( 0 );
+      cInput.readNextFrame();
+    }
+    cInput.close();
+  }
+  catch( CalypFailure& e )
+  {
+    state.SkipWithError( e.what() );
+  }
+  std::remove( strFilename.c_str() );
+  state.SetBytesProcessed( state.iterations() * pcFrame->getBytesPerFrame() );
+}
+
+static void registerBenchmarks()
+{
+  std::vector<ClpString> astrFormats = CalypFrame::supportedPixelFormatListNames();
+  std::vector<ClpString> astrMetrics = CalypFrame::supportedQualityMetricsList();
+  const char* apchEndianness[] = { "BE", "LE" };
+
+  for( int iPelFmt = 0; iPelFmt < CalypFrame::numberOfFormats(); iPelFmt++ )
+  {
+    for( unsigned int uiBitsPel : s_auiBitsPel )
+    {
+      ClpString strConfig = "/" + astrFormats[iPelFmt] + "/" + std::to_string( uiBitsPel ) + "bits";
+      for( int iEndianness = CLP_BIG_ENDIAN; iEndianness <= CLP_LITTLE_ENDIAN; iEndianness++ )
+      {
+        // Endianness does not matter for one byte per sample
+        if( uiBitsPel <= 8 && iEndianness != CLP_LITTLE_ENDIAN )
+          continue;
+        ClpString strEndianness = ClpString( "/" ) + apchEndianness[iEndianness];
+        benchmark::RegisterBenchmark( ( "frameFromBuffer" + strConfig + strEndianness ).c_str(), BM_FrameFromBuffer, iPelFmt,
+                                      uiBitsPel, iEndianness );
+        benchmark::RegisterBenchmark( ( "frameToBuffer" + strConfig + strEndianness ).c_str(), BM_FrameToBuffer, iPelFmt,
+                                      uiBitsPel, iEndianness );
+      }
+      benchmark::RegisterBenchmark( ( "fillRGBBuffer" + strConfig ).c_str(), BM_FillRGBBuffer, iPelFmt, uiBitsPel );
+      benchmark::RegisterBenchmark( ( "calcHistogram" + strConfig ).c_str(), BM_CalcHistogram, iPelFmt, uiBitsPel );
+      benchmark::RegisterBenchmark( ( "copyFrom" + strConfig ).c_str(), BM_CopyFrom, iPelFmt, uiBitsPel );
+      benchmark::RegisterBenchmark( ( "copyTo" + strConfig ).c_str(), BM_CopyTo, iPelFmt, uiBitsPel );
+      for( int iMetric = 0; iMetric < CalypFrame::NUMBER_METRICS; iMetric++ )
+      {
+        benchmark::RegisterBenchmark( ( "quality/" + astrMetrics[iMetric] + strConfig ).c_str(), BM_Quality, iMetric, iPelFmt,
+                                      uiBitsPel );
+      }
+      benchmark::RegisterBenchmark( ( "streamRead" + strConfig ).c_str(), BM_StreamRead, iPelFmt, uiBitsPel )
+          ->Unit( benchmark::kMillisecond );
+    }
+  }
+}
+
+int main( int argc, char** argv )
+{
+  benchmark::Initialize( &argc, argv );
+  if( benchmark::ReportUnrecognizedArguments( argc, argv ) )
+    return 1;
+  registerBenchmarks();
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,1746 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * \file     CalypPerformanceTests.cpp
+ * \brief    Bit-exactness and throughput regression tests on synthetic data
+ *
+ * The frames are generated on the fly (no external test data) for every
+ * pel format and bit depth. The optimized kernels of the library and of
+ * the built-in modules are compared against straightforward scalar
+ * references and their throughput is checked against minimum values.
+ *
+ * The minimum throughput (MB/s) of each kernel can be overridden with
+ * CALYP_PERF_MIN_<NAME> (e.g., CALYP_PERF_MIN_FRAMEFROMBUFFER=800) and all
+ * the minimums are multiplied by CALYP_PERF_SCALE (0 disables the
+ * throughput checks, e.g., on debug or instrumented builds)
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+#include "CalypFrame.h"
+#include "CalypMemory.h"
+#include "CalypMultiStreamReader.h"
+#include "CalypPlaneKernels.h"
+#include "CalypRemap.h"
+#include "CalypResampler.h"
+#include "CalypStream.h"
+#include "gtest/gtest.h"
+#include "modules/CalypModulesFactory.h"
+
+#define TEST_WIDTH 64
+#define TEST_HEIGHT 48
+#define TEST_SEQUENCE_FRAMES 3
+
+#define PERF_WIDTH 1920
+#define PERF_HEIGHT 1080
+#define PERF_MIN_SECONDS 0.1
+
+static const unsigned int s_auiBitsPel[] = { 8, 10, 12, 16 };
+
+/**
+ * Synthetic data
+ */
+
+static std::unique_ptr<CalypFrame> createSyntheticFrame( unsigned int uiWidth, unsigned int uiHeight, int iPelFmt,
+                                                         unsigned int uiBitsPel, unsigned int uiSeed )
+{
+  std::unique_ptr<CalypFrame> pcFrame( new CalypFrame( uiWidth, uiHeight, iPelFmt, uiBitsPel ) );
+  pcFrame->fillSynthetic( uiSeed );
+  return pcFrame;
+}
+
+static ::testing::AssertionResult framesAreEqual( CalypFrame* pcFrame, CalypFrame* pcRef )
+{
+  if( !pcFrame->haveSameFmt( pcRef ) )
+    return ::testing::AssertionFailure() << "format mismatch";
+  for( unsigned int ch = 0; ch < pcRef->getNumberChannels(); ch++ )
+    for( unsigned int y = 0; y < pcRef->getHeight( ch ); y++ )
+      for( unsigned int x = 0; x < pcRef->getWidth( ch ); x++ )
+        if( pcFrame->getPelBufferYUV()[ch][y][x] != pcRef->getPelBufferYUV()[ch][y][x] )
+          return ::testing::AssertionFailure() << "mismatch at channel " << ch << " (" << x << "," << y << "): "
+                                               << pcFrame->getPelBufferYUV()[ch][y][x]
+                                               << " != " << pcRef->getPelBufferYUV()[ch][y][x];
+  return ::testing::AssertionSuccess();
+}
+
+static bool pixelsAreEqual( CalypPixel cPixel, CalypPixel cRef, int iPelFmt )
+{
+  unsigned int uiChannels = CalypFrame( 2, 2, iPelFmt ).getNumberChannels();
+  for( unsigned int ch = 0; ch < uiChannels; ch++ )
+    if( cPixel[ch] != cRef[ch] )
+      return false;
+  return true;
+}
+
+/**
+ * Scalar references
+ */
+
+//! Position of a sample in a raw buffer (in samples), written from the
+//! layout of each format rather than from the pel format descriptors
+static ClpULong refSampleIndex( int iPelFmt, unsigned int ch, unsigned int x, unsigned int y, unsigned int uiWidth,
+                                unsigned int uiHeight )
+{
+  ClpULong uiLuma = ClpULong( uiWidth ) * uiHeight;
+  switch( iPelFmt )
+  {
+  case CLP_YUV420P:
+    return ch == 0 ? ClpULong( y ) * uiWidth + x : uiLuma + ( ch - 1 ) * ( uiLuma / 4 ) + ClpULong( y ) * ( uiWidth / 2 ) + x;
+  case CLP_YUV422P:
+    return ch == 0 ? ClpULong( y ) * uiWidth + x : uiLuma + ( ch - 1 ) * ( uiLuma / 2 ) + ClpULong( y ) * ( uiWidth / 2 ) + x;
+  case CLP_YUV444P:
+  case CLP_GRAY:
+  case CLP_RGB24P:
+    return ch * uiLuma + ClpULong( y ) * uiWidth + x;
+  case CLP_YUYV422:
+    // Y0 U0 Y1 V0
+    return ch == 0 ? ( ClpULong( y ) * uiWidth + x ) * 2 : ( ClpULong( y ) * ( uiWidth / 2 ) + x ) * 4 + ( ch == 1 ? 1 : 3 );
+  case CLP_RGB24:
+    return ( ClpULong( y ) * uiWidth + x ) * 3 + ch;
+  case CLP_BGR24:
+    return ( ClpULong( y ) * uiWidth + x ) * 3 + 2 - ch;
+  case CLP_RGBA32:
+    return ( ClpULong( y ) * uiWidth + x ) * 4 + ch;
+  case CLP_BGRA32:
+    return ( ClpULong( y ) * uiWidth + x ) * 4 + ( ch == 3 ? 3 : 2 - ch );
+  }
+  return 0;
+}
+
+static std::vector<ClpByte> refFrameToBuffer( CalypFrame* pcFrame, int iEndianness )
+{
+  unsigned int uiBytesPel = ( pcFrame->getBitsPel() - 1 ) / 8 + 1;
+  std::vector<ClpByte> acBuffer( pcFrame->getBytesPerFrame() );
+  for( unsigned int ch = 0; ch < pcFrame->getNumberChannels(); ch++ )
+  {
+    for( unsigned int y = 0; y < pcFrame->getHeight( ch ); y++ )
+    {
+      for( unsigned int x = 0; x < pcFrame->getWidth( ch ); x++ )
+      {
+        ClpPel uiPel = pcFrame->getPelBufferYUV()[ch][y][x];
+        ClpULong uiPos = refSampleIndex( pcFrame->getPelFormat(), ch, x, y, pcFrame->getWidth(), pcFrame->getHeight() ) * uiBytesPel;
+        for( unsigned int b = 0; b < uiBytesPel; b++ )
+        {
+          unsigned int uiShift = iEndianness == CLP_BIG_ENDIAN ? ( uiBytesPel - 1 - b ) * 8 : b * 8;
+          acBuffer[uiPos + b] = ( uiPel >> uiShift ) & 0xFF;
+        }
+      }
+    }
+  }
+  return acBuffer;
+}
+
+/**
+ * Throughput
+ */
+
+//! Minimum throughput of a kernel (MB/s) or 0 if it should not be checked
+static double getMinThroughput( const ClpString& strName, double dDefault )
+{
+  double dScale = 1;
+  if( const char* pchScale = getenv( "CALYP_PERF_SCALE" ) )
+    dScale = atof( pchScale );
+
+  ClpString strVariable = "CALYP_PERF_MIN_" + strName;
+  std::transform( strVariable.begin(), strVariable.end(), strVariable.begin(), ::toupper );
+  if( const char* pchMin = getenv( strVariable.c_str() ) )
+    dDefault = atof( pchMin );
+  return dDefault * dScale;
+}
+
+//! Run the kernel for at least PERF_MIN_SECONDS and return MB/s
+template <typename Fn>
+static double measureThroughput( ClpULong uiBytesPerRun, Fn fnKernel )
+{
+  typedef std::chrono::steady_clock Clock;
+  fnKernel();  // warm-up
+  ClpULong uiRuns = 0;
+  double dSeconds = 0;
+  Clock::time_point cStart = Clock::now();
+  do
+  {
+    fnKernel();
+    uiRuns++;
+    dSeconds = std::chrono::duration<double>( Clock::now() - cStart ).count();
+  } while( dSeconds < PERF_MIN_SECONDS || uiRuns < 3 );
+  return double( uiBytesPerRun ) * uiRuns / dSeconds / ( 1024 * 1024 );
+}
+
+#define EXPECT_THROUGHPUT( NAME, DEFAULT_MIN, BYTES, KERNEL )                      \
+  {                                                                                \
+    double dMin = getMinThroughput( NAME, DEFAULT_MIN );                           \
+    if( dMin > 0 )                                                                 \
+    {                                                                              \
+      double dThroughput = measureThroughput( BYTES, KERNEL );                     \
+      RecordProperty( NAME, std::to_string( int( dThroughput ) ) );                \
+      EXPECT_GE( dThroughput, dMin ) << NAME << " throughput regression (MB/s)"; \
+    }                                                                              \
+  }
+
+/**
+ * Fixture running over every pel format and bit depth
+ */
+
+class CalypFormatTest : public ::testing::TestWithParam<std::tuple<int, unsigned int>>
+{
+protected:
+  int m_iPelFmt;
+  unsigned int m_uiBitsPel;
+
+  void SetUp()
+  {
+    m_iPelFmt = std::get<0>( GetParam() );
+    m_uiBitsPel = std::get<1>( GetParam() );
+  }
+  std::unique_ptr<CalypFrame> createFrame( unsigned int uiSeed, unsigned int uiWidth = TEST_WIDTH,
+                                           unsigned int uiHeight = TEST_HEIGHT )
+  {
+    return createSyntheticFrame( uiWidth, uiHeight, m_iPelFmt, m_uiBitsPel, uiSeed );
+  }
+};
+
+TEST_P( CalypFormatTest, FrameToBuffer )
+{
+  for( int iEndianness = CLP_BIG_ENDIAN; iEndianness <= CLP_LITTLE_ENDIAN; iEndianness++ )
+  {
+    std::unique_ptr<CalypFrame> pcFrame = createFrame( 1 );
+    std::vector<ClpByte> acRef = refFrameToBuffer( pcFrame.get(), iEndianness );
+    std::vector<ClpByte> acBuffer( pcFrame->getBytesPerFrame() );
+    pcFrame->frameToBuffer( acBuffer.data(), iEndianness );
+    EXPECT_TRUE( acBuffer == acRef ) << "endianness " << iEndianness;
+  }
+}
+
+TEST_P( CalypFormatTest, FrameFromBuffer )
+{
+  for( int iEndianness = CLP_BIG_ENDIAN; iEndianness <= CLP_LITTLE_ENDIAN; iEndianness++ )
+  {
+    std::unique_ptr<CalypFrame> pcRef = createFrame( 2 );
+    std::unique_ptr<CalypFrame> pcFrame = createFrame( 3 );
+    std::vector<ClpByte> acBuffer = refFrameToBuffer( pcRef.get(), iEndianness );
+    pcFrame->frameFromBuffer( acBuffer.data(), iEndianness );
+    EXPECT_TRUE( framesAreEqual( pcFrame.get(), pcRef.get() ) ) << "endianness " << iEndianness;
+  }
+}
+
+TEST_P( CalypFormatTest, Histogram )
+{
+  std::unique_ptr<CalypFrame> pcFrame = createFrame( 4 );
+  // Read only access (the non-const getPelBufferYUV drops the histogram)
+  ClpPel*** pppcPel = static_cast<const CalypFrame*>( pcFrame.get() )->getPelBufferYUV();
+  pcFrame->calcHistogram();
+  for( unsigned int ch = 0; ch < pcFrame->getNumberChannels(); ch++ )
+  {
+    std::vector<unsigned int> auiRef( 1 << m_uiBitsPel, 0 );
+    for( unsigned int y = 0; y < pcFrame->getHeight( ch ); y++ )
+      for( unsigned int x = 0; x < pcFrame->getWidth( ch ); x++ )
+        auiRef[pppcPel[ch][y][x]]++;
+    for( unsigned int bin = 0; bin < auiRef.size(); bin++ )
+      ASSERT_EQ( pcFrame->getHistogramValue( CalypFrame::HIST_CHAN_ONE + ch, bin ), double( auiRef[bin] ) )
+          << "channel " << ch << " bin " << bin;
+  }
+}
+
+TEST_P( CalypFormatTest, PixelAccess )
+{
+  std::unique_ptr<CalypFrame> pcFrame = createFrame( 5 );
+  std::unique_ptr<CalypFrame> pcCopy = createFrame( 6 );
+  for( unsigned int y = 0; y < pcFrame->getHeight(); y++ )
+    for( unsigned int x = 0; x < pcFrame->getWidth(); x++ )
+      pcCopy->setPixel( x, y, pcFrame->getPixel( x, y ) );
+  EXPECT_TRUE( framesAreEqual( pcCopy.get(), pcFrame.get() ) );
+}
+
+TEST_P( CalypFormatTest, Copy )
+{
+  const unsigned int uiX = 16;
+  const unsigned int uiY = 8;
+  std::unique_ptr<CalypFrame> pcFrame = createFrame( 7 );
+  std::unique_ptr<CalypFrame> pcCopy = createFrame( 8 );
+  pcCopy->copyFrom( pcFrame.get() );
+  EXPECT_TRUE( framesAreEqual( pcCopy.get(), pcFrame.get() ) );
+
+  std::unique_ptr<CalypFrame> pcBlock = createFrame( 9, TEST_WIDTH / 2, TEST_HEIGHT / 2 );
+  pcBlock->copyFrom( pcFrame.get(), uiX, uiY );
+  for( unsigned int y = 0; y < pcBlock->getHeight(); y++ )
+    for( unsigned int x = 0; x < pcBlock->getWidth(); x++ )
+      ASSERT_TRUE( pixelsAreEqual( pcBlock->getPixel( x, y ), pcFrame->getPixel( uiX + x, uiY + y ), m_iPelFmt ) ) << "copyFrom (" << x << "," << y << ")";
+
+  pcBlock->fillSynthetic( 10 );
+  pcFrame->copyTo( pcBlock.get(), uiX, uiY );
+  for( unsigned int y = 0; y < pcBlock->getHeight(); y++ )
+    for( unsigned int x = 0; x < pcBlock->getWidth(); x++ )
+      ASSERT_TRUE( pixelsAreEqual( pcFrame->getPixel( uiX + x, uiY + y ), pcBlock->getPixel( x, y ), m_iPelFmt ) ) << "copyTo (" << x << "," << y << ")";
+}
+
+TEST_P( CalypFormatTest, Quality )
+{
+  std::unique_ptr<CalypFrame> pcFrame = createFrame( 11 );
+  std::unique_ptr<CalypFrame> pcRef = createFrame( 12 );
+  double dMaxValue = ( 1 << m_uiBitsPel ) - 1;
+  for( unsigned int ch = 0; ch < pcFrame->getNumberChannels(); ch++ )
+  {
+    double dSSD = 0;
+    double dPixels = double( pcFrame->getWidth( ch ) ) * pcFrame->getHeight( ch );
+    for( unsigned int y = 0; y < pcFrame->getHeight( ch ); y++ )
+      for( unsigned int x = 0; x < pcFrame->getWidth( ch ); x++ )
+      {
+        double dDiff = double( pcFrame->getPelBufferYUV()[ch][y][x] ) - pcRef->getPelBufferYUV()[ch][y][x];
+        dSSD += dDiff * dDiff;
+      }
+    double dMSE = dSSD / dPixels;
+    EXPECT_DOUBLE_EQ( pcFrame->getQuality( CalypFrame::MSE_METRIC, pcRef.get(), ch ), dMSE );
+    EXPECT_NEAR( pcFrame->getQuality( CalypFrame::PSNR_METRIC, pcRef.get(), ch ),
+                 10 * log10( dMaxValue * dMaxValue / dMSE ), 1e-9 );
+    EXPECT_EQ( pcFrame->getQuality( CalypFrame::MSE_METRIC, pcFrame.get(), ch ), 0 );
+  }
+}
+
+TEST_P( CalypFormatTest, StreamSequence )
+{
+  ClpString strFilename = "CalypPerformanceTests_" + std::to_string( m_iPelFmt ) + "_" + std::to_string( m_uiBitsPel ) + ".yuv";
+  for( int iEndianness = CLP_BIG_ENDIAN; iEndianness <= CLP_LITTLE_ENDIAN; iEndianness++ )
+  {
+    FILE* pFile = fopen( strFilename.c_str(), "wb" );
+    ASSERT_TRUE( pFile != NULL );
+    for( unsigned int i = 0; i < TEST_SEQUENCE_FRAMES; i++ )
+    {
+      std::vector<ClpByte> acBuffer = refFrameToBuffer( createFrame( 100 + i ).get(), iEndianness );
+      fwrite( acBuffer.data(), 1, acBuffer.size(), pFile );
+    }
+    fclose( pFile );
+
+    try
+    {
+      CalypStream cStream;
+      cStream.open( strFilename, TEST_WIDTH, TEST_HEIGHT, m_iPelFmt, m_uiBitsPel, iEndianness, 1, true );
+      ASSERT_EQ( cStream.getFrameNum(), ClpULong( TEST_SEQUENCE_FRAMES ) );
+      for( unsigned int i = 0; i < TEST_SEQUENCE_FRAMES; i++ )
+      {
+        if( i > 0 )
+        {
+          cStream.setNextFrame();
+          cStream.readNextFrame();
+        }
+        EXPECT_TRUE( framesAreEqual( cStream.getCurrFrame(), createFrame( 100 + i ).get() ) )
+            << "frame " << i << " endianness " << iEndianness;
+      }
+      cStream.close();
+    }
+    catch( CalypFailure& e )
+    {
+      ADD_FAILURE() << e.what();
+    }
+  }
+  std::remove( strFilename.c_str() );
+}
+
+static ClpString formatTestName( const ::testing::TestParamInfo<std::tuple<int, unsigned int>>& info )
+{
+  ClpString strName = CalypFrame::supportedPixelFormatListNames()[std::get<0>( info.param )] + "_" +
+                      std::to_string( std::get<1>( info.param ) ) + "bits";
+  std::replace_if( strName.begin(), strName.end(), []( char c ) { return !isalnum( c ); }, '_' );
+  return strName;
+}
+
+INSTANTIATE_TEST_CASE_P( AllFormats, CalypFormatTest,
+                         ::testing::Combine( ::testing::Range( 0, CalypFrame::numberOfFormats() ),
+                                             ::testing::ValuesIn( s_auiBitsPel ) ),
+                         formatTestName );
+
+/**
+ * Memory accounting
+ */
+
+TEST( CalypMemoryTest, Counters )
+{
+  CalypMemory::Usage cBase = CalypMemory::get( CLP_MEMORY_MODULE );
+  CalypMemory::Usage cBaseTotal = CalypMemory::getTotal();
+  CalypMemory::allocate( CLP_MEMORY_MODULE, 3000 );
+  CalypMemory::release( CLP_MEMORY_MODULE, 1000 );
+  CalypMemory::allocate( CLP_MEMORY_MODULE, 500 );
+  EXPECT_EQ( CalypMemory::get( CLP_MEMORY_MODULE ).uiCurrent, cBase.uiCurrent + 2500 );
+  EXPECT_EQ( CalypMemory::getTotal().uiCurrent, cBaseTotal.uiCurrent + 2500 );
+  // The peak is kept after the release
+  CalypMemory::release( CLP_MEMORY_MODULE, 2500 );
+  EXPECT_EQ( CalypMemory::get( CLP_MEMORY_MODULE ).uiCurrent, cBase.uiCurrent );
+  EXPECT_GE( CalypMemory::get( CLP_MEMORY_MODULE ).uiPeak, cBase.uiCurrent + 3000 );
+  EXPECT_GE( CalypMemory::getTotal().uiPeak, cBaseTotal.uiCurrent + 3000 );
+
+  // Frames are accounted in the category of the thread
+  ClpULong uiFrameBytes = ClpULong( TEST_WIDTH ) * TEST_HEIGHT * 3 / 2 * sizeof( ClpPel );
+  {
+    CalypMemoryScope cScope( CLP_MEMORY_MODULE );
+    EXPECT_EQ( CalypMemory::getThreadCategory(), CLP_MEMORY_MODULE );
+    CalypFrame cFrame( TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, 8 );
+    EXPECT_GE( CalypMemory::get( CLP_MEMORY_MODULE ).uiCurrent, cBase.uiCurrent + uiFrameBytes );
+  }
+  EXPECT_EQ( CalypMemory::getThreadCategory(), CLP_MEMORY_FRAME );
+  EXPECT_EQ( CalypMemory::get( CLP_MEMORY_MODULE ).uiCurrent, cBase.uiCurrent );
+}
+
+TEST( CalypMemoryTest, BudgetAndReclaimers )
+{
+  std::vector<ClpULong> auiFirst, auiSecond;
+  int iFirst = CalypMemory::addReclaimer( [&]( ClpULong uiBytes ) {
+    auiFirst.push_back( uiBytes );
+    return uiBytes / 2;
+  } );
+  int iSecond = CalypMemory::addReclaimer( [&]( ClpULong uiBytes ) {
+    auiSecond.push_back( uiBytes );
+    return uiBytes;
+  } );
+
+  ClpULong uiBudget = CalypMemory::getTotal().uiCurrent + 1000;
+  CalypMemory::setBudget( uiBudget );
+  EXPECT_EQ( CalypMemory::getBudget(), uiBudget );
+  EXPECT_EQ( CalypMemory::getAvailable(), 1000u );
+  CalypMemory::allocate( CLP_MEMORY_MODULE, 600 );
+  EXPECT_TRUE( auiFirst.empty() );
+
+  // Over the budget: the second reclaimer is asked for what the first did not free
+  CalypMemory::allocate( CLP_MEMORY_MODULE, 800 );
+  ASSERT_EQ( auiFirst.size(), 1u );
+  EXPECT_EQ( auiFirst[0], 400u );
+  ASSERT_EQ( auiSecond.size(), 1u );
+  EXPECT_EQ( auiSecond[0], 200u );
+  // Allocations never fail because of the budget
+  EXPECT_EQ( CalypMemory::getAvailable(), 0u );
+
+  CalypMemory::removeReclaimer( iFirst );
+  CalypMemory::release( CLP_MEMORY_MODULE, 1400 );
+  CalypMemory::allocate( CLP_MEMORY_MODULE, 1100 );
+  EXPECT_EQ( auiFirst.size(), 1u );
+  ASSERT_EQ( auiSecond.size(), 2u );
+  EXPECT_EQ( auiSecond[1], 100u );
+  CalypMemory::release( CLP_MEMORY_MODULE, 1100 );
+
+  CalypMemory::removeReclaimer( iSecond );
+  CalypMemory::setBudget( 0 );
+  EXPECT_EQ( CalypMemory::getAvailable(), CLP_MEMORY_UNLIMITED );
+}
+
+/**
+ * Streams over a synthetic raw file
+ */
+
+#define STREAM_TEST_FRAMES 8
+
+class CalypStreamTest : public ::testing::Test
+{
+protected:
+  ClpString m_strFilename;
+
+  void SetUp()
+  {
+    m_strFilename = ClpString( "CalypStreamTest_" ) + ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".yuv";
+    writeRawFile( m_strFilename, STREAM_TEST_FRAMES );
+  }
+  void TearDown()
+  {
+    CalypMemory::setBudget( 0 );
+    std::remove( m_strFilename.c_str() );
+  }
+  static std::unique_ptr<CalypFrame> createFrame( unsigned int uiIdx, unsigned int uiSeed = 100 )
+  {
+    return createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, 8, uiSeed + uiIdx );
+  }
+  //! Other seeds are used to tell the frames read again from the file
+  static void writeRawFile( const ClpString& strFilename, unsigned int uiNumFrames, unsigned int uiSeed = 100 )
+  {
+    FILE* pFile = fopen( strFilename.c_str(), "wb" );
+    ASSERT_TRUE( pFile != NULL );
+    for( unsigned int i = 0; i < uiNumFrames; i++ )
+    {
+      std::vector<ClpByte> acBuffer = refFrameToBuffer( createFrame( i, uiSeed ).get(), CLP_LITTLE_ENDIAN );
+      fwrite( acBuffer.data(), 1, acBuffer.size(), pFile );
+    }
+    fclose( pFile );
+  }
+  static void openStream( CalypStream& cStream, const ClpString& strFilename )
+  {
+    cStream.open( strFilename, TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, 8, CLP_LITTLE_ENDIAN, false, 1, true );
+  }
+  static ::testing::AssertionResult streamIsAt( CalypStream& cStream, unsigned int uiIdx, unsigned int uiSeed = 100 )
+  {
+    if( cStream.getCurrFrameNum() != long( uiIdx ) )
+      return ::testing::AssertionFailure() << "at frame " << cStream.getCurrFrameNum() << " instead of " << uiIdx;
+    return framesAreEqual( cStream.getCurrFrame(), createFrame( uiIdx, uiSeed ).get() );
+  }
+  static ::testing::AssertionResult rowsAreEqual( CalypFrame* pcFrame, CalypFrame* pcRef, unsigned int ch,
+                                                  unsigned int uiFirstRow, unsigned int uiNumRows )
+  {
+    for( unsigned int y = uiFirstRow; y < uiFirstRow + uiNumRows; y++ )
+      for( unsigned int x = 0; x < pcRef->getWidth( ch ); x++ )
+        if( pcFrame->getPelBufferYUV()[ch][y][x] != pcRef->getPelBufferYUV()[ch][y][x] )
+          return ::testing::AssertionFailure() << "channel " << ch << " differs at (" << x << "," << y << ")";
+    return ::testing::AssertionSuccess();
+  }
+};
+
+TEST_F( CalypStreamTest, ReadMask )
+{
+  CalypStream cStream;
+  openStream( cStream, m_strFilename );
+  cStream.setCacheSize( 1 );
+
+  // Rows of the luma only
+  cStream.setReadMask( 1 << CLP_LUMA, 8, 16 );
+  cStream.seekInput( 3 );
+  EXPECT_TRUE( rowsAreEqual( cStream.getCurrFrame(), createFrame( 3 ).get(), CLP_LUMA, 8, 16 ) );
+
+  // Whole chroma plane (the rows are given in luma rows)
+  cStream.setReadMask( 1 << CLP_CHROMA_U );
+  cStream.seekInput( 5 );
+  EXPECT_TRUE( rowsAreEqual( cStream.getCurrFrame(), createFrame( 5 ).get(), CLP_CHROMA_U, 0, TEST_HEIGHT / 2 ) );
+  cStream.setReadMask( 1 << CLP_CHROMA_V, 16, 16 );
+  cStream.seekInput( 6 );
+  EXPECT_TRUE( rowsAreEqual( cStream.getCurrFrame(), createFrame( 6 ).get(), CLP_CHROMA_V, 8, 8 ) );
+
+  // The partial reads are not cached: the full reads match the reference
+  cStream.resetReadMask();
+  for( unsigned int uiFrame : { 3, 5, 6, 0 } )
+  {
+    cStream.seekInput( uiFrame );
+    EXPECT_TRUE( streamIsAt( cStream, uiFrame ) );
+  }
+  cStream.close();
+}
+
+TEST_F( CalypStreamTest, CacheHits )
+{
+  CalypStream cStream;
+  openStream( cStream, m_strFilename );
+  cStream.setCacheSize( 1 );
+  for( unsigned int i = 1; i < STREAM_TEST_FRAMES; i++ )
+  {
+    cStream.setNextFrame();
+    cStream.readNextFrame();
+  }
+
+  // Frames read again come from the cache, not from the changed file
+  // (the first two frames are read when opening, before the cache is set)
+  writeRawFile( m_strFilename, STREAM_TEST_FRAMES, 200 );
+  for( unsigned int uiFrame : { 2, 6, 4 } )
+  {
+    cStream.seekInput( uiFrame );
+    EXPECT_TRUE( streamIsAt( cStream, uiFrame ) );
+  }
+  cStream.seekInputRelative( false );
+  EXPECT_TRUE( streamIsAt( cStream, 3 ) );
+  cStream.seekInput( 0 );
+  EXPECT_TRUE( streamIsAt( cStream, 0, 200 ) );
+  cStream.close();
+
+  CalypStream cUncached;
+  openStream( cUncached, m_strFilename );
+  cUncached.seekInput( 2 );
+  EXPECT_TRUE( streamIsAt( cUncached, 2, 200 ) );
+  cUncached.close();
+}
+
+TEST_F( CalypStreamTest, CacheEviction )
+{
+  // The reference frames are allocated first: any allocation over the budget evicts frames
+  std::vector<std::unique_ptr<CalypFrame>> apcFile, apcChanged;
+  for( unsigned int i = 0; i < STREAM_TEST_FRAMES; i++ )
+  {
+    apcFile.push_back( createFrame( i ) );
+    apcChanged.push_back( createFrame( i, 200 ) );
+  }
+
+  // The global budget keeps three frames: the least recently used ones are evicted
+  ClpULong uiFrameBytes = ClpULong( TEST_WIDTH ) * TEST_HEIGHT * 3 / 2 * sizeof( ClpPel );
+  CalypStream cStream;
+  openStream( cStream, m_strFilename );
+  cStream.setCacheSize( 1 );
+  ClpULong uiBudget = CalypMemory::getTotal().uiCurrent + 3 * uiFrameBytes + uiFrameBytes / 2;
+  CalypMemory::setBudget( uiBudget );
+  for( unsigned int i = 1; i < STREAM_TEST_FRAMES; i++ )
+  {
+    cStream.setNextFrame();
+    cStream.readNextFrame();
+    EXPECT_LE( CalypMemory::get( CLP_MEMORY_CACHE ).uiCurrent, 3 * uiFrameBytes ) << "frame " << i;
+  }
+  EXPECT_GT( CalypMemory::get( CLP_MEMORY_CACHE ).uiCurrent, 0u );
+
+  // The frames generated for the file would evict the cache too
+  CalypMemory::setBudget( 0 );
+  writeRawFile( m_strFilename, STREAM_TEST_FRAMES, 200 );
+  CalypMemory::setBudget( uiBudget );
+
+  cStream.seekInput( 6 );
+  EXPECT_TRUE( framesAreEqual( cStream.getCurrFrame(), apcFile[6].get() ) );
+  cStream.seekInput( 0 );
+  EXPECT_TRUE( framesAreEqual( cStream.getCurrFrame(), apcChanged[0].get() ) );
+  // Reading 0 and 1 evicted 5 and 6, but not 7 (used after 6)
+  cStream.seekInput( 7 );
+  EXPECT_TRUE( framesAreEqual( cStream.getCurrFrame(), apcFile[7].get() ) );
+  cStream.seekInput( 6 );
+  EXPECT_TRUE( framesAreEqual( cStream.getCurrFrame(), apcChanged[6].get() ) );
+  cStream.close();
+}
+
+TEST_F( CalypStreamTest, ReverseStepping )
+{
+  for( unsigned int uiCacheMB : { 0, 1 } )
+  {
+    CalypStream cStream;
+    openStream( cStream, m_strFilename );
+    cStream.setCacheSize( uiCacheMB );
+    cStream.seekInput( STREAM_TEST_FRAMES - 1 );
+    for( int i = STREAM_TEST_FRAMES - 2; i >= 0; i-- )
+    {
+      EXPECT_TRUE( cStream.seekInputRelative( false ) ) << "cache " << uiCacheMB;
+      EXPECT_TRUE( streamIsAt( cStream, i ) ) << "cache " << uiCacheMB;
+    }
+    EXPECT_FALSE( cStream.seekInputRelative( false ) );
+    EXPECT_TRUE( streamIsAt( cStream, 0 ) ) << "cache " << uiCacheMB;
+
+    // Back and forth: the frame after the current one is still the right one
+    cStream.seekInput( 4 );
+    cStream.seekInputRelative( false );
+    cStream.seekInputRelative( false );
+    EXPECT_TRUE( streamIsAt( cStream, 2 ) ) << "cache " << uiCacheMB;
+    cStream.seekInputRelative( true );
+    EXPECT_TRUE( streamIsAt( cStream, 3 ) ) << "cache " << uiCacheMB;
+    cStream.setNextFrame();
+    cStream.readNextFrame();
+    EXPECT_TRUE( streamIsAt( cStream, 4 ) ) << "cache " << uiCacheMB;
+    cStream.close();
+  }
+}
+
+TEST_F( CalypStreamTest, LoadAllProgress )
+{
+  CalypStream cStream;
+  openStream( cStream, m_strFilename );
+  cStream.seekInput( 2 );
+  std::vector<ClpULong> auiProgress;
+  EXPECT_TRUE( cStream.loadAll( 0,
+                                [&]( ClpULong uiLoaded, ClpULong uiTotal ) {
+                                  EXPECT_EQ( uiTotal, ClpULong( STREAM_TEST_FRAMES ) );
+                                  auiProgress.push_back( uiLoaded );
+                                  return true;
+                                },
+                                2 ) );
+  ASSERT_FALSE( auiProgress.empty() );
+  EXPECT_TRUE( std::is_sorted( auiProgress.begin(), auiProgress.end() ) );
+  EXPECT_EQ( auiProgress.back(), ClpULong( STREAM_TEST_FRAMES ) );
+
+  // Every frame is in memory: the changed file is not read again
+  writeRawFile( m_strFilename, STREAM_TEST_FRAMES, 200 );
+  EXPECT_TRUE( streamIsAt( cStream, 2 ) );
+  for( unsigned int uiFrame : { 7, 0, 5 } )
+  {
+    cStream.seekInput( uiFrame );
+    EXPECT_TRUE( streamIsAt( cStream, uiFrame ) );
+  }
+  cStream.close();
+}
+
+TEST_F( CalypStreamTest, LoadAllCancel )
+{
+  // Loading may end before the first report; otherwise it is cancelled
+  CalypStream cStream;
+  openStream( cStream, m_strFilename );
+  cStream.seekInput( 3 );
+  bool bCancelled = false;
+  bool bLoaded = cStream.loadAll( 0, [&]( ClpULong uiLoaded, ClpULong uiTotal ) {
+    bCancelled |= uiLoaded < uiTotal;
+    return uiLoaded == uiTotal;
+  } );
+  EXPECT_EQ( bLoaded, !bCancelled );
+
+  // A cancelled load leaves the stream reading from the file
+  EXPECT_TRUE( streamIsAt( cStream, 3 ) );
+  cStream.setNextFrame();
+  cStream.readNextFrame();
+  EXPECT_TRUE( streamIsAt( cStream, 4 ) );
+  cStream.seekInput( 1 );
+  EXPECT_TRUE( streamIsAt( cStream, 1 ) );
+  cStream.close();
+}
+
+TEST_F( CalypStreamTest, LoadAllBudget )
+{
+  // The global budget only fits part of the stream, so the frames are
+  // cached instead, with or without a limit of its own
+  unsigned int auiMaxMemoryMB[] = { 0, 64 };
+  for( unsigned int uiMaxMemoryMB : auiMaxMemoryMB )
+  {
+    CalypStream cStream;
+    openStream( cStream, m_strFilename );
+    ClpULong uiBudget = 40 * 1024;
+    CalypMemory::setBudget( CalypMemory::getTotal().uiCurrent + uiBudget );
+    EXPECT_FALSE( cStream.loadAll( uiMaxMemoryMB ) ) << "max memory " << uiMaxMemoryMB;
+    EXPECT_LE( CalypMemory::get( CLP_MEMORY_CACHE ).uiCurrent, uiBudget ) << "max memory " << uiMaxMemoryMB;
+    for( unsigned int i = 0; i < STREAM_TEST_FRAMES; i++ )
+    {
+      if( i > 0 )
+      {
+        cStream.setNextFrame();
+        cStream.readNextFrame();
+      }
+      EXPECT_TRUE( streamIsAt( cStream, i ) ) << "max memory " << uiMaxMemoryMB;
+    }
+    CalypMemory::setBudget( 0 );
+    cStream.close();
+  }
+}
+
+TEST_F( CalypStreamTest, FrameSelection )
+{
+  CalypStream cStream;
+  openStream( cStream, m_strFilename );
+  // Visits the selected frames from the current one until the end
+  auto visitFrames = [&]( const std::vector<ClpULong>& auiExpected ) {
+    EXPECT_EQ( cStream.getNumberOfSelectedFrames(), ClpULong( auiExpected.size() ) );
+    for( unsigned int i = 0; i < auiExpected.size(); i++ )
+    {
+      if( i > 0 )
+      {
+        ASSERT_FALSE( cStream.setNextFrame() ) << "frame " << auiExpected[i];
+        cStream.readNextFrame();
+      }
+      EXPECT_TRUE( streamIsAt( cStream, auiExpected[i] ) );
+    }
+    EXPECT_TRUE( cStream.setNextFrame() );
+    EXPECT_TRUE( streamIsAt( cStream, auiExpected.back() ) );
+  };
+
+  cStream.setFrameSelection( 1, 0, 3 );
+  visitFrames( { 1, 4, 7 } );
+  cStream.setFrameSelection( 2, 7, 2 );
+  visitFrames( { 2, 4, 6 } );
+  // Lists are sorted, without repetitions and frames beyond the end
+  cStream.setFrameSelection( std::vector<ClpULong>{ 6, 0, 3, 3, 12 } );
+  visitFrames( { 0, 3, 6 } );
+
+  // Forward relative seeks follow the selection too
+  cStream.setFrameSelection( 0, 0, 2 );
+  EXPECT_TRUE( streamIsAt( cStream, 0 ) );
+  cStream.seekInputRelative( true );
+  EXPECT_TRUE( streamIsAt( cStream, 2 ) );
+  cStream.seekInputRelative( true );
+  EXPECT_TRUE( streamIsAt( cStream, 4 ) );
+
+  cStream.resetFrameSelection();
+  EXPECT_EQ( cStream.getNumberOfSelectedFrames(), ClpULong( STREAM_TEST_FRAMES ) );
+  cStream.setNextFrame();
+  cStream.readNextFrame();
+  EXPECT_TRUE( streamIsAt( cStream, 1 ) );
+  cStream.close();
+}
+
+TEST_F( CalypStreamTest, MultiStreamReader )
+{
+  // The second stream ends first, with one cached stream (read by the
+  // threads instead of the batched reads)
+  ClpString strShortFile = m_strFilename + ".short.yuv";
+  writeRawFile( strShortFile, 5, 200 );
+  CalypStream cStream, cShortStream, cCachedStream;
+  openStream( cStream, m_strFilename );
+  openStream( cShortStream, strShortFile );
+  openStream( cCachedStream, m_strFilename );
+  cCachedStream.setCacheSize( 1 );
+  cCachedStream.seekInput( 1 );
+  cCachedStream.seekInput( 0 );
+  {
+    CalypMultiStreamReader cReader( { &cStream, &cShortStream, &cCachedStream } );
+    for( unsigned int i = 1; i < 5; i++ )
+    {
+      ASSERT_TRUE( cReader.readNextFrames() ) << "frame " << i;
+      std::vector<CalypFrame*> apcFrames = cReader.getCurrFrames();
+      ASSERT_EQ( apcFrames.size(), 3u );
+      EXPECT_TRUE( framesAreEqual( apcFrames[0], createFrame( i ).get() ) ) << "frame " << i;
+      EXPECT_TRUE( framesAreEqual( apcFrames[1], createFrame( i, 200 ).get() ) ) << "frame " << i;
+      EXPECT_TRUE( framesAreEqual( apcFrames[2], createFrame( i ).get() ) ) << "frame " << i;
+    }
+    // None of the streams moves past the end of the shortest one
+    EXPECT_FALSE( cReader.readNextFrames() );
+    EXPECT_FALSE( cReader.readNextFrames() );
+  }
+  EXPECT_TRUE( streamIsAt( cStream, 4 ) );
+  EXPECT_TRUE( streamIsAt( cShortStream, 4, 200 ) );
+  EXPECT_TRUE( streamIsAt( cCachedStream, 4 ) );
+  cStream.setNextFrame();
+  cStream.readNextFrame();
+  EXPECT_TRUE( streamIsAt( cStream, 5 ) );
+  cStream.close();
+  cShortStream.close();
+  cCachedStream.close();
+  std::remove( strShortFile.c_str() );
+}
+
+/**
+ * Image sequences
+ */
+
+TEST( CalypImageSequenceTest, PatternDetection )
+{
+  CreateStreamHandlerFn pfSequence = CalypStream::findStreamHandler( "frame_%05d.pgm", true );
+  CreateStreamHandlerFn pfImage = CalypStream::findStreamHandler( "frame.pgm", true );
+  ASSERT_TRUE( pfSequence != NULL );
+  EXPECT_NE( pfSequence, pfImage );
+  EXPECT_EQ( CalypStream::findStreamHandler( "dir/img_%03d_x.pgm", false ), pfSequence );
+  // Other uses of '%' are plain filenames
+  EXPECT_EQ( CalypStream::findStreamHandler( "100%_done.pgm", true ), pfImage );
+  EXPECT_EQ( CalypStream::findStreamHandler( "frame_%d.pgm", true ), pfImage );
+  EXPECT_EQ( CalypStream::findStreamHandler( "frame%20d.pgm", true ), pfImage );
+  EXPECT_EQ( CalypStream::findStreamHandler( "frame_%0d.pgm", true ), pfImage );
+}
+
+TEST( CalypImageSequenceTest, FirstIndex )
+{
+  ClpString strPrefix = "CalypPerformanceTests_seq_";
+  // The second first index is beyond any reasonable probing of the indices
+  for( unsigned int uiFirst : { 7, 123456 } )
+  {
+    std::vector<std::unique_ptr<CalypFrame>> apcFrames;
+    std::vector<ClpString> astrFiles;
+    for( unsigned int i = 0; i < TEST_SEQUENCE_FRAMES; i++ )
+    {
+      char acName[64];
+      snprintf( acName, sizeof( acName ), "%s%05u.pgm", strPrefix.c_str(), uiFirst + i );
+      apcFrames.push_back( createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, CLP_GRAY, 8, 110 + i ) );
+      ASSERT_TRUE( CalypStream::saveFrame( acName, apcFrames.back().get() ) );
+      astrFiles.push_back( acName );
+    }
+    // Not written with the padding of the pattern
+    astrFiles.push_back( strPrefix + "3.pgm" );
+    ASSERT_TRUE( CalypStream::saveFrame( astrFiles.back(), apcFrames[0].get() ) );
+
+    try
+    {
+      CalypStream cStream;
+      cStream.open( strPrefix + "%05d.pgm", 0, 0, -1, 0, CLP_LITTLE_ENDIAN, false, 0, true );
+      ASSERT_EQ( cStream.getFrameNum(), ClpULong( TEST_SEQUENCE_FRAMES ) );
+      for( unsigned int i = 0; i < TEST_SEQUENCE_FRAMES; i++ )
+      {
+        if( i > 0 )
+        {
+          cStream.setNextFrame();
+          cStream.readNextFrame();
+        }
+        EXPECT_TRUE( framesAreEqual( cStream.getCurrFrame(), apcFrames[i].get() ) ) << "first " << uiFirst << " frame " << i;
+      }
+      cStream.close();
+    }
+    catch( CalypFailure& e )
+    {
+      ADD_FAILURE() << e.what();
+    }
+    for( const ClpString& strFile : astrFiles )
+      std::remove( strFile.c_str() );
+  }
+}
+
+/**
+ * Native container round trip
+ */
+
+static void writeNativeFile( const ClpString& strFilename, const std::vector<CalypFrame*>& apcFrames )
+{
+  CalypFrame* pcRef = apcFrames[0];
+  CalypStream cStream;
+  ASSERT_TRUE( cStream.open( strFilename, pcRef->getWidth(), pcRef->getHeight(), pcRef->getPelFormat(),
+                             pcRef->getBitsPel(), CLP_LITTLE_ENDIAN, false, 25, false ) );
+  for( unsigned int i = 0; i < apcFrames.size(); i++ )
+    cStream.writeFrame( apcFrames[i] );
+  cStream.close();
+}
+
+static void expectNativeFile( const ClpString& strFilename, const std::vector<CalypFrame*>& apcFrames )
+{
+  CalypStream cStream;
+  cStream.open( strFilename, 0, 0, -1, 0, CLP_LITTLE_ENDIAN, false, 0, true );
+  ASSERT_EQ( cStream.getFrameNum(), ClpULong( apcFrames.size() ) );
+  for( unsigned int i = 0; i < apcFrames.size(); i++ )
+  {
+    if( i > 0 )
+    {
+      cStream.setNextFrame();
+      cStream.readNextFrame();
+    }
+    EXPECT_TRUE( framesAreEqual( cStream.getCurrFrame(), apcFrames[i] ) ) << "frame " << i;
+  }
+  cStream.close();
+}
+
+static long nativeFileSize( const ClpString& strFilename )
+{
+  FILE* pFile = fopen( strFilename.c_str(), "rb" );
+  if( !pFile )
+    return -1;
+  fseek( pFile, 0, SEEK_END );
+  long iSize = ftell( pFile );
+  fclose( pFile );
+  return iSize;
+}
+
+TEST( CalypNativeContainerTest, RoundTrip )
+{
+  ClpString strFilename = "CalypPerformanceTests_native.clp";
+  const unsigned int auiBitsPel[] = { 8, 16 };
+  for( unsigned int uiBitsPel : auiBitsPel )
+  {
+    // Smooth content takes the Rice path and noise the stored one
+    std::unique_ptr<CalypFrame> pcSmooth( new CalypFrame( TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, uiBitsPel ) );
+    ClpPel*** pppcPel = pcSmooth->getPelBufferYUV();
+    for( unsigned int ch = 0; ch < pcSmooth->getNumberChannels(); ch++ )
+      for( unsigned int y = 0; y < pcSmooth->getHeight( ch ); y++ )
+        for( unsigned int x = 0; x < pcSmooth->getWidth( ch ); x++ )
+          pppcPel[ch][y][x] = x + y + ch;
+    std::unique_ptr<CalypFrame> pcNoise = createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, uiBitsPel, 80 );
+    ClpULong uiRawBytes = pcSmooth->getBytesPerFrame();
+
+    try
+    {
+      std::vector<CalypFrame*> apcFrames = { pcSmooth.get(), pcSmooth.get() };
+      writeNativeFile( strFilename, apcFrames );
+      EXPECT_LT( nativeFileSize( strFilename ), long( uiRawBytes ) ) << uiBitsPel << " bits";
+      expectNativeFile( strFilename, apcFrames );
+
+      apcFrames = { pcNoise.get(), pcSmooth.get(), pcNoise.get() };
+      writeNativeFile( strFilename, apcFrames );
+      EXPECT_GE( nativeFileSize( strFilename ), long( uiRawBytes * 2 ) ) << uiBitsPel << " bits";
+      expectNativeFile( strFilename, apcFrames );
+    }
+    catch( CalypFailure& e )
+    {
+      ADD_FAILURE() << e.what();
+    }
+  }
+  std::remove( strFilename.c_str() );
+}
+
+TEST( CalypNativeContainerTest, OutOfRangeSamples )
+{
+  // Samples above the declared bit depth must not be truncated
+  ClpString strFilename = "CalypPerformanceTests_range.clp";
+  std::unique_ptr<CalypFrame> pcFrame = createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, 8, 81 );
+  pcFrame->getPelBufferYUV()[0][3][5] = 300;
+  pcFrame->getPelBufferYUV()[2][1][1] = 1023;
+  try
+  {
+    std::vector<CalypFrame*> apcFrames = { pcFrame.get() };
+    writeNativeFile( strFilename, apcFrames );
+    expectNativeFile( strFilename, apcFrames );
+  }
+  catch( CalypFailure& e )
+  {
+    ADD_FAILURE() << e.what();
+  }
+  std::remove( strFilename.c_str() );
+}
+
+TEST( CalypNativeContainerTest, CorruptFile )
+{
+  ClpString strFilename = "CalypPerformanceTests_corrupt.clp";
+  std::unique_ptr<CalypFrame> pcFrame = createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, 10, 82 );
+  std::vector<CalypFrame*> apcFrames = { pcFrame.get(), pcFrame.get() };
+  writeNativeFile( strFilename, apcFrames );
+  long iFileSize = nativeFileSize( strFilename );
+  ASSERT_GT( iFileSize, 40 );
+
+  auto patchFile = [&]( long iOffset, ClpByte uiValue ) {
+    FILE* pFile = fopen( strFilename.c_str(), "r+b" );
+    ASSERT_TRUE( pFile != NULL );
+    fseek( pFile, iOffset, SEEK_SET );
+    fputc( uiValue, pFile );
+    fclose( pFile );
+  };
+  auto openFails = [&]() {
+    CalypStream cStream;
+    try
+    {
+      return !cStream.open( strFilename, 0, 0, -1, 0, CLP_LITTLE_ENDIAN, false, 0, true );
+    }
+    catch( CalypFailure& e )
+    {
+      return true;
+    }
+  };
+
+  // Unknown pixel format
+  patchFile( 16, 0x7F );
+  EXPECT_TRUE( openFails() );
+  patchFile( 16, ClpByte( CLP_YUV420P ) );
+
+  // Frame count beyond the file size
+  patchFile( 39, 0x7F );
+  EXPECT_TRUE( openFails() );
+  patchFile( 39, 0 );
+
+  // Index entries pointing outside the frames fall back to a scan
+  patchFile( iFileSize - 16 - 2 * 8 + 7, 0x7F );
+  try
+  {
+    expectNativeFile( strFilename, apcFrames );
+  }
+  catch( CalypFailure& e )
+  {
+    ADD_FAILURE() << e.what();
+  }
+  std::remove( strFilename.c_str() );
+}
+
+/**
+ * Plane kernels against scalar references
+ */
+
+TEST( CalypPlaneKernelsTest, Kernels )
+{
+  // Odd sizes and offsets exercise the unaligned heads and the tails
+  const ClpULong uiSize = 1003;
+  const ClpULong uiOffset = 3;
+  std::vector<ClpPel> auiA( uiSize + uiOffset ), auiB( uiSize + uiOffset ), auiDst( uiSize + uiOffset );
+  std::vector<ClpPel> auiLut( 1 << 16 );
+  unsigned int uiState = 7;
+  for( ClpULong i = 0; i < auiA.size(); i++ )
+  {
+    uiState = uiState * 1103515245u + 12345u;
+    auiA[i] = ClpPel( uiState >> 16 );
+    uiState = uiState * 1103515245u + 12345u;
+    auiB[i] = ClpPel( uiState >> 16 );
+  }
+  for( ClpULong i = 0; i < auiLut.size(); i++ )
+    auiLut[i] = ClpPel( i * 7 + 1 );
+  const ClpPel* pA = auiA.data() + uiOffset;
+  const ClpPel* pB = auiB.data() + uiOffset;
+  ClpPel* pDst = auiDst.data() + uiOffset;
+
+  const unsigned int auiBlend[][3] = { { 4, 6, 10 }, { 1, 1, 2 }, { 10, 0, 10 }, { 100, 155, 255 }, { 1, 2, 3 } };
+  for( const unsigned int* puiBlend : auiBlend )
+  {
+    CalypPlaneKernels::blend( pDst, pA, pB, uiSize, puiBlend[0], puiBlend[1], puiBlend[2] );
+    for( ClpULong i = 0; i < uiSize; i++ )
+      ASSERT_EQ( pDst[i], ClpPel( ( ClpULong( pA[i] ) * puiBlend[0] + ClpULong( pB[i] ) * puiBlend[1] ) / puiBlend[2] ) )
+          << "blend " << puiBlend[0] << "/" << puiBlend[1] << "/" << puiBlend[2] << " at " << i;
+  }
+
+  CalypPlaneKernels::absDiff( pDst, pA, pB, uiSize );
+  for( ClpULong i = 0; i < uiSize; i++ )
+    ASSERT_EQ( pDst[i], ClpPel( std::abs( int( pA[i] ) - int( pB[i] ) ) ) ) << i;
+
+  for( ClpPel uiThreshold : { 0, 1, 32768, 65535 } )
+  {
+    CalypPlaneKernels::threshold( pDst, pA, uiSize, uiThreshold, 3, 65000 );
+    for( ClpULong i = 0; i < uiSize; i++ )
+      ASSERT_EQ( pDst[i], pA[i] >= uiThreshold ? 65000 : 3 ) << uiThreshold << " at " << i;
+  }
+
+  for( int iShift : { 0, 2, 8, -2, -6 } )
+  {
+    CalypPlaneKernels::shift( pDst, pA, uiSize, iShift );
+    for( ClpULong i = 0; i < uiSize; i++ )
+      ASSERT_EQ( pDst[i], ClpPel( iShift >= 0 ? pA[i] >> iShift : pA[i] << -iShift ) ) << iShift << " at " << i;
+  }
+
+  CalypPlaneKernels::applyLut( pDst, pA, uiSize, auiLut.data() );
+  for( ClpULong i = 0; i < uiSize; i++ )
+    ASSERT_EQ( pDst[i], auiLut[pA[i]] ) << i;
+
+  for( unsigned int uiLog2Factor : { 0, 1, 2 } )
+  {
+    CalypPlaneKernels::upsample( pDst, pA, uiSize, uiLog2Factor );
+    for( ClpULong i = 0; i < uiSize; i++ )
+      ASSERT_EQ( pDst[i], pA[i >> uiLog2Factor] ) << uiLog2Factor << " at " << i;
+  }
+
+  CalypPlaneKernels::reverse( pDst, pA, uiSize );
+  for( ClpULong i = 0; i < uiSize; i++ )
+    ASSERT_EQ( pDst[i], pA[uiSize - 1 - i] ) << i;
+
+  // Transposition of a 15 x 59 block (rows of the source are 17 samples apart)
+  CalypPlaneKernels::transpose( pDst, 59, pA, 17, 15, 59 );
+  for( unsigned int y = 0; y < 59; y++ )
+    for( unsigned int x = 0; x < 15; x++ )
+      ASSERT_EQ( pDst[x * 59 + y], pA[y * 17 + x] ) << "(" << x << "," << y << ")";
+
+  // In place
+  std::vector<ClpPel> auiInPlace( auiA );
+  CalypPlaneKernels::absDiff( auiInPlace.data() + uiOffset, auiInPlace.data() + uiOffset, pB, uiSize );
+  CalypPlaneKernels::absDiff( pDst, pA, pB, uiSize );
+  EXPECT_TRUE( std::equal( pDst, pDst + uiSize, auiInPlace.data() + uiOffset ) );
+}
+
+TEST( CalypPlaneKernelsTest, FrameBlend )
+{
+  // Sources with different chroma sampling (and a gray one) into 4:4:4
+  const int aaiFormats[][2] = { { CLP_YUV420P, CLP_YUV444P }, { CLP_YUV422P, CLP_YUV420P }, { CLP_GRAY, CLP_YUV420P } };
+  for( const int* piFormats : aaiFormats )
+  {
+    std::unique_ptr<CalypFrame> pcA = createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, piFormats[0], 10, 30 );
+    std::unique_ptr<CalypFrame> pcB = createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, piFormats[1], 10, 31 );
+    CalypFrame cDst( TEST_WIDTH, TEST_HEIGHT, CLP_YUV444P, 10 );
+    CalypPlaneKernels::blend( &cDst, pcA.get(), pcB.get(), 3, 7, 10 );
+    for( unsigned int y = 0; y < TEST_HEIGHT; y++ )
+      for( unsigned int x = 0; x < TEST_WIDTH; x++ )
+      {
+        CalypPixel cA = pcA->getPixel( x, y );
+        CalypPixel cB = pcB->getPixel( x, y );
+        CalypPixel cDstPixel = cDst.getPixel( x, y );
+        for( unsigned int ch = 0; ch < cDst.getNumberChannels(); ch++ )
+          ASSERT_EQ( cDstPixel[ch], ClpPel( ( cA[ch] * 3 + cB[ch] * 7 ) / 10 ) )
+              << "formats " << piFormats[0] << "/" << piFormats[1] << " (" << x << "," << y << ")";
+      }
+  }
+}
+
+TEST( CalypPlaneKernelsTest, RotateInverse )
+{
+  // Formats whose chroma sampling does not change with the direction
+  const int aiFormats[] = { CLP_YUV420P, CLP_YUV444P, CLP_GRAY, CLP_RGB24 };
+  for( int iPelFmt : aiFormats )
+  {
+    std::unique_ptr<CalypFrame> pcInput = createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, iPelFmt, 10, 32 );
+    for( int iAngle : { 0, 90, 180, 270 } )
+    {
+      bool bSwap = iAngle == 90 || iAngle == 270;
+      CalypFrame cRotated( bSwap ? TEST_HEIGHT : TEST_WIDTH, bSwap ? TEST_WIDTH : TEST_HEIGHT, iPelFmt, 10 );
+      CalypFrame cRestored( TEST_WIDTH, TEST_HEIGHT, iPelFmt, 10 );
+      ASSERT_TRUE( CalypPlaneKernels::rotate( &cRotated, pcInput.get(), iAngle ) );
+      ASSERT_TRUE( CalypPlaneKernels::rotate( &cRestored, &cRotated, ( 360 - iAngle ) % 360 ) );
+      EXPECT_TRUE( framesAreEqual( &cRestored, pcInput.get() ) ) << "format " << iPelFmt << " angle " << iAngle;
+    }
+  }
+}
+
+/**
+ * Resampler
+ */
+
+TEST( CalypResamplerTest, Identity )
+{
+  for( int iPelFmt : { CLP_YUV420P, CLP_YUV422P, CLP_YUV444P } )
+  {
+    std::unique_ptr<CalypFrame> pcInput = createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, iPelFmt, 10, 70 );
+    for( int iFilter = CLP_RESAMPLER_NEAREST; iFilter <= CLP_RESAMPLER_LANCZOS; iFilter++ )
+    {
+      for( int iSiting : { CLP_CHROMA_SITING_LEFT, CLP_CHROMA_SITING_CENTER } )
+      {
+        CalypResampler cResampler( iFilter, iSiting, 3 );
+        CalypFrame cOutput( TEST_WIDTH, TEST_HEIGHT, iPelFmt, 10 );
+        ASSERT_TRUE( cResampler.resample( &cOutput, pcInput.get() ) );
+        EXPECT_TRUE( framesAreEqual( &cOutput, pcInput.get() ) ) << "format " << iPelFmt << " filter " << iFilter;
+      }
+    }
+  }
+}
+
+TEST( CalypResamplerTest, Constant )
+{
+  // The filters are normalized: flat areas stay flat (also at the
+  // largest sample value)
+  const unsigned int auiSizes[][2] = { { 37, 100 }, { 150, 20 }, { 7, 3 } };
+  for( unsigned int uiBitsPel : { 8, 16 } )
+  {
+    ClpPel uiValue = ClpPel( ( 1 << uiBitsPel ) - 1 );
+    CalypFrame cInput( TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, uiBitsPel );
+    ClpPel* pInput = cInput.getPelBufferYUV()[0][0];
+    std::fill( pInput, pInput + cInput.getTotalNumberOfPixels(), uiValue );
+    for( int iFilter = CLP_RESAMPLER_NEAREST; iFilter <= CLP_RESAMPLER_LANCZOS; iFilter++ )
+    {
+      CalypResampler cResampler( iFilter );
+      for( const unsigned int* puiSize : auiSizes )
+      {
+        CalypFrame cOutput( puiSize[0], puiSize[1], CLP_YUV420P, uiBitsPel );
+        ASSERT_TRUE( cResampler.resample( &cOutput, &cInput ) );
+        const ClpPel* pOutput = cOutput.getPelBufferYUV()[0][0];
+        for( ClpULong i = 0; i < cOutput.getTotalNumberOfPixels(); i++ )
+          ASSERT_EQ( pOutput[i], uiValue ) << "filter " << iFilter << " size " << puiSize[0] << "x" << puiSize[1];
+      }
+    }
+  }
+}
+
+TEST( CalypResamplerTest, NearestUpscale )
+{
+  // Doubling with the nearest filter repeats each sample (chroma sited
+  // left horizontally and centred vertically)
+  std::unique_ptr<CalypFrame> pcInput = createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, 10, 71 );
+  CalypFrame cOutput( 2 * TEST_WIDTH, 2 * TEST_HEIGHT, CLP_YUV420P, 10 );
+  CalypResampler cResampler( CLP_RESAMPLER_NEAREST, CLP_CHROMA_SITING_LEFT );
+  ASSERT_TRUE( cResampler.resample( &cOutput, pcInput.get() ) );
+  for( unsigned int ch = 0; ch < cOutput.getNumberChannels(); ch++ )
+    for( unsigned int y = 0; y < cOutput.getHeight( ch ); y++ )
+      for( unsigned int x = 0; x < cOutput.getWidth( ch ); x++ )
+        ASSERT_EQ( cOutput.getPelBufferYUV()[ch][y][x], pcInput->getPelBufferYUV()[ch][y / 2][x / 2] )
+            << "channel " << ch << " (" << x << "," << y << ")";
+}
+
+TEST( CalypResamplerTest, Threads )
+{
+  std::unique_ptr<CalypFrame> pcInput = createSyntheticFrame( 300, 200, CLP_YUV420P, 10, 72 );
+  CalypFrame cSingle( 173, 411, CLP_YUV420P, 10 );
+  CalypFrame cThreaded( 173, 411, CLP_YUV420P, 10 );
+  CalypResampler cResampler( CLP_RESAMPLER_LANCZOS );
+  ASSERT_TRUE( cResampler.resample( &cSingle, pcInput.get() ) );
+  cResampler.setNumberOfThreads( 4 );
+  ASSERT_TRUE( cResampler.resample( &cThreaded, pcInput.get() ) );
+  EXPECT_TRUE( framesAreEqual( &cThreaded, &cSingle ) );
+
+  CalypFrame cOtherFormat( 173, 411, CLP_YUV444P, 10 );
+  EXPECT_FALSE( cResampler.resample( &cOtherFormat, pcInput.get() ) );
+}
+
+TEST( CalypRemapTest, Tables )
+{
+  std::unique_ptr<CalypFrame> pcInput = createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, 10, 74 );
+  CalypFrame cOutput( TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, 10 );
+  CalypRemap cRemap;
+
+  auto fnIdentity = []( double dX, double dY, double& rdSrcX, double& rdSrcY ) {
+    rdSrcX = dX;
+    rdSrcY = dY;
+  };
+  for( int iInterpolation : { CLP_REMAP_NEAREST, CLP_REMAP_BILINEAR } )
+  {
+    ASSERT_TRUE( cRemap.create( TEST_WIDTH, TEST_HEIGHT, TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, fnIdentity, iInterpolation ) );
+    ASSERT_TRUE( cRemap.remap( &cOutput, pcInput.get() ) );
+    EXPECT_TRUE( framesAreEqual( &cOutput, pcInput.get() ) ) << "interpolation " << iInterpolation;
+  }
+
+  // Half a sample to the right: average of two neighbours (the last
+  // column is clamped to the border)
+  auto fnShift = []( double dX, double dY, double& rdSrcX, double& rdSrcY ) {
+    rdSrcX = dX + 0.5;
+    rdSrcY = dY;
+  };
+  ASSERT_TRUE( cRemap.create( TEST_WIDTH, TEST_HEIGHT, TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, fnShift ) );
+  ASSERT_TRUE( cRemap.remap( &cOutput, pcInput.get() ) );
+  ClpPel** ppInput = pcInput->getPelBufferYUV()[CLP_LUMA];
+  for( unsigned int y = 0; y < TEST_HEIGHT; y++ )
+    for( unsigned int x = 0; x < TEST_WIDTH; x++ )
+    {
+      unsigned int uiRight = std::min( x + 1, TEST_WIDTH - 1u );
+      ASSERT_EQ( cOutput.getPelBufferYUV()[CLP_LUMA][y][x], ( ppInput[y][x] + ppInput[y][uiRight] + 1 ) >> 1 )
+          << "(" << x << "," << y << ")";
+    }
+
+  // Wrapping around, the last column is interpolated with the first one
+  cRemap.setHorizontalWrap( true );
+  ASSERT_TRUE( cRemap.create( TEST_WIDTH, TEST_HEIGHT, TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, fnShift ) );
+  ASSERT_TRUE( cRemap.remap( &cOutput, pcInput.get() ) );
+  for( unsigned int y = 0; y < TEST_HEIGHT; y++ )
+    ASSERT_EQ( cOutput.getPelBufferYUV()[CLP_LUMA][y][TEST_WIDTH - 1],
+               ( ppInput[y][TEST_WIDTH - 1] + ppInput[y][0] + 1 ) >> 1 )
+        << "row " << y;
+  cRemap.setHorizontalWrap( false );
+
+  // Two regions side by side: the last column of the left one is not
+  // interpolated with the right one (in every plane)
+  auto fnQuarterShift = []( double dX, double dY, double& rdSrcX, double& rdSrcY ) {
+    rdSrcX = dX + 0.25;
+    rdSrcY = dY;
+  };
+  cRemap.setRegionSize( TEST_WIDTH / 2, TEST_HEIGHT );
+  ASSERT_TRUE( cRemap.create( TEST_WIDTH, TEST_HEIGHT, TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, fnQuarterShift ) );
+  ASSERT_TRUE( cRemap.remap( &cOutput, pcInput.get() ) );
+  for( unsigned int ch = 0; ch < cOutput.getNumberChannels(); ch++ )
+  {
+    unsigned int uiLast = cOutput.getWidth( ch ) / 2 - 1;
+    for( unsigned int y = 0; y < cOutput.getHeight( ch ); y++ )
+      ASSERT_EQ( cOutput.getPelBufferYUV()[ch][y][uiLast], pcInput->getPelBufferYUV()[ch][y][uiLast] )
+          << "channel " << ch << " row " << y;
+  }
+
+  CalypFrame cOtherSize( TEST_WIDTH, TEST_WIDTH, CLP_YUV420P, 10 );
+  EXPECT_FALSE( cRemap.remap( &cOtherSize, pcInput.get() ) );
+}
+
+/**
+ * Built-in modules against scalar references
+ */
+
+class CalypModuleTest : public ::testing::Test
+{
+protected:
+  CalypModuleIf* m_pcModule;
+  std::unique_ptr<CalypFrame> m_pcOutput;  //!< Output of API 4 modules
+
+  CalypModuleTest()
+      : m_pcModule( NULL )
+  {
+  }
+  void TearDown()
+  {
+    releaseModule();
+  }
+  CalypModuleIf* createModule( const char* pchName, const std::vector<ClpString>& astrOptions = std::vector<ClpString>() )
+  {
+    releaseModule();
+    m_pcModule = CalypModulesFactory::Get()->CreateModule( pchName );
+    if( m_pcModule )
+      m_pcModule->m_cModuleOptions.parse( astrOptions );
+    return m_pcModule;
+  }
+  CalypFrame* processModule( std::vector<CalypFrame*> apcFrameList )
+  {
+    if( m_pcModule->m_iModuleAPI != CLP_MODULE_API_4 )
+      return m_pcModule->process( apcFrameList );
+    if( !m_pcOutput || !m_pcModule->isOutputFormat( m_pcOutput.get() ) )
+      m_pcOutput.reset( m_pcModule->newOutputFrame() );
+    if( !m_pcOutput || !m_pcModule->process( apcFrameList, m_pcOutput.get() ) )
+      return NULL;
+    return m_pcOutput.get();
+  }
+  void releaseModule()
+  {
+    if( m_pcModule )
+    {
+      m_pcModule->destroy();
+      m_pcModule->Delete();
+    }
+    m_pcModule = NULL;
+  }
+};
+
+TEST_F( CalypModuleTest, FrameMask )
+{
+  const int aiFormats[] = { CLP_YUV420P, CLP_YUV444P, CLP_RGB24 };
+  const int iWeight = 6;
+  for( int iPelFmt : aiFormats )
+  {
+    for( unsigned int uiBitsPel : { 8, 10 } )
+    {
+      std::unique_ptr<CalypFrame> pcImage = createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, iPelFmt, uiBitsPel, 20 );
+      std::unique_ptr<CalypFrame> pcMask = createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, iPelFmt, uiBitsPel, 21 );
+      std::vector<CalypFrame*> apcInput = { pcImage.get(), pcMask.get() };
+
+      ASSERT_TRUE( createModule( "FrameMask", { "--MaskWeigth=" + std::to_string( iWeight ) } ) != NULL );
+      ASSERT_TRUE( m_pcModule->create( apcInput ) );
+      CalypFrame* pcOut = processModule( apcInput );
+      ASSERT_TRUE( pcOut != NULL );
+      for( unsigned int y = 0; y < TEST_HEIGHT; y++ )
+        for( unsigned int x = 0; x < TEST_WIDTH; x++ )
+        {
+          CalypPixel cImage = pcImage->getPixel( x, y );
+          CalypPixel cMask = pcMask->getPixel( x, y );
+          CalypPixel cOut = pcOut->getPixel( x, y );
+          for( unsigned int ch = 0; ch < pcOut->getNumberChannels(); ch++ )
+          {
+            ClpPel uiSum = ClpPel( cImage[ch] * ( 10 - iWeight ) ) + ClpPel( cMask[ch] * iWeight );
+            ASSERT_EQ( cOut[ch], ClpPel( uiSum * 0.1 ) ) << "format " << iPelFmt << " (" << x << "," << y << ")";
+          }
+        }
+    }
+  }
+}
+
+TEST_F( CalypModuleTest, FrameRotate )
+{
+  const int aiFormats[] = { CLP_YUV420P, CLP_YUV422P, CLP_YUV444P, CLP_YUYV422, CLP_GRAY, CLP_RGB24 };
+  // The second size is not a multiple of the 8 x 8 tiles nor of the blocks
+  const unsigned int auiSizes[][2] = { { TEST_WIDTH, TEST_HEIGHT }, { 150, 38 } };
+  for( const unsigned int* puiSize : auiSizes )
+  {
+    unsigned int uiWidth = puiSize[0];
+    unsigned int uiHeight = puiSize[1];
+    for( int iPelFmt : aiFormats )
+    {
+      std::unique_ptr<CalypFrame> pcInput = createSyntheticFrame( uiWidth, uiHeight, iPelFmt, 10, 22 );
+      std::vector<CalypFrame*> apcInput = { pcInput.get() };
+      for( int iAngle : { 0, 90, 180, 270 } )
+      {
+        ASSERT_TRUE( createModule( "FrameRotate", { "--Angle=" + std::to_string( iAngle ) } ) != NULL );
+        ASSERT_TRUE( m_pcModule->create( apcInput ) );
+        CalypFrame* pcOut = processModule( apcInput );
+        ASSERT_TRUE( pcOut != NULL );
+        for( unsigned int ch = 0; ch < pcOut->getNumberChannels(); ch++ )
+        {
+          unsigned int uiLog2W = ch > 0 ? pcOut->getChromaWidthRatio() : 0;
+          unsigned int uiLog2H = ch > 0 ? pcOut->getChromaHeightRatio() : 0;
+          for( unsigned int y = 0; y < pcOut->getHeight( ch ); y++ )
+            for( unsigned int x = 0; x < pcOut->getWidth( ch ); x++ )
+            {
+              // Average of the input samples co-located with the luma
+              // samples covered by this one (a single sample unless the
+              // chroma subsampling changes direction)
+              unsigned int uiSum = 0;
+              unsigned int uiCount = 0;
+              for( unsigned int ly = y << uiLog2H; ly < ( y + 1 ) << uiLog2H; ly++ )
+                for( unsigned int lx = x << uiLog2W; lx < ( x + 1 ) << uiLog2W; lx++ )
+                {
+                  unsigned int uiInX = iAngle == 0 ? lx : iAngle == 90 ? ly : iAngle == 180 ? uiWidth - lx - 1 : uiWidth - ly - 1;
+                  unsigned int uiInY = iAngle == 0 ? ly : iAngle == 90 ? uiHeight - lx - 1 : iAngle == 180 ? uiHeight - ly - 1 : lx;
+                  uiSum += pcInput->getPelBufferYUV()[ch][uiInY >> uiLog2H][uiInX >> uiLog2W];
+                  uiCount++;
+                }
+              ASSERT_EQ( pcOut->getPelBufferYUV()[ch][y][x], ( uiSum + uiCount / 2 ) / uiCount )
+                  << "format " << iPelFmt << " angle " << iAngle << " channel " << ch << " (" << x << "," << y << ")";
+            }
+        }
+      }
+    }
+  }
+}
+
+TEST_F( CalypModuleTest, FrameResampling )
+{
+  std::unique_ptr<CalypFrame> pcInput = createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, 10, 73 );
+  std::vector<CalypFrame*> apcInput = { pcInput.get() };
+  const int aiFilters[] = { CLP_RESAMPLER_NEAREST, CLP_RESAMPLER_BILINEAR, CLP_RESAMPLER_BICUBIC, CLP_RESAMPLER_LANCZOS };
+  for( int iInterpolation = 1; iInterpolation <= 4; iInterpolation++ )
+  {
+    ASSERT_TRUE( createModule( "FrameResampling", { "--width=100", "--Interpolation=" + std::to_string( iInterpolation ),
+                                                    "--siting=1", "--resample_threads=2" } ) != NULL );
+    ASSERT_TRUE( m_pcModule->create( apcInput ) );
+    CalypFrame* pcOut = processModule( apcInput );
+    ASSERT_TRUE( pcOut != NULL );
+    ASSERT_EQ( pcOut->getWidth(), 100u );
+    ASSERT_EQ( pcOut->getHeight(), 75u );
+
+    CalypFrame cReference( 100, 75, CLP_YUV420P, 10 );
+    CalypResampler cResampler( aiFilters[iInterpolation - 1], CLP_CHROMA_SITING_CENTER );
+    ASSERT_TRUE( cResampler.resample( &cReference, pcInput.get() ) );
+    EXPECT_TRUE( framesAreEqual( pcOut, &cReference ) ) << "interpolation " << iInterpolation;
+  }
+}
+
+TEST_F( CalypModuleTest, ThreeSixtyProjectionConversion )
+{
+  // Smooth content on the sphere (x to the right, y up, z to the front)
+  auto fnSphere = []( double dX, double dY, double dZ ) {
+    double dNorm = std::sqrt( dX * dX + dY * dY + dZ * dZ );
+    return 512 + ( 200 * dX + 150 * dY + 100 * dZ ) / dNorm;
+  };
+  const double dPi = 3.14159265358979323846;
+  const unsigned int uiWidth = 256;
+  const unsigned int uiHeight = 128;
+  CalypFrame cErp( uiWidth, uiHeight, CLP_GRAY, 10 );
+  for( unsigned int y = 0; y < uiHeight; y++ )
+    for( unsigned int x = 0; x < uiWidth; x++ )
+    {
+      double dLongitude = ( ( x + 0.5 ) / uiWidth - 0.5 ) * 2 * dPi;
+      double dLatitude = ( 0.5 - ( y + 0.5 ) / uiHeight ) * dPi;
+      cErp.getPelBufferYUV()[0][y][x] = ClpPel( fnSphere( std::cos( dLatitude ) * std::sin( dLongitude ), std::sin( dLatitude ),
+                                                          std::cos( dLatitude ) * std::cos( dLongitude ) ) +
+                                                0.5 );
+    }
+
+  // Centre of each face (left, front, right / bottom, back, top)
+  std::vector<CalypFrame*> apcInput = { &cErp };
+  ASSERT_TRUE( createModule( "ThreeSixtyProjectionConversion" ) != NULL );
+  ASSERT_TRUE( m_pcModule->create( apcInput ) );
+  CalypFrame* pcCmp = processModule( apcInput );
+  ASSERT_TRUE( pcCmp != NULL );
+  ASSERT_EQ( pcCmp->getWidth(), 3 * 64u );
+  ASSERT_EQ( pcCmp->getHeight(), 2 * 64u );
+  const double adCentres[6][3] = { { -1, 0, 0 }, { 0, 0, 1 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 0, -1 }, { 0, 1, 0 } };
+  for( unsigned int f = 0; f < 6; f++ )
+  {
+    // Average of the four samples around the centre
+    unsigned int uiX = ( f % 3 ) * 64 + 31;
+    unsigned int uiY = ( f / 3 ) * 64 + 31;
+    ClpPel** ppCmp = pcCmp->getPelBufferYUV()[0];
+    double dCentre = ( ppCmp[uiY][uiX] + ppCmp[uiY][uiX + 1] + ppCmp[uiY + 1][uiX] + ppCmp[uiY + 1][uiX + 1] ) / 4.0;
+    EXPECT_NEAR( dCentre, fnSphere( adCentres[f][0], adCentres[f][1], adCentres[f][2] ), 2 ) << "face " << f;
+  }
+
+  // And back to equirectangular
+  CalypFrame cCmp( pcCmp );
+  apcInput = { &cCmp };
+  ASSERT_TRUE( createModule( "ThreeSixtyProjectionConversion", { "--input=1", "--output=0" } ) != NULL );
+  ASSERT_TRUE( m_pcModule->create( apcInput ) );
+  CalypFrame* pcErp = processModule( apcInput );
+  ASSERT_TRUE( pcErp != NULL );
+  ASSERT_EQ( pcErp->getWidth(), uiWidth );
+  ASSERT_EQ( pcErp->getHeight(), uiHeight );
+  for( unsigned int y = 0; y < uiHeight; y++ )
+    for( unsigned int x = 0; x < uiWidth; x++ )
+      ASSERT_NEAR( pcErp->getPelBufferYUV()[0][y][x], cErp.getPelBufferYUV()[0][y][x], 4 ) << "(" << x << "," << y << ")";
+
+  // Faces of a 4:2:0 cubemap with a different value in each face and
+  // channel: no sample of the conversion mixes two faces
+  const unsigned int uiFace = 32;
+  CalypFrame cFaces( 3 * uiFace, 2 * uiFace, CLP_YUV420P, 8 );
+  for( unsigned int ch = 0; ch < cFaces.getNumberChannels(); ch++ )
+    for( unsigned int y = 0; y < cFaces.getHeight( ch ); y++ )
+      for( unsigned int x = 0; x < cFaces.getWidth( ch ); x++ )
+      {
+        unsigned int uiFaceIdx = ( y << cFaces.getChromaHeightRatio() * ( ch > 0 ) ) / uiFace * 3 +
+                                 ( x << cFaces.getChromaWidthRatio() * ( ch > 0 ) ) / uiFace;
+        cFaces.getPelBufferYUV()[ch][y][x] = ClpPel( 20 + 40 * uiFaceIdx + ch );
+      }
+  apcInput = { &cFaces };
+  ASSERT_TRUE( createModule( "ThreeSixtyProjectionConversion", { "--input=1", "--output=0" } ) != NULL );
+  ASSERT_TRUE( m_pcModule->create( apcInput ) );
+  pcErp = processModule( apcInput );
+  ASSERT_TRUE( pcErp != NULL );
+  for( unsigned int ch = 0; ch < pcErp->getNumberChannels(); ch++ )
+    for( unsigned int y = 0; y < pcErp->getHeight( ch ); y++ )
+      for( unsigned int x = 0; x < pcErp->getWidth( ch ); x++ )
+      {
+        int iValue = pcErp->getPelBufferYUV()[ch][y][x] - int( ch );
+        ASSERT_TRUE( iValue >= 20 && iValue % 40 == 20 && iValue <= 220 )
+            << "channel " << ch << " (" << x << "," << y << "): " << iValue + ch;
+      }
+}
+
+TEST_F( CalypModuleTest, ThreeSixtyFaceRoundTrip )
+{
+  // Extracting the six cubemap faces and concatenating them gives back the input
+  std::unique_ptr<CalypFrame> pcInput = createSyntheticFrame( 3 * 16, 2 * 16, CLP_YUV420P, 10, 90 );
+  std::vector<CalypFrame*> apcInput = { pcInput.get() };
+  for( int iAngle : { 0, 90, 180, 270 } )
+  {
+    ClpString strRotation = "--rotation=" + std::to_string( iAngle );
+    std::vector<std::unique_ptr<CalypFrame>> apcFaces;
+    for( unsigned int uiFace = 0; uiFace < 6; uiFace++ )
+    {
+      ASSERT_TRUE( createModule( "ThreeSixtyFaceExtraction", { "--faceNum=" + std::to_string( uiFace ), strRotation } ) != NULL );
+      ASSERT_TRUE( m_pcModule->create( apcInput ) );
+      CalypFrame* pcFace = processModule( apcInput );
+      ASSERT_TRUE( pcFace != NULL );
+      apcFaces.push_back( std::unique_ptr<CalypFrame>( new CalypFrame( *pcFace ) ) );
+    }
+    std::vector<CalypFrame*> apcFaceList;
+    for( unsigned int uiFace = 0; uiFace < 6; uiFace++ )
+      apcFaceList.push_back( apcFaces[uiFace].get() );
+    ASSERT_TRUE( createModule( "ThreeSixtyFaceConcatenation", { strRotation } ) != NULL );
+    m_pcModule->m_uiNumberOfFrames = 6;
+    ASSERT_TRUE( m_pcModule->create( apcFaceList ) );
+    CalypFrame* pcOut = processModule( apcFaceList );
+    ASSERT_TRUE( pcOut != NULL );
+    EXPECT_TRUE( framesAreEqual( pcOut, pcInput.get() ) ) << "angle " << iAngle;
+  }
+}
+
+TEST_F( CalypModuleTest, AbsoluteFrameDifference )
+{
+  for( unsigned int uiBitsPel : { 8, 10 } )
+  {
+    std::unique_ptr<CalypFrame> pcFrame1 = createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, uiBitsPel, 23 );
+    std::unique_ptr<CalypFrame> pcFrame2 = createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, uiBitsPel, 24 );
+    std::vector<CalypFrame*> apcInput = { pcFrame1.get(), pcFrame2.get() };
+    ASSERT_TRUE( createModule( "AbsoluteFrameDifference" ) != NULL );
+    ASSERT_TRUE( m_pcModule->create( apcInput ) );
+    CalypFrame* pcOut = processModule( apcInput );
+    ASSERT_TRUE( pcOut != NULL );
+    EXPECT_EQ( pcOut->getPelFormat(), CLP_GRAY );
+    for( unsigned int y = 0; y < TEST_HEIGHT; y++ )
+      for( unsigned int x = 0; x < TEST_WIDTH; x++ )
+        ASSERT_EQ( pcOut->getPelBufferYUV()[0][y][x], abs( int( pcFrame1->getPelBufferYUV()[0][y][x] ) -
+                                                           int( pcFrame2->getPelBufferYUV()[0][y][x] ) ) );
+  }
+}
+
+TEST_F( CalypModuleTest, FrameBinarization )
+{
+  const unsigned int uiThreshold = 100;
+  std::unique_ptr<CalypFrame> pcInput = createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, 8, 25 );
+  std::vector<CalypFrame*> apcInput = { pcInput.get() };
+  ASSERT_TRUE( createModule( "FrameBinarization", { "--threshold=" + std::to_string( uiThreshold ) } ) != NULL );
+  ASSERT_TRUE( m_pcModule->create( apcInput ) );
+  CalypFrame* pcOut = processModule( apcInput );
+  ASSERT_TRUE( pcOut != NULL );
+  for( unsigned int y = 0; y < TEST_HEIGHT; y++ )
+    for( unsigned int x = 0; x < TEST_WIDTH; x++ )
+      ASSERT_EQ( pcOut->getPelBufferYUV()[0][y][x], pcInput->getPelBufferYUV()[0][y][x] >= uiThreshold ? 255 : 0 );
+}
+
+TEST_F( CalypModuleTest, EightBitsSampling )
+{
+  const int aiFormats[] = { CLP_YUV420P, CLP_YUV422P, CLP_GRAY, CLP_RGB24 };
+  for( int iPelFmt : aiFormats )
+  {
+    for( unsigned int uiBitsPel : { 10, 12, 16 } )
+    {
+      std::unique_ptr<CalypFrame> pcInput = createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, iPelFmt, uiBitsPel, 26 );
+      std::vector<CalypFrame*> apcInput = { pcInput.get() };
+      ASSERT_TRUE( createModule( "EightBitsSampling", { "--num_bits=8" } ) != NULL );
+      ASSERT_TRUE( m_pcModule->create( apcInput ) );
+      CalypFrame* pcOut = processModule( apcInput );
+      ASSERT_TRUE( pcOut != NULL );
+      ASSERT_EQ( pcOut->getBitsPel(), 8u );
+      for( unsigned int ch = 0; ch < pcInput->getNumberChannels(); ch++ )
+        for( unsigned int y = 0; y < pcInput->getHeight( ch ); y++ )
+          for( unsigned int x = 0; x < pcInput->getWidth( ch ); x++ )
+            ASSERT_EQ( pcOut->getPelBufferYUV()[ch][y][x], pcInput->getPelBufferYUV()[ch][y][x] >> ( uiBitsPel - 8 ) );
+    }
+  }
+}
+
+TEST_F( CalypModuleTest, InterFrameVariance )
+{
+  const unsigned int uiWindow = 3;
+  const unsigned int uiNumberOfFrames = 7;
+  std::vector<std::unique_ptr<CalypFrame>> apcFrames;
+  for( unsigned int i = 0; i < uiNumberOfFrames; i++ )
+    apcFrames.push_back( createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, CLP_YUV420P, 10, 50 + i ) );
+
+  // Reference: variance across the frames of each window
+  std::vector<std::unique_ptr<CalypFrame>> apcExpected;
+  for( unsigned int i = 0; i < uiNumberOfFrames; i++ )
+  {
+    std::vector<CalypFrame*> apcWindow;
+    for( unsigned int j = i + 1 > uiWindow ? i + 1 - uiWindow : 0; j <= i; j++ )
+      apcWindow.push_back( apcFrames[j].get() );
+    ASSERT_TRUE( createModule( "InterFrameVariance" ) != NULL );
+    m_pcModule->m_uiNumberOfFrames = apcWindow.size();
+    ASSERT_TRUE( m_pcModule->create( apcWindow ) );
+    CalypFrame* pcOut = processModule( apcWindow );
+    ASSERT_TRUE( pcOut != NULL );
+    apcExpected.push_back( std::unique_ptr<CalypFrame>( new CalypFrame( pcOut ) ) );
+    apcExpected.back()->copyFrom( pcOut );
+  }
+
+  // Sliding window over a single input
+  ASSERT_TRUE( createModule( "InterFrameVariance", { "--window=" + std::to_string( uiWindow ) } ) != NULL );
+  m_pcModule->m_uiNumberOfFrames = 1;
+  std::vector<CalypFrame*> apcInput = { apcFrames[0].get() };
+  ASSERT_TRUE( m_pcModule->create( apcInput ) );
+  for( unsigned int i = 0; i < uiNumberOfFrames; i++ )
+  {
+    apcInput[0] = apcFrames[i].get();
+    CalypFrame* pcOut = processModule( apcInput );
+    ASSERT_TRUE( pcOut != NULL );
+    EXPECT_TRUE( framesAreEqual( pcOut, apcExpected[i].get() ) ) << "frame " << i;
+  }
+}
+
+TEST_F( CalypModuleTest, ApiVersion4 )
+{
+  const unsigned int uiNumberOfSets = 3;
+  std::vector<std::unique_ptr<CalypFrame>> apcFrames;
+  std::vector<std::vector<CalypFrame*>> aapcFrameSets( uiNumberOfSets );
+  for( unsigned int i = 0; i < uiNumberOfSets; i++ )
+  {
+    for( unsigned int f = 0; f < 2; f++ )
+    {
+      apcFrames.push_back( createSyntheticFrame( TEST_WIDTH, TEST_HEIGHT, CLP_YUV444P, 8, 60 + 2 * i + f ) );
+      aapcFrameSets[i].push_back( apcFrames.back().get() );
+    }
+  }
+  ASSERT_TRUE( createModule( "FrameMask" ) != NULL );
+  ASSERT_EQ( m_pcModule->m_iModuleAPI, CLP_MODULE_API_4 );
+  ASSERT_TRUE( m_pcModule->create( aapcFrameSets[0] ) );
+
+  // One call for each set
+  std::vector<std::unique_ptr<CalypFrame>> apcExpected;
+  for( unsigned int i = 0; i < uiNumberOfSets; i++ )
+  {
+    apcExpected.push_back( std::unique_ptr<CalypFrame>( m_pcModule->newOutputFrame() ) );
+    ASSERT_TRUE( m_pcModule->process( aapcFrameSets[i], apcExpected.back().get() ) );
+  }
+
+  // Whole batch in one call
+  std::vector<std::unique_ptr<CalypFrame>> apcBatch;
+  std::vector<CalypFrame*> apcBatchOutput;
+  for( unsigned int i = 0; i < uiNumberOfSets; i++ )
+  {
+    apcBatch.push_back( std::unique_ptr<CalypFrame>( m_pcModule->newOutputFrame() ) );
+    apcBatchOutput.push_back( apcBatch.back().get() );
+  }
+  ASSERT_TRUE( m_pcModule->processBatch( aapcFrameSets, apcBatchOutput ) );
+  for( unsigned int i = 0; i < uiNumberOfSets; i++ )
+    EXPECT_TRUE( framesAreEqual( apcBatchOutput[i], apcExpected[i].get() ) ) << "set " << i;
+
+  // Hosts of the previous APIs get a frame owned by the module
+  CalypFrame* pcLegacy = m_pcModule->process( aapcFrameSets[0] );
+  ASSERT_TRUE( pcLegacy != NULL );
+  EXPECT_TRUE( framesAreEqual( pcLegacy, apcExpected[0].get() ) );
+
+  // In place (same format as the first input)
+  ASSERT_TRUE( m_pcModule->canProcessInPlace( aapcFrameSets[1] ) );
+  ASSERT_TRUE( m_pcModule->process( aapcFrameSets[1], aapcFrameSets[1][0] ) );
+  EXPECT_TRUE( framesAreEqual( aapcFrameSets[1][0], apcExpected[1].get() ) );
+}
+
+/**
+ * Throughput regression checks
+ */
+
+class CalypThroughputTest : public CalypModuleTest
+{
+};
+
+TEST_F( CalypThroughputTest, FrameKernels )
+{
+  for( unsigned int uiBitsPel : { 8, 10 } )
+  {
+    std::unique_ptr<CalypFrame> pcFrame = createSyntheticFrame( PERF_WIDTH, PERF_HEIGHT, CLP_YUV420P, uiBitsPel, 30 );
+    std::unique_ptr<CalypFrame> pcRef = createSyntheticFrame( PERF_WIDTH, PERF_HEIGHT, CLP_YUV420P, uiBitsPel, 31 );
+    std::vector<ClpByte> acBuffer( pcFrame->getBytesPerFrame() );
+    ClpULong uiBytes = pcFrame->getBytesPerFrame();
+    CalypFrame* pcPtr = pcFrame.get();
+    CalypFrame* pcRefPtr = pcRef.get();
+    ClpByte* pcBuffer = acBuffer.data();
+
+    EXPECT_THROUGHPUT( "frameToBuffer", 75, uiBytes, [&]() { pcPtr->frameToBuffer( pcBuffer, CLP_LITTLE_ENDIAN ); } );
+    EXPECT_THROUGHPUT( "frameFromBuffer", 75, uiBytes, [&]() { pcPtr->frameFromBuffer( pcBuffer, CLP_LITTLE_ENDIAN ); } );
+    EXPECT_THROUGHPUT( "fillRGBBuffer", 35, uiBytes, [&]() {
+      pcPtr->frameFromBuffer( pcBuffer, CLP_LITTLE_ENDIAN );
+      pcPtr->fillRGBBuffer();
+    } );
+    EXPECT_THROUGHPUT( "calcHistogram", 50, uiBytes, [&]() {
+      pcPtr->frameFromBuffer( pcBuffer, CLP_LITTLE_ENDIAN );
+      pcPtr->calcHistogram();
+    } );
+    EXPECT_THROUGHPUT( "copyFrom", 1000, uiBytes, [&]() { pcRefPtr->copyFrom( pcPtr ); } );
+    EXPECT_THROUGHPUT( "mse", 250, uiBytes, [&]() { pcPtr->getQuality( CalypFrame::MSE_METRIC, pcRefPtr, CLP_LUMA ); } );
+  }
+}
+
+TEST_F( CalypThroughputTest, Modules )
+{
+  struct ModuleCase
+  {
+    const char* pchName;
+    const char* pchOption;
+    unsigned int uiNumberOfFrames;
+    unsigned int uiBitsPel;
+    double dDefaultMin;
+  };
+  const ModuleCase acCases[] = {
+      { "FrameMask", "", 2, 8, 20 },
+      { "FrameRotate", "--Angle=90", 1, 8, 50 },
+      { "AbsoluteFrameDifference", "", 2, 8, 150 },
+      { "EightBitsSampling", "--num_bits=8", 1, 10, 150 },
+      { "FrameBinarization", "", 1, 8, 150 },
+      { "FrameResampling", "--width=960", 1, 8, 20 },
+      { "ThreeSixtyProjectionConversion", "", 1, 8, 50 },
+  };
+  for( const ModuleCase& cCase : acCases )
+  {
+    std::vector<std::unique_ptr<CalypFrame>> apcFrames;
+    std::vector<CalypFrame*> apcInput;
+    for( unsigned int i = 0; i < cCase.uiNumberOfFrames; i++ )
+    {
+      apcFrames.push_back( createSyntheticFrame( PERF_WIDTH, PERF_HEIGHT, CLP_YUV420P, cCase.uiBitsPel, 40 + i ) );
+      apcInput.push_back( apcFrames.back().get() );
+    }
+    std::vector<ClpString> astrOptions;
+    if( *cCase.pchOption )
+      astrOptions.push_back( cCase.pchOption );
+    ASSERT_TRUE( createModule( cCase.pchName, astrOptions ) != NULL );
+    ASSERT_TRUE( m_pcModule->create( apcInput ) );
+    EXPECT_THROUGHPUT( cCase.pchName, cCase.dDefaultMin, apcInput[0]->getBytesPerFrame(),
+                       [&]() { processModule( apcInput ); } );
+  }
+}
@@ -24,10 +24,12 @@
 
 #include "AbsoluteFrameDifference.h"
 
+#include "lib/CalypPlaneKernels.h"
+
 AbsoluteFrameDifference::AbsoluteFrameDifference()
 {
   /* Module Definition */
-  m_iModuleAPI = CLP_MODULE_API_2;  // Use API version 2 (recommended).
+  m_iModuleAPI = CLP_MODULE_API_4;  // Use API version 4 (outputs provided by the caller).
   // See this example for details on the functions prototype
   m_iModuleType = CLP_FRAME_PROCESSING_MODULE;             // Apply module to the frames or to
                                                            // the whole sequence.
@@ -36,12 +38,12 @@ AbsoluteFrameDifference::AbsoluteFrameDifference()
   m_pchModuleLongName = "Absolute Difference";             // Long Name
   m_pchModuleTooltip = "Measure the absolute difference "  // Description
                        "between two images (Y plane), e. g., abs( Y1 - Y2 )";
-  m_uiNumberOfFrames = 2;                                   // Number of frames required
-  m_uiModuleRequirements = CLP_MODULE_REQUIRES_NEW_WINDOW;  // Module requirements
-                                                            // (check
-                                                            // CalypModulesIf.h).
+  m_uiNumberOfFrames = 2;                                    // Number of frames required
+  m_uiModuleRequirements = CLP_MODULE_REQUIRES_NEW_WINDOW |  // Module requirements
+                           CLP_MODULE_FRAME_INDEPENDENT |    // (check
+                           CLP_MODULE_REENTRANT |            // CalypModulesIf.h).
+                           CLP_MODULE_IN_PLACE;
   // Several requirements should be "or" between each others.
-  m_pcFrameDifference = NULL;
 }
 
 bool AbsoluteFrameDifference::create( std::vector<CalypFrame*> apcFrameList )
@@ -53,37 +55,27 @@ bool AbsoluteFrameDifference::create( std::vector<CalypFrame*> apcFrameList )
         | CalypFrame::MATCH_COLOR_SPACE | CalypFrame::MATCH_RESOLUTION | CalypFrame::MATCH_BITS ) )
       return false;
 
-  m_pcFrameDifference = new CalypFrame( apcFrameList[0]->getWidth(), apcFrameList[0]->getHeight(), CLP_GRAY, apcFrameList[0]->getBitsPel() );
+  setOutputFormat( apcFrameList[0]->getWidth(), apcFrameList[0]->getHeight(), CLP_GRAY, apcFrameList[0]->getBitsPel() );
   return true;
 }
 
-CalypFrame* AbsoluteFrameDifference::process( std::vector<CalypFrame*> apcFrameList )
+bool AbsoluteFrameDifference::process( std::vector<CalypFrame*> apcFrameList, CalypFrame* pcOutput )
 {
-  CalypFrame* Input1 = apcFrameList[0];
-  CalypFrame* Input2 = apcFrameList[1];
-  ClpPel* pInput1PelYUV = Input1->getPelBufferYUV()[0][0];
-  ClpPel* pInput2PelYUV = Input2->getPelBufferYUV()[0][0];
-  ClpPel* pOutputPelYUV = m_pcFrameDifference->getPelBufferYUV()[0][0];
-  int aux_pel_1, aux_pel_2;
+  const CalypFrame* Input1 = apcFrameList[0];
+  const CalypFrame* Input2 = apcFrameList[1];
+  ClpPel*** pppOutputPel = pcOutput->getPelBufferYUV();
 
-  for( unsigned int ch = 0; ch < m_pcFrameDifference->getNumberChannels(); ch++ )
+  for( unsigned int ch = 0; ch < pcOutput->getNumberChannels(); ch++ )
   {
-    for( unsigned int y = 0; y < m_pcFrameDifference->getHeight(); y++ )
-    {
-      for( unsigned int x = 0; x < m_pcFrameDifference->getWidth(); x++ )
-      {
-        aux_pel_1 = *pInput1PelYUV++;
-        aux_pel_2 = *pInput2PelYUV++;
-        *pOutputPelYUV++ = abs( aux_pel_1 - aux_pel_2 );
-      }
-    }
+    CalypPlaneKernels::absDiff( pppOutputPel[ch][0], Input1->getPelBufferYUV()[ch][0], Input2->getPelBufferYUV()[ch][0],
+                                ClpULong( pcOutput->getWidth( ch ) ) * pcOutput->getHeight( ch ) );
   }
-  return m_pcFrameDifference;
+  return true;
 }
 
 void AbsoluteFrameDifference::destroy()
 {
-  if( m_pcFrameDifference )
-    delete m_pcFrameDifference;
-  m_pcFrameDifference = NULL;
+  if( m_pcOutputFrame )
+    delete m_pcOutputFrame;
+  m_pcOutputFrame = NULL;
 }
@@ -32,14 +32,11 @@ class AbsoluteFrameDifference : public CalypModuleIf
 {
   REGISTER_CLASS_FACTORY( AbsoluteFrameDifference )
 
-private:
-  CalypFrame* m_pcFrameDifference;
-
 public:
   AbsoluteFrameDifference();
   virtual ~AbsoluteFrameDifference() {}
   bool create( std::vector<CalypFrame*> apcFrameList );
-  CalypFrame* process( std::vector<CalypFrame*> apcFrameList );
+  bool process( std::vector<CalypFrame*> apcFrameList, CalypFrame* pcOutput );
   void destroy();
 };
 
@@ -24,23 +24,24 @@
 
 #include "EightBitsSampling.h"
 
+#include "lib/CalypPlaneKernels.h"
+
 EightBitsSampling::EightBitsSampling()
 {
   /* Module Definition */
-  m_iModuleAPI = CLP_MODULE_API_2;
+  m_iModuleAPI = CLP_MODULE_API_4;
   m_iModuleType = CLP_FRAME_PROCESSING_MODULE;
   m_pchModuleCategory = "Conversions";
   m_pchModuleName = "BitsResampling";
   m_pchModuleLongName = "Re-sampling frame (bpp)";
   m_pchModuleTooltip = "Re-sampling frame to a different value of bits per pixel";
   m_uiNumberOfFrames = 1;
-  m_uiModuleRequirements = CLP_MODULE_REQUIRES_OPTIONS;
+  m_uiModuleRequirements = CLP_MODULE_REQUIRES_OPTIONS | CLP_MODULE_FRAME_INDEPENDENT | CLP_MODULE_REENTRANT;
 
   m_cModuleOptions.addOptions() /**/
       ( "num_bits", m_iNumberOfBits, "Number of bits/pixel (8-16) [8]" );
 
   m_iNumberOfBits = 8;
-  m_pcResampledFrame = NULL;
 }
 
 bool EightBitsSampling::create( std::vector<CalypFrame*> apcFrameList )
@@ -49,30 +50,27 @@ bool EightBitsSampling::create( std::vector<CalypFrame*> apcFrameList )
   if( !m_iBitSifting )
     return false;
 
-  m_pcResampledFrame = new CalypFrame( apcFrameList[0]->getWidth(), apcFrameList[0]->getHeight(),
-                                       apcFrameList[0]->getPelFormat(), m_iNumberOfBits );
+  setOutputFormat( apcFrameList[0]->getWidth(), apcFrameList[0]->getHeight(), apcFrameList[0]->getPelFormat(),
+                   m_iNumberOfBits );
   return true;
 }
 
-CalypFrame* EightBitsSampling::process( std::vector<CalypFrame*> apcFrameList )
+bool EightBitsSampling::process( std::vector<CalypFrame*> apcFrameList, CalypFrame* pcOutput )
 {
-  CalypFrame* pcFrame = apcFrameList[0];
-  ClpPel* pPelInput = pcFrame->getPelBufferYUV()[0][0];
-  ClpPel* pPelResampled = m_pcResampledFrame->getPelBufferYUV()[0][0];
-  int bitShifting = m_iBitSifting > 0 ? m_iBitSifting : -m_iBitSifting;
+  const CalypFrame* pcFrame = apcFrameList[0];
+  ClpPel*** pppOutputPel = pcOutput->getPelBufferYUV();
 
-  if( m_iBitSifting > 0 )
-    for( unsigned i = 0; i < pcFrame->getTotalNumberOfPixels(); i++ )
-      *pPelResampled++ = *pPelInput++ >> bitShifting;
-  else
-    for( unsigned i = 0; i < pcFrame->getTotalNumberOfPixels(); i++ )
-      *pPelResampled++ = *pPelInput++ << bitShifting;
-  return m_pcResampledFrame;
+  for( unsigned int ch = 0; ch < pcOutput->getNumberChannels(); ch++ )
+  {
+    CalypPlaneKernels::shift( pppOutputPel[ch][0], pcFrame->getPelBufferYUV()[ch][0],
+                              ClpULong( pcOutput->getWidth( ch ) ) * pcOutput->getHeight( ch ), m_iBitSifting );
+  }
+  return true;
 }
 
 void EightBitsSampling::destroy()
 {
-  if( m_pcResampledFrame )
-    delete m_pcResampledFrame;
-  m_pcResampledFrame = NULL;
+  if( m_pcOutputFrame )
+    delete m_pcOutputFrame;
+  m_pcOutputFrame = NULL;
 }
@@ -35,13 +35,12 @@ class EightBitsSampling : public CalypModuleIf
 private:
   int m_iNumberOfBits;
   int m_iBitSifting;
-  CalypFrame* m_pcResampledFrame;
 
 public:
   EightBitsSampling();
   virtual ~EightBitsSampling() {}
   bool create( std::vector<CalypFrame*> apcFrameList );
-  CalypFrame* process( std::vector<CalypFrame*> apcFrameList );
+  bool process( std::vector<CalypFrame*> apcFrameList, CalypFrame* pcOutput );
   void destroy();
 };
 
@@ -32,7 +32,7 @@ FilterComponentModule::FilterComponentModule()
   m_iModuleAPI = CLP_MODULE_API_2;
   m_iModuleType = CLP_FRAME_PROCESSING_MODULE;
   m_uiNumberOfFrames = 1;
-  m_uiModuleRequirements = CLP_MODULE_REQUIRES_NOTHING;
+  m_uiModuleRequirements = CLP_MODULE_FRAME_INDEPENDENT;
   m_pchModuleCategory = "Filtering";
 
   m_pcFilteredFrame = NULL;
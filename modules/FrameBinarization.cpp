@@ -24,45 +24,44 @@
 
 #include "FrameBinarization.h"
 
+#include "lib/CalypPlaneKernels.h"
+
 FrameBinarization::FrameBinarization()
 {
   /* Module Definition */
+  m_iModuleAPI = CLP_MODULE_API_4;
   m_iModuleType = CLP_FRAME_PROCESSING_MODULE;
   m_pchModuleCategory = "Utilities";
   m_pchModuleLongName = "Binarization";
   m_pchModuleName = "FrameBinarization";
   m_pchModuleTooltip = "Binarize frame";
   m_uiNumberOfFrames = 1;
-  m_uiModuleRequirements = CLP_MODULE_REQUIRES_OPTIONS;
+  m_uiModuleRequirements = CLP_MODULE_REQUIRES_OPTIONS | CLP_MODULE_FRAME_INDEPENDENT | CLP_MODULE_REENTRANT | CLP_MODULE_IN_PLACE;
 
   m_cModuleOptions.addOptions() /**/
       ( "threshold", m_uiThreshold, "Threshold level for binarization (0-255) [128]" );
 
-  m_pcBinFrame = NULL;
   m_uiThreshold = 128;
 }
 
-void FrameBinarization::create( CalypFrame* frame )
+bool FrameBinarization::create( std::vector<CalypFrame*> apcFrameList )
 {
-  m_pcBinFrame = NULL;
-  m_pcBinFrame = new CalypFrame( frame->getWidth(), frame->getHeight(), CLP_GRAY, 8 );
+  _BASIC_MODULE_API_2_CHECK_
+  setOutputFormat( apcFrameList[0]->getWidth(), apcFrameList[0]->getHeight(), CLP_GRAY, 8 );
+  return true;
 }
 
-CalypFrame* FrameBinarization::process( CalypFrame* frame )
+bool FrameBinarization::process( std::vector<CalypFrame*> apcFrameList, CalypFrame* pcOutput )
 {
-  ClpPel* pPelInput = frame->getPelBufferYUV()[0][0];
-  ClpPel* pPelBin = m_pcBinFrame->getPelBufferYUV()[0][0];
-  for( unsigned int y = 0; y < frame->getHeight(); y++ )
-    for( unsigned int x = 0; x < frame->getWidth(); x++ )
-    {
-      *pPelBin++ = *pPelInput++ >= m_uiThreshold ? 255 : 0;
-    }
-  return m_pcBinFrame;
+  const CalypFrame* frame = apcFrameList[0];
+  CalypPlaneKernels::threshold( pcOutput->getPelBufferYUV()[0][0], frame->getPelBufferYUV()[0][0],
+                                ClpULong( frame->getWidth() ) * frame->getHeight(), m_uiThreshold, 0, 255 );
+  return true;
 }
 
 void FrameBinarization::destroy()
 {
-  if( m_pcBinFrame )
-    delete m_pcBinFrame;
-  m_pcBinFrame = NULL;
+  if( m_pcOutputFrame )
+    delete m_pcOutputFrame;
+  m_pcOutputFrame = NULL;
 }
@@ -33,14 +33,13 @@ class FrameBinarization : public CalypModuleIf
   REGISTER_CLASS_FACTORY( FrameBinarization )
 
 private:
-  CalypFrame* m_pcBinFrame;
   unsigned int m_uiThreshold;
 
 public:
   FrameBinarization();
   virtual ~FrameBinarization() {}
-  void create( CalypFrame* );
-  CalypFrame* process( CalypFrame* );
+  bool create( std::vector<CalypFrame*> apcFrameList );
+  bool process( std::vector<CalypFrame*> apcFrameList, CalypFrame* pcOutput );
   void destroy();
 };
 
@@ -33,7 +33,7 @@ FrameCrop::FrameCrop()
   m_pchModuleName = "FrameCrop";
   m_pchModuleTooltip = "Crop a region of a frame";
   m_uiNumberOfFrames = 1;
-  m_uiModuleRequirements = CLP_MODULE_REQUIRES_OPTIONS;
+  m_uiModuleRequirements = CLP_MODULE_REQUIRES_OPTIONS | CLP_MODULE_FRAME_INDEPENDENT;
 
   m_cModuleOptions.addOptions()                                                                   /**/
       ( "xPosition", m_uiXPosition, "X cordinate of the left-top corner of the crop region [0]" ) /**/
@@ -34,7 +34,7 @@ FrameDifference::FrameDifference()
   m_pchModuleName = "Difference";
   m_pchModuleTooltip = "Measure the difference between two images (Y plane),  "
                        "Y1 - Y2, with max absolute diff of 128";
-  m_uiModuleRequirements = CLP_MODULE_REQUIRES_NEW_WINDOW | CLP_MODULE_REQUIRES_OPTIONS;
+  m_uiModuleRequirements = CLP_MODULE_REQUIRES_NEW_WINDOW | CLP_MODULE_REQUIRES_OPTIONS | CLP_MODULE_FRAME_INDEPENDENT;
   m_uiNumberOfFrames = 2;
 
   m_cModuleOptions.addOptions() /**/
@@ -24,24 +24,25 @@
 
 #include "FrameMask.h"
 
+#include "lib/CalypPlaneKernels.h"
+
 FrameMask::FrameMask()
 {
   /* Module Definition */
-  m_iModuleAPI = CLP_MODULE_API_2;
+  m_iModuleAPI = CLP_MODULE_API_4;
   m_iModuleType = CLP_FRAME_PROCESSING_MODULE;
   m_pchModuleCategory = "Utilities";
   m_pchModuleLongName = "Apply mask";
   m_pchModuleName = "FrameMask";
   m_pchModuleTooltip = "Applies a mask to the selected image (first image)";
   m_uiNumberOfFrames = 2;
-  m_uiModuleRequirements = CLP_MODULE_REQUIRES_NEW_WINDOW | CLP_MODULE_REQUIRES_OPTIONS | CLP_MODULE_USES_KEYS;
+  m_uiModuleRequirements = CLP_MODULE_REQUIRES_NEW_WINDOW | CLP_MODULE_REQUIRES_OPTIONS | CLP_MODULE_USES_KEYS |
+                           CLP_MODULE_FRAME_INDEPENDENT | CLP_MODULE_REENTRANT | CLP_MODULE_IN_PLACE;
 
   m_cModuleOptions.addOptions() /**/
       ( "MaskWeigth", m_iWeight, "Influence of the mask [60%]" );
 
   m_iWeight = 6;
-
-  m_pcFrameProcessed = NULL;
 }
 
 bool FrameMask::create( std::vector<CalypFrame*> apcFrameList )
@@ -65,7 +66,7 @@ bool FrameMask::create( std::vector<CalypFrame*> apcFrameList )
   int iColorSpace = apcFrameList[0]->getColorSpace();
   if( iColorSpace == CLP_COLOR_GRAY )
   {
-    iColorSpace = apcFrameList[1]->getPelFormat();
+    iColorSpace = apcFrameList[1]->getColorSpace();
   }
   switch( iColorSpace )
   {
@@ -80,31 +81,14 @@ bool FrameMask::create( std::vector<CalypFrame*> apcFrameList )
     break;
   }
 
-  m_pcFrameProcessed = new CalypFrame( apcFrameList[0]->getWidth(), apcFrameList[0]->getHeight(), iPelFmt,
-                                       apcFrameList[0]->getBitsPel() );
+  setOutputFormat( apcFrameList[0]->getWidth(), apcFrameList[0]->getHeight(), iPelFmt, apcFrameList[0]->getBitsPel() );
   return true;
 }
 
-CalypFrame* FrameMask::process( std::vector<CalypFrame*> apcFrameList )
+bool FrameMask::process( std::vector<CalypFrame*> apcFrameList, CalypFrame* pcOutput )
 {
-  CalypFrame* InputFrame = apcFrameList[0];
-  CalypFrame* MaskFrame = apcFrameList[1];
-  CalypPixel pixelImg;
-  CalypPixel pixelMask;
-  CalypPixel pixelOut;
-
-  for( unsigned int y = 0; y < m_pcFrameProcessed->getHeight(); y++ )
-  {
-    for( unsigned int x = 0; x < m_pcFrameProcessed->getWidth(); x++ )
-    {
-      pixelImg = InputFrame->getPixel( x, y );
-      pixelMask = MaskFrame->getPixel( x, y );
-      pixelOut = pixelImg * ( 10 - m_iWeight ) + pixelMask * m_iWeight;
-      pixelOut = pixelOut * 0.1;
-      m_pcFrameProcessed->setPixel( x, y, pixelOut );
-    }
-  }
-  return m_pcFrameProcessed;
+  CalypPlaneKernels::blend( pcOutput, apcFrameList[0], apcFrameList[1], 10 - m_iWeight, m_iWeight, 10 );
+  return true;
 }
 
 bool FrameMask::keyPressed( enum Module_Key_Supported value )
@@ -124,9 +108,7 @@ bool FrameMask::keyPressed( enum Module_Key_Supported value )
 
 void FrameMask::destroy()
 {
-  if( m_pcFrameProcessed )
-  {
-    delete m_pcFrameProcessed;
-  }
-  m_pcFrameProcessed = NULL;
+  if( m_pcOutputFrame )
+    delete m_pcOutputFrame;
+  m_pcOutputFrame = NULL;
 }
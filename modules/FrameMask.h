@@ -34,13 +34,12 @@ class FrameMask : public CalypModuleIf
 
 private:
   int m_iWeight;
-  CalypFrame* m_pcFrameProcessed;
 
 public:
   FrameMask();
   virtual ~FrameMask() {}
   bool create( std::vector<CalypFrame*> apcFrameList );
-  CalypFrame* process( std::vector<CalypFrame*> apcFrameList );
+  bool process( std::vector<CalypFrame*> apcFrameList, CalypFrame* pcOutput );
   bool keyPressed( enum Module_Key_Supported value );
   void destroy();
 };
@@ -24,52 +24,51 @@
 
 #include "FrameResampling.h"
 
-#include <cstdlib>
-
-// OpenCV
-#include <opencv2/core/core.hpp>
-#include <opencv2/imgproc.hpp>
-
-using cv::Mat;
-using cv::Size;
+#include "lib/CalypResampler.h"
 
 FrameResampling::FrameResampling()
 {
   /* Module Definition */
-  m_iModuleAPI = CLP_MODULE_API_2;
+  m_iModuleAPI = CLP_MODULE_API_4;
   m_iModuleType = CLP_FRAME_PROCESSING_MODULE;
   m_pchModuleCategory = "Utilities";
   m_pchModuleName = "FrameResampling";
   m_pchModuleLongName = "Frame Resampling (Spatial)";
   m_pchModuleTooltip = "Resampling frame to an abritary resolution";
   m_uiNumberOfFrames = 1;
-  m_uiModuleRequirements = CLP_MODULE_REQUIRES_OPTIONS;
+  m_uiModuleRequirements = CLP_MODULE_REQUIRES_OPTIONS | CLP_MODULE_FRAME_INDEPENDENT;
 
-  m_cModuleOptions.addOptions()                              /**/
-      ( "width", m_iWidth, "Width of the crop region [-1]" ) /**/
-      ( "height", m_iHeight, "Height of the crop region [-1]" ) /**/
-      ( "Interpolation", m_iInterpolation, "Interpolation method (1-4) [4]" )                  ;
+  m_cModuleOptions.addOptions()                                                       /**/
+      ( "width", m_iWidth, "Width of the crop region [-1]" )                          /**/
+      ( "height", m_iHeight, "Height of the crop region [-1]" )                       /**/
+      ( "Interpolation", m_iInterpolation, "Interpolation method (1-4) [4]" )         /**/
+      ( "siting", m_iChromaSiting, "Chroma siting (0: left, 1: center) [0]" )         /**/
+      ( "resample_threads", m_uiThreads, "Number of threads (0: number of cores) [1]" );
 
   m_iInterpolation = 4;
   m_iWidth = -1;
   m_iHeight = -1;
+  m_iChromaSiting = CLP_CHROMA_SITING_LEFT;
+  m_uiThreads = 1;
+  m_pcResampler = NULL;
 }
 
 bool FrameResampling::create( std::vector<CalypFrame*> apcFrameList )
 {
+  int iFilter;
   switch( m_iInterpolation )
   {
   case 2:
-    m_iInterpolation = cv::INTER_LINEAR;
+    iFilter = CLP_RESAMPLER_BILINEAR;
     break;
   case 3:
-    m_iInterpolation = cv::INTER_CUBIC;
+    iFilter = CLP_RESAMPLER_BICUBIC;
     break;
   case 4:
-    m_iInterpolation = cv::INTER_LANCZOS4;
+    iFilter = CLP_RESAMPLER_LANCZOS;
     break;
   default:
-    m_iInterpolation = cv::INTER_NEAREST;
+    iFilter = CLP_RESAMPLER_NEAREST;
   }
   if( m_iWidth == -1 )
   {
@@ -79,26 +78,23 @@ bool FrameResampling::create( std::vector<CalypFrame*> apcFrameList )
   {
     m_iHeight = apcFrameList[0]->getHeight() * double( m_iWidth ) / double( apcFrameList[0]->getWidth() );
   }
-  m_pcOutputFrame = new CalypFrame( m_iWidth, m_iHeight, apcFrameList[0]->getPelFormat(), apcFrameList[0]->getBitsPel() );
-  return m_pcOutputFrame;
+  if( m_iWidth <= 0 || m_iHeight <= 0 )
+    return false;
+  m_pcResampler = new CalypResampler( iFilter, m_iChromaSiting, m_uiThreads );
+  setOutputFormat( m_iWidth, m_iHeight, apcFrameList[0]->getPelFormat(), apcFrameList[0]->getBitsPel() );
+  return true;
 }
 
-CalypFrame* FrameResampling::process( std::vector<CalypFrame*> apcFrameList )
+bool FrameResampling::process( std::vector<CalypFrame*> apcFrameList, CalypFrame* pcOutput )
 {
-  m_pcOutputFrame->reset();
-  for( unsigned ch = 0; ch < apcFrameList[0]->getNumberChannels(); ch++ )
-  {
-    Mat inputFrame, outputFrame;
-    cv::Size outSize( m_pcOutputFrame->getWidth( ch ), m_pcOutputFrame->getHeight( ch ) );
-    apcFrameList[0]->toMat( inputFrame, true, false, ch );
-    cv::resize( inputFrame, outputFrame, outSize, 0, 0, m_iInterpolation );
-    m_pcOutputFrame->fromMat( outputFrame, ch );
-  }
-  return m_pcOutputFrame;
+  return m_pcResampler->resample( pcOutput, apcFrameList[0] );
 }
 
 void FrameResampling::destroy()
 {
+  delete m_pcResampler;
+  m_pcResampler = NULL;
   if( m_pcOutputFrame )
     delete m_pcOutputFrame;
+  m_pcOutputFrame = NULL;
 }
@@ -28,6 +28,7 @@
 // CalypLib
 #include "lib/CalypModuleIf.h"
 
+class CalypResampler;
 /**
  * \ingroup  Calyp_Modules
  * @defgroup Calyp_Modules_Saliency Saliency
@@ -42,12 +43,16 @@ class FrameResampling : public CalypModuleIf
 private:
   int m_iWidth;
   int m_iHeight;
-int m_iInterpolation;
+  int m_iInterpolation;
+  int m_iChromaSiting;
+  unsigned int m_uiThreads;
+  CalypResampler* m_pcResampler;
+
 public:
   FrameResampling();
   virtual ~FrameResampling() {}
   bool create( std::vector<CalypFrame*> apcFrameList );
-  CalypFrame* process( std::vector<CalypFrame*> apcFrameList );
+  bool process( std::vector<CalypFrame*> apcFrameList, CalypFrame* pcOutput );
   void destroy();
 };
 
@@ -24,24 +24,24 @@
 
 #include "FrameRotate.h"
 
+#include "lib/CalypPlaneKernels.h"
+
 FrameRotate::FrameRotate()
 {
   /* Module Definition */
-  m_iModuleAPI = CLP_MODULE_API_2;
+  m_iModuleAPI = CLP_MODULE_API_4;
   m_iModuleType = CLP_FRAME_PROCESSING_MODULE;
   m_pchModuleCategory = "Utilities";
   m_pchModuleLongName = "Rotation";
   m_pchModuleName = "FrameRotate";
   m_pchModuleTooltip = "Rotates frame";
   m_uiNumberOfFrames = 1;
-  m_uiModuleRequirements = CLP_MODULE_REQUIRES_OPTIONS;
+  m_uiModuleRequirements = CLP_MODULE_REQUIRES_OPTIONS | CLP_MODULE_FRAME_INDEPENDENT | CLP_MODULE_REENTRANT;
 
   m_cModuleOptions.addOptions() /**/
       ( "Angle", m_iAngle, "Angle to rotate (0, 90, 180, 270)" );
 
   m_iAngle = 90;
-
-  m_pcFrameProcessed = NULL;
 }
 
 bool FrameRotate::create( std::vector<CalypFrame*> apcFrameList )
@@ -67,53 +67,18 @@ bool FrameRotate::create( std::vector<CalypFrame*> apcFrameList )
     return false;
   }
 
-  m_pcFrameProcessed = new CalypFrame( iWidth, iHeight, apcFrameList[0]->getPelFormat(),
-                                       apcFrameList[0]->getBitsPel() );
+  setOutputFormat( iWidth, iHeight, apcFrameList[0]->getPelFormat(), apcFrameList[0]->getBitsPel() );
   return true;
 }
 
-CalypFrame* FrameRotate::process( std::vector<CalypFrame*> apcFrameList )
+bool FrameRotate::process( std::vector<CalypFrame*> apcFrameList, CalypFrame* pcOutput )
 {
-  CalypFrame* InputFrame = apcFrameList[0];
-  unsigned int inWidht = InputFrame->getWidth();
-  unsigned int inHeight = InputFrame->getHeight();
-  CalypPixel pixel;
-  unsigned int inX;
-  unsigned int inY;
-
-  for( unsigned int y = 0; y < m_pcFrameProcessed->getHeight(); y++ )
-  {
-    for( unsigned int x = 0; x < m_pcFrameProcessed->getWidth(); x++ )
-    {
-      inX = x;
-      inY = y;
-      switch( m_iAngle )
-      {
-      case 90:
-        inX = y;
-        inY = inHeight - x - 1;
-        break;
-      case 180:
-        inX = inWidht - x - 1;
-        inY = inHeight - y - 1;
-        break;
-      case 270:
-        inX = inWidht - y;
-        inY = x;
-        break;
-      }
-      pixel = InputFrame->getPixel( inX, inY );
-      m_pcFrameProcessed->setPixel( x, y, pixel );
-    }
-  }
-  return m_pcFrameProcessed;
+  return CalypPlaneKernels::rotate( pcOutput, apcFrameList[0], m_iAngle );
 }
 
 void FrameRotate::destroy()
 {
-  if( m_pcFrameProcessed )
-  {
-    delete m_pcFrameProcessed;
-  }
-  m_pcFrameProcessed = NULL;
+  if( m_pcOutputFrame )
+    delete m_pcOutputFrame;
+  m_pcOutputFrame = NULL;
 }
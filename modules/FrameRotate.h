@@ -34,13 +34,12 @@ class FrameRotate : public CalypModuleIf
 
 private:
   int m_iAngle;
-  CalypFrame* m_pcFrameProcessed;
 
 public:
   FrameRotate();
   virtual ~FrameRotate() {}
   bool create( std::vector<CalypFrame*> apcFrameList );
-  CalypFrame* process( std::vector<CalypFrame*> apcFrameList );
+  bool process( std::vector<CalypFrame*> apcFrameList, CalypFrame* pcOutput );
   void destroy();
 };
 
@@ -34,7 +34,7 @@ FrameShift::FrameShift()
   m_pchModuleName = "FrameShift";
   m_pchModuleTooltip = "Shift frame horizontal and vertical";
   m_uiNumberOfFrames = 1;
-  m_uiModuleRequirements = CLP_MODULE_REQUIRES_OPTIONS | CLP_MODULE_USES_KEYS;
+  m_uiModuleRequirements = CLP_MODULE_REQUIRES_OPTIONS | CLP_MODULE_USES_KEYS | CLP_MODULE_FRAME_INDEPENDENT;
 
   m_cModuleOptions.addOptions()                                                               /**/
       ( "ShiftHorizontal", m_iShiftHor, "Amount of pixels to shift in horizontal direction" ) /**/
@@ -63,7 +63,8 @@ bool HEVCIntraPrediction::create( std::vector<CalypFrame*> apcFrameList )
   m_pcPredBlock = NULL;
   m_pcPredBlock = new CalypFrame( m_iBlockSize * 2 + 1, m_iBlockSize * 2 + 1, CLP_GRAY, apcFrameList[0]->getBitsPel() );
 
-  getMem1D( &m_referenceMem, m_iBlockSize * 4 );
+  // References from -2 * size + 1 to 2 * size around the corner
+  getMem1D( &m_referenceMem, m_iBlockSize * 4 + 1 );
   return true;
 }
 
@@ -24,7 +24,8 @@
 
 #include "InterFrameVariance.h"
 
-#include "lib/LibMemory.h"
+#include <algorithm>
+#include <cstring>
 
 InterFrameVariance::InterFrameVariance()
 {
@@ -39,9 +40,17 @@ InterFrameVariance::InterFrameVariance()
   m_pchModuleTooltip = "Measure the variance across several frames";
   m_uiNumberOfFrames = 2;  // Number of Frames required (This module
                            // allows a variable number of inputs)
-  m_uiModuleRequirements = CLP_MODULE_REQUIRES_NEW_WINDOW | CLP_MODULES_VARIABLE_NUM_FRAMES;
+  m_uiModuleRequirements = CLP_MODULE_REQUIRES_NEW_WINDOW | CLP_MODULES_VARIABLE_NUM_FRAMES | CLP_MODULE_REQUIRES_OPTIONS;
   // Several requirements should be "or" between each others.
+
+  m_cModuleOptions.addOptions() /**/
+      ( "window", m_uiWindow,
+        "Variance over the last frames of the first input (sliding window) instead of across the inputs [0]" );
+
   m_pcFrameVariance = NULL;
+  m_uiWindow = 0;
+  m_uiWindowCount = 0;
+  m_uiWindowPos = 0;
 }
 
 bool InterFrameVariance::create( std::vector<CalypFrame*> apcFrameList )
@@ -56,58 +65,108 @@ bool InterFrameVariance::create( std::vector<CalypFrame*> apcFrameList )
 
   m_pcFrameVariance =
       new CalypFrame( apcFrameList[0]->getWidth(), apcFrameList[0]->getHeight(), CLP_GRAY, 8 );
-  getMem2D( &m_pVariance, apcFrameList[0]->getHeight(), apcFrameList[0]->getWidth() );
+
+  ClpULong uiSize = ClpULong( apcFrameList[0]->getWidth() ) * apcFrameList[0]->getHeight();
+  m_auiSum.assign( uiSize, 0 );
+  m_auiSumSquares.assign( uiSize, 0 );
+  m_auiVariance.resize( uiSize );
+
+  m_uiWindowCount = 0;
+  m_uiWindowPos = 0;
+  if( m_uiWindow )
+    m_auiWindowPels.resize( uiSize * m_uiWindow );
 
   return true;
 }
 
-CalypFrame* InterFrameVariance::process( std::vector<CalypFrame*> apcFrameList )
+/**
+ * N * sum( x^2 ) - sum( x )^2 is N^2 times the variance; the scale does
+ * not matter as the output is normalized to the largest value
+ */
+void InterFrameVariance::computeVariance( unsigned int uiNumFrames )
 {
-  int numFrames = apcFrameList.size();
+  ClpULong uiSize = m_auiVariance.size();
+  const std::uint32_t* puiSum = m_auiSum.data();
+  const std::uint64_t* puiSumSquares = m_auiSumSquares.data();
+  std::uint64_t* puiVariance = m_auiVariance.data();
+  std::uint64_t uiMaxVariance = 0;
+  for( ClpULong i = 0; i < uiSize; i++ )
+  {
+    puiVariance[i] = puiSumSquares[i] * uiNumFrames - std::uint64_t( puiSum[i] ) * puiSum[i];
+    uiMaxVariance = std::max( uiMaxVariance, puiVariance[i] );
+  }
 
-  ClpPel** pInput = new ClpPel*[numFrames];
   ClpPel* pOutputPelYUV = m_pcFrameVariance->getPelBufferYUV()[0][0];
-
-  for( int i = 0; i < numFrames; i++ )
+  if( uiMaxVariance == 0 )
   {
-    pInput[i] = apcFrameList[i]->getPelBufferYUV()[0][0];
+    memset( pOutputPelYUV, 0, uiSize * sizeof( ClpPel ) );
+    return;
   }
+  double dMaxVariance = double( uiMaxVariance );
+  for( ClpULong i = 0; i < uiSize; i++ )
+    pOutputPelYUV[i] = ClpPel( double( puiVariance[i] ) * 255 / dMaxVariance );
+}
 
-  double maxVariance = 0;
-  for( unsigned int y = 0; y < m_pcFrameVariance->getHeight(); y++ )
-    for( unsigned int x = 0; x < m_pcFrameVariance->getWidth(); x++ )
-    {
-      int sum = 0;
-      int v = 0;
-      m_pVariance[y][x] = 0;
+CalypFrame* InterFrameVariance::process( std::vector<CalypFrame*> apcFrameList )
+{
+  ClpULong uiSize = m_auiSum.size();
+  std::uint32_t* puiSum = m_auiSum.data();
+  std::uint64_t* puiSumSquares = m_auiSumSquares.data();
 
-      for( int i = 0; i < numFrames; i++ )
+  if( !m_uiWindow )
+  {
+    std::fill( m_auiSum.begin(), m_auiSum.end(), 0 );
+    std::fill( m_auiSumSquares.begin(), m_auiSumSquares.end(), 0 );
+    for( unsigned int f = 0; f < apcFrameList.size(); f++ )
+    {
+      const ClpPel* pInput = static_cast<const CalypFrame*>( apcFrameList[f] )->getPelBufferYUV()[0][0];
+      for( ClpULong i = 0; i < uiSize; i++ )
       {
-        v = *pInput[i]++;
-        sum += v;
-        m_pVariance[y][x] += v * v;
+        std::uint32_t v = pInput[i];
+        puiSum[i] += v;
+        puiSumSquares[i] += v * v;
       }
-      // Final result of the variance for one block
-      m_pVariance[y][x] -= double( sum * sum ) / double( numFrames );
-      m_pVariance[y][x] /= double( numFrames );
-      if( m_pVariance[y][x] > maxVariance )
-        maxVariance = m_pVariance[y][x];
     }
+    computeVariance( apcFrameList.size() );
+    return m_pcFrameVariance;
+  }
 
-  for( unsigned int y = 0; y < m_pcFrameVariance->getHeight(); y++ )
-    for( unsigned int x = 0; x < m_pcFrameVariance->getWidth(); x++ )
+  // Sliding window: add the new frame and remove the one that leaves
+  const ClpPel* pNewest = static_cast<const CalypFrame*>( apcFrameList[0] )->getPelBufferYUV()[0][0];
+  ClpPel* pSlot = m_auiWindowPels.data() + uiSize * m_uiWindowPos;
+  if( m_uiWindowCount == m_uiWindow )
+  {
+    for( ClpULong i = 0; i < uiSize; i++ )
     {
-      *pOutputPelYUV++ = m_pVariance[y][x] * 255 / maxVariance;
+      std::uint32_t uiNew = pNewest[i];
+      std::uint32_t uiOld = pSlot[i];
+      puiSum[i] += uiNew - uiOld;
+      puiSumSquares[i] += std::uint64_t( uiNew * uiNew ) - std::uint64_t( uiOld * uiOld );
     }
-  delete[] pInput;
+  }
+  else
+  {
+    for( ClpULong i = 0; i < uiSize; i++ )
+    {
+      std::uint32_t uiNew = pNewest[i];
+      puiSum[i] += uiNew;
+      puiSumSquares[i] += uiNew * uiNew;
+    }
+    m_uiWindowCount++;
+  }
+  memcpy( pSlot, pNewest, uiSize * sizeof( ClpPel ) );
+  m_uiWindowPos = ( m_uiWindowPos + 1 ) % m_uiWindow;
+
+  computeVariance( m_uiWindowCount );
   return m_pcFrameVariance;
 }
 
 void InterFrameVariance::destroy()
 {
-  if( m_pVariance )
-    freeMem2D( m_pVariance );
-  m_pVariance = NULL;
+  std::vector<std::uint32_t>().swap( m_auiSum );
+  std::vector<std::uint64_t>().swap( m_auiSumSquares );
+  std::vector<std::uint64_t>().swap( m_auiVariance );
+  std::vector<ClpPel>().swap( m_auiWindowPels );
   if( m_pcFrameVariance )
     delete m_pcFrameVariance;
   m_pcFrameVariance = NULL;
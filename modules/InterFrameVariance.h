@@ -28,13 +28,27 @@
 // CalypLib
 #include "lib/CalypModuleIf.h"
 
+#include <cstdint>
+
 class InterFrameVariance : public CalypModuleIf
 {
   REGISTER_CLASS_FACTORY( InterFrameVariance )
 
 private:
   CalypFrame* m_pcFrameVariance;
-  double** m_pVariance;
+  unsigned int m_uiWindow;
+
+  // Sliding window
+  unsigned int m_uiWindowCount;
+  unsigned int m_uiWindowPos;
+  std::vector<ClpPel> m_auiWindowPels;
+
+  // Per pixel sums over the frames and N * sum of squares - sum^2
+  std::vector<std::uint32_t> m_auiSum;
+  std::vector<std::uint64_t> m_auiSumSquares;
+  std::vector<std::uint64_t> m_auiVariance;
+
+  void computeVariance( unsigned int uiNumFrames );
 
 public:
   InterFrameVariance();
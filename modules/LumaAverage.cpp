@@ -37,7 +37,7 @@ LumaAverage::LumaAverage()
   m_uiNumberOfFrames = 1;                                        // Number of Frames required
                                                                  // (ONE_FRAME, TWO_FRAMES,
                                                                  // THREE_FRAMES)
-  m_uiModuleRequirements = CLP_MODULE_REQUIRES_NOTHING;          // Module requirements
+  m_uiModuleRequirements = CLP_MODULE_FRAME_INDEPENDENT;         // Module requirements
                                                                  // (check
                                                                  // CalypModulesIf.h).
   // Several requirements should be "or" between each others.
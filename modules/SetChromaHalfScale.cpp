@@ -33,7 +33,7 @@ SetChromaHalfScale::SetChromaHalfScale()
   m_pchModuleLongName = "Half scale chroma";
   m_pchModuleTooltip = "Copy frame only keeping luma component";
   m_uiNumberOfFrames = 1;
-  m_uiModuleRequirements = CLP_MODULE_REQUIRES_NOTHING;
+  m_uiModuleRequirements = CLP_MODULE_FRAME_INDEPENDENT;
 
   m_pcProcessedFrame = NULL;
 }
@@ -54,8 +54,8 @@ CalypFrame* SetChromaHalfScale::process( CalypFrame* frame )
   {
     *pPelOut++ = *pPelInput++;
   }
-  pPelInput = frame->getPelBufferYUV()[CLP_CHROMA_U][0];
-  for( unsigned int i = 0; i < m_pcProcessedFrame->getChromaLength() * 2; i++ )
+  // Formats without chroma (e.g., gray) only have the luma plane
+  for( unsigned int i = 0; i < m_pcProcessedFrame->getChromaLength() * ( m_pcProcessedFrame->getNumberChannels() > 1 ? 2 : 0 ); i++ )
   {
     *pPelOut++ = halfScaleValue;
   }
@@ -23,15 +23,10 @@
 
 #include "ThreeSixtyFaceConcatenation.h"
 
-#include <opencv2/core/core.hpp>
-#include <opencv2/imgproc.hpp>
+#include "lib/CalypPlaneKernels.h"
 
-using cv::InputArray;
-using cv::Mat;
-using cv::OutputArray;
-using cv::Point;
-using cv::Rect;
-using cv::Size;
+#include <cassert>
+#include <utility>
 
 ThreeSixtyFaceConcatenation::ThreeSixtyFaceConcatenation()
 {
@@ -48,12 +43,14 @@ ThreeSixtyFaceConcatenation::ThreeSixtyFaceConcatenation()
   m_cModuleOptions.addOptions()                                                            /**/
       ( "projection", m_uiProjectionType, "Projection [1] \n 1: Cubemap (6 faces)" )       /**/
       ( "partitions", m_uiNumberOfPartitionsPerFace, "Number of partitions per face [1]" ) /**/
+      ( "rotation", m_iRotation, "Rotation to undo on the faces (0, 90, 180, 270) [0]" )   /**/
       ;
 
   m_uiProjectionType = 1;
   m_uiNumberOfPartitionsPerFace = 1;
   m_uiFacesX = 0;
   m_uiFacesY = 0;
+  m_iRotation = 0;
 
   m_pcTmpFrame = NULL;
 }
@@ -80,8 +77,21 @@ bool ThreeSixtyFaceConcatenation::create( std::vector<CalypFrame*> apcFrameList
     assert( 0 );
   }
 
-  unsigned int width = apcFrameList[0]->getWidth() * m_uiFacesX;
-  unsigned int height = apcFrameList[0]->getHeight() * m_uiFacesY;
+  if( apcFrameList.size() != m_uiFacesX * m_uiFacesY )
+    return false;
+
+  if( m_iRotation != 0 && m_iRotation != 90 && m_iRotation != 180 && m_iRotation != 270 )
+    return false;
+
+  unsigned int faceWidth = apcFrameList[0]->getWidth();
+  unsigned int faceHeight = apcFrameList[0]->getHeight();
+  if( m_iRotation == 90 || m_iRotation == 270 )
+    std::swap( faceWidth, faceHeight );
+  if( m_iRotation )
+    m_pcTmpFrame = new CalypFrame( faceWidth, faceHeight, apcFrameList[0]->getPelFormat(), apcFrameList[0]->getBitsPel() );
+
+  unsigned int width = faceWidth * m_uiFacesX;
+  unsigned int height = faceHeight * m_uiFacesY;
 
   m_pcOutputFrame = new CalypFrame( width, height, apcFrameList[0]->getPelFormat(), apcFrameList[0]->getBitsPel() );
 
@@ -98,6 +108,12 @@ CalypFrame* ThreeSixtyFaceConcatenation::process( std::vector<CalypFrame*> apcFr
     for( unsigned i = 0; i < m_uiFacesX * m_uiFacesY; i++ )
     {
       CalypFrame* pcFrame = apcFrameList[i];
+      if( m_pcTmpFrame )
+      {
+        // Undo the clockwise rotation applied by ThreeSixtyFaceExtraction
+        CalypPlaneKernels::rotate( m_pcTmpFrame, pcFrame, ( 360 - m_iRotation ) % 360 );
+        pcFrame = m_pcTmpFrame;
+      }
       unsigned x = i % m_uiFacesX * pcFrame->getWidth();
       unsigned y = i / m_uiFacesX * pcFrame->getHeight();
       m_pcOutputFrame->copyTo( pcFrame, x, y );
@@ -115,4 +131,8 @@ void ThreeSixtyFaceConcatenation::destroy()
   if( m_pcOutputFrame )
     delete m_pcOutputFrame;
   m_pcOutputFrame = NULL;
+
+  if( m_pcTmpFrame )
+    delete m_pcTmpFrame;
+  m_pcTmpFrame = NULL;
 }
@@ -37,6 +37,7 @@ private:
   unsigned m_uiNumberOfPartitionsPerFace;
   unsigned m_uiFacesX;
   unsigned m_uiFacesY;
+  int m_iRotation;
 
 public:
   ThreeSixtyFaceConcatenation();
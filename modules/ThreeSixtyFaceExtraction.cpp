@@ -23,15 +23,10 @@
 
 #include "ThreeSixtyFaceExtraction.h"
 
-#include <opencv2/core/core.hpp>
-#include <opencv2/imgproc.hpp>
+#include "lib/CalypPlaneKernels.h"
 
-using cv::InputArray;
-using cv::Mat;
-using cv::OutputArray;
-using cv::Point;
-using cv::Rect;
-using cv::Size;
+#include <cassert>
+#include <utility>
 
 ThreeSixtyFaceExtraction::ThreeSixtyFaceExtraction()
 {
@@ -49,6 +44,7 @@ ThreeSixtyFaceExtraction::ThreeSixtyFaceExtraction()
       ( "faceNum", m_uiFaceNum, "360 proejction face to be outputed [0]" )                 /**/
       ( "projection", m_uiProjectionType, "Projection [1] \n 1: Cubemap" )                 /**/
       ( "partitions", m_uiNumberOfPartitionsPerFace, "Number of partitions per face [1]" ) /**/
+      ( "rotation", m_iRotation, "Clockwise rotation of the face (0, 90, 180, 270) [0]" )  /**/
       ;
 
   m_uiFaceNum = 2;
@@ -56,6 +52,7 @@ ThreeSixtyFaceExtraction::ThreeSixtyFaceExtraction()
   m_uiNumberOfPartitionsPerFace = 1;
   m_uiFacesX = 0;
   m_uiFacesY = 0;
+  m_iRotation = 0;
 
   m_pcTmpFrame = NULL;
 }
@@ -74,9 +71,18 @@ bool ThreeSixtyFaceExtraction::create( std::vector<CalypFrame*> apcFrameList )
     assert( 0 );
   }
 
+  if( m_iRotation != 0 && m_iRotation != 90 && m_iRotation != 180 && m_iRotation != 270 )
+    return false;
+
   unsigned int width = apcFrameList[0]->getWidth() / m_uiFacesX;
   unsigned int height = apcFrameList[0]->getHeight() / m_uiFacesY;
 
+  if( m_iRotation )
+  {
+    m_pcTmpFrame = new CalypFrame( width, height, apcFrameList[0]->getPelFormat(), apcFrameList[0]->getBitsPel() );
+    if( m_iRotation != 180 )
+      std::swap( width, height );
+  }
   m_pcOutputFrame = new CalypFrame( width, height, apcFrameList[0]->getPelFormat(), apcFrameList[0]->getBitsPel() );
 
   return true;
@@ -86,20 +92,23 @@ CalypFrame* ThreeSixtyFaceExtraction::process( std::vector<CalypFrame*> apcFrame
 {
   m_pcOutputFrame->reset();
 
+  CalypFrame* pcFace = m_pcTmpFrame ? m_pcTmpFrame : m_pcOutputFrame;
   unsigned x = -1;
   unsigned y = -1;
 
   switch( m_uiProjectionType )
   {
   case 1: // Cube-map
-    x = m_uiFaceNum % m_uiFacesX * m_pcOutputFrame->getWidth();
-    y = ( m_uiFaceNum / m_uiFacesX ) * m_pcOutputFrame->getHeight();
+    x = m_uiFaceNum % m_uiFacesX * pcFace->getWidth();
+    y = ( m_uiFaceNum / m_uiFacesX ) * pcFace->getHeight();
     break;
   default:
     assert( 0 );
   }
 
-  m_pcOutputFrame->copyFrom( apcFrameList[0], x, y );
+  pcFace->copyFrom( apcFrameList[0], x, y );
+  if( m_pcTmpFrame )
+    CalypPlaneKernels::rotate( m_pcOutputFrame, m_pcTmpFrame, m_iRotation );
   return m_pcOutputFrame;
 }
 
@@ -108,4 +117,8 @@ void ThreeSixtyFaceExtraction::destroy()
   if( m_pcOutputFrame )
     delete m_pcOutputFrame;
   m_pcOutputFrame = NULL;
+
+  if( m_pcTmpFrame )
+    delete m_pcTmpFrame;
+  m_pcTmpFrame = NULL;
 }
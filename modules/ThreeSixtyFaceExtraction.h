@@ -38,6 +38,7 @@ private:
   unsigned m_uiNumberOfPartitionsPerFace;
   unsigned m_uiFacesX;
   unsigned m_uiFacesY;
+  int m_iRotation;
 
 public:
   ThreeSixtyFaceExtraction();
@@ -0,0 +1,212 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * \file     ThreeSixtyProjectionConversion.cpp
+ * \brief    Conversion between 360 video projections
+ */
+
+#include "ThreeSixtyProjectionConversion.h"
+
+#include "lib/CalypRemap.h"
+
+#include <algorithm>
+#include <cmath>
+
+enum ThreeSixtyProjection
+{
+  EQUIRECTANGULAR = 0,
+  CUBEMAP = 1,  //!< 3x2 faces: left, front, right / bottom, back, top
+};
+
+static const double s_dPi = 3.14159265358979323846;
+
+/**
+ * Directions on the sphere: x to the right, y up and z to the front.
+ * Positions are in luma samples with the centre of sample i at i
+ */
+
+static void equirectangularToSphere( double dX, double dY, unsigned int uiWidth, unsigned int uiHeight, double adDir[3] )
+{
+  double dLongitude = ( ( dX + 0.5 ) / uiWidth - 0.5 ) * 2 * s_dPi;
+  double dLatitude = ( 0.5 - ( dY + 0.5 ) / uiHeight ) * s_dPi;
+  adDir[0] = std::cos( dLatitude ) * std::sin( dLongitude );
+  adDir[1] = std::sin( dLatitude );
+  adDir[2] = std::cos( dLatitude ) * std::cos( dLongitude );
+}
+
+static void sphereToEquirectangular( const double adDir[3], unsigned int uiWidth, unsigned int uiHeight, double& rdX,
+                                     double& rdY )
+{
+  double dLongitude = std::atan2( adDir[0], adDir[2] );
+  double dLatitude = std::atan2( adDir[1], std::sqrt( adDir[0] * adDir[0] + adDir[2] * adDir[2] ) );
+  rdX = ( dLongitude / ( 2 * s_dPi ) + 0.5 ) * uiWidth - 0.5;
+  rdY = ( 0.5 - dLatitude / s_dPi ) * uiHeight - 0.5;
+}
+
+/**
+ * Cube faces: ( dA, dB ) in [-1, 1] are the face coordinates to the
+ * right and down as the face is laid out in the frame
+ */
+static void cubemapToSphere( double dX, double dY, unsigned int uiFaceSize, double adDir[3] )
+{
+  int iCol = std::min( std::max( int( ( dX + 0.5 ) / uiFaceSize ), 0 ), 2 );
+  int iRow = std::min( std::max( int( ( dY + 0.5 ) / uiFaceSize ), 0 ), 1 );
+  double dA = 2 * ( dX - iCol * uiFaceSize + 0.5 ) / uiFaceSize - 1;
+  double dB = 2 * ( dY - iRow * uiFaceSize + 0.5 ) / uiFaceSize - 1;
+  double adFaces[6][3] = {
+      { -1, -dB, dA },  // left
+      { dA, -dB, 1 },   // front
+      { 1, -dB, -dA },  // right
+      { dA, -1, -dB },  // bottom
+      { -dA, -dB, -1 }, // back
+      { dA, 1, dB },    // top
+  };
+  std::copy( adFaces[iRow * 3 + iCol], adFaces[iRow * 3 + iCol] + 3, adDir );
+}
+
+static void sphereToCubemap( const double adDir[3], unsigned int uiFaceSize, double& rdX, double& rdY )
+{
+  double dAbsX = std::fabs( adDir[0] );
+  double dAbsY = std::fabs( adDir[1] );
+  double dAbsZ = std::fabs( adDir[2] );
+  int iFace;
+  double dA, dB;
+  if( dAbsX >= dAbsY && dAbsX >= dAbsZ )
+  {
+    iFace = adDir[0] > 0 ? 2 : 0;
+    dA = ( adDir[0] > 0 ? -adDir[2] : adDir[2] ) / dAbsX;
+    dB = -adDir[1] / dAbsX;
+  }
+  else if( dAbsY >= dAbsZ )
+  {
+    iFace = adDir[1] > 0 ? 5 : 3;
+    dA = adDir[0] / dAbsY;
+    dB = ( adDir[1] > 0 ? adDir[2] : -adDir[2] ) / dAbsY;
+  }
+  else
+  {
+    iFace = adDir[2] > 0 ? 1 : 4;
+    dA = ( adDir[2] > 0 ? adDir[0] : -adDir[0] ) / dAbsZ;
+    dB = -adDir[1] / dAbsZ;
+  }
+  // Positions stay in the face (the remap also keeps the interpolation
+  // of each plane inside it)
+  double dMax = uiFaceSize - 1;
+  rdX = ( iFace % 3 ) * uiFaceSize + std::min( std::max( ( dA + 1 ) * uiFaceSize / 2 - 0.5, 0.0 ), dMax );
+  rdY = ( iFace / 3 ) * uiFaceSize + std::min( std::max( ( dB + 1 ) * uiFaceSize / 2 - 0.5, 0.0 ), dMax );
+}
+
+ThreeSixtyProjectionConversion::ThreeSixtyProjectionConversion()
+{
+  /* Module Definition */
+  m_iModuleAPI = CLP_MODULE_API_4;
+  m_iModuleType = CLP_FRAME_PROCESSING_MODULE;
+  m_pchModuleCategory = "360Video";
+  m_pchModuleLongName = "Projection Conversion";
+  m_pchModuleName = "ThreeSixtyProjectionConversion";
+  m_pchModuleTooltip = "Convert a 360 video to another projection";
+  m_uiNumberOfFrames = 1;
+  m_uiModuleRequirements = CLP_MODULE_REQUIRES_OPTIONS | CLP_MODULE_FRAME_INDEPENDENT | CLP_MODULE_REENTRANT;
+
+  m_cModuleOptions.addOptions()                                                                           /**/
+      ( "input", m_uiInputProjection, "Input projection [0] \n 0: Equirectangular \n 1: Cubemap 3x2" )    /**/
+      ( "output", m_uiOutputProjection, "Output projection [1] \n 0: Equirectangular \n 1: Cubemap 3x2" ) /**/
+      ( "width", m_iWidth, "Width of the output (the height follows the projection) [-1]" )               /**/
+      ( "Interpolation", m_iInterpolation, "Interpolation method (1: nearest, 2: bilinear) [2]" );
+
+  m_uiInputProjection = EQUIRECTANGULAR;
+  m_uiOutputProjection = CUBEMAP;
+  m_iWidth = -1;
+  m_iInterpolation = 2;
+  m_pcRemap = NULL;
+}
+
+bool ThreeSixtyProjectionConversion::create( std::vector<CalypFrame*> apcFrameList )
+{
+  _BASIC_MODULE_API_2_CHECK_
+
+  if( m_uiInputProjection > CUBEMAP || m_uiOutputProjection > CUBEMAP )
+    return false;
+
+  unsigned int uiSrcWidth = apcFrameList[0]->getWidth();
+  unsigned int uiSrcHeight = apcFrameList[0]->getHeight();
+  unsigned int uiSrcFaceSize = uiSrcWidth / 3;
+
+  // By default the faces have a quarter of the equirectangular width
+  unsigned int uiWidth = m_iWidth;
+  if( m_iWidth <= 0 )
+  {
+    uiWidth = uiSrcWidth;
+    if( m_uiInputProjection == EQUIRECTANGULAR && m_uiOutputProjection == CUBEMAP )
+      uiWidth = 3 * ( uiSrcWidth / 4 );
+    else if( m_uiInputProjection == CUBEMAP && m_uiOutputProjection == EQUIRECTANGULAR )
+      uiWidth = 4 * uiSrcFaceSize;
+  }
+  // Faces are aligned with the chroma samples
+  unsigned int uiLog2Chroma = std::max( apcFrameList[0]->getChromaWidthRatio(), apcFrameList[0]->getChromaHeightRatio() );
+  unsigned int uiFaceSize = ( uiWidth / 3 ) >> uiLog2Chroma << uiLog2Chroma;
+  unsigned int uiHeight = m_uiOutputProjection == CUBEMAP ? 2 * uiFaceSize : uiWidth / 2;
+  if( m_uiOutputProjection == CUBEMAP )
+    uiWidth = 3 * uiFaceSize;
+  if( !uiWidth || !uiHeight || ( m_uiInputProjection == CUBEMAP && !uiSrcFaceSize ) )
+    return false;
+
+  unsigned int uiInputProjection = m_uiInputProjection;
+  unsigned int uiOutputProjection = m_uiOutputProjection;
+  auto fnMap = [=]( double dX, double dY, double& rdSrcX, double& rdSrcY ) {
+    double adDir[3];
+    if( uiOutputProjection == CUBEMAP )
+      cubemapToSphere( dX, dY, uiFaceSize, adDir );
+    else
+      equirectangularToSphere( dX, dY, uiWidth, uiHeight, adDir );
+    if( uiInputProjection == CUBEMAP )
+      sphereToCubemap( adDir, uiSrcFaceSize, rdSrcX, rdSrcY );
+    else
+      sphereToEquirectangular( adDir, uiSrcWidth, uiSrcHeight, rdSrcX, rdSrcY );
+  };
+
+  // Interpolation wraps around the longitude and does not cross the faces
+  delete m_pcRemap;
+  m_pcRemap = new CalypRemap;
+  if( uiInputProjection == CUBEMAP )
+    m_pcRemap->setRegionSize( uiSrcFaceSize, uiSrcFaceSize );
+  else
+    m_pcRemap->setHorizontalWrap( true );
+  if( !m_pcRemap->create( uiWidth, uiHeight, uiSrcWidth, uiSrcHeight, apcFrameList[0]->getPelFormat(), fnMap,
+                          m_iInterpolation == 1 ? CLP_REMAP_NEAREST : CLP_REMAP_BILINEAR ) )
+    return false;
+
+  setOutputFormat( uiWidth, uiHeight, apcFrameList[0]->getPelFormat(), apcFrameList[0]->getBitsPel() );
+  return true;
+}
+
+bool ThreeSixtyProjectionConversion::process( std::vector<CalypFrame*> apcFrameList, CalypFrame* pcOutput )
+{
+  return m_pcRemap->remap( pcOutput, apcFrameList[0] );
+}
+
+void ThreeSixtyProjectionConversion::destroy()
+{
+  delete m_pcRemap;
+  m_pcRemap = NULL;
+  if( m_pcOutputFrame )
+    delete m_pcOutputFrame;
+  m_pcOutputFrame = NULL;
+}
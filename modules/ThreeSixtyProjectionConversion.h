@@ -0,0 +1,52 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * \file     ThreeSixtyProjectionConversion.h
+ * \brief    Conversion between 360 video projections
+ */
+
+#ifndef __THREESIXTYPROJECTIONCONVERSION_H__
+#define __THREESIXTYPROJECTIONCONVERSION_H__
+
+// CalypLib
+#include "lib/CalypModuleIf.h"
+
+class CalypRemap;
+
+class ThreeSixtyProjectionConversion : public CalypModuleIf
+{
+  REGISTER_CLASS_FACTORY( ThreeSixtyProjectionConversion )
+
+private:
+  unsigned int m_uiInputProjection;
+  unsigned int m_uiOutputProjection;
+  int m_iWidth;
+  int m_iInterpolation;
+  CalypRemap* m_pcRemap;
+
+public:
+  ThreeSixtyProjectionConversion();
+  virtual ~ThreeSixtyProjectionConversion() {}
+  bool create( std::vector<CalypFrame*> apcFrameList );
+  bool process( std::vector<CalypFrame*> apcFrameList, CalypFrame* pcOutput );
+  void destroy();
+};
+
+#endif  // __THREESIXTYPROJECTIONCONVERSION_H__
@@ -35,7 +35,7 @@ WeightedPSNR::WeightedPSNR()
   m_pchModuleName = "WeightedPSNR";
   m_pchModuleLongName = "Weighted PSNR";
   m_pchModuleTooltip = "Measure the weighted PSNR between two images";
-  m_uiModuleRequirements = CLP_MODULE_REQUIRES_OPTIONS;
+  m_uiModuleRequirements = CLP_MODULE_REQUIRES_OPTIONS | CLP_MODULE_FRAME_INDEPENDENT;
   m_uiNumberOfFrames = 3;
 
   m_cModuleOptions.addOptions() /**/
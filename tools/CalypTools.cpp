@@ -24,15 +24,33 @@
 
 #include "CalypTools.h"
 
+#include <algorithm>
+#include <chrono>
 #include <climits>
 #include <cstring>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <sstream>
 
 #include "config.h"
 #include "lib/CalypFrame.h"
+#include "lib/CalypMemory.h"
 #include "lib/CalypModuleIf.h"
+#include "lib/CalypMultiStreamReader.h"
+#include "lib/CalypStats.h"
 #include "lib/CalypStream.h"
+#include "lib/CalypThreadPool.h"
 #include "modules/CalypModulesFactory.h"
+#include "CalypToolsPipeline.h"
+
+//! Decoded frames of each input kept for the other jobs of a batch
+#define BATCH_SHARED_CACHE_MB 64
+//! Frames waiting between two stages of a pipeline
+#define PIPELINE_QUEUE_SIZE 4
+//! Minimum duration of each benchmark measurement (seconds)
+#define BENCHMARK_MIN_TIME 0.25
 
 CalypTools::CalypTools()
 {
@@ -43,10 +61,17 @@ CalypTools::CalypTools()
   m_uiQualityMetric = -1;
 
   m_pcCurrModuleIf = NULL;
+  m_pcInputReader = NULL;
+  m_pcPipeline = NULL;
+  m_bBatchJob = false;
+  m_iArgc = 0;
+  m_ppchArgv = NULL;
 }
 
 CalypTools::~CalypTools()
 {
+  delete m_pcPipeline;
+  delete m_pcInputReader;
   for( unsigned int i = 0; i < m_apcInputStreams.size(); i++ )
   {
     m_apcInputStreams[i]->close();
@@ -112,6 +137,8 @@ int CalypTools::openInputs()
         hasNegativeValues = std::stoi( GET_PARAM( m_strHasNegativeValues, i ).c_str() ) == 0 ? false : true;
       }
       pcStream = new CalypStream;
+      if( m_bBatchJob )
+        pcStream->setCacheSize( BATCH_SHARED_CACHE_MB, true );
       try
       {
         if( !pcStream->open( inputFileNames[i], resolutionString, fmtString, uiBitsPerPixel, uiEndianness, hasNegativeValues, 1, true ) )
@@ -128,7 +155,41 @@ int CalypTools::openInputs()
         log( CLP_LOG_ERROR, "Cannot open input stream %s with the following error: \n%s\n", inputFileNames[i].c_str(), msg );
         return -1;
       }
+      catch( CalypFailure& e )
+      {
+        log( CLP_LOG_ERROR, "Cannot open input stream %s with the following error: \n%s\n", inputFileNames[i].c_str(), e.what() );
+        delete pcStream;
+        return -1;
+      }
+    }
+  }
+
+  /**
+   * Frame selection: unselected frames are skipped by the streams
+   */
+  if( Opts().hasOpt( "frame_list" ) )
+  {
+    std::stringstream cFrameList( m_strFrameList );
+    ClpString strFrame;
+    while( std::getline( cFrameList, strFrame, ',' ) )
+    {
+      if( !strFrame.empty() )
+        m_auiFrameList.push_back( std::stoul( strFrame ) );
     }
+    std::sort( m_auiFrameList.begin(), m_auiFrameList.end() );
+    m_auiFrameList.erase( std::unique( m_auiFrameList.begin(), m_auiFrameList.end() ), m_auiFrameList.end() );
+    for( unsigned int i = 0; i < m_apcInputStreams.size(); i++ )
+      m_apcInputStreams[i]->setFrameSelection( m_auiFrameList );
+  }
+  else if( Opts().hasOpt( "start" ) || Opts().hasOpt( "step" ) )
+  {
+    if( m_iStartFrame < 0 || m_iFrameStep <= 0 )
+    {
+      log( CLP_LOG_ERROR, "Invalid frame selection! " );
+      return -1;
+    }
+    for( unsigned int i = 0; i < m_apcInputStreams.size(); i++ )
+      m_apcInputStreams[i]->setFrameSelection( m_iStartFrame, 0, m_iFrameStep );
   }
 
   m_uiNumberOfFrames = -1;
@@ -140,11 +201,14 @@ int CalypTools::openInputs()
   m_uiNumberOfComponents = -1;
   for( unsigned int i = 0; i < m_apcInputStreams.size(); i++ )
   {
-    m_uiNumberOfFrames = std::min( m_uiNumberOfFrames, m_apcInputStreams[i]->getFrameNum() );
+    m_uiNumberOfFrames = std::min( m_uiNumberOfFrames, m_apcInputStreams[i]->getNumberOfSelectedFrames() );
     m_uiNumberOfComponents =
         std::min( m_uiNumberOfComponents, m_apcInputStreams[i]->getCurrFrame()->getNumberChannels() );
   }
 
+  // All inputs are advanced together
+  m_pcInputReader = new CalypMultiStreamReader( m_apcInputStreams );
+
   return 0;
 }
 
@@ -152,7 +216,11 @@ int CalypTools::Open( int argc, char* argv[] )
 {
   int iRet = 0;
 
-  log( CLP_LOG_ERROR, "calypTools - The command line interface for Calyp modules! \n" );
+  m_iArgc = argc;
+  m_ppchArgv = argv;
+
+  if( !m_bBatchJob )
+    log( CLP_LOG_ERROR, "calypTools - The command line interface for Calyp modules! \n" );
 
   // check requirements
   if( CalypPixel::getMaxNumberOfComponents() > MAX_NUMBER_CHANNELS )
@@ -169,6 +237,36 @@ int CalypTools::Open( int argc, char* argv[] )
     return iRet;
   }
 
+  if( Opts().hasOpt( "stats" ) && !m_bBatchJob )
+  {
+    CalypStats::reset();
+    CalypStats::setEnabled( true );
+  }
+  if( m_iMemoryBudget > 0 && !m_bBatchJob )
+  {
+    CalypMemory::setBudget( ClpULong( m_iMemoryBudget ) * 1024 * 1024 );
+  }
+
+  /**
+   * Batch of jobs (the inputs are opened by each job)
+   */
+  if( Opts().hasOpt( "batch" ) )
+  {
+    if( m_bBatchJob )
+    {
+      log( CLP_LOG_ERROR, "Batch jobs cannot run other batches! " );
+      return -1;
+    }
+    if( ( iRet = parseBatchManifest() ) < 0 )
+    {
+      return iRet;
+    }
+    m_uiOperation = BATCH_OPERATION;
+    m_fpProcess = &CalypTools::BatchOperation;
+    log( CLP_LOG_INFO, "Calyp Batch (%d jobs)\n", m_aastrBatchJobs.size() );
+    return iRet;
+  }
+
   if( ( iRet = openInputs() ) < 0 )
   {
     return iRet;
@@ -246,6 +344,21 @@ int CalypTools::Open( int argc, char* argv[] )
     if( Opts().hasOpt( "output" ) )
       m_pcOutputFileNames.push_back( m_strOutput );
 
+    // Dropped frames are skipped by the input stream instead of being read,
+    // keeping one in every m_iRateReductionFactor of the selected frames
+    if( !m_auiFrameList.empty() )
+    {
+      std::vector<ClpULong> auiFrames;
+      for( std::size_t i = 0; i < m_auiFrameList.size(); i += m_iRateReductionFactor )
+        auiFrames.push_back( m_auiFrameList[i] );
+      m_apcInputStreams[0]->setFrameSelection( auiFrames );
+    }
+    else
+    {
+      m_apcInputStreams[0]->setFrameSelection( m_iStartFrame, 0, m_iFrameStep * m_iRateReductionFactor );
+    }
+    m_uiNumberOfFrames = ( m_uiNumberOfFrames + m_iRateReductionFactor - 1 ) / m_iRateReductionFactor;
+
     CalypFrame* pcInputFrame = m_apcInputStreams[0]->getCurrFrame();
     CalypStream* pcOutputStream = new CalypStream;
     try
@@ -301,6 +414,13 @@ int CalypTools::Open( int argc, char* argv[] )
       log( CLP_LOG_ERROR, "Invalid quality metric! " );
       return -1;
     }
+    if( m_bLumaOnly )
+    {
+      // Chroma planes are not even read from the files
+      m_uiNumberOfComponents = 1;
+      for( unsigned int i = 0; i < m_apcInputStreams.size(); i++ )
+        m_apcInputStreams[i]->setReadMask( 1 << CLP_LUMA );
+    }
     m_uiOperation = QUALITY_OPERATION;
     m_fpProcess = &CalypTools::QualityOperation;
     log( CLP_LOG_INFO, "Calyp Quality\n" );
@@ -351,6 +471,7 @@ int CalypTools::Open( int argc, char* argv[] )
     {
       apcFrameList.push_back( m_apcInputStreams[i]->getCurrFrame() );
     }
+    CalypMemoryScope cMemoryScope( CLP_MEMORY_MODULE );
     if( m_pcCurrModuleIf->m_iModuleAPI >= CLP_MODULE_API_2 )
     {
       moduleCreated = m_pcCurrModuleIf->create( apcFrameList );
@@ -419,6 +540,30 @@ int CalypTools::Open( int argc, char* argv[] )
     log( CLP_LOG_INFO, "Calyp Module\n" );
   }
 
+  /**
+   * Check Benchmark operation (synthetic frames, no inputs)
+   */
+  if( Opts().hasOpt( "benchmark" ) )
+  {
+    m_uiOperation = BENCHMARK_OPERATION;
+    m_fpProcess = &CalypTools::BenchmarkOperation;
+    log( CLP_LOG_INFO, "Calyp Benchmark\n" );
+  }
+
+  /**
+   * Check Pipeline operation
+   */
+  if( Opts().hasOpt( "pipeline" ) )
+  {
+    if( ( iRet = parsePipeline() ) < 0 )
+    {
+      return iRet;
+    }
+    m_uiOperation = PIPELINE_OPERATION;
+    m_fpProcess = &CalypTools::PipelineOperation;
+    log( CLP_LOG_INFO, "Calyp Pipeline\n" );
+  }
+
   if( m_uiOperation == INVALID_OPERATION )
   {
     log( CLP_LOG_ERROR, "No operation was selected! " );
@@ -435,6 +580,10 @@ int CalypTools::Process()
 int CalypTools::Close()
 {
   // Finish
+  if( Opts().hasOpt( "stats" ) && !m_bBatchJob )
+  {
+    log( CLP_LOG_RESULT, "\n  Statistics: \n%s\n%s", CalypStats::report().c_str(), CalypMemory::report().c_str() );
+  }
   return 0;
 }
 
@@ -460,17 +609,14 @@ int CalypTools::RateReductionOperation()
   log( CLP_LOG_INFO, "\n Reducing frame rate by a factor of %d ... ", m_iRateReductionFactor );
   for( unsigned int frame = 0; frame < m_uiNumberOfFrames; frame++ )
   {
-    log( CLP_LOG_INFO, "\n Reading frame %d ... ", frame );
-    if( ( frame % m_iRateReductionFactor ) == 0 )
-    {
-      log( CLP_LOG_INFO, "Writing", frame );
-      m_apcOutputStreams[0]->writeFrame( m_apcInputStreams[0]->getCurrFrame() );
-    }
+    log( CLP_LOG_INFO, "\n Writing frame %ld ... ", m_apcInputStreams[0]->getCurrFrameNum() );
+    m_apcOutputStreams[0]->writeFrame( m_apcInputStreams[0]->getCurrFrame() );
     abEOF = m_apcInputStreams[0]->setNextFrame();
-    if( !abEOF )
+    if( abEOF )
     {
-      m_apcInputStreams[0]->readNextFrame();
+      break;
     }
+    m_apcInputStreams[0]->readNextFrame();
   }
   return 0;
 }
@@ -479,7 +625,6 @@ int CalypTools::QualityOperation()
 {
   const char* pchQualityMetricName = CalypFrame::supportedQualityMetricsList()[m_uiQualityMetric].c_str();
   CalypFrame* apcCurrFrame[MAX_NUMBER_INPUTS];
-  bool abEOF[MAX_NUMBER_INPUTS];
   double adAverageQuality[MAX_NUMBER_INPUTS - 1][MAX_NUMBER_CHANNELS];
   double dQuality;
 
@@ -519,7 +664,6 @@ int CalypTools::QualityOperation()
 
   for( unsigned int s = 0; s < m_apcInputStreams.size(); s++ )
   {
-    abEOF[s] = false;
     for( unsigned int c = 0; c < m_uiNumberOfComponents; c++ )
     {
       adAverageQuality[s][c] = 0;
@@ -527,6 +671,7 @@ int CalypTools::QualityOperation()
   }
   for( unsigned int frame = 0; frame < m_uiNumberOfFrames; frame++ )
   {
+    bool bEndOfStreams = false;
     log( CLP_LOG_INFO, "  %3d  ", frame );
     for( unsigned int s = 0; s < m_apcInputStreams.size(); s++ )
       apcCurrFrame[s] = m_apcInputStreams[s]->getCurrFrame();
@@ -543,13 +688,11 @@ int CalypTools::QualityOperation()
       log( CLP_LOG_RESULT, " " );
     }
     log( CLP_LOG_RESULT, "\n" );
-    for( unsigned int s = 0; s < m_apcInputStreams.size(); s++ )
+    bEndOfStreams = !m_pcInputReader->readNextFrames();
+    // Streams from pipes only report their length when the end is reached
+    if( bEndOfStreams )
     {
-      abEOF[s] = m_apcInputStreams[s]->setNextFrame();
-      if( !abEOF[s] )
-      {
-        m_apcInputStreams[s]->readNextFrame();
-      }
+      break;
     }
   }
   log( CLP_LOG_INFO, "\n  Mean Values: \n         " );
@@ -580,15 +723,9 @@ std::vector<CalypFrame*> CalypTools::readInput()
   std::vector<CalypFrame*> apcFrameList;
   apcFrameList.clear();
   // Check EOF and read next frame
-  bool abEOF[MAX_NUMBER_INPUTS];
-  for( unsigned int s = 0; s < m_apcInputStreams.size(); s++ )
+  if( !m_pcInputReader->readNextFrames() )
   {
-    abEOF[s] = m_apcInputStreams[s]->setNextFrame();
-    if( abEOF[s] )
-    {
-      return apcFrameList;
-    }
-    m_apcInputStreams[s]->readNextFrame();
+    return apcFrameList;
   }
   for( unsigned int i = 0; i < m_pcCurrModuleIf->m_uiNumberOfFrames; i++ )
   {
@@ -599,6 +736,14 @@ std::vector<CalypFrame*> CalypTools::readInput()
 
 int CalypTools::ModuleOperation()
 {
+  // Frames are independent: process several at once
+  if( ( m_pcCurrModuleIf->m_uiModuleRequirements & CLP_MODULE_FRAME_INDEPENDENT ) &&
+      m_pcCurrModuleIf->m_iModuleAPI != CLP_MODULE_API_3 &&
+      ( m_iNumberOfThreads > 1 || ( m_iNumberOfThreads == 0 && CalypThreadPool::defaultNumberOfThreads() > 1 ) ) )
+  {
+    return ParallelModuleOperation();
+  }
+
   log( CLP_LOG_INFO, "  Applying Module %s/%s ...\n", m_pcCurrModuleIf->m_pchModuleCategory,
        m_pcCurrModuleIf->m_pchModuleName );
 
@@ -618,10 +763,14 @@ int CalypTools::ModuleOperation()
     bool bReadFrame = true;
     if( m_pcCurrModuleIf->m_iModuleType == CLP_FRAME_PROCESSING_MODULE )
     {
-      if( m_pcCurrModuleIf->m_iModuleAPI >= CLP_MODULE_API_2 )
-        pcProcessedFrame = m_pcCurrModuleIf->process( apcFrameList );
-      else
-        pcProcessedFrame = m_pcCurrModuleIf->process( m_apcInputStreams[0]->getCurrFrame() );
+      {
+        CalypStatsTimer cTimer( CLP_STATS_MODULE );
+        CalypMemoryScope cMemoryScope( CLP_MEMORY_MODULE );
+        if( m_pcCurrModuleIf->m_iModuleAPI >= CLP_MODULE_API_2 )
+          pcProcessedFrame = m_pcCurrModuleIf->process( apcFrameList );
+        else
+          pcProcessedFrame = m_pcCurrModuleIf->process( m_apcInputStreams[0]->getCurrFrame() );
+      }
 
       if( pcProcessedFrame )
       {
@@ -630,10 +779,14 @@ int CalypTools::ModuleOperation()
     }
     else if( m_pcCurrModuleIf->m_iModuleType == CLP_FRAME_MEASUREMENT_MODULE )
     {
-      if( m_pcCurrModuleIf->m_iModuleAPI >= CLP_MODULE_API_2 )
-        dMeasurementResult = m_pcCurrModuleIf->measure( apcFrameList );
-      else
-        dMeasurementResult = m_pcCurrModuleIf->measure( m_apcInputStreams[0]->getCurrFrame() );
+      {
+        CalypStatsTimer cTimer( CLP_STATS_MODULE );
+        CalypMemoryScope cMemoryScope( CLP_MEMORY_MODULE );
+        if( m_pcCurrModuleIf->m_iModuleAPI >= CLP_MODULE_API_2 )
+          dMeasurementResult = m_pcCurrModuleIf->measure( apcFrameList );
+        else
+          dMeasurementResult = m_pcCurrModuleIf->measure( m_apcInputStreams[0]->getCurrFrame() );
+      }
       log( CLP_LOG_INFO, "   %3d", frame );
       log( CLP_LOG_RESULT, "  %8.3f \n", dMeasurementResult );
       dAveragedMeasurementResult =
@@ -648,10 +801,14 @@ int CalypTools::ModuleOperation()
     {
       apcFrameList = readInput();
       frame++;
+      if( apcFrameList.empty() )
+      {
+        break;
+      }
     }
   }
 
-  if( m_pcCurrModuleIf->m_iModuleAPI >= CLP_MODULE_API_3 )
+  if( m_pcCurrModuleIf->m_iModuleAPI == CLP_MODULE_API_3 )
   {
     while( true )
     {
@@ -672,3 +829,695 @@ int CalypTools::ModuleOperation()
 
   return 0;
 }
+
+/**
+ * Manifest of a batch: one job per line with the same options of
+ * calypTools (quotes group arguments with spaces, # starts a comment)
+ */
+int CalypTools::parseBatchManifest()
+{
+  std::ifstream cManifest( m_strBatchFile.c_str() );
+  if( !cManifest.is_open() )
+  {
+    log( CLP_LOG_ERROR, "Cannot open batch manifest %s! ", m_strBatchFile.c_str() );
+    return -1;
+  }
+  ClpString strLine;
+  while( std::getline( cManifest, strLine ) )
+  {
+    std::vector<ClpString> astrArgs;
+    ClpString strArg;
+    bool bQuoted = false;
+    bool bHasArg = false;
+    for( unsigned int i = 0; i < strLine.size(); i++ )
+    {
+      char c = strLine[i];
+      if( c == '"' )
+      {
+        bQuoted = !bQuoted;
+        bHasArg = true;
+      }
+      else if( !bQuoted && c == '#' )
+      {
+        break;
+      }
+      else if( !bQuoted && isspace( c ) )
+      {
+        if( bHasArg )
+          astrArgs.push_back( strArg );
+        strArg.clear();
+        bHasArg = false;
+      }
+      else
+      {
+        strArg += c;
+        bHasArg = true;
+      }
+    }
+    if( bHasArg )
+      astrArgs.push_back( strArg );
+    if( !astrArgs.empty() )
+      m_aastrBatchJobs.push_back( astrArgs );
+  }
+  if( m_aastrBatchJobs.empty() )
+  {
+    log( CLP_LOG_ERROR, "Batch manifest %s has no jobs! ", m_strBatchFile.c_str() );
+    return -1;
+  }
+  return 0;
+}
+
+int CalypTools::runBatchJob( unsigned int uiJob, ClpString* pstrLog )
+{
+  std::vector<char*> apchArgs;
+  apchArgs.push_back( const_cast<char*>( "calypTools" ) );
+  for( unsigned int i = 0; i < m_aastrBatchJobs[uiJob].size(); i++ )
+    apchArgs.push_back( const_cast<char*>( m_aastrBatchJobs[uiJob][i].c_str() ) );
+  apchArgs.push_back( NULL );
+
+  int iRet = 0;
+  CalypTools cJob;
+  cJob.m_bBatchJob = true;
+  cJob.setLogBuffer( pstrLog );
+  try
+  {
+    iRet = cJob.Open( apchArgs.size() - 1, apchArgs.data() );
+    if( iRet == 0 )
+      iRet = cJob.Process();
+    if( iRet >= 0 )
+      iRet = cJob.Close();
+  }
+  catch( CalypFailure& e )
+  {
+    cJob.log( CLP_LOG_ERROR, "%s\n", e.what() );
+    iRet = -1;
+  }
+  catch( const char* msg )
+  {
+    cJob.log( CLP_LOG_ERROR, "%s\n", msg );
+    iRet = -1;
+  }
+  catch( std::exception& e )
+  {
+    cJob.log( CLP_LOG_ERROR, "%s\n", e.what() );
+    iRet = -1;
+  }
+  catch( ... )
+  {
+    cJob.log( CLP_LOG_ERROR, "Unknown error\n" );
+    iRet = -1;
+  }
+  return iRet;
+}
+
+int CalypTools::BatchOperation()
+{
+  unsigned int uiNumJobs = m_aastrBatchJobs.size();
+  std::vector<ClpString> astrLogs( uiNumJobs );
+  std::vector<int> aiResults( uiNumJobs, 0 );
+  std::vector<std::future<void>> acJobs( uiNumJobs );
+
+  // Jobs with the same first input (e.g., the reference) run side by side
+  // so that its frames are decoded once and shared
+  std::vector<ClpString> astrFirstInput( uiNumJobs );
+  std::vector<unsigned int> auiOrder( uiNumJobs );
+  for( unsigned int j = 0; j < uiNumJobs; j++ )
+  {
+    auiOrder[j] = j;
+    for( unsigned int i = 0; i < m_aastrBatchJobs[j].size(); i++ )
+    {
+      const ClpString& strArg = m_aastrBatchJobs[j][i];
+      if( strArg.compare( 0, 8, "--input=" ) == 0 || strArg.compare( 0, 3, "-i=" ) == 0 )
+      {
+        astrFirstInput[j] = strArg.substr( strArg.find( '=' ) + 1 );
+        break;
+      }
+    }
+  }
+  std::stable_sort( auiOrder.begin(), auiOrder.end(),
+                    [&astrFirstInput]( unsigned int a, unsigned int b ) { return astrFirstInput[a] < astrFirstInput[b]; } );
+
+  CalypThreadPool cPool( m_iNumberOfThreads > 0 ? m_iNumberOfThreads : 0 );
+  log( CLP_LOG_INFO, "  Running %d jobs with %d threads ...\n", uiNumJobs, cPool.size() );
+  for( unsigned int j = 0; j < uiNumJobs; j++ )
+  {
+    unsigned int uiJob = auiOrder[j];
+    acJobs[uiJob] = cPool.addTask( [this, uiJob, &astrLogs, &aiResults]() {
+      aiResults[uiJob] = runBatchJob( uiJob, &astrLogs[uiJob] );
+    } );
+  }
+
+  // Report in the order of the manifest
+  unsigned int uiFailed = 0;
+  for( unsigned int j = 0; j < uiNumJobs; j++ )
+  {
+    // An exception stored in the future is also a failure
+    try
+    {
+      acJobs[j].get();
+    }
+    catch( ... )
+    {
+      aiResults[j] = -1;
+    }
+    log( CLP_LOG_INFO, "\n# Job %d:", j + 1 );
+    for( unsigned int i = 0; i < m_aastrBatchJobs[j].size(); i++ )
+      log( CLP_LOG_INFO, " %s", m_aastrBatchJobs[j][i].c_str() );
+    log( CLP_LOG_INFO, "\n" );
+    log( CLP_LOG_RESULT, "%s", astrLogs[j].c_str() );
+    if( aiResults[j] < 0 )
+    {
+      log( CLP_LOG_ERROR, "\n# Job %d failed\n", j + 1 );
+      uiFailed++;
+    }
+  }
+  if( uiFailed > 0 )
+  {
+    log( CLP_LOG_ERROR, "\n%d of %d jobs failed! ", uiFailed, uiNumJobs );
+    return -1;
+  }
+  return 0;
+}
+
+static CalypModuleIf* createModule( const ClpString& strModuleName )
+{
+  CalypModulesFactoryMap& moduleFactoryMap = CalypModulesFactory::Get()->getMap();
+  for( CalypModulesFactoryMap::iterator it = moduleFactoryMap.begin(); it != moduleFactoryMap.end(); ++it )
+  {
+    if( strcmp( it->first, strModuleName.c_str() ) == 0 )
+      return it->second();
+  }
+  return NULL;
+}
+
+/**
+ * Pipeline: modules separated by | each followed by its own options,
+ * e.g., "FrameCrop --width=64 | EightBitsSampling". All stages but the
+ * first take one frame; a measurement module can only be the last stage
+ */
+int CalypTools::parsePipeline()
+{
+  std::vector<std::vector<ClpString>> aastrStages( 1 );
+  std::stringstream cPipeline( m_strPipeline );
+  ClpString strToken;
+  while( cPipeline >> strToken )
+  {
+    if( strToken == "|" )
+      aastrStages.push_back( std::vector<ClpString>() );
+    else
+      aastrStages.back().push_back( strToken );
+  }
+
+  m_pcPipeline = new CalypToolsPipeline( PIPELINE_QUEUE_SIZE );
+  for( unsigned int s = 0; s < aastrStages.size(); s++ )
+  {
+    if( aastrStages[s].empty() )
+    {
+      log( CLP_LOG_ERROR, "Invalid pipeline: empty stage %d! ", s + 1 );
+      return -1;
+    }
+    CalypModuleIf* pcModule = createModule( aastrStages[s][0] );
+    if( !pcModule )
+    {
+      log( CLP_LOG_ERROR, "Invalid module %s! ", aastrStages[s][0].c_str() );
+      return -1;
+    }
+    pcModule->m_cModuleOptions.parse( std::vector<ClpString>( aastrStages[s].begin() + 1, aastrStages[s].end() ) );
+
+    unsigned int uiNumberOfInputs = s == 0 ? m_apcInputStreams.size() : 1;
+    if( pcModule->m_uiModuleRequirements & CLP_MODULES_VARIABLE_NUM_FRAMES )
+      pcModule->m_uiNumberOfFrames = uiNumberOfInputs;
+    if( pcModule->m_uiNumberOfFrames != uiNumberOfInputs || ( pcModule->m_iModuleAPI == CLP_MODULE_API_1 && uiNumberOfInputs > 1 ) )
+    {
+      log( CLP_LOG_ERROR, "Invalid number of inputs for module %s! ", pcModule->m_pchModuleName );
+      pcModule->Delete();
+      return -1;
+    }
+
+    if( pcModule->m_iModuleType == CLP_FRAME_MEASUREMENT_MODULE )
+    {
+      if( s != aastrStages.size() - 1 )
+      {
+        log( CLP_LOG_ERROR, "Measurement module %s must be the last stage! ", pcModule->m_pchModuleName );
+        pcModule->Delete();
+        return -1;
+      }
+      m_pcCurrModuleIf = pcModule;
+    }
+    else
+    {
+      m_pcPipeline->addStage( pcModule );
+    }
+  }
+
+  if( !m_pcCurrModuleIf && !Opts().hasOpt( "output" ) )
+  {
+    log( CLP_LOG_ERROR, "One output is required! " );
+    return -1;
+  }
+  return 0;
+}
+
+int CalypTools::PipelineOperation()
+{
+  log( CLP_LOG_INFO, "  Applying Pipeline %s ...\n", m_strPipeline.c_str() );
+
+  ClpULong uiReadFrames = 0;
+  auto pfSource = [this, &uiReadFrames]( std::vector<CalypFrame*>& apcFrames ) {
+    if( uiReadFrames >= m_uiNumberOfFrames || ( uiReadFrames > 0 && !m_pcInputReader->readNextFrames() ) )
+      return false;
+    uiReadFrames++;
+    apcFrames.clear();
+    for( unsigned int i = 0; i < m_apcInputStreams.size(); i++ )
+      apcFrames.push_back( m_apcInputStreams[i]->getCurrFrame() );
+    return true;
+  };
+
+  // Last stage: write or measure the frames on this thread
+  CalypModuleIf* pcMeasure = m_pcCurrModuleIf;
+  bool bMeasureCreated = false;
+  bool bError = false;
+  unsigned int uiFrame = 0;
+  double dAveragedMeasurementResult = 0;
+  auto pfSink = [&]( std::vector<CalypFrame*>& apcFrames ) {
+    if( pcMeasure )
+    {
+      if( !bMeasureCreated )
+      {
+        CalypMemoryScope cMemoryScope( CLP_MEMORY_MODULE );
+        if( pcMeasure->m_iModuleAPI >= CLP_MODULE_API_2 )
+          bMeasureCreated = pcMeasure->create( apcFrames );
+        else
+        {
+          pcMeasure->create( apcFrames[0] );
+          bMeasureCreated = true;
+        }
+        if( !bMeasureCreated )
+        {
+          log( CLP_LOG_ERROR, "Module is not supported with the selected inputs! " );
+          bError = true;
+          return false;
+        }
+      }
+      double dMeasurementResult;
+      CalypStatsTimer cTimer( CLP_STATS_MODULE );
+      CalypMemoryScope cMemoryScope( CLP_MEMORY_MODULE );
+      if( pcMeasure->m_iModuleAPI >= CLP_MODULE_API_2 )
+        dMeasurementResult = pcMeasure->measure( apcFrames );
+      else
+        dMeasurementResult = pcMeasure->measure( apcFrames[0] );
+      log( CLP_LOG_INFO, "   %3d", uiFrame );
+      log( CLP_LOG_RESULT, "  %8.3f \n", dMeasurementResult );
+      dAveragedMeasurementResult =
+          ( dAveragedMeasurementResult * double( uiFrame ) + dMeasurementResult ) / double( uiFrame + 1 );
+    }
+    else
+    {
+      if( m_apcOutputStreams.empty() )
+      {
+        CalypFrame* pcFrame = apcFrames[0];
+        CalypStream* pcOutputStream = new CalypStream;
+        try
+        {
+          pcOutputStream->open( m_strOutput, pcFrame->getWidth(), pcFrame->getHeight(), pcFrame->getPelFormat(),
+                                pcFrame->getBitsPel(), m_uiOutEndianness, 1, false );
+        }
+        catch( CalypFailure& e )
+        {
+          log( CLP_LOG_ERROR, "Cannot open output stream %s with the following error %s!\n", m_strOutput.c_str(), e.what() );
+          delete pcOutputStream;
+          bError = true;
+          return false;
+        }
+        m_apcOutputStreams.push_back( pcOutputStream );
+        reportStreamInfo( pcOutputStream, "Pipeline Output " );
+      }
+      log( CLP_LOG_INFO, "  Writing frame %3d\n", uiFrame );
+      m_apcOutputStreams[0]->writeFrame( apcFrames[0] );
+    }
+    uiFrame++;
+    return true;
+  };
+
+  try
+  {
+    m_pcPipeline->run( pfSource, pfSink );
+  }
+  catch( CalypFailure& e )
+  {
+    log( CLP_LOG_ERROR, "%s\n", e.what() );
+    bError = true;
+  }
+
+  if( pcMeasure )
+  {
+    if( bMeasureCreated )
+      pcMeasure->destroy();
+    if( !bError )
+      log( CLP_LOG_INFO, "\n  Mean Value: \n        %8.3f\n", dAveragedMeasurementResult );
+  }
+  return bError ? -1 : 0;
+}
+
+/**
+ * Modules without state between frames: each worker has its own module
+ * instance (or all share it for reentrant modules of API 4) and processes
+ * a copy of the input frames. Frames are handed out in order and the
+ * results are written (or reported) in order
+ */
+int CalypTools::ParallelModuleOperation()
+{
+  struct FrameJob
+  {
+    unsigned int uiFrame;
+    std::vector<std::unique_ptr<CalypFrame>> apcInputFrames;
+    std::vector<CalypFrame*> apcInput;
+    std::unique_ptr<CalypFrame> pcOutput;
+    CalypFrame* pcResult;  //!< pcOutput or the first input (in place)
+    bool bHasOutput;
+    double dResult;
+    std::future<void> cTask;
+  };
+  struct ModuleDeleter
+  {
+    void operator()( CalypModuleIf* pcModule )
+    {
+      pcModule->destroy();
+      pcModule->Delete();
+    }
+  };
+
+  unsigned int uiNumThreads = m_iNumberOfThreads > 0 ? m_iNumberOfThreads : CalypThreadPool::defaultNumberOfThreads();
+  bool bProcessing = m_pcCurrModuleIf->m_iModuleType == CLP_FRAME_PROCESSING_MODULE;
+  bool bApi1 = m_pcCurrModuleIf->m_iModuleAPI == CLP_MODULE_API_1;
+  bool bApi4 = m_pcCurrModuleIf->m_iModuleAPI == CLP_MODULE_API_4;
+  bool bShared = bApi4 && ( m_pcCurrModuleIf->m_uiModuleRequirements & CLP_MODULE_REENTRANT );
+
+  // One module per worker (unless the module is reentrant)
+  std::vector<CalypFrame*> apcFrameList;
+  for( unsigned int i = 0; i < m_pcCurrModuleIf->m_uiNumberOfFrames; i++ )
+    apcFrameList.push_back( m_apcInputStreams[i]->getCurrFrame() );
+  std::vector<std::unique_ptr<CalypModuleIf, ModuleDeleter>> apcExtraModules;
+  std::vector<CalypModuleIf*> apcModules( 1, m_pcCurrModuleIf );
+  for( unsigned int i = 1; i < ( bShared ? 1 : uiNumThreads ); i++ )
+  {
+    CalypModuleIf* pcModule = createModule( m_strModule );
+    if( !pcModule )
+      break;
+    pcModule->m_uiNumberOfFrames = m_pcCurrModuleIf->m_uiNumberOfFrames;
+    pcModule->m_cModuleOptions.parse( m_iArgc, m_ppchArgv );
+    apcExtraModules.push_back( std::unique_ptr<CalypModuleIf, ModuleDeleter>( pcModule ) );
+    CalypMemoryScope cMemoryScope( CLP_MEMORY_MODULE );
+    if( bApi1 )
+    {
+      pcModule->create( apcFrameList[0] );
+    }
+    else if( !pcModule->create( apcFrameList ) )
+    {
+      // Same inputs as the first instance: should not happen
+      apcExtraModules.back().release()->Delete();
+      apcExtraModules.pop_back();
+      break;
+    }
+    apcModules.push_back( pcModule );
+  }
+  // Fewer workers when not every instance could be created
+  if( !bShared )
+    uiNumThreads = apcModules.size();
+  log( CLP_LOG_INFO, "  Applying Module %s/%s (%d threads) ...\n", m_pcCurrModuleIf->m_pchModuleCategory,
+       m_pcCurrModuleIf->m_pchModuleName, uiNumThreads );
+  std::vector<CalypModuleIf*> apcIdleModules( apcModules );
+  std::mutex cModulesMutex;
+
+  auto runJob = [&]( FrameJob* pcJob ) {
+    CalypModuleIf* pcModule = m_pcCurrModuleIf;
+    if( !bShared )
+    {
+      std::lock_guard<std::mutex> lock( cModulesMutex );
+      pcModule = apcIdleModules.back();
+      apcIdleModules.pop_back();
+    }
+    if( bProcessing && bApi4 )
+    {
+      // Written directly into the frames of the job
+      pcJob->pcResult = pcModule->canProcessInPlace( pcJob->apcInput ) ? pcJob->apcInput[0] : pcJob->pcOutput.get();
+      CalypStatsTimer cTimer( CLP_STATS_MODULE );
+      CalypMemoryScope cMemoryScope( CLP_MEMORY_MODULE );
+      pcJob->bHasOutput = pcJob->pcResult && pcModule->process( pcJob->apcInput, pcJob->pcResult );
+    }
+    else if( bProcessing )
+    {
+      CalypFrame* pcFrame;
+      {
+        CalypStatsTimer cTimer( CLP_STATS_MODULE );
+        CalypMemoryScope cMemoryScope( CLP_MEMORY_MODULE );
+        pcFrame = bApi1 ? pcModule->process( pcJob->apcInput[0] ) : pcModule->process( pcJob->apcInput );
+      }
+      pcJob->bHasOutput = pcFrame != NULL;
+      if( pcFrame )
+      {
+        if( pcJob->pcOutput && !pcJob->pcOutput->haveSameFmt( pcFrame ) )
+          pcJob->pcOutput.reset();
+        if( !pcJob->pcOutput )
+          pcJob->pcOutput.reset( new CalypFrame( pcFrame->getWidth(), pcFrame->getHeight(), pcFrame->getPelFormat(),
+                                                 pcFrame->getBitsPel(), pcFrame->getHasNegativeValues() ) );
+        pcJob->pcOutput->copyFrom( pcFrame );
+      }
+      pcJob->pcResult = pcJob->pcOutput.get();
+    }
+    else
+    {
+      CalypStatsTimer cTimer( CLP_STATS_MODULE );
+      CalypMemoryScope cMemoryScope( CLP_MEMORY_MODULE );
+      pcJob->dResult = bApi1 ? pcModule->measure( pcJob->apcInput[0] ) : pcModule->measure( pcJob->apcInput );
+    }
+    if( !bShared )
+    {
+      std::lock_guard<std::mutex> lock( cModulesMutex );
+      apcIdleModules.push_back( pcModule );
+    }
+  };
+
+  // Enough jobs to keep every worker busy while the oldest one is written
+  std::vector<FrameJob> acJobs( 2 * uiNumThreads );
+  for( unsigned int j = 0; j < acJobs.size(); j++ )
+  {
+    for( unsigned int i = 0; i < apcFrameList.size(); i++ )
+    {
+      acJobs[j].apcInputFrames.push_back( std::unique_ptr<CalypFrame>( new CalypFrame( apcFrameList[i] ) ) );
+      acJobs[j].apcInput.push_back( acJobs[j].apcInputFrames.back().get() );
+    }
+    if( bProcessing && bApi4 && !m_pcCurrModuleIf->canProcessInPlace( acJobs[j].apcInput ) )
+    {
+      CalypMemoryScope cMemoryScope( CLP_MEMORY_MODULE );
+      acJobs[j].pcOutput.reset( m_pcCurrModuleIf->newOutputFrame() );
+    }
+  }
+
+  // The pool is declared after everything its tasks use, and the tasks
+  // still queued or running are waited for before any of it is released
+  // (also when writing or reading throws)
+  CalypThreadPool cPool( uiNumThreads );
+  struct PendingJobs
+  {
+    std::vector<FrameJob>& racJobs;
+    ~PendingJobs()
+    {
+      for( FrameJob& rcJob : racJobs )
+        if( rcJob.cTask.valid() )
+          rcJob.cTask.wait();
+    }
+  } cPendingJobs = { acJobs };
+
+  double dAveragedMeasurementResult = 0;
+  auto finishJob = [&]( FrameJob& rcJob ) {
+    rcJob.cTask.get();
+    if( bProcessing )
+    {
+      log( CLP_LOG_INFO, "  Processing frame %3d\n", rcJob.uiFrame );
+      if( rcJob.bHasOutput )
+        m_apcOutputStreams[0]->writeFrame( rcJob.pcResult );
+    }
+    else
+    {
+      log( CLP_LOG_INFO, "   %3d", rcJob.uiFrame );
+      log( CLP_LOG_RESULT, "  %8.3f \n", rcJob.dResult );
+      dAveragedMeasurementResult =
+          ( dAveragedMeasurementResult * double( rcJob.uiFrame ) + rcJob.dResult ) / double( rcJob.uiFrame + 1 );
+    }
+  };
+
+  unsigned int frame = 0;
+  for( ; frame < m_uiNumberOfFrames; frame++ )
+  {
+    if( frame > 0 && !m_pcInputReader->readNextFrames() )
+      break;
+    FrameJob& rcJob = acJobs[frame % acJobs.size()];
+    if( frame >= acJobs.size() )
+      finishJob( rcJob );
+    rcJob.uiFrame = frame;
+    for( unsigned int i = 0; i < rcJob.apcInput.size(); i++ )
+      rcJob.apcInput[i]->copyFrom( m_apcInputStreams[i]->getCurrFrame() );
+    FrameJob* pcJob = &rcJob;
+    rcJob.cTask = cPool.addTask( [&runJob, pcJob]() { runJob( pcJob ); } );
+  }
+  for( unsigned int f = frame > acJobs.size() ? frame - acJobs.size() : 0; f < frame; f++ )
+    finishJob( acJobs[f % acJobs.size()] );
+
+  if( !bProcessing )
+  {
+    log( CLP_LOG_INFO, "\n  Mean Value: \n        %8.3f\n", dAveragedMeasurementResult );
+  }
+  return 0;
+}
+
+/**
+ * Repeat an operation for BENCHMARK_MIN_TIME (or --frames times) and
+ * report its throughput; uiBytes is the size of the frame processed
+ */
+void CalypTools::runBenchmark( const ClpString& strName, const ClpString& strConfig, ClpULong uiBytes,
+                               std::function<void()> pfOperation )
+{
+  ClpULong uiIterations = 0;
+  double dElapsed = 0;
+  std::chrono::steady_clock::time_point cStart = std::chrono::steady_clock::now();
+  try
+  {
+    do
+    {
+      pfOperation();
+      uiIterations++;
+      dElapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - cStart ).count();
+    } while( m_iFrames > 0 ? uiIterations < ClpULong( m_iFrames ) : dElapsed < BENCHMARK_MIN_TIME );
+  }
+  catch( CalypFailure& e )
+  {
+    log( CLP_LOG_WARNINGS, "  %-30s %-24s not supported\n", strName.c_str(), strConfig.c_str() );
+    return;
+  }
+  double dFps = dElapsed > 0 ? uiIterations / dElapsed : 0;
+  log( CLP_LOG_RESULT, "  %-30s %-24s %10.1f %9.3f\n", strName.c_str(), strConfig.c_str(), dFps, dFps * uiBytes / 1e9 );
+}
+
+int CalypTools::BenchmarkOperation()
+{
+  std::vector<ClpString> astrSizes( 1, "1920x1080" );
+  if( Opts().hasOpt( "size" ) )
+    astrSizes = m_strResolution;
+  std::vector<int> aiPelFormats;
+  for( unsigned int i = 0; i < CalypFrame::supportedPixelFormatListNames().size(); i++ )
+  {
+    bool bSelected = !Opts().hasOpt( "pel_fmt" );
+    for( unsigned int f = 0; f < m_strPelFmt.size() && !bSelected; f++ )
+      bSelected = clpLowercase( CalypFrame::supportedPixelFormatListNames()[i] ) == clpLowercase( m_strPelFmt[f] );
+    if( bSelected )
+      aiPelFormats.push_back( i );
+  }
+  std::vector<unsigned int> auiBitsPerPixel = { 8, 10 };
+  if( Opts().hasOpt( "bits_pel" ) )
+  {
+    auiBitsPerPixel.clear();
+    for( unsigned int i = 0; i < m_strBitsPerPixel.size(); i++ )
+      auiBitsPerPixel.push_back( std::stoi( m_strBitsPerPixel[i] ) );
+  }
+
+  log( CLP_LOG_INFO, "  Benchmarking %s ...\n", m_iFrames > 0 ? "a fixed number of frames" : "for a fixed time" );
+  log( CLP_LOG_RESULT, "# %-30s %-24s %10s %9s\n", "Operation", "Format", "Frames/s", "GB/s" );
+
+  unsigned int uiSeed = 1;
+  for( unsigned int r = 0; r < astrSizes.size(); r++ )
+  {
+    unsigned int uiWidth = 0;
+    unsigned int uiHeight = 0;
+    if( sscanf( astrSizes[r].c_str(), "%ux%u", &uiWidth, &uiHeight ) != 2 || uiWidth == 0 || uiHeight == 0 )
+    {
+      log( CLP_LOG_ERROR, "Invalid size %s! ", astrSizes[r].c_str() );
+      return -1;
+    }
+    for( unsigned int f = 0; f < aiPelFormats.size(); f++ )
+    {
+      for( unsigned int b = 0; b < auiBitsPerPixel.size(); b++ )
+      {
+        CalypFrame* apcFrames[2] = { NULL, NULL };
+        try
+        {
+          for( unsigned int i = 0; i < 2; i++ )
+            apcFrames[i] = new CalypFrame( uiWidth, uiHeight, aiPelFormats[f], auiBitsPerPixel[b] );
+        }
+        catch( CalypFailure& e )
+        {
+          delete apcFrames[0];
+          continue;
+        }
+        CalypFrame* pcFrame = apcFrames[0];
+        CalypFrame* pcReference = apcFrames[1];
+
+        // Synthetic content (fixed seeds so runs are comparable)
+        for( unsigned int i = 0; i < 2; i++ )
+          apcFrames[i]->fillSynthetic( uiSeed++ );
+
+        char acConfig[64];
+        snprintf( acConfig, sizeof( acConfig ), "%ux%u %s %ub", uiWidth, uiHeight,
+                  CalypFrame::supportedPixelFormatListNames()[aiPelFormats[f]].c_str(), auiBitsPerPixel[b] );
+        ClpString strConfig( acConfig );
+        ClpULong uiBytes = pcFrame->getBytesPerFrame();
+        std::vector<ClpByte> acBuffer( uiBytes );
+
+        runBenchmark( "frameToBuffer", strConfig, uiBytes, [&]() { pcFrame->frameToBuffer( acBuffer.data(), CLP_LITTLE_ENDIAN ); } );
+        runBenchmark( "frameFromBuffer", strConfig, uiBytes, [&]() { pcFrame->frameFromBuffer( acBuffer.data(), CLP_LITTLE_ENDIAN ); } );
+        runBenchmark( "fillRGBBuffer", strConfig, uiBytes, [&]() { pcFrame->fillRGBBuffer(); } );
+        runBenchmark( "calcHistogram", strConfig, uiBytes, [&]() { pcFrame->calcHistogram(); } );
+
+        for( int m = 0; m < CalypFrame::NUMBER_METRICS; m++ )
+        {
+          runBenchmark( "quality " + CalypFrame::supportedQualityMetricsList()[m], strConfig, uiBytes, [&]() {
+            for( unsigned int c = 0; c < pcFrame->getNumberChannels(); c++ )
+              pcFrame->getQuality( m, pcReference, c );
+          } );
+        }
+
+        CalypModulesFactoryMap& moduleFactoryMap = CalypModulesFactory::Get()->getMap();
+        for( CalypModulesFactoryMap::iterator it = moduleFactoryMap.begin(); it != moduleFactoryMap.end(); ++it )
+        {
+          CalypModuleIf* pcModule = it->second();
+          if( pcModule->m_iModuleAPI == CLP_MODULE_API_3 || pcModule->m_uiNumberOfFrames == 0 ||
+              ( pcModule->m_iModuleAPI == CLP_MODULE_API_1 && pcModule->m_uiNumberOfFrames > 1 ) )
+          {
+            pcModule->Delete();
+            continue;
+          }
+          std::vector<CalypFrame*> apcFrameList;
+          for( unsigned int i = 0; i < pcModule->m_uiNumberOfFrames; i++ )
+            apcFrameList.push_back( apcFrames[i % 2] );
+          bool bCreated = true;
+          if( pcModule->m_iModuleAPI == CLP_MODULE_API_1 )
+            pcModule->create( pcFrame );
+          else
+            bCreated = pcModule->create( apcFrameList );
+          if( bCreated )
+          {
+            bool bApi1 = pcModule->m_iModuleAPI == CLP_MODULE_API_1;
+            // API 4 outputs are owned by the caller
+            std::unique_ptr<CalypFrame> pcOutput;
+            if( pcModule->m_iModuleAPI == CLP_MODULE_API_4 )
+              pcOutput.reset( pcModule->newOutputFrame() );
+            runBenchmark( ClpString( "module " ) + it->first, strConfig, uiBytes, [&]() {
+              if( pcOutput )
+                pcModule->process( apcFrameList, pcOutput.get() );
+              else if( pcModule->m_iModuleType == CLP_FRAME_PROCESSING_MODULE )
+                bApi1 ? pcModule->process( pcFrame ) : pcModule->process( apcFrameList );
+              else
+                bApi1 ? pcModule->measure( pcFrame ) : pcModule->measure( apcFrameList );
+            } );
+            pcModule->destroy();
+          }
+          pcModule->Delete();
+        }
+
+        delete pcFrame;
+        delete pcReference;
+      }
+    }
+  }
+  return 0;
+}
@@ -48,9 +48,13 @@
 
 #include "CalypToolsCmdParser.h"
 
+#include <functional>
+
 class CalypFrame;
 class CalypStream;
+class CalypMultiStreamReader;
 class CalypModuleIf;
+class CalypToolsPipeline;
 
 #define MAX_NUMBER_INPUTS 255
 #define MAX_NUMBER_CHANNELS 4
@@ -67,6 +71,8 @@ public:
 
 private:
   bool m_bVerbose;
+  int m_iArgc;
+  char** m_ppchArgv;
 
   unsigned int m_uiOperation;
   enum TOOLS_OPERATIONS_LIST
@@ -76,12 +82,17 @@ private:
     RATE_REDUCTION_OPERATION,
     QUALITY_OPERATION,
     MODULE_OPERATION,
+    BATCH_OPERATION,
+    PIPELINE_OPERATION,
+    BENCHMARK_OPERATION,
   };
 
   ClpULong m_uiNumberOfFrames;
+  std::vector<ClpULong> m_auiFrameList;  //!< Frames selected with --frame_list (sorted)
   unsigned int m_uiNumberOfComponents;
   std::vector<CalypStream*> m_apcInputStreams;
   std::vector<CalypStream*> m_apcOutputStreams;
+  CalypMultiStreamReader* m_pcInputReader;
 
   void reportStreamInfo( const CalypStream* stream, ClpString strPrefix = "" );
   int openInputs();
@@ -102,6 +113,20 @@ private:
   CalypModuleIf* m_pcCurrModuleIf;
   //CalypFrame* applyFrameModule();
   int ModuleOperation();
+  int ParallelModuleOperation();
+
+  void runBenchmark( const ClpString& strName, const ClpString& strConfig, ClpULong uiBytes, std::function<void()> pfOperation );
+  int BenchmarkOperation();
+
+  CalypToolsPipeline* m_pcPipeline;
+  int parsePipeline();
+  int PipelineOperation();
+
+  bool m_bBatchJob;  //!< Running as a job of a batch (inputs share the decoded frames)
+  std::vector<std::vector<ClpString>> m_aastrBatchJobs;
+  int parseBatchManifest();
+  int runBatchJob( unsigned int uiJob, ClpString* pstrLog );
+  int BatchOperation();
 };
 
 #endif  // __CALYPTOOLS_H__
@@ -36,8 +36,14 @@
 CalypToolsCmdParser::CalypToolsCmdParser()
 {
   m_uiLogLevel = 0;
+  m_pstrLogBuffer = NULL;
   m_bQuiet = false;
+  m_bLumaOnly = false;
   m_iFrames = -1;
+  m_iStartFrame = 0;
+  m_iFrameStep = 1;
+  m_iNumberOfThreads = 1;
+  m_iMemoryBudget = 0;
 
   m_cOptions.addDefaultOptions();
 }
@@ -50,7 +56,23 @@ void CalypToolsCmdParser::log( unsigned int level, const char* fmt, ... )
   {
     std::va_list args;
     va_start( args, fmt );
-    vfprintf( stdout, fmt, args );
+    if( m_pstrLogBuffer )
+    {
+      std::va_list argsSize;
+      va_copy( argsSize, args );
+      int iSize = vsnprintf( NULL, 0, fmt, argsSize );
+      va_end( argsSize );
+      if( iSize > 0 )
+      {
+        std::vector<char> achMessage( iSize + 1 );
+        vsnprintf( achMessage.data(), achMessage.size(), fmt, args );
+        m_pstrLogBuffer->append( achMessage.data(), iSize );
+      }
+    }
+    else
+    {
+      vfprintf( stdout, fmt, args );
+    }
     va_end( args );
   }
 }
@@ -68,10 +90,20 @@ int CalypToolsCmdParser::parseToolsArgs( int argc, char* argv[] )
       ( "endianness", m_strEndianness, "File endianness (big, little)" )                 /**/
       ( "has_negative", m_strHasNegativeValues, "Flag for files with negatie values" )   /**/
       ( "frames,f", m_iFrames, "number of frames to parse" )                             /**/
+      ( "start", m_iStartFrame, "first frame to parse" )                                 /**/
+      ( "step", m_iFrameStep, "parse one every N frames" )                               /**/
+      ( "frame_list", m_strFrameList, "comma separated list of frames to parse" )        /**/
       ( "quality", m_strQualityMetric, "select a quality metric" )                       /**/
+      ( "luma", m_bLumaOnly, "only read and measure the luma channel" )                  /**/
       ( "module", m_strModule, "select a module (use internal name)" )                   /**/
+      ( "pipeline", m_strPipeline, "chain of modules (with options) separated by |" )    /**/
+      ( "benchmark", "measure the throughput of frame operations and modules" )          /**/
+      ( "stats", "report the time spent in each processing stage" )                      /**/
       ( "save", "save a specific frame" )                                                /**/
-      ( "rate-reduction", m_iRateReductionFactor, "reduce the frame rate" );             /**/
+      ( "rate-reduction", m_iRateReductionFactor, "reduce the frame rate" )              /**/
+      ( "batch", m_strBatchFile, "run the jobs of a manifest (one per line)" )           /**/
+      ( "threads", m_iNumberOfThreads, "parallel jobs/frames (0: all cores) [1]" )       /**/
+      ( "memory_budget", m_iMemoryBudget, "memory budget in MB (evicts the caches)" );   /**/
 
   if( !m_cOptions.parse( argc, argv ) )
   {
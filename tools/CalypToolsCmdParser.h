@@ -49,6 +49,9 @@ public:
    */
   void log( unsigned int level, const char* fmt, ... );
 
+  //! Append the log messages to a buffer instead of stdout (NULL resets)
+  void setLogBuffer( ClpString* pstrBuffer ) { m_pstrLogBuffer = pstrBuffer; }
+
   int parseToolsArgs( int argc, char* argv[] );
 
   CalypOptions& Opts() { return m_cOptions; }
@@ -56,6 +59,7 @@ public:
 protected:
   CalypOptions m_cOptions;
   unsigned int m_uiLogLevel;
+  ClpString* m_pstrLogBuffer;
 
   /**
    * Command line opts for CalypTools
@@ -72,11 +76,19 @@ protected:
   std::vector<ClpString> m_strHasNegativeValues;
   ClpString m_strOutput;
   long m_iFrames;
+  long m_iStartFrame;
+  long m_iFrameStep;
+  ClpString m_strFrameList;
   unsigned m_uiOutEndianness;
 
   int m_iRateReductionFactor;
   ClpString m_strQualityMetric;
+  bool m_bLumaOnly;
   ClpString m_strModule;
+  ClpString m_strPipeline;
+  ClpString m_strBatchFile;
+  int m_iNumberOfThreads;
+  int m_iMemoryBudget;
 
   bool m_bListPelFmts;
   bool m_bListQuality;
@@ -0,0 +1,413 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * \file     CalypToolsPipeline.cpp
+ * \brief    Chain of modules running on their own threads
+ */
+
+#include "CalypToolsPipeline.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "lib/CalypFrame.h"
+#include "lib/CalypMemory.h"
+#include "lib/CalypModuleIf.h"
+#include "lib/CalypStats.h"
+
+/**
+ * Bounded queue between two stages. Entries hold copies of the frames
+ * produced by a stage (modules reuse their output frame) and are recycled
+ * once the next stage is done with them. Modules of API 4 write directly
+ * into the entries (acquire/commit)
+ */
+class CalypFrameQueue
+{
+private:
+  typedef std::vector<CalypFrame*> Entry;
+  std::vector<Entry*> m_apcEntries;  //!< All the entries allocated
+  std::deque<Entry*> m_apcQueue;
+  std::vector<Entry*> m_apcFree;
+  unsigned int m_uiCapacity;
+  bool m_bClosed;
+  bool m_bAborted;
+  std::mutex m_cMutex;
+  std::condition_variable m_cCondition;
+
+public:
+  CalypFrameQueue( unsigned int uiCapacity )
+      : m_uiCapacity( uiCapacity ), m_bClosed( false ), m_bAborted( false )
+  {
+  }
+  ~CalypFrameQueue()
+  {
+    for( unsigned int i = 0; i < m_apcEntries.size(); i++ )
+    {
+      for( unsigned int f = 0; f < m_apcEntries[i]->size(); f++ )
+        delete m_apcEntries[i]->at( f );
+      delete m_apcEntries[i];
+    }
+  }
+
+  unsigned int capacity() const { return m_uiCapacity; }
+
+  //! Get an entry to be filled (blocks while full, NULL if aborted)
+  Entry* acquire()
+  {
+    std::unique_lock<std::mutex> lock( m_cMutex );
+    m_cCondition.wait( lock, [this] { return m_bAborted || m_apcFree.size() > 0 || m_apcEntries.size() < m_uiCapacity; } );
+    if( m_bAborted )
+      return NULL;
+    Entry* pcEntry;
+    if( m_apcFree.size() > 0 )
+    {
+      pcEntry = m_apcFree.back();
+      m_apcFree.pop_back();
+    }
+    else
+    {
+      pcEntry = new Entry;
+      m_apcEntries.push_back( pcEntry );
+    }
+    return pcEntry;
+  }
+
+  //! Queue an entry obtained with acquire()
+  void commit( Entry* pcEntry )
+  {
+    std::lock_guard<std::mutex> lock( m_cMutex );
+    m_apcQueue.push_back( pcEntry );
+    m_cCondition.notify_all();
+  }
+
+  //! Copy the frames into the queue (blocks while full)
+  bool push( const std::vector<CalypFrame*>& apcFrames )
+  {
+    Entry* pcEntry = acquire();
+    if( !pcEntry )
+      return false;
+    pcEntry->resize( apcFrames.size(), NULL );
+    for( unsigned int i = 0; i < apcFrames.size(); i++ )
+    {
+      CalypFrame*& pcFrame = pcEntry->at( i );
+      if( pcFrame && !pcFrame->haveSameFmt( apcFrames[i] ) )
+      {
+        delete pcFrame;
+        pcFrame = NULL;
+      }
+      if( !pcFrame )
+        pcFrame = new CalypFrame( apcFrames[i]->getWidth(), apcFrames[i]->getHeight(), apcFrames[i]->getPelFormat(),
+                                  apcFrames[i]->getBitsPel(), apcFrames[i]->getHasNegativeValues() );
+      pcFrame->copyFrom( apcFrames[i] );
+    }
+    commit( pcEntry );
+    return true;
+  }
+
+  //! Wait for the next entry (false at the end of the stream)
+  bool pop( std::vector<CalypFrame*>*& rpcEntry )
+  {
+    std::unique_lock<std::mutex> lock( m_cMutex );
+    m_cCondition.wait( lock, [this] { return m_bAborted || m_bClosed || m_apcQueue.size() > 0; } );
+    if( m_bAborted || m_apcQueue.empty() )
+      return false;
+    rpcEntry = m_apcQueue.front();
+    m_apcQueue.pop_front();
+    return true;
+  }
+
+  //! Take the next entry only if it is already queued
+  bool tryPop( std::vector<CalypFrame*>*& rpcEntry )
+  {
+    std::lock_guard<std::mutex> lock( m_cMutex );
+    if( m_bAborted || m_apcQueue.empty() )
+      return false;
+    rpcEntry = m_apcQueue.front();
+    m_apcQueue.pop_front();
+    return true;
+  }
+
+  void release( std::vector<CalypFrame*>* pcEntry )
+  {
+    std::lock_guard<std::mutex> lock( m_cMutex );
+    m_apcFree.push_back( pcEntry );
+    m_cCondition.notify_all();
+  }
+
+  //! No more entries will be pushed
+  void close()
+  {
+    std::lock_guard<std::mutex> lock( m_cMutex );
+    m_bClosed = true;
+    m_cCondition.notify_all();
+  }
+
+  //! Wake up and stop both sides
+  void abort()
+  {
+    std::lock_guard<std::mutex> lock( m_cMutex );
+    m_bAborted = true;
+    m_cCondition.notify_all();
+  }
+};
+
+CalypToolsPipeline::CalypToolsPipeline( unsigned int uiQueueSize )
+    : m_uiQueueSize( uiQueueSize > 0 ? uiQueueSize : 1 )
+{
+}
+
+CalypToolsPipeline::~CalypToolsPipeline()
+{
+  for( unsigned int i = 0; i < m_apcStages.size(); i++ )
+  {
+    if( m_abCreated[i] )
+      m_apcStages[i]->destroy();
+    m_apcStages[i]->Delete();
+  }
+}
+
+void CalypToolsPipeline::addStage( CalypModuleIf* pcModule )
+{
+  m_apcStages.push_back( pcModule );
+  m_abCreated.push_back( false );
+}
+
+void CalypToolsPipeline::runSource( SourceFn pfSource, CalypFrameQueue* pcOutput )
+{
+  std::vector<CalypFrame*> apcFrames;
+  while( pfSource( apcFrames ) )
+  {
+    if( !pcOutput->push( apcFrames ) )
+      break;
+  }
+}
+
+void CalypToolsPipeline::createStage( unsigned int uiStage, std::vector<CalypFrame*>& apcFrames )
+{
+  if( m_abCreated[uiStage] )
+    return;
+  CalypModuleIf* pcModule = m_apcStages[uiStage];
+  CalypMemoryScope cMemoryScope( CLP_MEMORY_MODULE );
+  bool bCreated = true;
+  if( pcModule->m_iModuleAPI >= CLP_MODULE_API_2 )
+    bCreated = pcModule->create( apcFrames );
+  else
+    pcModule->create( apcFrames[0] );
+  if( !bCreated )
+  {
+    throw CalypFailure( "CalypToolsPipeline", ClpString( "Module " ) + pcModule->m_pchModuleName +
+                                                  " is not supported with the frames of the previous stage" );
+  }
+  m_abCreated[uiStage] = true;
+}
+
+void CalypToolsPipeline::runStage( unsigned int uiStage, CalypFrameQueue* pcInput, CalypFrameQueue* pcOutput )
+{
+  CalypModuleIf* pcModule = m_apcStages[uiStage];
+  if( pcModule->m_iModuleAPI == CLP_MODULE_API_4 )
+  {
+    runBatchStage( uiStage, pcInput, pcOutput );
+    return;
+  }
+  std::vector<CalypFrame*> apcOutput( 1 );
+  std::vector<CalypFrame*>* pcEntry;
+  for( unsigned int uiFrame = 0; pcInput->pop( pcEntry ); uiFrame++ )
+  {
+    std::vector<CalypFrame*>& apcFrames = *pcEntry;
+    createStage( uiStage, apcFrames );
+    // Modules of API 3 can output several frames for each input
+    bool bNeedFrame;
+    do
+    {
+      {
+        CalypStatsTimer cTimer( CLP_STATS_MODULE );
+        CalypMemoryScope cMemoryScope( CLP_MEMORY_MODULE );
+        if( pcModule->m_iModuleAPI >= CLP_MODULE_API_2 )
+          apcOutput[0] = pcModule->process( apcFrames );
+        else
+          apcOutput[0] = pcModule->process( apcFrames[0] );
+      }
+      // Only modules of API 3 hold frames back (flushed at the end)
+      if( !apcOutput[0] && pcModule->m_iModuleAPI < CLP_MODULE_API_3 )
+      {
+        pcInput->release( pcEntry );
+        throw CalypFailure( "CalypToolsPipeline", ClpString( "Module " ) + pcModule->m_pchModuleName +
+                                                      " failed to process frame " + std::to_string( uiFrame ) );
+      }
+      if( apcOutput[0] && !pcOutput->push( apcOutput ) )
+      {
+        pcInput->release( pcEntry );
+        return;
+      }
+      bNeedFrame = pcModule->m_iModuleAPI < CLP_MODULE_API_3 || pcModule->needFrame();
+    } while( !bNeedFrame );
+    pcInput->release( pcEntry );
+  }
+  // Flush the frames buffered by the module
+  if( m_abCreated[uiStage] && pcModule->m_iModuleAPI == CLP_MODULE_API_3 )
+  {
+    std::vector<CalypFrame*> apcEmpty;
+    while( ( apcOutput[0] = pcModule->process( apcEmpty ) ) )
+    {
+      if( !pcOutput->push( apcOutput ) )
+        return;
+    }
+  }
+}
+
+/**
+ * Modules of API 4 process every frame already waiting in the input queue
+ * in one call and write directly into the entries of the output queue
+ */
+void CalypToolsPipeline::runBatchStage( unsigned int uiStage, CalypFrameQueue* pcInput, CalypFrameQueue* pcOutput )
+{
+  CalypModuleIf* pcModule = m_apcStages[uiStage];
+  std::vector<std::vector<CalypFrame*>*> apcInputEntries;
+  std::vector<std::vector<CalypFrame*>*> apcOutputEntries;
+  std::vector<std::vector<CalypFrame*>> aapcFrameSets;
+  std::vector<CalypFrame*> apcOutputFrames;
+  std::vector<CalypFrame*>* pcEntry;
+  unsigned int uiFrame = 0;
+  while( pcInput->pop( pcEntry ) )
+  {
+    // No more entries than the output queue holds (they are all acquired before processing)
+    apcInputEntries.assign( 1, pcEntry );
+    while( apcInputEntries.size() < pcOutput->capacity() && pcInput->tryPop( pcEntry ) )
+      apcInputEntries.push_back( pcEntry );
+
+    createStage( uiStage, *apcInputEntries[0] );
+
+    aapcFrameSets.clear();
+    apcOutputEntries.clear();
+    apcOutputFrames.clear();
+    for( unsigned int i = 0; i < apcInputEntries.size(); i++ )
+    {
+      std::vector<CalypFrame*>* pcOutputEntry = pcOutput->acquire();
+      if( !pcOutputEntry )
+        return;
+      pcOutputEntry->resize( 1, NULL );
+      CalypFrame*& pcFrame = pcOutputEntry->at( 0 );
+      if( pcFrame && !pcModule->isOutputFormat( pcFrame ) )
+      {
+        delete pcFrame;
+        pcFrame = NULL;
+      }
+      if( !pcFrame )
+      {
+        CalypMemoryScope cMemoryScope( CLP_MEMORY_MODULE );
+        pcFrame = pcModule->newOutputFrame();
+      }
+      aapcFrameSets.push_back( *apcInputEntries[i] );
+      apcOutputEntries.push_back( pcOutputEntry );
+      apcOutputFrames.push_back( pcFrame );
+    }
+
+    bool bProcessed;
+    {
+      CalypStatsTimer cTimer( CLP_STATS_MODULE );
+      CalypMemoryScope cMemoryScope( CLP_MEMORY_MODULE );
+      bProcessed = pcModule->processBatch( aapcFrameSets, apcOutputFrames );
+    }
+    for( unsigned int i = 0; i < apcOutputEntries.size(); i++ )
+    {
+      if( bProcessed )
+        pcOutput->commit( apcOutputEntries[i] );
+      else
+        pcOutput->release( apcOutputEntries[i] );
+      pcInput->release( apcInputEntries[i] );
+    }
+    if( !bProcessed )
+    {
+      throw CalypFailure( "CalypToolsPipeline", ClpString( "Module " ) + pcModule->m_pchModuleName +
+                                                    " failed to process frames " + std::to_string( uiFrame ) + " to " +
+                                                    std::to_string( uiFrame + apcInputEntries.size() - 1 ) );
+    }
+    uiFrame += apcInputEntries.size();
+  }
+}
+
+bool CalypToolsPipeline::run( SourceFn pfSource, SinkFn pfSink )
+{
+  std::vector<CalypFrameQueue*> apcQueues;
+  for( unsigned int i = 0; i <= m_apcStages.size(); i++ )
+    apcQueues.push_back( new CalypFrameQueue( m_uiQueueSize ) );
+
+  std::mutex cErrorMutex;
+  std::exception_ptr pcError;
+  auto abortAll = [&apcQueues]() {
+    for( unsigned int i = 0; i < apcQueues.size(); i++ )
+      apcQueues[i]->abort();
+  };
+  // Any failure stops every stage
+  auto guarded = [&]( std::function<void()> pfTask, CalypFrameQueue* pcOutput ) {
+    try
+    {
+      pfTask();
+    }
+    catch( ... )
+    {
+      std::lock_guard<std::mutex> lock( cErrorMutex );
+      if( !pcError )
+        pcError = std::current_exception();
+      abortAll();
+    }
+    pcOutput->close();
+  };
+
+  std::vector<std::thread> acThreads;
+  acThreads.push_back( std::thread( guarded, [&]() { runSource( pfSource, apcQueues[0] ); }, apcQueues[0] ) );
+  for( unsigned int i = 0; i < m_apcStages.size(); i++ )
+  {
+    acThreads.push_back( std::thread( guarded, [this, i, &apcQueues]() { runStage( i, apcQueues[i], apcQueues[i + 1] ); },
+                                      apcQueues[i + 1] ) );
+  }
+
+  bool bRet = true;
+  CalypFrameQueue* pcLast = apcQueues.back();
+  std::vector<CalypFrame*>* pcEntry;
+  guarded(
+      [&]() {
+        while( pcLast->pop( pcEntry ) )
+        {
+          bool bContinue = pfSink( *pcEntry );
+          pcLast->release( pcEntry );
+          if( !bContinue )
+          {
+            bRet = false;
+            abortAll();
+            break;
+          }
+        }
+      },
+      pcLast );
+
+  for( unsigned int i = 0; i < acThreads.size(); i++ )
+    acThreads[i].join();
+  for( unsigned int i = 0; i < apcQueues.size(); i++ )
+    delete apcQueues[i];
+
+  if( pcError )
+    std::rethrow_exception( pcError );
+  return bRet;
+}
@@ -0,0 +1,90 @@
+/*    This file is a part of Calyp project
+ *    Copyright (C) 2014-2019  by Joao Carreira   (jfmcarreira@gmail.com)
+ *                                Luis Lucas      (luisfrlucas@gmail.com)
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * \file     CalypToolsPipeline.h
+ * \brief    Chain of modules running on their own threads
+ */
+
+#ifndef __CALYPTOOLSPIPELINE_H__
+#define __CALYPTOOLSPIPELINE_H__
+
+#include "lib/CalypDefs.h"
+
+#include <functional>
+
+class CalypFrame;
+class CalypModuleIf;
+class CalypFrameQueue;
+
+/**
+ * \class    CalypToolsPipeline
+ * \brief    Chain of processing modules with the frames passed in memory
+ *
+ * Each stage runs on its own thread. Stages are connected by bounded
+ * queues of frames, so a slow stage stalls the previous ones instead of
+ * accumulating frames. Modules are created with the first frames they
+ * receive
+ */
+class CalypToolsPipeline
+{
+public:
+  /**
+   * Provide the input frames of the first stage (called on the reader
+   * thread). The frames are copied. Returning false ends the stream
+   */
+  typedef std::function<bool( std::vector<CalypFrame*>& )> SourceFn;
+  /**
+   * Consume the frames of the last stage (called on the caller thread).
+   * Returning false stops the pipeline
+   */
+  typedef std::function<bool( std::vector<CalypFrame*>& )> SinkFn;
+
+  /**
+   * @param uiQueueSize number of frames each queue holds
+   */
+  CalypToolsPipeline( unsigned int uiQueueSize );
+  ~CalypToolsPipeline();
+
+  /**
+   * Append a processing module (the pipeline destroys it)
+   */
+  void addStage( CalypModuleIf* pcModule );
+  unsigned int size() const { return m_apcStages.size(); }
+
+  /**
+   * Run all the frames through the chain
+   * @return false if the sink stopped the pipeline
+   * Errors of any stage are thrown (CalypFailure) on the caller thread
+   */
+  bool run( SourceFn pfSource, SinkFn pfSink );
+
+private:
+  void runSource( SourceFn pfSource, CalypFrameQueue* pcOutput );
+  void createStage( unsigned int uiStage, std::vector<CalypFrame*>& apcFrames );
+  void runStage( unsigned int uiStage, CalypFrameQueue* pcInput, CalypFrameQueue* pcOutput );
+  void runBatchStage( unsigned int uiStage, CalypFrameQueue* pcInput, CalypFrameQueue* pcOutput );
+
+  unsigned int m_uiQueueSize;
+  std::vector<CalypModuleIf*> m_apcStages;
+  std::vector<char> m_abCreated;  //!< Written by the thread of each stage
+};
+
+#endif  // __CALYPTOOLSPIPELINE_H__